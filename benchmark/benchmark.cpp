@@ -0,0 +1,520 @@
+// Only defines the REAPER API function pointers reaper.cpp links against, they stay null since the plugin runs on SimulatedReaper
+#define REAPERAPI_IMPLEMENT
+
+#include "guitar_pro.h"
+#include "memory_dump.h"
+#include "memory_source.h"
+#include "plugin.h"
+#include "process_reader.h"
+#include "profiler.h"
+#include "signature_scanner.h"
+#include "simulated_reaper.h"
+#include "synthetic_guitar_pro.h"
+
+#include <WDL/wdltypes.h> // Must be included before reaper_plugin_functions
+#include <reaper_plugin_functions.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace tnt;
+
+// REAPER calls MainLoop 30 times/second
+static constexpr double TICK_INTERVAL = 1.0 / 30.0; // Seconds
+static constexpr auto SIMULATED_TICK_INTERVAL = std::chrono::duration_cast<SimulatedReaper::Clock::duration>(std::chrono::duration<double>(TICK_INTERVAL));
+
+static constexpr double SIMULATED_OUTPUT_LATENCY = 0.01; // Seconds
+
+static constexpr int DEFAULT_ITERATIONS = 10000;
+static constexpr int WARMUP_ITERATIONS = 100;
+static constexpr double DEFAULT_BUDGET = 33.0; // Milliseconds
+
+// Audio hook simulation
+static constexpr int AUDIO_BLOCKS_PER_TICK = 3;
+static constexpr int AUDIO_BLOCK_SIZE = 512;
+static constexpr double AUDIO_SAMPLE_RATE = 48000.0;
+
+// Signature scans read the whole code section so they get fewer iterations
+static constexpr int SIGNATURE_SCAN_ITERATION_DIVISOR = 100;
+
+// Every allocation made by the process, sampled around each tick
+static std::atomic<std::size_t> g_allocation_count = 0;
+
+void* operator new(std::size_t size)
+{
+    g_allocation_count.fetch_add(1, std::memory_order_relaxed);
+
+    if (void* pointer = std::malloc(size ? size : 1))
+    {
+        return pointer;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+// Counts the system calls the live backends would make for the same reads
+// Win32 issues one ReadProcessMemory per region, Linux batches every region into one process_vm_readv
+class CountingMemorySource final : public MemorySource
+{
+public:
+    CountingMemorySource(std::unique_ptr<MemorySource> memory_source, std::size_t& syscall_count)
+        : m_memory_source(std::move(memory_source))
+        , m_syscall_count(syscall_count)
+    {}
+
+    std::string GetName() const override
+    {
+        return m_memory_source->GetName();
+    }
+
+    const std::wstring& GetProcessVersion() const override
+    {
+        return m_memory_source->GetProcessVersion();
+    }
+
+    std::uintptr_t GetModuleBaseAddress() const override
+    {
+        return m_memory_source->GetModuleBaseAddress();
+    }
+
+    bool IsProcessRunning() const override
+    {
+        // WaitForSingleObject or kill
+        m_syscall_count++;
+        return m_memory_source->IsProcessRunning();
+    }
+
+    bool Read(const std::uintptr_t address, void* buffer, const std::size_t size) override
+    {
+        m_syscall_count++;
+        return m_memory_source->Read(address, buffer, size);
+    }
+
+    bool ReadRegions(const std::vector<ReadPlan::Region>& regions, std::byte* buffer, std::uintptr_t& failed_address) override
+    {
+#ifdef __linux__
+        m_syscall_count++;
+#else
+        m_syscall_count += regions.size();
+#endif
+        return m_memory_source->ReadRegions(regions, buffer, failed_address);
+    }
+
+    std::string GetLastErrorMessage() const override
+    {
+        return m_memory_source->GetLastErrorMessage();
+    }
+
+private:
+    std::unique_ptr<MemorySource> m_memory_source;
+    std::size_t& m_syscall_count;
+};
+
+struct BenchmarkResult final
+{
+    std::string name;
+    int iterations = 0;
+    double p50 = 0.0;  // Microseconds
+    double p99 = 0.0;  // Microseconds
+    double max = 0.0;  // Microseconds
+    double mean = 0.0; // Microseconds
+    double syscalls_per_tick = 0.0;
+    double allocations_per_tick = 0.0;
+};
+
+// Runs tick repeatedly and collects its latency distribution
+// Between ticks advance moves the simulated applications forward, it is not part of the measurement
+static BenchmarkResult RunBenchmark(const std::string& name, const int iterations, const std::size_t& syscall_count, const std::function<void()>& tick, const std::function<void()>& advance)
+{
+    for (int i = 0; i < WARMUP_ITERATIONS; i++)
+    {
+        advance();
+        tick();
+    }
+
+    std::vector<double> durations;
+    durations.reserve(static_cast<std::size_t>(iterations));
+
+    std::size_t syscalls = 0;
+    std::size_t allocations = 0;
+
+    for (int i = 0; i < iterations; i++)
+    {
+        advance();
+
+        const std::size_t start_syscalls = syscall_count;
+        const std::size_t start_allocations = g_allocation_count.load(std::memory_order_relaxed);
+        const auto start = std::chrono::steady_clock::now();
+
+        tick();
+
+        const auto end = std::chrono::steady_clock::now();
+        allocations += g_allocation_count.load(std::memory_order_relaxed) - start_allocations;
+        syscalls += syscall_count - start_syscalls;
+
+        durations.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+    }
+
+    std::sort(durations.begin(), durations.end());
+
+    BenchmarkResult result;
+    result.name = name;
+    result.iterations = iterations;
+    result.p50 = durations[durations.size() / 2];
+    result.p99 = durations[std::min(durations.size() - 1, durations.size() * 99 / 100)];
+    result.max = durations.back();
+    for (const double duration : durations)
+    {
+        result.mean += duration / static_cast<double>(durations.size());
+    }
+    result.syscalls_per_tick = static_cast<double>(syscalls) / iterations;
+    result.allocations_per_tick = static_cast<double>(allocations) / iterations;
+
+    return result;
+}
+
+// Guitar Pro playback at the given rate, cursor moving forward in real time
+static void AdvancePlayback(SyntheticGuitarPro& guitar_pro, double& play_position, const double play_rate)
+{
+    play_position += TICK_INTERVAL * play_rate;
+    guitar_pro.SetPlayPosition(play_position);
+}
+
+static std::unique_ptr<SimulatedReaper> CreateSimulatedReaper(const bool profile)
+{
+    auto simulated_reaper = std::make_unique<SimulatedReaper>();
+    simulated_reaper->SetOutputLatency(SIMULATED_OUTPUT_LATENCY);
+
+    // Plugin::Start enables the profiler from ExtState
+    if (profile)
+    {
+        simulated_reaper->SetExtState(EXT_STATE_SECTION, PROFILER_KEY, "1");
+    }
+
+    return simulated_reaper;
+}
+
+static std::vector<BenchmarkResult> RunBenchmarks(const int iterations, const bool profile, const std::filesystem::path& memory_dump_path)
+{
+    Profiler::SetEnabled(profile);
+
+    std::vector<BenchmarkResult> results;
+    std::size_t syscall_count = 0;
+
+    SyntheticGuitarPro synthetic_guitar_pro;
+    synthetic_guitar_pro.SetTimeSelection(10.0, 20.0);
+    synthetic_guitar_pro.SetPlayRate(1.0);
+
+    const MemorySourceFactory counting_factory = [&] {
+        return std::make_unique<CountingMemorySource>(synthetic_guitar_pro.GetMemorySourceFactory()(), syscall_count);
+    };
+
+    double play_position = 0.0;
+    const auto advance_playback = [&] {
+        AdvancePlayback(synthetic_guitar_pro, play_position, 1.0);
+    };
+
+    // One full scan of the code section for the root pointer, as done once per unknown Guitar Pro build
+    {
+        static constexpr GuitarProLayout signature_layout = [] {
+            GuitarProLayout layout = GUITAR_PRO_LAYOUTS.back();
+            layout.root_signature = { "48 8B 05 ?? ?? ?? ?? 48 85 C0 74 ??", 3, 7 };
+            return layout;
+        }();
+
+        SyntheticGuitarPro scanned_guitar_pro(signature_layout);
+        ProcessReader process_reader(std::make_unique<CountingMemorySource>(scanned_guitar_pro.CreateMemorySource(), syscall_count));
+        const BytePattern pattern(signature_layout.root_signature.pattern);
+
+        const int scan_iterations = std::max(1, iterations / SIGNATURE_SCAN_ITERATION_DIVISOR);
+        results.push_back(RunBenchmark("signature_scan", scan_iterations, syscall_count, [&] {
+            if (process_reader.FindRipRelativeTarget(pattern, signature_layout.root_signature.displacement_offset, signature_layout.root_signature.instruction_size) != signature_layout.module_offset)
+            {
+                throw std::runtime_error("Signature scan did not find the root pointer.\n");
+            }
+        }, [] {}));
+    }
+
+    // Raw cost of one Guitar Pro snapshot
+    {
+        GuitarPro guitar_pro(counting_factory);
+        results.push_back(RunBenchmark("read_process_memory", iterations, syscall_count, [&] { guitar_pro.ReadProcessMemory(); }, advance_playback));
+    }
+
+    {
+        GuitarPro guitar_pro(counting_factory);
+        guitar_pro.SetConsistentReads(true);
+        results.push_back(RunBenchmark("read_process_memory_consistent", iterations, syscall_count, [&] { guitar_pro.ReadProcessMemory(); }, advance_playback));
+    }
+
+    // Same image read back from a memory-mapped dump
+    {
+        const std::filesystem::path dump_path = std::filesystem::temp_directory_path() / "guitar_pro_sync_benchmark.dmp";
+        synthetic_guitar_pro.SaveMemoryDump(dump_path);
+
+        GuitarPro guitar_pro([&]() -> std::unique_ptr<MemorySource> {
+            return std::make_unique<CountingMemorySource>(std::make_unique<MemoryDump>(dump_path), syscall_count);
+        });
+        results.push_back(RunBenchmark("read_memory_dump", iterations, syscall_count, [&] { guitar_pro.ReadProcessMemory(); }, [] {}));
+
+        std::error_code error;
+        std::filesystem::remove(dump_path, error);
+    }
+
+    // Dump captured from a real Guitar Pro process, exercises its actual layout and pointer chains
+    if (!memory_dump_path.empty())
+    {
+        GuitarPro guitar_pro([&]() -> std::unique_ptr<MemorySource> {
+            return std::make_unique<CountingMemorySource>(std::make_unique<MemoryDump>(memory_dump_path), syscall_count);
+        });
+        results.push_back(RunBenchmark("read_captured_memory_dump", iterations, syscall_count, [&] { guitar_pro.ReadProcessMemory(); }, [] {}));
+    }
+
+    // Full sync pass while both applications play
+    {
+        PluginState plugin_state;
+        const auto simulated_reaper = CreateSimulatedReaper(profile);
+        Plugin plugin(plugin_state, counting_factory, simulated_reaper->CreateBackend());
+
+        synthetic_guitar_pro.SetPlayState(true);
+        results.push_back(RunBenchmark("main_loop_playing", iterations, syscall_count, [&] { plugin.MainLoop(); }, [&] {
+            advance_playback();
+            simulated_reaper->Advance(SIMULATED_TICK_INTERVAL);
+        }));
+    }
+
+    // Full sync pass while both applications are paused
+    {
+        PluginState plugin_state;
+        const auto simulated_reaper = CreateSimulatedReaper(profile);
+        Plugin plugin(plugin_state, counting_factory, simulated_reaper->CreateBackend());
+
+        synthetic_guitar_pro.SetPlayState(false);
+        results.push_back(RunBenchmark("main_loop_paused", iterations, syscall_count, [&] { plugin.MainLoop(); }, [&] { simulated_reaper->Advance(SIMULATED_TICK_INTERVAL); }));
+    }
+
+    // Full sync pass while the user keeps switching scores in Guitar Pro
+    {
+        PluginState plugin_state;
+        const auto simulated_reaper = CreateSimulatedReaper(profile);
+        Plugin plugin(plugin_state, counting_factory, simulated_reaper->CreateBackend());
+
+        synthetic_guitar_pro.SetPlayState(false);
+        results.push_back(RunBenchmark("main_loop_document_switch", iterations, syscall_count, [&] { plugin.MainLoop(); }, [&] {
+            synthetic_guitar_pro.ReplaceDocument();
+            simulated_reaper->Advance(SIMULATED_TICK_INTERVAL);
+        }));
+    }
+
+    // Full sync pass with REAPER's position sampled for every audio block, 3 blocks per tick at 48 kHz and 512 samples
+    {
+        PluginState plugin_state;
+        const auto simulated_reaper = CreateSimulatedReaper(profile);
+        simulated_reaper->SetExtState(EXT_STATE_SECTION, AUDIO_HOOK_KEY, "1");
+        Plugin plugin(plugin_state, counting_factory, simulated_reaper->CreateBackend());
+
+        synthetic_guitar_pro.SetPlayState(true);
+        plugin.Start();
+
+        results.push_back(RunBenchmark("main_loop_audio_hook", iterations, syscall_count, [&] { plugin.MainLoop(); }, [&] {
+            advance_playback();
+            simulated_reaper->Advance(SIMULATED_TICK_INTERVAL);
+            for (int i = 0; i < AUDIO_BLOCKS_PER_TICK; i++)
+            {
+                plugin.OnAudioBuffer(false, AUDIO_BLOCK_SIZE, AUDIO_SAMPLE_RATE);
+            }
+        }));
+
+        plugin.Stop();
+    }
+
+    // Full sync pass with Guitar Pro read on the background polling thread, only the snapshot handoff is left on the tick
+    // The synthetic image isn't thread safe so Guitar Pro holds still and the polling thread's reads aren't counted
+    {
+        PluginState plugin_state;
+        const auto simulated_reaper = CreateSimulatedReaper(profile);
+        simulated_reaper->SetExtState(EXT_STATE_SECTION, BACKGROUND_POLLING_RATE_KEY, "1000");
+        Plugin plugin(plugin_state, synthetic_guitar_pro.GetMemorySourceFactory(), simulated_reaper->CreateBackend());
+
+        synthetic_guitar_pro.SetPlayState(true);
+        plugin.Start();
+
+        // Let the first snapshot arrive
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+        results.push_back(RunBenchmark("main_loop_background_polling", iterations, syscall_count, [&] { plugin.MainLoop(); }, [&] { simulated_reaper->Advance(SIMULATED_TICK_INTERVAL); }));
+
+        plugin.Stop();
+    }
+
+    // Full sync pass while Guitar Pro is not running
+    {
+        PluginState plugin_state;
+        const auto simulated_reaper = CreateSimulatedReaper(profile);
+        Plugin plugin(plugin_state, counting_factory, simulated_reaper->CreateBackend());
+
+        synthetic_guitar_pro.SetRunning(false);
+        results.push_back(RunBenchmark("main_loop_guitar_pro_closed", iterations, syscall_count, [&] { plugin.MainLoop(); }, [&] { simulated_reaper->Advance(SIMULATED_TICK_INTERVAL); }));
+        synthetic_guitar_pro.SetRunning(true);
+    }
+
+    return results;
+}
+
+static void WriteResults(const std::filesystem::path& path, const std::vector<BenchmarkResult>& results, const double budget)
+{
+    std::ofstream file(path, std::ios::trunc);
+
+    file << "{\n";
+    file << std::format("  \"budget_ms\": {:.3f},\n", budget);
+    file << "  \"benchmarks\": [\n";
+
+    for (std::size_t i = 0; i < results.size(); i++)
+    {
+        const BenchmarkResult& result = results[i];
+        file << std::format("    {{\"name\": \"{}\", \"iterations\": {}, \"p50_us\": {:.3f}, \"p99_us\": {:.3f}, \"max_us\": {:.3f}, \"mean_us\": {:.3f}, \"syscalls_per_tick\": {:.3f}, \"allocations_per_tick\": {:.3f}}}{}\n",
+            result.name, result.iterations, result.p50, result.p99, result.max, result.mean, result.syscalls_per_tick, result.allocations_per_tick, i + 1 < results.size() ? "," : "");
+    }
+
+    file << "  ]\n";
+    file << "}\n";
+
+    if (!file)
+    {
+        throw std::runtime_error(std::format("Failed to write benchmark results to '{}'.\n", path.string()));
+    }
+}
+
+static void PrintUsage()
+{
+    std::cerr << "Usage: GuitarProSyncBenchmark [--iterations N] [--budget-ms MS] [--output results.json] [--profile trace.json] [--memory-dump dump.dmp]\n";
+    std::cerr << "       GuitarProSyncBenchmark --capture-memory-dump dump.dmp\n";
+}
+
+int main(int argc, char* argv[])
+{
+    int iterations = DEFAULT_ITERATIONS;
+    double budget = DEFAULT_BUDGET;
+    std::filesystem::path output_path;
+    std::filesystem::path profile_path;
+    std::filesystem::path memory_dump_path;
+    std::filesystem::path capture_path;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string argument = argv[i];
+        if (i + 1 >= argc)
+        {
+            PrintUsage();
+            return 2;
+        }
+
+        if (argument == "--iterations")
+        {
+            iterations = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (argument == "--budget-ms")
+        {
+            budget = std::atof(argv[++i]);
+        }
+        else if (argument == "--output")
+        {
+            output_path = argv[++i];
+        }
+        else if (argument == "--profile")
+        {
+            profile_path = argv[++i];
+        }
+        else if (argument == "--memory-dump")
+        {
+            memory_dump_path = argv[++i];
+        }
+        else if (argument == "--capture-memory-dump")
+        {
+            capture_path = argv[++i];
+        }
+        else
+        {
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    try
+    {
+        // Needs the running Guitar Pro process, the dump can then be benchmarked anywhere with --memory-dump
+        if (!capture_path.empty())
+        {
+            GuitarPro().CaptureMemoryDump(capture_path);
+            std::cout << std::format("Saved Guitar Pro memory dump to '{}'.\n", capture_path.string());
+            return 0;
+        }
+
+        const std::vector<BenchmarkResult> results = RunBenchmarks(iterations, !profile_path.empty(), memory_dump_path);
+
+        std::cout << std::format("{:<32}{:>12}{:>12}{:>12}{:>14}{:>14}\n", "benchmark", "p50 (us)", "p99 (us)", "max (us)", "syscalls/tick", "allocs/tick");
+
+        bool over_budget = false;
+        for (const BenchmarkResult& result : results)
+        {
+            std::cout << std::format("{:<32}{:>12.3f}{:>12.3f}{:>12.3f}{:>14.2f}{:>14.2f}\n", result.name, result.p50, result.p99, result.max, result.syscalls_per_tick, result.allocations_per_tick);
+            over_budget = over_budget || result.p99 > budget * 1000.0;
+        }
+
+        if (!output_path.empty())
+        {
+            WriteResults(output_path, results, budget);
+        }
+
+        if (!profile_path.empty())
+        {
+            std::ofstream file(profile_path, std::ios::binary | std::ios::trunc);
+            file << Profiler::ExportChromeTrace();
+            if (!file)
+            {
+                throw std::runtime_error(std::format("Failed to write profile '{}'.\n", profile_path.string()));
+            }
+        }
+
+        if (over_budget)
+        {
+            std::cerr << std::format("p99 tick latency exceeds the {} ms budget.\n", budget);
+            return 1;
+        }
+    }
+    catch (const std::exception& error)
+    {
+        std::cerr << error.what();
+        return 1;
+    }
+
+    return 0;
+}
@@ -25,3 +25,18 @@ if(NOT WIN32)
 endif()
 
 add_library(WDL::WDL ALIAS wdl)
+
+# The zlib copy that ships with WDL, only the parts needed to inflate zip entries
+add_library(wdl_zlib STATIC
+  ${WDL_DIR}/zlib/adler32.c
+  ${WDL_DIR}/zlib/crc32.c
+  ${WDL_DIR}/zlib/inffast.c
+  ${WDL_DIR}/zlib/inflate.c
+  ${WDL_DIR}/zlib/inftrees.c
+  ${WDL_DIR}/zlib/zutil.c
+)
+
+set_target_properties(wdl_zlib PROPERTIES POSITION_INDEPENDENT_CODE ON)
+target_include_directories(wdl_zlib INTERFACE ${WDL_INCLUDE_DIR})
+
+add_library(WDL::zlib ALIAS wdl_zlib)
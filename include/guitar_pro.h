@@ -1,6 +1,11 @@
 #pragma once
 
+#include "memory_source.h"
+
+#include <chrono>
+#include <filesystem>
 #include <memory>
+#include <stdexcept>
 
 namespace tnt {
 
@@ -26,19 +31,64 @@ struct GuitarProState final
 
     // Loop state
     bool loop_state = false;
+
+    // Monotonic time at which every field above was read
+    std::chrono::steady_clock::time_point timestamp;
 };    
 
+struct GuitarProEvents;
+
+// Thrown instead of a read error while Guitar Pro is still being looked for in the background
+// Nothing failed yet, the read can simply be tried again later
+class GuitarProAttachPending final : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
 // Basic API to extract data from Guitar Pro
 class GuitarPro final
 {
 public:
+    // Reads from the running Guitar Pro process
     GuitarPro();
+
+    // Reads from whatever memory source the factory creates, e.g. a memory dump or a synthetic image
+    explicit GuitarPro(MemorySourceFactory memory_source_factory);
+
     ~GuitarPro();
 
-    // Reads program state from memory
+    // Reads program state from memory, stamped with the current time
     // Throws std::runtime_error on failure
     GuitarProState ReadProcessMemory();
 
+    // Stamped with the given time instead, e.g. from a simulated clock
+    // Events compare it against the previous read's timestamp, so all reads should come from the same clock
+    GuitarProState ReadProcessMemory(const std::chrono::steady_clock::time_point timestamp);
+
+    // What changed between the last successful read and the one before it, see guitar_pro_events.h
+    const GuitarProEvents& GetEvents() const;
+
+    // Reads every snapshot twice and retries until both reads match
+    // Guarantees cursor, loop and play state all come from the same moment at the cost of extra reads
+    void SetConsistentReads(const bool enabled);
+
+    // Looks for the process, reads its version and validates the offsets on a worker thread instead of the reading one
+    // Reads throw GuitarProAttachPending until the worker hands over a session, they never wait for it
+    void SetAsyncAttach(const bool enabled);
+
+    // Attaches again and saves every byte the attach and a read touch as a MemoryDump file, see memory_dump.h
+    // Makes reads of a real Guitar Pro build reproducible without the process, e.g. in the benchmark
+    // Throws std::runtime_error on failure
+    void CaptureMemoryDump(const std::filesystem::path& path);
+
+    // Offset database merged into the built-in version table, re-read on attach whenever the file changes
+    void SetOffsetDatabasePath(const std::filesystem::path& path);
+
+    // Re-reads the offset database and attaches again with the new layout
+    // Throws std::runtime_error if the file can't be parsed
+    void ReloadOffsetDatabase();
+
 private:
     struct Impl;
     std::unique_ptr<Impl> m_impl;
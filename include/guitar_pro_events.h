@@ -0,0 +1,62 @@
+#pragma once
+
+#include "guitar_pro.h"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace tnt {
+
+// Smallest changes that count, event detection and the sync logic work with the same steps
+static constexpr double MINIMUM_TIME_STEP = 0.001; // Seconds
+static constexpr double MINIMUM_PLAY_RATE_STEP = 0.001;
+
+// Transitions found by comparing a Guitar Pro snapshot with the one read before it
+enum class GuitarProEventType
+{
+    // The play position changed by more than the smallest step, for any reason including playback
+    CURSOR_MOVED,
+
+    // The play position changed by more than playback explains, e.g. the user clicked elsewhere
+    CURSOR_JUMPED,
+
+    PLAY_STARTED,
+    PLAY_STOPPED,
+    COUNT_IN_BEGAN,
+    LOOP_TOGGLED,
+    SELECTION_CHANGED,
+    RATE_CHANGED,
+
+    COUNT,
+};
+
+std::string_view ToString(const GuitarProEventType type);
+
+// Dirty bitmask of the events that happened since they were last consumed, with the time each was last seen
+// Trivially copyable so it can be handed between threads through a SeqLock
+struct GuitarProEvents final
+{
+    using Clock = std::chrono::steady_clock;
+
+    void Add(const GuitarProEventType type, const Clock::time_point timestamp);
+
+    // Keeps the union of both, the later timestamp wins
+    void Merge(const GuitarProEvents& events);
+
+    bool Has(const GuitarProEventType type) const;
+    bool Any() const;
+
+    // Timestamp of the latest occurrence, only meaningful if Has(type)
+    Clock::time_point GetTimestamp(const GuitarProEventType type) const;
+
+    std::uint32_t mask = 0;
+    std::array<Clock::time_point, static_cast<std::size_t>(GuitarProEventType::COUNT)> timestamps = {};
+};
+
+// Events between two consecutive snapshots, stamped with the time the newer one was read
+GuitarProEvents DetectGuitarProEvents(const GuitarProState& previous, const GuitarProState& state);
+
+}
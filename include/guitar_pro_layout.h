@@ -0,0 +1,216 @@
+#pragma once
+
+#include "guitar_pro.h"
+#include "pointer_chain.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace tnt {
+
+// Guitar Pro stores positions in samples at this rate
+static constexpr double SAMPLE_RATE = 44100.0;
+
+// Every value read from Guitar Pro is 32 bits wide
+static constexpr std::size_t GUITAR_PRO_FIELD_SIZE = 4;
+
+// Raw representation of a value in Guitar Pro memory
+enum class GuitarProFieldType
+{
+    INT32,
+    FLOAT32,
+    FLAG32,
+};
+
+// Describes where a GuitarProState member lives in Guitar Pro memory and how to decode it
+struct GuitarProField final
+{
+    // Key in the offset database
+    const char* name = "";
+
+    GuitarProFieldType type = GuitarProFieldType::INT32;
+    PointerChain pointer_chain;
+
+    // Destination for numeric fields, the raw value is multiplied by scale
+    double GuitarProState::* value = nullptr;
+    double scale = 1.0;
+
+    // Destination for flag fields, set when flag_bit is set in the raw value
+    bool GuitarProState::* flag = nullptr;
+    int flag_bit = 0;
+};
+
+template <typename T>
+constexpr GuitarProFieldType GetGuitarProFieldType()
+{
+    static_assert(sizeof(T) == GUITAR_PRO_FIELD_SIZE, "Guitar Pro fields are 32 bits wide");
+
+    if constexpr (std::is_same_v<T, std::int32_t>)
+    {
+        return GuitarProFieldType::INT32;
+    }
+    else if constexpr (std::is_same_v<T, float>)
+    {
+        return GuitarProFieldType::FLOAT32;
+    }
+    else
+    {
+        static_assert(std::is_same_v<T, std::uint32_t>, "Unsupported Guitar Pro field type");
+        return GuitarProFieldType::FLAG32;
+    }
+}
+
+// Numeric field of raw type T, decoded as raw * scale
+template <typename T>
+constexpr GuitarProField MakeValueField(const char* name, double GuitarProState::* value, const PointerChain& pointer_chain, const double scale = 1.0)
+{
+    static_assert(!std::is_same_v<T, std::uint32_t>, "Use MakeFlagField for flag containers");
+
+    GuitarProField field;
+    field.name = name;
+    field.type = GetGuitarProFieldType<T>();
+    field.pointer_chain = pointer_chain;
+    field.value = value;
+    field.scale = scale;
+    return field;
+}
+
+// Single bit of a 32 bit flag container
+template <int BIT>
+constexpr GuitarProField MakeFlagField(const char* name, bool GuitarProState::* flag, const PointerChain& pointer_chain)
+{
+    static_assert(BIT >= 0 && BIT < 32, "Flag bit must be inside the 32 bit flag container");
+
+    GuitarProField field;
+    field.name = name;
+    field.type = GetGuitarProFieldType<std::uint32_t>();
+    field.pointer_chain = pointer_chain;
+    field.flag = flag;
+    field.flag_bit = BIT;
+    return field;
+}
+
+// Addresses and offsets acquired from CheatEngine with Guitar Pro version 8.1.3 - Build 121
+// Every GuitarProState member read from Guitar Pro, adding a member only takes a descriptor here
+// Other layouts and the offset database reuse the decoding and only change the pointer chains
+inline constexpr std::array GUITAR_PRO_8_FIELDS = {
+    MakeValueField<std::int32_t>("play_position", &GuitarProState::play_position, { 0x18, 0xA0, 0x38, 0x1A8, 0x20, 0x1D8, 0x0 }, 1.0 / SAMPLE_RATE),
+    MakeValueField<std::int32_t>("time_selection_start_position", &GuitarProState::time_selection_start_position, { 0x18, 0xA0, 0x38, 0x1A8, 0x20, 0x1E0, 0x0 }, 1.0 / SAMPLE_RATE),
+    MakeValueField<std::int32_t>("time_selection_end_position", &GuitarProState::time_selection_end_position, { 0x18, 0xA0, 0x38, 0x1A8, 0x20, 0x1E0, 0x8 }, 1.0 / SAMPLE_RATE),
+    MakeValueField<float>("play_rate", &GuitarProState::play_rate, { 0x18, 0xA0, 0x38, 0x80, 0x18, 0x68, 0x28, 0x74 }),
+    MakeFlagField<8>("play_state", &GuitarProState::play_state, { 0x18, 0xA0, 0x38, 0x70, 0x30, 0x4E0, 0x0, 0x20, 0x20, 0x0 }),
+    MakeFlagField<8>("count_in_state", &GuitarProState::count_in_state, { 0x18, 0xE0, 0x0, 0x28, 0x10, 0x18, 0x60, 0x0 }),
+    MakeFlagField<8>("loop_state", &GuitarProState::loop_state, { 0x18, 0xA0, 0x38, 0x70, 0x30, 0x4B8, 0x28, 0x88, 0x80, 0x0 }),
+};
+
+static constexpr std::size_t GUITAR_PRO_FIELD_COUNT = GUITAR_PRO_8_FIELDS.size();
+
+// Instruction that loads the root pointer through a RIP-relative operand, e.g. mov rax, [rip + disp32]
+// Lets a signature scan find module_offset on builds that are missing from the offset database
+struct RootSignature final
+{
+    // Byte pattern of the instruction and its neighbours, see BytePattern
+    const char* pattern = nullptr;
+
+    // Position of the disp32 operand from the start of the pattern
+    std::size_t displacement_offset = 0;
+
+    // The operand is relative to the end of the instruction
+    std::size_t instruction_size = 0;
+};
+
+// Memory layout of a specific Guitar Pro version
+struct GuitarProLayout final
+{
+    const wchar_t* version = L"";
+
+    // Offset of the root pointer from the GPCore.dll base address
+    std::uintptr_t module_offset = 0;
+
+    // Prefix shared by most chains, re-checked on every read to detect Guitar Pro switching documents
+    PointerChain document_chain;
+
+    std::array<GuitarProField, GUITAR_PRO_FIELD_COUNT> fields;
+
+    // Optional, see RootSignature
+    RootSignature root_signature;
+};
+
+// Built-in layouts, the offset database can add to or override these without rebuilding
+inline constexpr std::array<GuitarProLayout, 2> GUITAR_PRO_LAYOUTS = {
+    GuitarProLayout{ L"8.1.3.121", 0x00A24F80, { 0x18, 0xA0, 0x38 }, GUITAR_PRO_8_FIELDS, {} },
+    GuitarProLayout{ L"8.1.4.43", 0x00A26F80, { 0x18, 0xA0, 0x38 }, GUITAR_PRO_8_FIELDS, {} },
+};
+
+// Compile time sanity checks for a layout
+constexpr bool IsValidGuitarProLayout(const GuitarProLayout& layout)
+{
+    if (layout.module_offset == 0 || layout.document_chain.empty())
+    {
+        return false;
+    }
+
+    if (layout.root_signature.pattern && layout.root_signature.displacement_offset + sizeof(std::int32_t) > layout.root_signature.instruction_size)
+    {
+        return false;
+    }
+
+    for (const GuitarProField& field : layout.fields)
+    {
+        // Every field decodes into exactly one member
+        if (field.pointer_chain.empty() || (field.value == nullptr) == (field.flag == nullptr))
+        {
+            return false;
+        }
+
+        if ((field.type == GuitarProFieldType::FLAG32) != (field.flag != nullptr))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Every field decodes into the same member as the built-in descriptor at its index, so no member is written twice
+constexpr bool MatchesGuitarProFields(const GuitarProLayout& layout)
+{
+    for (std::size_t i = 0; i < layout.fields.size(); i++)
+    {
+        const GuitarProField& field = layout.fields[i];
+        const GuitarProField& descriptor = GUITAR_PRO_8_FIELDS[i];
+        if (field.type != descriptor.type || field.value != descriptor.value || field.flag != descriptor.flag || field.flag_bit != descriptor.flag_bit)
+        {
+            return false;
+        }
+
+        for (std::size_t j = 0; j < i; j++)
+        {
+            if ((descriptor.value && descriptor.value == GUITAR_PRO_8_FIELDS[j].value) || (descriptor.flag && descriptor.flag == GUITAR_PRO_8_FIELDS[j].flag))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+constexpr bool AreValidGuitarProLayouts()
+{
+    for (const GuitarProLayout& layout : GUITAR_PRO_LAYOUTS)
+    {
+        if (!IsValidGuitarProLayout(layout) || !MatchesGuitarProFields(layout))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static_assert(AreValidGuitarProLayouts(), "Invalid built-in Guitar Pro layout");
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "guitar_pro.h"
+#include "guitar_pro_events.h"
+#include "poll_scheduler.h"
+
+#include <chrono>
+#include <memory>
+
+namespace tnt {
+
+// Slowest and fastest supported background polling rates
+static constexpr double MIN_POLLING_RATE = 250.0;  // Hz
+static constexpr double MAX_POLLING_RATE = 1000.0; // Hz
+
+// Reads Guitar Pro on a dedicated thread so the REAPER UI thread never waits for cross-process reads
+// Snapshots are handed over through a SeqLock, the UI thread picks up the latest one without locking
+class GuitarProPoller final
+{
+public:
+    // The GuitarPro instance is used exclusively by the polling thread while it runs
+    GuitarProPoller(GuitarPro& guitar_pro);
+    ~GuitarProPoller();
+
+    GuitarProPoller(const GuitarProPoller&) = delete;
+    GuitarProPoller& operator=(const GuitarProPoller&) = delete;
+
+    // Starts polling at the given rate, clamped to MIN_POLLING_RATE..MAX_POLLING_RATE
+    void Start(const double rate);
+
+    // Stops the polling thread and waits for it to exit
+    void Stop();
+
+    bool IsRunning() const;
+
+    // The polling thread backs off like the timer does when Guitar Pro is idle or absent
+    PollState GetPollState() const;
+    std::chrono::steady_clock::duration GetPollInterval() const;
+
+    // Latest snapshot, the state timestamp tells when it was read
+    // Events are everything the polling thread saw since the previous call, none are lost between calls
+    // Returns false if nothing has been read yet
+    // Throws std::runtime_error with the read error if the latest read failed
+    bool GetLatestState(GuitarProState& state, GuitarProEvents& events);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+}
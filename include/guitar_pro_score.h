@@ -0,0 +1,53 @@
+#pragma once
+
+#include "tempo_map.h"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace tnt {
+
+// A master bar where Guitar Pro's playback leaves the order the bars are written in
+struct GuitarProPlaybackJump final
+{
+    enum class Type
+    {
+        REPEAT,
+        ALTERNATE_ENDING,
+        DIRECTION,
+    };
+
+    // Zero based
+    int bar = 0;
+    Type type = Type::REPEAT;
+};
+
+// The timing of a Guitar Pro score, everything else in the file is skipped
+struct GuitarProScore final
+{
+    // Time signature of every master bar in the order they are written
+    std::vector<TimeSignature> bars;
+
+    // Tempo automation of the master track, sorted by position
+    std::vector<BarTempo> tempos;
+
+    // Repeat signs, alternate endings and directions (e.g. D.C. al Coda), sorted by bar
+    // The tempo map only follows the written order, so it matches playback up to the first one
+    std::vector<GuitarProPlaybackJump> playback_jumps;
+
+    TempoMap GetTempoMap() const;
+
+    // One REAPER marker per tempo or time signature change, combined where both change at once
+    std::vector<TempoMarker> GetTempoMarkers() const;
+};
+
+// Bars are counted from 1 like Guitar Pro does, e.g. "Bar 5 has a repeat sign"
+std::string ToString(const GuitarProPlaybackJump& playback_jump);
+
+// Reads the score.gpif inside a Guitar Pro 7/8 .gp file in a single streaming pass
+// Repeats aren't unrolled, bars are taken in the order they are written and the jumps are only listed
+// Throws std::runtime_error if the file isn't a .gp file or its score can't be parsed
+GuitarProScore ReadGuitarProScore(const std::filesystem::path& path);
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "reaper.h"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace tnt {
+
+// Used until the latency calibration action has been run
+static constexpr double DEFAULT_SEEK_LATENCY = 0.05; // Seconds
+
+// Measured delay between a seek and REAPER playing from the new position, per play rate
+class LatencyTable final
+{
+public:
+    // Parses the format written by Serialize, e.g. "output_latency=0.0107;0.5=0.0612;1=0.0583"
+    // Returns std::nullopt if the text is malformed
+    static std::optional<LatencyTable> Parse(const std::string_view text);
+
+    std::string Serialize() const;
+
+    bool empty() const;
+
+    // Adds or replaces the latency measured at the given play rate
+    void Set(const double play_rate, const double latency);
+
+    // Seek latency in seconds, interpolated between the calibrated play rates
+    // Falls back to DEFAULT_SEEK_LATENCY if nothing was calibrated
+    // Shifted by however much the output latency changed since calibrating, e.g. after switching audio devices
+    double GetLatency(const double play_rate, const double output_latency) const;
+
+    // REAPER's output latency at the time of calibration
+    double GetOutputLatency() const;
+    void SetOutputLatency(const double output_latency);
+
+private:
+    // Sorted by play rate
+    std::vector<std::pair<double, double>> m_latencies;
+    double m_output_latency = 0.0;
+};
+
+// Measures the seek latency by doing a series of controlled seeks at several play rates
+// Runs a little on every call to Tick so it never blocks REAPER, sync must be paused meanwhile
+class LatencyCalibrator final
+{
+public:
+    LatencyCalibrator(Reaper& reaper);
+    ~LatencyCalibrator();
+
+    // Remembers the transport state and starts the first seek
+    void Start();
+
+    // Restores the transport state and discards the measurements
+    void Cancel();
+
+    bool IsRunning() const;
+
+    // Advances the calibration, returns false once it is finished
+    bool Tick();
+
+    // Table measured by the last completed calibration
+    // Throws std::runtime_error if it failed, e.g. because REAPER never started playing
+    LatencyTable GetResult() const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+}
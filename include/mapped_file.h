@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <string>
+
+namespace tnt {
+
+// Read-only memory mapping of a whole file
+class MappedFile final
+{
+public:
+    // The description names the kind of file in error messages, e.g. "memory dump"
+    // Throws std::runtime_error if the file can't be opened, is empty or can't be mapped
+    MappedFile(const std::filesystem::path& path, const std::string& description);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Valid for the lifetime of the MappedFile
+    std::span<const std::byte> GetData() const;
+
+private:
+    const std::byte* m_data = nullptr;
+    std::size_t m_size = 0;
+
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#endif
+};
+
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "memory_source.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tnt {
+
+// Block of captured memory
+struct MemoryDumpRegion final
+{
+    std::uintptr_t address = 0;
+    const std::byte* data = nullptr;
+    std::size_t size = 0;
+};
+
+// Memory source backed by a memory-mapped dump file so captured Guitar Pro memory can be read without the process
+//
+// File layout (little endian):
+//   char     magic[8]            "TNTGPMEM"
+//   uint32   format_version
+//   uint32   region_count
+//   uint64   module_base_address
+//   char     process_version[32] UTF-8, NUL padded
+//   region_count x { uint64 address, uint64 size, uint64 file_offset } sorted by address
+//   raw region bytes
+class MemoryDump final : public MemorySource
+{
+public:
+    // Maps the dump file
+    // Throws std::runtime_error if the file can't be mapped or is not a valid dump
+    explicit MemoryDump(const std::filesystem::path& path);
+    ~MemoryDump() override;
+
+    MemoryDump(const MemoryDump&) = delete;
+    MemoryDump& operator=(const MemoryDump&) = delete;
+
+    // Writes a dump file that can be opened with MemoryDump
+    // Throws std::runtime_error on failure
+    static void Save(const std::filesystem::path& path, const std::wstring& process_version, const std::uintptr_t module_base_address, std::vector<MemoryDumpRegion> regions);
+
+    std::string GetName() const override;
+
+    const std::wstring& GetProcessVersion() const override;
+
+    std::uintptr_t GetModuleBaseAddress() const override;
+
+    // A dump never goes away
+    bool IsProcessRunning() const override;
+
+    bool Read(const std::uintptr_t address, void* buffer, const std::size_t size) override;
+
+    std::string GetLastErrorMessage() const override;
+
+    // Direct pointer into the mapped file, or nullptr if the range is not in the dump
+    // Valid for the lifetime of the MemoryDump
+    const std::byte* GetPointer(const std::uintptr_t address, const std::size_t size) const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+// Forwards to another memory source and keeps a copy of every byte read through it
+// Attaching and reading once through the recorder captures exactly what a later MemoryDump needs to be read the same way
+class MemoryDumpRecorder final : public MemorySource
+{
+public:
+    explicit MemoryDumpRecorder(std::unique_ptr<MemorySource> memory_source);
+
+    MemoryDumpRecorder(const MemoryDumpRecorder&) = delete;
+    MemoryDumpRecorder& operator=(const MemoryDumpRecorder&) = delete;
+
+    std::string GetName() const override;
+
+    const std::wstring& GetProcessVersion() const override;
+
+    std::uintptr_t GetModuleBaseAddress() const override;
+
+    bool IsProcessRunning() const override;
+
+    bool Read(const std::uintptr_t address, void* buffer, const std::size_t size) override;
+
+    std::string GetLastErrorMessage() const override;
+
+    // Writes everything read so far as a dump file, overlapping and adjacent reads are merged into one region
+    // Throws std::runtime_error on failure
+    void Save(const std::filesystem::path& path) const;
+
+private:
+    std::unique_ptr<MemorySource> m_memory_source;
+
+    // Every successful read in the order it was made, a later read of the same address wins
+    std::vector<std::pair<std::uintptr_t, std::vector<std::byte>>> m_reads;
+};
+
+}
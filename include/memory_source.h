@@ -0,0 +1,58 @@
+#pragma once
+
+#include "read_plan.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tnt {
+
+// Anything Guitar Pro memory can be read from: the live process, a captured dump or a synthetic image
+class MemorySource
+{
+public:
+    virtual ~MemorySource() = default;
+
+    // Human readable name used in error messages
+    virtual std::string GetName() const = 0;
+
+    // File version of the Guitar Pro executable, e.g. "8.1.3.121"
+    virtual const std::wstring& GetProcessVersion() const = 0;
+
+    virtual std::uintptr_t GetModuleBaseAddress() const = 0;
+
+    // Cheap liveness check, sources that can't go away always return true
+    virtual bool IsProcessRunning() const = 0;
+
+    // Returns false if the memory could not be read
+    virtual bool Read(const std::uintptr_t address, void* buffer, const std::size_t size) = 0;
+
+    // Reads every region into its place in buffer
+    // Returns false and sets failed_address if any region could not be read
+    virtual bool ReadRegions(const std::vector<ReadPlan::Region>& regions, std::byte* buffer, std::uintptr_t& failed_address)
+    {
+        for (const ReadPlan::Region& region : regions)
+        {
+            if (!this->Read(region.address, buffer + region.buffer_offset, region.size))
+            {
+                failed_address = region.address;
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Description of the last failed read
+    virtual std::string GetLastErrorMessage() const = 0;
+};
+
+// Creates a new memory source every time GuitarPro (re)attaches
+// Throws std::runtime_error if the source is not available
+using MemorySourceFactory = std::function<std::unique_ptr<MemorySource>()>;
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "guitar_pro_layout.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+namespace tnt {
+
+// Guitar Pro layouts by version, so a Guitar Pro update only needs a new database entry instead of a rebuild
+//
+// Starts out with the built-in GUITAR_PRO_LAYOUTS, entries in the database file add to or override them.
+// The file is plain text, one key and its values per line, '#' starts a comment:
+//
+//   version 8.1.4.43                  starts a new entry
+//   module_hash 5F1A2B3C00C8E000      optional, PE TimeDateStamp and SizeOfImage of GPCore.dll in hex
+//   module_offset 0x00A26F80
+//   document_chain 0x18 0xA0 0x38
+//   root_signature 3 7 48 8B 05 ?? ?? ?? ?? 48 85 C0   optional, see RootSignature (displacement offset, instruction size, pattern)
+//   play_position 0x18 0xA0 ...       one line per GUITAR_PRO_8_FIELDS name, decoded like the built-in field
+//
+// Layouts found by signature scans are appended to a cache file next to the database (<name>.cache.txt)
+class OffsetDatabase final
+{
+public:
+    OffsetDatabase();
+    ~OffsetDatabase();
+
+    OffsetDatabase(const OffsetDatabase&) = delete;
+    OffsetDatabase& operator=(const OffsetDatabase&) = delete;
+
+    // Database file to merge into the built-in layouts, it is fine if it does not exist
+    // The signature scan cache is stored next to it
+    void SetPath(const std::filesystem::path& path);
+
+    const std::filesystem::path& GetPath() const;
+
+    // Reloads the file if it changed since it was last loaded, cheap enough to call on every attach
+    // Throws std::runtime_error if the file can't be parsed, the previous entries of that file are kept in that case
+    // and the built-in layouts and the other file are still used
+    void Refresh();
+
+    // Reloads the file even if it did not change
+    // Throws std::runtime_error under the same conditions as Refresh
+    void Reload();
+
+    // O(1) lookup, entries matching the module hash take precedence over entries matching the version
+    // The returned layout stays valid after the database is reloaded
+    // Returns nullptr if neither is known
+    std::shared_ptr<const GuitarProLayout> Find(const std::wstring& version, const std::uint64_t module_hash) const;
+
+    // Newest layout with a root signature, used as the template for builds that are not in the database
+    // Returns nullptr if no layout has a signature
+    std::shared_ptr<const GuitarProLayout> FindSignatureLayout() const;
+
+    // Adds a layout found by a signature scan and appends it to the cache file so the scan never runs again for this build
+    std::shared_ptr<const GuitarProLayout> AddScannedLayout(const std::wstring& version, const std::uint64_t module_hash, const GuitarProLayout& layout);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+}
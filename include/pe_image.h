@@ -0,0 +1,38 @@
+#pragma once
+
+#include "memory_source.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace tnt {
+
+struct PeSection final
+{
+    // Relative to the image base
+    std::uint32_t virtual_address = 0;
+    std::uint32_t virtual_size = 0;
+
+    bool executable = false;
+};
+
+// Fields of a mapped PE image header (e.g. GPCore.dll) read straight from memory
+struct PeImage final
+{
+    std::uint32_t time_date_stamp = 0;
+    std::uint32_t size_of_image = 0;
+    std::vector<PeSection> sections;
+
+    // Identifies one specific build of the image the same way symbol servers do
+    // Unlike the executable version it changes whenever the DLL is rebuilt
+    std::uint64_t GetModuleHash() const
+    {
+        return (static_cast<std::uint64_t>(time_date_stamp) << 32) | size_of_image;
+    }
+};
+
+// Reads the PE header and section table of the image mapped at base_address
+// Returns false if the memory does not hold a valid PE header
+bool ReadPeImage(MemorySource& memory_source, const std::uintptr_t base_address, PeImage& image);
+
+}
@@ -1,16 +1,45 @@
 #pragma once
 
+#include "memory_source.h"
+#include "reaper_backend.h"
+
+#include <filesystem>
 #include <memory>
 #include <reaper_plugin.h>
 
 namespace tnt {
 
+struct GuitarProState;
+struct PositionEstimate;
+
+// Persistent settings, e.g. SetExtState("TNT_GUITAR_PRO_SYNC", "background_polling_rate", "500", true)
+static constexpr const char* EXT_STATE_SECTION = "TNT_GUITAR_PRO_SYNC";
+static constexpr const char* BACKGROUND_POLLING_RATE_KEY = "background_polling_rate"; // Hz, empty or 0 polls on the REAPER timer
+static constexpr const char* LATENCY_CALIBRATION_KEY = "latency_calibration";          // Written by the calibration action
+static constexpr const char* AUDIO_HOOK_KEY = "audio_hook";                            // 1 measures drift on the audio thread
+static constexpr const char* TRACE_PATH_KEY = "trace_path";                            // Records a trace of every sync session to this file
+static constexpr const char* PROFILER_KEY = "profiler";                                // 1 records hot path spans for the metrics export
+
 struct PluginState final
 {
     REAPER_PLUGIN_HINSTANCE hinstance = nullptr;
     int command_id = 0;
     bool action_state = false;
     custom_action_register_t action = {0, "TNT_GUITAR_PRO_SYNC_COMMAND", "TNT: Toggle Guitar Pro sync", nullptr};
+    int reload_offsets_command_id = 0;
+    custom_action_register_t reload_offsets_action = {0, "TNT_GUITAR_PRO_SYNC_RELOAD_OFFSETS", "TNT: Reload Guitar Pro offset database", nullptr};
+    int calibrate_latency_command_id = 0;
+    custom_action_register_t calibrate_latency_action = {0, "TNT_GUITAR_PRO_SYNC_CALIBRATE_LATENCY", "TNT: Calibrate Guitar Pro sync seek latency", nullptr};
+    int export_metrics_command_id = 0;
+    custom_action_register_t export_metrics_action = {0, "TNT_GUITAR_PRO_SYNC_EXPORT_METRICS", "TNT: Export Guitar Pro sync metrics", nullptr};
+    int import_tempo_map_command_id = 0;
+    custom_action_register_t import_tempo_map_action = {0, "TNT_GUITAR_PRO_SYNC_IMPORT_TEMPO_MAP", "TNT: Import tempo map from Guitar Pro file", nullptr};
+    int check_tempo_map_command_id = 0;
+    custom_action_register_t check_tempo_map_action = {0, "TNT_GUITAR_PRO_SYNC_CHECK_TEMPO_MAP", "TNT: Check tempo map against Guitar Pro file", nullptr};
+    int capture_memory_dump_command_id = 0;
+    custom_action_register_t capture_memory_dump_action = {0, "TNT_GUITAR_PRO_SYNC_CAPTURE_MEMORY_DUMP", "TNT: Capture Guitar Pro memory dump", nullptr};
+    audio_hook_register_t audio_hook = {};
+    bool audio_hook_registered = false;
 };
     
 // Class for the plugin
@@ -18,10 +47,69 @@ class Plugin final
 {
 public:
     Plugin(PluginState& plugin_state);
+
+    // Syncs against whatever memory source the factory creates instead of the Guitar Pro process
+    Plugin(PluginState& plugin_state, MemorySourceFactory memory_source_factory);
+
+    // Also drives another REAPER backend instead of the running REAPER, e.g. a SimulatedReaper for headless runs
+    // Background polling stamps Guitar Pro snapshots with the real clock, simulated time only works with timer polling
+    Plugin(PluginState& plugin_state, MemorySourceFactory memory_source_factory, std::unique_ptr<ReaperBackend> reaper_backend);
+
     ~Plugin();
 
+    // Called when sync is toggled on/off
+    // Starts the background Guitar Pro polling thread if enabled in the "background_polling_rate" ExtState
+    // Records a trace until Stop if the "trace_path" ExtState is set, the file is overwritten every time
+    void Start();
+    void Stop();
+
+    // True if the "audio_hook" ExtState asks for REAPER's position to be sampled on the audio thread
+    // The audio hook must then be registered and forward every buffer to OnAudioBuffer until Stop
+    bool UsesAudioHook() const;
+
+    // Called on the audio thread, only records REAPER's transport position for the next MainLoop
+    void OnAudioBuffer(const bool is_post, const int length, const double sample_rate);
+
     void MainLoop();
 
+    // Offset database file used to look up Guitar Pro versions
+    void SetOffsetDatabasePath(const std::filesystem::path& path);
+
+    // Re-reads the offset database without restarting REAPER, errors are shown in the console
+    void ReloadOffsetDatabase();
+
+    // Sync metrics are exported to this path with .json and .csv extensions
+    void SetMetricsPath(const std::filesystem::path& path);
+
+    // Writes the metrics of the current or last sync session and publishes a summary to the "metrics" ExtState
+    // With the "profiler" ExtState set the recorded spans are written next to them as a Chrome trace
+    // Errors are shown in the console
+    void ExportMetrics();
+
+    // Saves the Guitar Pro memory a read touches so it can be read again without Guitar Pro, errors are shown in the console
+    void CaptureMemoryDump(const std::filesystem::path& path);
+
+    // Replaces REAPER's tempo map with the one of a Guitar Pro 7/8 .gp file in a single undo step
+    // Errors are shown in the console
+    void ImportTempoMap(const std::filesystem::path& path);
+
+    // Lists every bar in which REAPER's tempo map differs from the one of a .gp file in the console
+    void CheckTempoMap(const std::filesystem::path& path);
+
+    // Latest Guitar Pro state the sync loop read and how many seconds ago, never reads Guitar Pro itself
+    // Exactly as read, the sync logic's own adjustments don't show up here
+    // Returns false while sync is off or Guitar Pro isn't connected
+    bool GetCachedGuitarProState(GuitarProState& state, double& age) const;
+
+    // Guitar Pro's play position extrapolated to now from the cached reads, exact while Guitar Pro isn't playing
+    // Returns false under the same conditions as GetCachedGuitarProState
+    bool PredictGuitarProPosition(PositionEstimate& estimate) const;
+
+    // Measures how long REAPER takes to play from a new position, sync is paused until it finishes
+    // LatencyCalibrationLoop must then run on a timer until it returns false, the result is stored in ExtState
+    void StartLatencyCalibration();
+    bool LatencyCalibrationLoop();
+
 private:
     struct Impl;
     std::unique_ptr<Impl> m_impl;
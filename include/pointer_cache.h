@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tnt {
+
+// Cache of resolved pointer chain addresses
+// Chains are stored as a tree so that chains sharing a prefix also share the resolved intermediate addresses
+class PointerCache final
+{
+public:
+    static constexpr std::size_t ROOT = 0;
+    static constexpr std::size_t NOT_FOUND = static_cast<std::size_t>(-1);
+
+    PointerCache()
+    {
+        // Enough for every chain Guitar Pro needs so the tree never reallocates while reading
+        m_nodes.reserve(64);
+        this->Clear(0);
+    }
+
+    // Drops every resolved address and starts a new tree at the given root address
+    void Clear(const std::uintptr_t root_address)
+    {
+        m_nodes.clear();
+        m_nodes.push_back({ ROOT, 0, root_address });
+        m_generation++;
+    }
+
+    // Changes every time the cache is cleared so addresses resolved from it can tell when to resolve again
+    std::uint64_t GetGeneration() const
+    {
+        return m_generation;
+    }
+
+    std::uintptr_t GetRootAddress() const
+    {
+        return m_nodes[ROOT].address;
+    }
+
+    std::uintptr_t GetAddress(const std::size_t node) const
+    {
+        return m_nodes[node].address;
+    }
+
+    std::size_t GetParent(const std::size_t node) const
+    {
+        return m_nodes[node].parent;
+    }
+
+    std::uintptr_t GetOffset(const std::size_t node) const
+    {
+        return m_nodes[node].offset;
+    }
+
+    // Number of nodes including the root
+    std::size_t GetSize() const
+    {
+        return m_nodes.size();
+    }
+
+    // Returns the child of parent reached through offset, or NOT_FOUND if it has not been resolved yet
+    std::size_t Find(const std::size_t parent, const std::uintptr_t offset) const
+    {
+        // The tree only has a few dozen nodes so a linear search beats any hashing
+        for (std::size_t i = parent + 1; i < m_nodes.size(); i++)
+        {
+            if (m_nodes[i].parent == parent && m_nodes[i].offset == offset)
+            {
+                return i;
+            }
+        }
+
+        return NOT_FOUND;
+    }
+
+    std::size_t Insert(const std::size_t parent, const std::uintptr_t offset, const std::uintptr_t address)
+    {
+        m_nodes.push_back({ parent, offset, address });
+        return m_nodes.size() - 1;
+    }
+
+private:
+    struct Node final
+    {
+        std::size_t parent;
+        std::uintptr_t offset;
+
+        // Address reached by dereferencing the parent address and adding offset
+        std::uintptr_t address;
+    };
+
+    std::vector<Node> m_nodes;
+    std::uint64_t m_generation = 0;
+};
+
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+namespace tnt {
+
+// Longest pointer chain supported by PointerChain
+static constexpr std::size_t MAX_POINTER_CHAIN_DEPTH = 12;
+
+// Fixed capacity list of pointer offsets that can be built at compile time
+// Unlike std::vector it never allocates so it can be passed around freely on the read path
+class PointerChain final
+{
+public:
+    constexpr PointerChain() = default;
+
+    // Allows writing chains as braced lists, e.g. { 0x18, 0xA0, 0x38 }
+    template <typename... Offsets>
+        requires (sizeof...(Offsets) > 0 && (std::is_integral_v<Offsets> && ...))
+    constexpr PointerChain(const Offsets... offsets)
+        : m_offsets{ static_cast<std::uintptr_t>(offsets)... }
+        , m_size(sizeof...(Offsets))
+    {
+        static_assert(sizeof...(Offsets) <= MAX_POINTER_CHAIN_DEPTH, "Pointer chain is longer than MAX_POINTER_CHAIN_DEPTH");
+    }
+
+    // Appends an offset to a chain built at runtime, e.g. from the offset database
+    // Throws std::length_error if the chain is already MAX_POINTER_CHAIN_DEPTH long
+    constexpr void push_back(const std::uintptr_t offset)
+    {
+        if (m_size == MAX_POINTER_CHAIN_DEPTH)
+        {
+            throw std::length_error("Pointer chain is longer than MAX_POINTER_CHAIN_DEPTH.\n");
+        }
+
+        m_offsets[m_size++] = offset;
+    }
+
+    constexpr std::size_t size() const
+    {
+        return m_size;
+    }
+
+    constexpr bool empty() const
+    {
+        return m_size == 0;
+    }
+
+    constexpr std::uintptr_t operator[](const std::size_t index) const
+    {
+        return m_offsets[index];
+    }
+
+    constexpr const std::uintptr_t* begin() const
+    {
+        return m_offsets.data();
+    }
+
+    constexpr const std::uintptr_t* end() const
+    {
+        return m_offsets.data() + m_size;
+    }
+
+    // Returns true if every offset of this chain is also the start of other
+    constexpr bool IsPrefixOf(const PointerChain& other) const
+    {
+        if (m_size > other.m_size)
+        {
+            return false;
+        }
+
+        for (std::size_t i = 0; i < m_size; i++)
+        {
+            if (m_offsets[i] != other.m_offsets[i])
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+private:
+    std::array<std::uintptr_t, MAX_POINTER_CHAIN_DEPTH> m_offsets = {};
+    std::size_t m_size = 0;
+};
+
+}
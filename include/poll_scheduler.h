@@ -0,0 +1,71 @@
+#pragma once
+
+#include "guitar_pro.h"
+
+#include <chrono>
+#include <string_view>
+
+namespace tnt {
+
+enum class PollState
+{
+    // Guitar Pro is playing or something just changed, poll at the full rate
+    ACTIVE,
+
+    // Guitar Pro is attached but nothing has changed for a while
+    IDLE,
+
+    // Guitar Pro couldn't be read, back off exponentially
+    DISCONNECTED,
+};
+
+std::string_view ToString(const PollState state);
+
+// Decides when Guitar Pro should be read next based on what the previous reads returned
+class PollScheduler final
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Stay active this long after the last change so quick edits while paused feel immediate
+    static constexpr Clock::duration ACTIVE_HOLD = std::chrono::seconds(1);
+
+    static constexpr Clock::duration IDLE_INTERVAL = std::chrono::milliseconds(100);
+
+    static constexpr Clock::duration MIN_BACKOFF_INTERVAL = std::chrono::milliseconds(250);
+    static constexpr Clock::duration MAX_BACKOFF_INTERVAL = std::chrono::seconds(8);
+
+    // active_interval is the fastest rate, 0 polls on every call to IsDue
+    explicit PollScheduler(const Clock::duration active_interval);
+
+    bool IsDue(const Clock::time_point now) const;
+
+    // Time of the next read, nothing needs to happen before it
+    Clock::time_point GetNextPoll() const;
+
+    PollState GetState() const;
+    Clock::duration GetInterval() const;
+
+    // Report the outcome of a read, schedules the next one
+    void OnRead(const Clock::time_point now, const GuitarProState& state);
+    void OnReadFailed(const Clock::time_point now);
+
+    // Something outside of Guitar Pro changed (e.g. the REAPER transport), poll right away at the full rate
+    void Wake(const Clock::time_point now);
+
+private:
+    bool Changed(const GuitarProState& state) const;
+    void Schedule(const Clock::time_point now, const PollState state, const Clock::duration interval);
+
+    Clock::duration m_active_interval;
+
+    PollState m_state = PollState::ACTIVE;
+    Clock::duration m_interval = Clock::duration::zero();
+    Clock::time_point m_next_poll;
+    Clock::time_point m_last_change;
+
+    bool m_has_previous_state = false;
+    GuitarProState m_previous_state;
+};
+
+}
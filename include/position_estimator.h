@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+namespace tnt {
+
+struct PositionEstimate final
+{
+    // Predicted Guitar Pro play position in seconds
+    double position = 0.0;
+
+    // 0 when there is nothing to go on, approaches 1 as samples agree with the fitted line
+    double confidence = 0.0;
+};
+
+// Fits Guitar Pro's play position against the monotonic clock while it plays
+// Exponentially weighted least squares over the recent samples, with the slope pulled towards the play rate
+// so a handful of samples is enough and the stepping of Guitar Pro's cursor is averaged out
+class PositionEstimator final
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Samples further off the prediction than this mean the cursor was moved, the fit starts over
+    static constexpr double JUMP_THRESHOLD = 0.1; // Seconds
+
+    // Forget everything, e.g. when playback stops
+    void Reset();
+
+    // Adds a sample read at the given time
+    // Returns true if it didn't fit the current line and the fit was restarted from it
+    bool AddSample(const Clock::time_point time, const double position, const double play_rate);
+
+    // Extrapolated position at the given time, usually now or slightly ahead of it
+    PositionEstimate Predict(const Clock::time_point time) const;
+
+    bool HasSamples() const;
+
+private:
+    void Restart(const Clock::time_point time, const double position, const double play_rate);
+    void Fit();
+
+    double Seconds(const Clock::time_point time) const;
+
+    Clock::time_point m_origin;
+    Clock::time_point m_last_time;
+    std::size_t m_sample_count = 0;
+    double m_play_rate = 1.0;
+
+    // Weighted sums over x = time since m_origin and y = position
+    double m_sum_w = 0.0;
+    double m_sum_wx = 0.0;
+    double m_sum_wy = 0.0;
+    double m_sum_wxx = 0.0;
+    double m_sum_wxy = 0.0;
+
+    // Weighted mean squared prediction error
+    double m_error_variance = 0.0;
+
+    // Fitted line y = m_intercept + m_slope * x
+    double m_intercept = 0.0;
+    double m_slope = 1.0;
+};
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "memory_source.h"
+#include "read_plan.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tnt {
+
+// Platform specific access to the memory of another process
+// Windows uses ReadProcessMemory, Linux (Guitar Pro running under Wine) uses process_vm_readv
+class ProcessMemory final : public MemorySource
+{
+public:
+    // Attaches to the process and locates the module
+    // Throws std::runtime_error on failure
+    ProcessMemory(const std::wstring& process_name, const std::wstring& module_name);
+    ~ProcessMemory() override;
+
+    ProcessMemory(const ProcessMemory&) = delete;
+    ProcessMemory& operator=(const ProcessMemory&) = delete;
+
+    std::string GetName() const override;
+
+    const std::wstring& GetProcessVersion() const override;
+
+    std::uintptr_t GetModuleBaseAddress() const override;
+
+    // Does not enumerate processes
+    bool IsProcessRunning() const override;
+
+    bool Read(const std::uintptr_t address, void* buffer, const std::size_t size) override;
+
+    // Batches the regions into as few system calls as the platform allows
+    bool ReadRegions(const std::vector<ReadPlan::Region>& regions, std::byte* buffer, std::uintptr_t& failed_address) override;
+
+    std::string GetLastErrorMessage() const override;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+}
@@ -1,223 +1,323 @@
 #pragma once
 
-#include "wstring_utils.h"
-
-#include <windows.h> // Must be included before tlhelp32.h
-#include <tlhelp32.h>
-#include <winver.h>
-
-#include <codecvt>
+#include "memory_source.h"
+#include "pe_image.h"
+#include "pointer_cache.h"
+#include "pointer_chain.h"
+#include "process_memory.h"
+#include "profiler.h"
+#include "read_plan.h"
+#include "signature_scanner.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <format>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
-#pragma comment(lib, "Version.lib") // Ensure linking to Version.lib
-
 namespace tnt {
 
+// Number of times a consistent read is attempted before giving up
+static constexpr int MAX_CONSISTENT_READ_ATTEMPTS = 4;
+
+// Number of cached hops ValidateCachedHops re-reads per call
+static constexpr std::size_t VALIDATED_HOPS_PER_READ = 4;
+
 class ProcessReader final
 {
 public:
     ProcessReader(const std::wstring& process_name, const std::wstring& module_name)
-        : m_process_name(process_name)
-        , m_module_name(module_name)
+        : ProcessReader(std::make_unique<ProcessMemory>(process_name, module_name))
+    {}
+
+    explicit ProcessReader(std::unique_ptr<MemorySource> memory_source)
+        : m_memory_source(std::move(memory_source))
+        , m_module_base_address(m_memory_source->GetModuleBaseAddress())
     {
-        m_process_id = this->GetProcessID(m_process_name.c_str());
-        if (!m_process_id)
-        {
-            throw std::runtime_error(std::format("Failed to get process ID for process '{}'.\n", WStringToString(m_process_name)));
-        }
+        m_validated_hop_regions.reserve(VALIDATED_HOPS_PER_READ);
+    }
 
-        m_process_path = this->GetProcessPath(m_process_id);
+    ProcessReader(const ProcessReader&) = delete;
+    ProcessReader& operator=(const ProcessReader&) = delete;
 
-        m_module_base_address = this->GetModuleBaseAddress(m_module_name.c_str());
-        if (!m_module_base_address)
-        {
-            throw std::runtime_error(std::format("Failed to get module base address for module '{}'.\n", WStringToString(m_module_name)));
-        }
-
-        m_process_handle = OpenProcess(PROCESS_VM_READ, FALSE, m_process_id);
-        if (!m_process_handle) {
-            throw std::runtime_error(std::format("Failed to open process '{}'.\n", WStringToString(m_process_name)));
-        }
+    const std::wstring& GetProcessVersion() const
+    {
+        return m_memory_source->GetProcessVersion();
     }
 
-    ~ProcessReader()
+    // Build identifier of the module from its PE header, 0 if the header can't be read
+    std::uint64_t GetModuleHash()
     {
-        CloseHandle(m_process_handle);
+        PeImage image;
+        return ReadPeImage(*m_memory_source, m_module_base_address, image) ? image.GetModuleHash() : 0;
     }
 
-    std::wstring GetProcessVersion() const
+    // Scans the module for the instruction described by the signature and resolves its RIP-relative operand
+    // Returns the operand target as an offset from the module base, or 0 if it can't be found
+    // Reads the whole code section of the module so this is only meant to run once per module build
+    std::uintptr_t FindRipRelativeTarget(const BytePattern& pattern, const std::size_t displacement_offset, const std::size_t instruction_size)
     {
-        DWORD handle = 0;
-        const DWORD size = GetFileVersionInfoSizeW(m_process_path.c_str(), &handle);
-        if (size == 0)
+        PeImage image;
+        if (!ReadPeImage(*m_memory_source, m_module_base_address, image))
         {
-            return L"";
+            return 0;
         }
 
-        std::vector<BYTE> data(size);
-        if (!GetFileVersionInfoW(m_process_path.c_str(), handle, size, data.data()))
-        {
-            return L"";
-        }
+        const std::uintptr_t instruction = ScanModule(*m_memory_source, m_module_base_address, image, pattern);
 
-        VS_FIXEDFILEINFO* fileInfo = nullptr;
-        UINT len = 0;
-        if (!VerQueryValueW(data.data(), L"\\", reinterpret_cast<LPVOID*>(&fileInfo), &len))
+        std::int32_t displacement = 0;
+        if (!instruction || !m_memory_source->Read(instruction + displacement_offset, &displacement, sizeof(displacement)))
         {
-            return L"";
+            return 0;
         }
 
-        if (fileInfo)
+        const std::uintptr_t target = instruction + instruction_size + static_cast<std::intptr_t>(displacement);
+        if (target <= m_module_base_address || target >= m_module_base_address + image.size_of_image)
         {
-            return std::to_wstring(HIWORD(fileInfo->dwFileVersionMS)) + L"."
-                + std::to_wstring(LOWORD(fileInfo->dwFileVersionMS)) + L"."
-                + std::to_wstring(HIWORD(fileInfo->dwFileVersionLS)) + L"."
-                + std::to_wstring(LOWORD(fileInfo->dwFileVersionLS));
+            return 0;
         }
 
-        return L"";
+        return target - m_module_base_address;
+    }
+
+    // Cheap liveness check that does not enumerate processes
+    bool IsProcessRunning() const
+    {
+        return m_memory_source->IsProcessRunning();
     }
 
     template <typename T>
-    T ReadMemoryAddress(const DWORD_PTR module_offset, const std::vector<DWORD_PTR> pointer_offsets) const
+    T ReadMemoryAddress(const std::uintptr_t module_offset, const PointerChain& pointer_offsets)
     {
-        DWORD_PTR base_address = m_module_base_address + module_offset;
-        DWORD_PTR address = this->ReadPointer(base_address, pointer_offsets);
+        TNT_PROFILE_SCOPE("ProcessReader::ReadMemoryAddress");
+
+        std::uintptr_t base_address = m_module_base_address + module_offset;
+        std::uintptr_t address = this->ReadPointer(base_address, pointer_offsets);
 
         // Value stored at the memory address
         T value;
 
         // Attempt to read memory
-        if (!ReadProcessMemory(m_process_handle, reinterpret_cast<LPCVOID>(address), &value, sizeof(value), nullptr))
-        {
-            // If ReadProcessMemory fails, get the last error code
-            DWORD error = GetLastError();
-            std::string error_message = [&] {
-                switch(error)
-                {
-                case ERROR_ACCESS_DENIED:
-                    return "Access denied. Make sure the process is accessible.";
-                case ERROR_INVALID_PARAMETER:
-                    return "Invalid parameter passed to ReadProcessMemory.";
-                case ERROR_PARTIAL_COPY:
-                    return "Partial copy, the memory range is inaccessible.";
-                default:
-                    return "Unknown error.";
-                }
-            }();
-
-            throw std::runtime_error(std::format("Failed to read memory at address {} for process '{}': {}\n", address, WStringToString(m_process_name), error_message));
+        if (!m_memory_source->Read(address, &value, sizeof(value)))
+        {
+            // The cached chain may have gone stale, resolve it again once before giving up
+            m_pointer_cache.Clear(base_address);
+            address = this->ReadPointer(base_address, pointer_offsets);
+            if (m_memory_source->Read(address, &value, sizeof(value)))
+            {
+                return value;
+            }
+
+            this->ThrowReadError(address);
         }
 
         return value;
     }
 
-private:
-    
-    DWORD GetProcessID(const wchar_t* process_name) const
+    // Walks the given chain prefix without the cache and drops every cached address if any hop changed
+    // This is much cheaper than re-resolving every chain and catches Guitar Pro switching documents
+    void ValidatePointerCache(const std::uintptr_t module_offset, const PointerChain& pointer_offsets)
     {
-        HANDLE snapshot_handle = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
-        if (snapshot_handle == INVALID_HANDLE_VALUE)
+        TNT_PROFILE_SCOPE("ProcessReader::ValidatePointerCache");
+
+        const std::uintptr_t base_address = m_module_base_address + module_offset;
+        if (m_pointer_cache.GetRootAddress() != base_address)
         {
-            return 0;
+            m_pointer_cache.Clear(base_address);
+            return;
         }
 
-        PROCESSENTRY32 process_entry;
-        process_entry.dwSize = sizeof(PROCESSENTRY32);
+        std::uintptr_t address = base_address;
+        std::size_t node = PointerCache::ROOT;
 
-        if (Process32First(snapshot_handle, &process_entry))
+        for (const std::uintptr_t offset : pointer_offsets)
         {
-            do
+            node = m_pointer_cache.Find(node, offset);
+            if (node == PointerCache::NOT_FOUND)
             {
-                if (_wcsicmp(process_entry.szExeFile, process_name) == 0)
-                {
-                    CloseHandle(snapshot_handle);
-                    return process_entry.th32ProcessID;
-                }
-            } while (Process32Next(snapshot_handle, &process_entry));
-        }
+                // Nothing cached below this point so there is nothing to validate
+                return;
+            }
 
-        CloseHandle(snapshot_handle);
+            std::uintptr_t temp_address;
+            if (!m_memory_source->Read(address, &temp_address, sizeof(temp_address))
+             || temp_address + offset != m_pointer_cache.GetAddress(node))
+            {
+                m_pointer_cache.Clear(base_address);
+                return;
+            }
 
-        return 0;
+            address = temp_address + offset;
+        }
     }
 
-    std::wstring GetProcessPath(const DWORD pid) const
+    // Re-reads the next few cached hops in rotation in a single batch and drops every cached address if any of them changed
+    // Catches objects Guitar Pro reallocates below the prefix checked by ValidatePointerCache within a few calls
+    void ValidateCachedHops()
     {
-        std::wstring path;
-        const HANDLE process_handle = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
-        if (process_handle)
+        TNT_PROFILE_SCOPE("ProcessReader::ValidateCachedHops");
+
+        // Every node but the root is a hop
+        const std::size_t hop_count = m_pointer_cache.GetSize() - 1;
+        if (hop_count == 0)
+        {
+            return;
+        }
+
+        const std::size_t count = std::min(VALIDATED_HOPS_PER_READ, hop_count);
+        std::array<std::size_t, VALIDATED_HOPS_PER_READ> nodes;
+        std::array<std::uintptr_t, VALIDATED_HOPS_PER_READ> pointers;
+
+        m_validated_hop_regions.clear();
+        for (std::size_t i = 0; i < count; i++)
+        {
+            nodes[i] = PointerCache::ROOT + 1 + (m_next_validated_hop + i) % hop_count;
+
+            // The pointer stored at the parent address leads to this hop
+            const std::uintptr_t parent_address = m_pointer_cache.GetAddress(m_pointer_cache.GetParent(nodes[i]));
+            m_validated_hop_regions.push_back({ parent_address, sizeof(std::uintptr_t), i * sizeof(std::uintptr_t) });
+        }
+
+        m_next_validated_hop = (m_next_validated_hop + count) % hop_count;
+
+        if (!m_memory_source->ReadRegions(m_validated_hop_regions, reinterpret_cast<std::byte*>(pointers.data()), m_last_failed_address))
         {
-            wchar_t buffer[MAX_PATH];
-            DWORD size = MAX_PATH;
+            m_pointer_cache.Clear(m_pointer_cache.GetRootAddress());
+            return;
+        }
 
-            if (QueryFullProcessImageNameW(process_handle, 0, buffer, &size))
+        for (std::size_t i = 0; i < count; i++)
+        {
+            if (pointers[i] + m_pointer_cache.GetOffset(nodes[i]) != m_pointer_cache.GetAddress(nodes[i]))
             {
-                path.assign(buffer, size);
+                m_pointer_cache.Clear(m_pointer_cache.GetRootAddress());
+                return;
             }
-
-            CloseHandle(process_handle);
         }
+    }
 
-        return path;
+    // Resolves a pointer chain to the address of its value, reusing cached hops
+    std::uintptr_t ResolvePointer(const std::uintptr_t module_offset, const PointerChain& pointer_offsets)
+    {
+        return this->ReadPointer(m_module_base_address + module_offset, pointer_offsets);
     }
 
-    DWORD_PTR GetModuleBaseAddress(const wchar_t* module_name) const
+    void ClearPointerCache()
     {
-        const HANDLE snapshot_handle = CreateToolhelp32Snapshot(TH32CS_SNAPMODULE | TH32CS_SNAPMODULE32, m_process_id);
-        if (snapshot_handle == INVALID_HANDLE_VALUE)
+        m_pointer_cache.Clear(m_pointer_cache.GetRootAddress());
+    }
+
+    // See PointerCache::GetGeneration
+    std::uint64_t GetPointerCacheGeneration() const
+    {
+        return m_pointer_cache.GetGeneration();
+    }
+
+    // Fetches every region of the plan into its buffer, batching the regions into as few reads as the platform allows
+    // When validate is set the regions are read again until two consecutive reads match so the snapshot is self-consistent
+    // Returns false if any region could not be read
+    bool TryExecuteReadPlan(ReadPlan& plan, const bool validate)
+    {
+        TNT_PROFILE_SCOPE("ProcessReader::ExecuteReadPlan");
+
+        if (!m_memory_source->ReadRegions(plan.GetRegions(), plan.GetBuffer(), m_last_failed_address))
         {
-            return 0;
+            return false;
         }
 
-        MODULEENTRY32W module_entry;
-        module_entry.dwSize = sizeof(module_entry);
+        if (!validate)
+        {
+            return true;
+        }
 
-        if (Module32FirstW(snapshot_handle, &module_entry))
+        m_validation_buffer.resize(plan.GetBufferSize());
+        for (int attempt = 0; attempt < MAX_CONSISTENT_READ_ATTEMPTS; attempt++)
         {
-            do
+            if (!m_memory_source->ReadRegions(plan.GetRegions(), m_validation_buffer.data(), m_last_failed_address))
             {
-                if (_wcsicmp(module_entry.szModule, module_name) == 0)
-                {
-                    CloseHandle(snapshot_handle);
-                    return reinterpret_cast<DWORD_PTR>(module_entry.modBaseAddr);
-                }
-            } while (Module32NextW(snapshot_handle, &module_entry));
+                return false;
+            }
+
+            if (std::memcmp(plan.GetBuffer(), m_validation_buffer.data(), plan.GetBufferSize()) == 0)
+            {
+                return true;
+            }
+
+            std::memcpy(plan.GetBuffer(), m_validation_buffer.data(), plan.GetBufferSize());
         }
 
-        CloseHandle(snapshot_handle);
+        throw std::runtime_error(std::format("Failed to read a consistent snapshot from {}.\n", m_memory_source->GetName()));
+    }
+
+    // Same as TryExecuteReadPlan but throws std::runtime_error on failure
+    void ExecuteReadPlan(ReadPlan& plan, const bool validate)
+    {
+        if (!this->TryExecuteReadPlan(plan, validate))
+        {
+            this->ThrowReadError(m_last_failed_address);
+        }
+    }
 
-        return 0;
+private:
+    [[noreturn]] void ThrowReadError(const std::uintptr_t address) const
+    {
+        throw std::runtime_error(std::format("Failed to read memory at address {} for {}: {}\n", address, m_memory_source->GetName(), m_memory_source->GetLastErrorMessage()));
     }
 
-    DWORD_PTR ReadPointer(const DWORD_PTR base_address, const std::vector<DWORD_PTR> offsets) const
+    std::uintptr_t ReadPointer(const std::uintptr_t base_address, const PointerChain& offsets)
     {
-        DWORD_PTR address = base_address;
-        DWORD_PTR temp_address;
+        if (m_pointer_cache.GetRootAddress() != base_address)
+        {
+            m_pointer_cache.Clear(base_address);
+        }
+
+        std::uintptr_t address = base_address;
+        std::uintptr_t temp_address;
+        std::size_t node = PointerCache::ROOT;
+        bool cacheable = true;
 
         for (size_t i = 0; i < offsets.size(); i++)
         {
-            if (!ReadProcessMemory(m_process_handle, (LPCVOID)address, &temp_address, sizeof(temp_address), nullptr))
+            // Reuse hops already resolved by this or any other chain
+            const std::size_t cached_node = cacheable ? m_pointer_cache.Find(node, offsets[i]) : PointerCache::NOT_FOUND;
+            if (cached_node != PointerCache::NOT_FOUND)
+            {
+                node = cached_node;
+                address = m_pointer_cache.GetAddress(node);
+                continue;
+            }
+
+            if (!m_memory_source->Read(address, &temp_address, sizeof(temp_address)))
             {
                 return 0;
             }
 
             address = temp_address + offsets[i];
+
+            // Null pointers mean Guitar Pro has not finished building this part of the chain yet
+            cacheable = cacheable && temp_address != 0;
+            if (cacheable)
+            {
+                node = m_pointer_cache.Insert(node, offsets[i], address);
+            }
         }
 
         return address;
     }
 
-    std::wstring m_process_name;
-    std::wstring m_module_name;
-    std::wstring m_process_path;
-    DWORD m_process_id;
-    DWORD_PTR m_module_base_address;
-    HANDLE m_process_handle;
+    std::unique_ptr<MemorySource> m_memory_source;
+    std::uintptr_t m_module_base_address;
+    PointerCache m_pointer_cache;
+    std::vector<std::byte> m_validation_buffer;
+    std::vector<ReadPlan::Region> m_validated_hop_regions;
+    std::size_t m_next_validated_hop = 0;
+    std::uintptr_t m_last_failed_address = 0;
 };
 
-}
\ No newline at end of file
+}
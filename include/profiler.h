@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace tnt {
+
+// Hot path spans recorded into a preallocated ring per thread, exported as Chrome trace event JSON
+// Open the export in chrome://tracing or https://ui.perfetto.dev
+// Spans are compiled in with the GUITAR_PRO_SYNC_PROFILER CMake option and cost a single relaxed load while disabled
+class Profiler final
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Spans kept per thread, the oldest ones are overwritten
+    static constexpr std::size_t SPANS_PER_THREAD = 8192;
+
+    // False if the spans were compiled out, enabling the profiler then records nothing
+    static bool IsCompiledIn();
+
+    static void SetEnabled(const bool enabled);
+
+    static bool IsEnabled()
+    {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+
+    // The name must outlive the export, spans only ever use string literals
+    // Lock-free, the first span of a thread allocates its ring
+    static void Record(const char* name, const Clock::time_point start, const Clock::time_point end);
+
+    // Every span still held by the rings, may run while other threads keep recording
+    static std::string ExportChromeTrace();
+
+    // Forgets every span recorded so far
+    static void Clear();
+
+private:
+    static inline std::atomic<bool> s_enabled = false;
+};
+
+// Records the lifetime of the scope as a span while the profiler is enabled
+class ProfileScope final
+{
+public:
+    explicit ProfileScope(const char* name)
+        : m_name(Profiler::IsEnabled() ? name : nullptr)
+    {
+        if (m_name)
+        {
+            m_start = Profiler::Clock::now();
+        }
+    }
+
+    ~ProfileScope()
+    {
+        if (m_name)
+        {
+            Profiler::Record(m_name, m_start, Profiler::Clock::now());
+        }
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* m_name;
+    Profiler::Clock::time_point m_start;
+};
+
+}
+
+#ifdef TNT_PROFILER
+#define TNT_PROFILE_CONCAT_INNER(a, b) a##b
+#define TNT_PROFILE_CONCAT(a, b) TNT_PROFILE_CONCAT_INNER(a, b)
+#define TNT_PROFILE_SCOPE(name) const ::tnt::ProfileScope TNT_PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+#else
+#define TNT_PROFILE_SCOPE(name) static_cast<void>(0)
+#endif
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace tnt {
+
+// Groups the fields of a snapshot into contiguous memory regions so that each region can be fetched with a single read
+// Fields are then decoded from the local buffer, which also guarantees they all come from the same read
+class ReadPlan final
+{
+public:
+    // Fields closer than this are fetched together with the bytes in between
+    static constexpr std::size_t MAX_REGION_GAP = 64;
+
+    // Upper bound for a single region so a bad pointer can't make us read huge amounts of memory
+    static constexpr std::size_t MAX_REGION_SIZE = 256;
+
+    struct Region final
+    {
+        std::uintptr_t address;
+        std::size_t size;
+
+        // Offset of the region in the plan buffer
+        std::size_t buffer_offset;
+    };
+
+    ReadPlan()
+    {
+        m_fields.reserve(16);
+        m_regions.reserve(16);
+        m_order.reserve(16);
+        m_buffer.reserve(16 * MAX_REGION_SIZE);
+    }
+
+    void Clear()
+    {
+        m_fields.clear();
+        m_regions.clear();
+        m_order.clear();
+        m_buffer.clear();
+    }
+
+    // Adds a field to the plan and returns its index
+    std::size_t AddField(const std::uintptr_t address, const std::size_t size)
+    {
+        m_fields.push_back({ address, size, 0 });
+        return m_fields.size() - 1;
+    }
+
+    // Merges the fields added so far into regions and sizes the buffer
+    void Build()
+    {
+        m_regions.clear();
+        m_order.clear();
+
+        for (std::size_t i = 0; i < m_fields.size(); i++)
+        {
+            m_order.push_back(i);
+        }
+
+        std::sort(m_order.begin(), m_order.end(), [&](const std::size_t a, const std::size_t b) {
+            return m_fields[a].address < m_fields[b].address;
+        });
+
+        std::size_t buffer_size = 0;
+        for (const std::size_t index : m_order)
+        {
+            Field& field = m_fields[index];
+
+            if (!m_regions.empty())
+            {
+                Region& region = m_regions.back();
+                const std::uintptr_t region_end = region.address + region.size;
+                const std::uintptr_t field_end = field.address + field.size;
+
+                if (field.address <= region_end + MAX_REGION_GAP && field_end - region.address <= MAX_REGION_SIZE)
+                {
+                    const std::size_t new_size = std::max(region.size, static_cast<std::size_t>(field_end - region.address));
+                    buffer_size += new_size - region.size;
+                    region.size = new_size;
+                    field.buffer_offset = region.buffer_offset + (field.address - region.address);
+                    continue;
+                }
+            }
+
+            m_regions.push_back({ field.address, field.size, buffer_size });
+            field.buffer_offset = buffer_size;
+            buffer_size += field.size;
+        }
+
+        m_buffer.resize(buffer_size);
+    }
+
+    const std::vector<Region>& GetRegions() const
+    {
+        return m_regions;
+    }
+
+    std::byte* GetBuffer()
+    {
+        return m_buffer.data();
+    }
+
+    std::size_t GetBufferSize() const
+    {
+        return m_buffer.size();
+    }
+
+    // Decodes a field from the buffer filled by the last read
+    template <typename T>
+    T Get(const std::size_t field) const
+    {
+        T value;
+        std::memcpy(&value, m_buffer.data() + m_fields[field].buffer_offset, sizeof(value));
+        return value;
+    }
+
+private:
+    struct Field final
+    {
+        std::uintptr_t address;
+        std::size_t size;
+        std::size_t buffer_offset;
+    };
+
+    std::vector<Field> m_fields;
+    std::vector<Region> m_regions;
+    std::vector<std::size_t> m_order;
+    std::vector<std::byte> m_buffer;
+};
+
+}
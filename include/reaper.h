@@ -1,7 +1,13 @@
 #pragma once
 
+#include "reaper_backend.h"
+#include "tempo_map.h"
+
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace tnt {
 
@@ -17,26 +23,135 @@ enum class ReaperToggleCommand
     PRESERVE_PITCH,
 };
 
+// Everything the sync logic looks at, captured in one go so a tick decides on consistent values
+struct ReaperState final
+{
+    // Play position in seconds
+    double play_position = 0.0;
+
+    // Play rate
+    double play_rate = 1.0;
+
+    // Stopped/playing/paused state
+    ReaperPlayState play_state = ReaperPlayState::STOPPED;
+
+    // Repeat state
+    bool repeat = false;
+
+    // Time selection start position in seconds
+    double time_selection_start_position = 0.0;
+
+    // Time selection end position in seconds
+    double time_selection_end_position = 0.0;
+
+    // Preserve pitch toggle state
+    bool preserve_pitch = false;
+};
+
+// REAPER's transport position when an audio block was processed
+struct ReaperAudioBlock final
+{
+    std::chrono::steady_clock::time_point timestamp;
+    double position = 0.0;
+    bool playing = false;
+};
+
+enum class ReaperCommandType
+{
+    EDIT_CURSOR_POSITION,
+    PLAY_RATE,
+    PLAY_STATE,
+    REPEAT,
+    TIME_SELECTION,
+    PRESERVE_PITCH,
+};
+
+// One change Reaper applied to REAPER
+struct ReaperCommand final
+{
+    ReaperCommandType type = ReaperCommandType::EDIT_CURSOR_POSITION;
+
+    // Edit cursor position, play rate or time selection start
+    double value = 0.0;
+
+    // Time selection end
+    double end_value = 0.0;
+
+    // New play state, repeat or preserve pitch state, or 1 if an edit cursor move seeks playback
+    int state = 0;
+};
+
+std::string ToString(const ReaperCommand& command);
+
 // C++ wrapper around C-style REAPER API functions
 // Since it is in a class it is also capable of holding state
 class Reaper final
 {
 public:
+    // Calls into the running REAPER
     Reaper();
+
+    // Runs against any backend, e.g. a SimulatedReaper
+    explicit Reaper(std::unique_ptr<ReaperBackend> backend);
+
     ~Reaper();
 
+    // Current time on the backend's clock
+    std::chrono::steady_clock::time_point GetTime() const;
+
+    // Reads every field of ReaperState
+    // Also remembered as REAPER's current state, queued commands that match it are dropped
+    ReaperState GetState() const;
+
+    // Same as GetState without being remembered, so it doesn't affect which queued commands are dropped
+    ReaperState PeekState() const;
+
+    // Called with every command applied to REAPER, queued or immediate, an empty function stops listening
+    // UI thread only
+    void SetCommandListener(std::function<void(const ReaperCommand&)> listener) const;
+
+    // Queued commands, only the last one of each kind survives until FlushCommands
+    // Safe to call from any thread
+    void QueuePreservePitch(const bool enabled) const;
+    void QueueRepeat(const bool repeat) const;
+    void QueueTimeSelection(const double start_time, const double end_time) const;
+    void QueueEditCursorPosition(const double time, const bool move_view, const bool seek_play) const;
+
+    // Pauses REAPER first if it is playing, it handles stretching much more efficiently that way
+    void QueuePlayRate(const double play_rate) const;
+
+    void QueuePlayState(const ReaperPlayState& play_state) const;
+
+    // Applies the queued commands that would change something in one UI refresh
+    // Applied in this order: preserve pitch, repeat, time selection, play rate, edit cursor, play state
+    // UI thread only
+    void FlushCommands() const;
+
     // double GetPlayPosition()
     double GetPlayPosition() const;
     
+    // double GetPlayPosition2() and int GetPlayState()
+    // Position of the audio block being processed, the only call meant for the audio thread
+    // Records no profiling spans, takes no locks and doesn't allocate
+    ReaperAudioBlock ReadAudioBlock() const;
+
+    // double GetOutputLatency()
+    double GetOutputLatency() const;
+
     // double Master_GetPlayRate(ReaProject* project)
     double GetPlayRate() const;
 
     // int GetPlayState()
     ReaperPlayState GetPlayState() const;
 
+    // int GetSetRepeat(int val)
+    bool GetRepeat() const;
+
     // int GetToggleCommandState(int command_id)
     bool GetToggleCommandState(const ReaperToggleCommand& command) const;
 
+    // The setters below apply immediately, bypassing the command queue
+
     // void SetEditCurPos(double time, bool moveview, bool seekplay)
     void SetEditCursorPosition(const double time, const bool move_view, const bool seek_play) const;
 
@@ -55,6 +170,22 @@ public:
     // void GetSet_LoopTimeRange(bool isSet, bool isLoop, double* startOut, double* endOut, bool allowautoseek)
     void SetTimeSelection(const double start_time, const double end_time) const;
 
+    // int CountTempoTimeSigMarkers(ReaProject* proj)
+    // bool GetTempoTimeSigMarker(ReaProject* proj, int ptidx, ...)
+    // Every tempo/time signature marker of the current project, sorted by time
+    std::vector<TempoMarker> GetTempoMarkers() const;
+
+    // bool DeleteTempoTimeSigMarker(ReaProject* project, int markerindex)
+    // bool SetTempoTimeSigMarker(ReaProject* proj, int ptidx, double timepos, ...)
+    // Replaces every tempo/time signature marker with these, sorted by time, in one UI refresh and one undo step
+    void ReplaceTempoMarkers(const std::vector<TempoMarker>& markers, const std::string& undo_description) const;
+
+    // const char* GetExtState(const char* section, const char* key)
+    std::string GetExtState(const std::string& section, const std::string& key) const;
+
+    // void SetExtState(const char* section, const char* key, const char* value, bool persist)
+    void SetExtState(const std::string& section, const std::string& key, const std::string& value, const bool persist) const;
+
     // void ShowConsoleMsg(const char* msg)
     void ShowConsoleMessage(const std::string& message) const;
 
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+namespace tnt {
+
+// The raw REAPER API functions the Reaper wrapper is built on
+// Implemented by the real REAPER API and by SimulatedReaper, so the plugin can also run headless
+class ReaperBackend
+{
+public:
+    virtual ~ReaperBackend() = default;
+
+    // Monotonic time every timestamp of the plugin is taken from, the simulation runs on its own clock
+    virtual std::chrono::steady_clock::time_point GetTime() const = 0;
+
+    // double GetPlayPosition()
+    virtual double GetPlayPosition() const = 0;
+
+    // double GetPlayPosition2()
+    virtual double GetPlayPosition2() const = 0;
+
+    // double GetOutputLatency()
+    virtual double GetOutputLatency() const = 0;
+
+    // double Master_GetPlayRate(ReaProject* project)
+    virtual double GetMasterPlayRate() const = 0;
+
+    // int GetPlayState()
+    virtual int GetPlayState() const = 0;
+
+    // int GetSetRepeat(int val)
+    virtual int GetSetRepeat(const int value) = 0;
+
+    // void GetSet_LoopTimeRange(bool isSet, bool isLoop, double* startOut, double* endOut, bool allowautoseek)
+    virtual void GetSetLoopTimeRange(const bool is_set, double& start_time, double& end_time) = 0;
+
+    // int GetToggleCommandState(int command_id)
+    virtual int GetToggleCommandState(const int command_id) const = 0;
+
+    // void Main_OnCommand(int command, int flag)
+    virtual void MainOnCommand(const int command_id, const int flag) = 0;
+
+    // void SetEditCurPos(double time, bool moveview, bool seekplay)
+    virtual void SetEditCurPos(const double time, const bool move_view, const bool seek_play) = 0;
+
+    // void CSurf_OnPlayRateChange(double playrate)
+    virtual void OnPlayRateChange(const double play_rate) = 0;
+
+    // void CSurf_OnStop()
+    virtual void OnStop() = 0;
+
+    // void CSurf_OnPlay()
+    virtual void OnPlay() = 0;
+
+    // void CSurf_OnPause()
+    virtual void OnPause() = 0;
+
+    // int CountTempoTimeSigMarkers(ReaProject* proj)
+    virtual int CountTempoTimeSigMarkers() const = 0;
+
+    // bool GetTempoTimeSigMarker(ReaProject* proj, int ptidx, double* timeposOut, int* measureposOut, double* beatposOut, double* bpmOut, int* timesig_numOut, int* timesig_denomOut, bool* lineartempoOut)
+    virtual bool GetTempoTimeSigMarker(const int index, double& time, int& measure, double& beat, double& bpm, int& numerator, int& denominator, bool& linear) const = 0;
+
+    // bool SetTempoTimeSigMarker(ReaProject* proj, int ptidx, double timepos, int measurepos, double beatpos, double bpm, int timesig_num, int timesig_denom, bool lineartempo)
+    virtual bool SetTempoTimeSigMarker(const int index, const double time, const int measure, const double beat, const double bpm, const int numerator, const int denominator, const bool linear) = 0;
+
+    // bool DeleteTempoTimeSigMarker(ReaProject* project, int markerindex)
+    virtual bool DeleteTempoTimeSigMarker(const int index) = 0;
+
+    // void UpdateTimeline()
+    virtual void UpdateTimeline() = 0;
+
+    // void Undo_BeginBlock()
+    virtual void UndoBeginBlock() = 0;
+
+    // void Undo_EndBlock(const char* descchange, int extraflags)
+    virtual void UndoEndBlock(const std::string& description, const int flags) = 0;
+
+    // void PreventUIRefresh(int prevent_count)
+    virtual void PreventUIRefresh(const int prevent_count) = 0;
+
+    // const char* GetExtState(const char* section, const char* key)
+    virtual std::string GetExtState(const std::string& section, const std::string& key) const = 0;
+
+    // void SetExtState(const char* section, const char* key, const char* value, bool persist)
+    virtual void SetExtState(const std::string& section, const std::string& key, const std::string& value, const bool persist) = 0;
+
+    // void ShowConsoleMsg(const char* msg)
+    virtual void ShowConsoleMsg(const std::string& message) = 0;
+};
+
+// Calls the REAPER API function pointers, only usable inside REAPER once the API is loaded
+std::unique_ptr<ReaperBackend> CreateReaperApiBackend();
+
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace tnt {
+
+// Single writer, many reader handoff of a small trivially copyable value
+// Neither side ever blocks: the writer always succeeds and readers retry while a write is in progress
+template <typename T>
+class SeqLock final
+{
+    static_assert(std::is_trivially_copyable_v<T>, "SeqLock values are copied byte by byte");
+
+public:
+    // Only one thread may store
+    void Store(const T& value)
+    {
+        std::array<std::uint64_t, WORD_COUNT> words = {};
+        std::memcpy(words.data(), &value, sizeof(T));
+
+        // Odd sequence marks a write in progress
+        const std::uint32_t sequence = m_sequence.load(std::memory_order_relaxed);
+        m_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (std::size_t i = 0; i < WORD_COUNT; i++)
+        {
+            m_words[i].store(words[i], std::memory_order_relaxed);
+        }
+
+        m_sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    // Returns the most recently stored value, or a default constructed T if nothing was stored yet
+    T Load() const
+    {
+        std::array<std::uint64_t, WORD_COUNT> words;
+
+        while (true)
+        {
+            const std::uint32_t sequence = m_sequence.load(std::memory_order_acquire);
+            if (sequence == 0)
+            {
+                return T{};
+            }
+
+            if (sequence & 1)
+            {
+                continue;
+            }
+
+            for (std::size_t i = 0; i < WORD_COUNT; i++)
+            {
+                words[i] = m_words[i].load(std::memory_order_relaxed);
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (m_sequence.load(std::memory_order_relaxed) == sequence)
+            {
+                break;
+            }
+        }
+
+        T value;
+        std::memcpy(static_cast<void*>(&value), words.data(), sizeof(T));
+        return value;
+    }
+
+private:
+    static constexpr std::size_t WORD_COUNT = (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+    std::atomic<std::uint32_t> m_sequence = 0;
+    std::array<std::atomic<std::uint64_t>, WORD_COUNT> m_words = {};
+};
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "memory_source.h"
+#include "pe_image.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+namespace tnt {
+
+// Bytes read from the target process per call while scanning
+static constexpr std::size_t SIGNATURE_SCAN_CHUNK_SIZE = 4 << 20;
+
+// Byte pattern with wildcards as written in Cheat Engine AOB scans, e.g. "48 8B 05 ?? ?? ?? ?? 48 85 C0"
+class BytePattern final
+{
+public:
+    static constexpr std::size_t NOT_FOUND = std::numeric_limits<std::size_t>::max();
+
+    // Search implementations, Find uses the fastest one the CPU supports
+    enum class SearchPath
+    {
+        SCALAR,
+        SSE2,
+        AVX2,
+    };
+
+    // Throws std::runtime_error if the pattern is malformed or has no fixed bytes
+    explicit BytePattern(const std::string_view pattern);
+
+    std::size_t size() const
+    {
+        return m_bytes.size();
+    }
+
+    bool IsWildcard(const std::size_t index) const
+    {
+        return m_mask[index] == 0;
+    }
+
+    std::uint8_t operator[](const std::size_t index) const
+    {
+        return m_bytes[index];
+    }
+
+    // Offset of the first match in data, or NOT_FOUND
+    // Uses AVX2 or SSE2 on x86 and falls back to a scalar search elsewhere
+    std::size_t Find(const std::byte* data, const std::size_t size) const;
+
+    // Same as Find with the given implementation, e.g. to check them against each other
+    // Falls back to the scalar search if the CPU lacks the instructions
+    std::size_t Find(const std::byte* data, const std::size_t size, const SearchPath path) const;
+
+private:
+    bool Matches(const std::byte* data) const;
+
+    std::size_t FindScalar(const std::byte* data, const std::size_t start, const std::size_t last) const;
+    std::size_t FindSse2(const std::byte* data, const std::size_t last) const;
+    std::size_t FindAvx2(const std::byte* data, const std::size_t last) const;
+
+    std::vector<std::uint8_t> m_bytes;
+    std::vector<std::uint8_t> m_mask;
+
+    // First and last fixed bytes, candidates must match both before the whole pattern is compared
+    std::size_t m_first_anchor = 0;
+    std::size_t m_last_anchor = 0;
+};
+
+// Searches every executable section of the image mapped at base_address, reading it in large chunks
+// Returns the address of the first match, or 0 if there is none
+std::uintptr_t ScanModule(MemorySource& memory_source, const std::uintptr_t base_address, const PeImage& image, const BytePattern& pattern);
+
+}
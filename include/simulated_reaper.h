@@ -0,0 +1,92 @@
+#pragma once
+
+#include "reaper.h"
+#include "reaper_backend.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tnt {
+
+// How often the plugin changed the simulated transport
+struct SimulatedReaperCounters final
+{
+    int seeks = 0;
+    int play_rate_changes = 0;
+    int play_state_changes = 0;
+    int repeat_changes = 0;
+    int time_selection_changes = 0;
+    int preserve_pitch_changes = 0;
+    int ui_refresh_blocks = 0;
+    int tempo_marker_changes = 0;
+    int undo_blocks = 0;
+};
+
+// In-memory stand-in for REAPER's transport, running on its own clock
+// Time only moves on Advance, so the sync logic can be driven much faster than real time and without REAPER
+// Not thread safe, audio buffers have to be simulated on the same thread
+class SimulatedReaper final
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    SimulatedReaper();
+    ~SimulatedReaper();
+
+    SimulatedReaper(const SimulatedReaper&) = delete;
+    SimulatedReaper& operator=(const SimulatedReaper&) = delete;
+
+    // Backend for Reaper that drives this transport, the transport must outlive it
+    std::unique_ptr<ReaperBackend> CreateBackend();
+
+    Clock::time_point GetTime() const;
+
+    // Moves the clock forward, the play position follows at the play rate and wraps around the time selection on repeat
+    void Advance(const Clock::duration duration);
+
+    // After a seek while playing the heard position holds still this long before it moves on
+    // The buffer position (GetPlayPosition2) runs ahead of the heard position by the output latency
+    void SetSeekLatency(const double seek_latency);
+    void SetOutputLatency(const double output_latency);
+
+    // Changes made as the user, not counted
+    void SetEditCursorPosition(const double time, const bool seek_play);
+    void SetPlayRate(const double play_rate);
+    void SetPlayState(const ReaperPlayState play_state);
+    void SetRepeat(const bool repeat);
+    void SetTimeSelection(const double start_time, const double end_time);
+    void SetPreservePitch(const bool preserve_pitch);
+    void SetExtState(const std::string& section, const std::string& key, const std::string& value);
+
+    // Tempo map of the simulated project, only stored and never applied to the transport
+    void SetTempoMarkers(const std::vector<TempoMarker>& markers);
+
+    // Puts the whole transport in this state at once, both positions at the play position without any seek latency
+    void SetState(const ReaperState& state);
+
+    double GetPlayPosition() const;
+    double GetBufferPlayPosition() const;
+    double GetEditCursorPosition() const;
+    ReaperState GetState() const;
+    std::string GetExtState(const std::string& section, const std::string& key) const;
+    const std::vector<TempoMarker>& GetTempoMarkers() const;
+
+    // Everything shown with ShowConsoleMsg
+    const std::vector<std::string>& GetConsoleMessages() const;
+
+    // Changes made through the backend since construction or the last reset
+    // Commands are logged the same way Reaper reports them to its command listener
+    const SimulatedReaperCounters& GetCounters() const;
+    const std::vector<ReaperCommand>& GetCommands() const;
+    void ResetCounters();
+
+private:
+    friend class SimulatedReaperBackend;
+
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+namespace tnt {
+
+// Wait-free ring buffer for exactly one producer and one consumer thread
+// Neither side allocates or locks, so the producer may be a real-time audio thread
+template <typename T, std::size_t CAPACITY>
+class SpscRing final
+{
+    static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "SpscRing capacity must be a power of two");
+    static_assert(std::is_trivially_copyable_v<T>, "SpscRing values must be trivially copyable");
+
+public:
+    // Producer only, returns false and drops the value if the consumer fell behind
+    bool TryPush(const T& value)
+    {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) == CAPACITY)
+        {
+            return false;
+        }
+
+        m_values[head & (CAPACITY - 1)] = value;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only, returns false if the ring is empty
+    bool TryPop(T& value)
+    {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        value = m_values[tail & (CAPACITY - 1)];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    // Keep the producer and consumer indices on separate cache lines
+    static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> m_head = 0;
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> m_tail = 0;
+    alignas(CACHE_LINE_SIZE) std::array<T, CAPACITY> m_values = {};
+};
+
+}
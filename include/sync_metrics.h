@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace tnt {
+
+// Why REAPER's edit cursor was moved
+enum class SeekReason
+{
+    // Guitar Pro's cursor jumped while playing
+    JUMP,
+
+    // REAPER drifted away from Guitar Pro while playing
+    DESYNC,
+
+    // Guitar Pro started playing
+    PLAY_START,
+
+    // Guitar Pro's cursor or time selection was moved while paused
+    CURSOR_MOVED,
+
+    COUNT,
+};
+
+std::string_view ToString(const SeekReason reason);
+
+// Counts values into fixed buckets, nothing is allocated after construction
+class Histogram final
+{
+public:
+    // Bucket upper bounds in ascending order, values above the last one land in an overflow bucket
+    explicit Histogram(const std::span<const double> upper_bounds);
+
+    void Reset();
+    void Add(const double value);
+
+    std::uint64_t GetCount() const;
+    double GetMean() const;
+    double GetMax() const;
+
+    // Interpolated within the bucket the percentile falls into, p is between 0 and 1
+    double GetPercentile(const double p) const;
+
+    std::span<const double> GetUpperBounds() const;
+
+    // One more than the upper bounds, the last one is the overflow bucket
+    std::span<const std::uint64_t> GetBucketCounts() const;
+
+private:
+    std::vector<double> m_upper_bounds;
+    std::vector<std::uint64_t> m_counts;
+    std::uint64_t m_count = 0;
+    double m_sum = 0.0;
+    double m_max = 0.0;
+};
+
+// Running measurements of how well a sync session went, cheap enough to update on every tick
+class SyncMetrics final
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    SyncMetrics();
+
+    // Starts a new session
+    void Reset(const Clock::time_point start);
+
+    // Duration of a whole MainLoop
+    void RecordTick(const Clock::time_point now, const Clock::duration duration);
+
+    // Distance between REAPER and Guitar Pro while both play, either sign
+    void RecordDrift(const double drift);
+
+    void RecordSeek(const SeekReason reason);
+    void RecordPlayRateChange();
+    void RecordCountInStop();
+    void RecordReadFailure();
+
+    // From Guitar Pro being read as playing to REAPER's transport reporting it plays
+    void RecordTimeToPlay(const Clock::duration duration);
+
+    // Single line summary for ExtState, e.g. "ticks=1800;drift_p50_ms=4.2;..."
+    std::string Serialize() const;
+
+    std::string ToJson() const;
+
+    // One metric per row, histogram buckets are named after their upper bound
+    std::string ToCsv() const;
+
+private:
+    // Flat name/value pairs shared by every export
+    std::vector<std::pair<std::string, double>> GetValues() const;
+
+    Clock::time_point m_start;
+    Clock::time_point m_last_tick;
+
+    Histogram m_tick_durations;   // Milliseconds
+    Histogram m_drifts;           // Milliseconds
+    Histogram m_times_to_play;    // Milliseconds
+
+    std::array<std::uint64_t, static_cast<std::size_t>(SeekReason::COUNT)> m_seeks = {};
+    std::uint64_t m_play_rate_changes = 0;
+    std::uint64_t m_count_in_stops = 0;
+    std::uint64_t m_read_failures = 0;
+};
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "guitar_pro.h"
+#include "guitar_pro_layout.h"
+#include "memory_source.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace tnt {
+
+// In-memory stand-in for a running Guitar Pro process
+// Builds the pointer graph described by a GuitarProLayout so the whole read path can run without Guitar Pro
+class SyntheticGuitarPro final
+{
+public:
+    explicit SyntheticGuitarPro(const GuitarProLayout& layout = GUITAR_PRO_LAYOUTS.back());
+    ~SyntheticGuitarPro();
+
+    SyntheticGuitarPro(const SyntheticGuitarPro&) = delete;
+    SyntheticGuitarPro& operator=(const SyntheticGuitarPro&) = delete;
+
+    // Writes every field of the state into the image the same way Guitar Pro stores it
+    void SetState(const GuitarProState& state);
+
+    void SetPlayPosition(const double play_position);
+    void SetTimeSelection(const double start_position, const double end_position);
+    void SetPlayRate(const double play_rate);
+    void SetPlayState(const bool play_state);
+    void SetCountInState(const bool count_in_state);
+    void SetLoopState(const bool loop_state);
+
+    // Rebuilds the pointer graph at new addresses like Guitar Pro does when it opens another score
+    // The old objects stay readable with their old values so stale pointers are not caught by read errors
+    void ReplaceDocument();
+
+    // Moves the objects only this field's chain goes through to new addresses, the rest of the graph is left alone
+    // Throws std::logic_error if the field does not exist or shares its whole chain with another field
+    void ReplaceBranch(const std::string_view field_name);
+
+    // Module hash of the fake GPCore.dll PE header, unique per layout version
+    std::uint64_t GetModuleHash() const;
+
+    // Simulates Guitar Pro exiting (every read fails) or starting again
+    void SetRunning(const bool running);
+
+    // Creates a memory source reading this image, the image must outlive it
+    std::unique_ptr<MemorySource> CreateMemorySource();
+
+    // Factory for GuitarPro that attaches to this image, the image must outlive the GuitarPro instance
+    MemorySourceFactory GetMemorySourceFactory();
+
+    // Saves the image in the MemoryDump format
+    void SaveMemoryDump(const std::filesystem::path& path) const;
+
+private:
+    friend class SyntheticMemorySource;
+
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+}
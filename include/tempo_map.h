@@ -0,0 +1,138 @@
+#pragma once
+
+#include <span>
+#include <string>
+#include <vector>
+
+namespace tnt {
+
+struct TimeSignature final
+{
+    int numerator = 4;
+    int denominator = 4;
+
+    bool operator==(const TimeSignature&) const = default;
+};
+
+// A tempo/time signature marker the way REAPER stores it
+struct TempoMarker final
+{
+    // Position in seconds
+    double time = 0.0;
+
+    // Quarter notes per minute
+    double bpm = 120.0;
+
+    // Time signature starting at this marker, 0 keeps the previous one
+    int numerator = 0;
+    int denominator = 0;
+
+    // Tempo ramps linearly to the next marker
+    bool linear = false;
+};
+
+// A tempo change the way Guitar Pro stores it, relative to the bar it is in
+struct BarTempo final
+{
+    // Zero based
+    int bar = 0;
+
+    // 0 at the start of the bar, 1 at its end
+    double bar_position = 0.0;
+
+    // Quarter notes per minute
+    double bpm = 120.0;
+
+    // Tempo ramps linearly to the next change
+    bool linear = false;
+};
+
+// Converts between seconds, quarter notes and bars
+// Both sides of the conversion are kept in one sorted array of segments and looked up with a binary search
+class TempoMap final
+{
+public:
+    static constexpr double DEFAULT_BPM = 120.0;
+
+    // 120 bpm in 4/4 forever
+    TempoMap();
+
+    // From REAPER's tempo markers, sorted by time
+    static TempoMap FromMarkers(std::span<const TempoMarker> markers);
+
+    // From the time signature of every bar and the tempo changes within them, sorted by position
+    static TempoMap FromBars(std::span<const TimeSignature> bars, std::span<const BarTempo> tempos);
+
+    // Beats are quarter notes since the start of the project
+    double TimeToBeat(const double time) const;
+    double BeatToTime(const double beat) const;
+
+    // Quarter notes per minute at the given beat
+    double GetTempo(const double beat) const;
+
+    // Bars are zero based, the ones after the last known bar repeat its time signature
+    double GetBarBeat(const int bar) const;
+    double GetBarTime(const int bar) const;
+
+    // Beat at a fraction of a bar, 0 at its start and 1 at its end
+    double GetBeat(const int bar, const double bar_position) const;
+    TimeSignature GetTimeSignature(const int bar) const;
+
+    // Bars the map was built from, a marker based map ends with the bar of its last marker
+    int GetBarCount() const;
+
+private:
+    // Tempo is bpm + slope * (beat - start beat) until the next segment
+    struct Segment final
+    {
+        double time = 0.0;
+        double beat = 0.0;
+        double bpm = DEFAULT_BPM;
+        double slope = 0.0;
+    };
+
+    struct TimeSignatureChange final
+    {
+        int bar = 0;
+        double beat = 0.0;
+        TimeSignature time_signature;
+    };
+
+    void AddTimeSignature(const int bar, const double beat, const TimeSignature& time_signature);
+
+    const Segment& FindSegmentByTime(const double time) const;
+    const Segment& FindSegmentByBeat(const double beat) const;
+    const TimeSignatureChange& FindTimeSignature(const int bar) const;
+
+    std::vector<Segment> m_segments;
+    std::vector<TimeSignatureChange> m_time_signatures;
+    int m_bar_count = 0;
+};
+
+// A bar that starts, ends or is divided differently in the two maps
+struct TempoMapMismatch final
+{
+    int bar = 0;
+
+    // Where the bar starts and ends in seconds
+    double expected_start_time = 0.0;
+    double expected_end_time = 0.0;
+    double actual_start_time = 0.0;
+    double actual_end_time = 0.0;
+
+    // Tempo at the start of the bar
+    double expected_bpm = 0.0;
+    double actual_bpm = 0.0;
+
+    TimeSignature expected_time_signature;
+    TimeSignature actual_time_signature;
+};
+
+// Every bar of the expected map whose start or end differs by more than tolerance seconds in the actual map,
+// or whose time signature differs
+std::vector<TempoMapMismatch> DiffTempoMaps(const TempoMap& expected, const TempoMap& actual, const double tolerance);
+
+// Bars are counted from 1 like Guitar Pro does, e.g. "Bar 12 spans 21.500-23.500 s instead of 21.000-23.000 s (120.00 bpm 4/4 instead of 120.00 bpm 4/4)"
+std::string ToString(const TempoMapMismatch& mismatch);
+
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "guitar_pro.h"
+#include "guitar_pro_layout.h"
+#include "reaper.h"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace tnt {
+
+// Sync session trace, append-only so a crash leaves a readable file ending at the last complete record
+// Records still buffered by TraceRecorder are lost with it, up to its last second or 64 KiB of ticks
+//
+// File layout (little endian):
+//   char     magic[8]        "TNTTRACE"
+//   uint32   format_version
+//   records until the end of the file, each one being
+//     uint8    type
+//     varint   nanoseconds since the previous record
+//     payload depending on the type
+//
+// States are stored as a varint bitmask of the fields that changed since the previous record of the same type,
+// followed by the zigzag varint difference of each changed field's bit pattern
+// Unchanged fields cost nothing and doubles round trip exactly
+enum class TraceRecordType : std::uint8_t
+{
+    // varint key size, key, varint value size, value
+    EXT_STATE = 1,
+
+    // ReaperState and output latency at the start of a MainLoop
+    TICK = 2,
+
+    // GuitarProState the tick synced against
+    GUITAR_PRO_STATE = 3,
+
+    // No payload
+    GUITAR_PRO_READ_FAILED = 4,
+
+    // uint8 command type, varint state, double value, double end value
+    REAPER_COMMAND = 5,
+};
+
+struct TraceRecord final
+{
+    TraceRecordType type = TraceRecordType::TICK;
+
+    // Since the start of the trace
+    std::chrono::nanoseconds time = std::chrono::nanoseconds::zero();
+
+    ReaperState reaper_state;
+    double output_latency = 0.0;
+
+    // The timestamp is counted from the start of the trace as well
+    GuitarProState guitar_pro_state;
+
+    ReaperCommand command;
+
+    // Point into the decoded data
+    std::string_view key;
+    std::string_view value;
+};
+
+// Appends records to a buffer, every record is delta encoded against the ones before it
+class TraceEncoder final
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Times are stored relative to the start
+    explicit TraceEncoder(const Clock::time_point start);
+
+    static void EncodeHeader(std::vector<std::byte>& buffer);
+
+    void EncodeExtState(std::vector<std::byte>& buffer, const Clock::time_point time, const std::string_view key, const std::string_view value);
+    void EncodeTick(std::vector<std::byte>& buffer, const Clock::time_point time, const ReaperState& state, const double output_latency);
+    void EncodeGuitarProState(std::vector<std::byte>& buffer, const Clock::time_point time, const GuitarProState& state);
+    void EncodeGuitarProReadFailed(std::vector<std::byte>& buffer, const Clock::time_point time);
+    void EncodeReaperCommand(std::vector<std::byte>& buffer, const Clock::time_point time, const ReaperCommand& command);
+
+    static constexpr std::size_t TICK_FIELD_COUNT = 8;
+    // Every layout field plus the timestamp, the order follows GUITAR_PRO_8_FIELDS so changing it needs a new format version
+    static constexpr std::size_t GUITAR_PRO_STATE_FIELD_COUNT = GUITAR_PRO_FIELD_COUNT + 1;
+
+private:
+    void EncodeRecordStart(std::vector<std::byte>& buffer, const TraceRecordType type, const Clock::time_point time);
+
+    Clock::time_point m_start;
+    Clock::time_point m_previous_time;
+    std::array<std::uint64_t, TICK_FIELD_COUNT> m_previous_tick = {};
+    std::array<std::uint64_t, GUITAR_PRO_STATE_FIELD_COUNT> m_previous_guitar_pro_state = {};
+};
+
+// Reads records back in the order they were encoded
+class TraceDecoder final
+{
+public:
+    // Throws std::runtime_error if the data doesn't start with a trace header of this version
+    explicit TraceDecoder(const std::span<const std::byte> data);
+
+    // False at the end of the data, or at a record that was cut off
+    // Throws std::runtime_error on a record that can't be part of a trace
+    bool Next(TraceRecord& record);
+
+    // True if the data ends in the middle of a record, e.g. because REAPER crashed while recording
+    bool IsTruncated() const;
+
+private:
+    std::span<const std::byte> m_data;
+    std::size_t m_offset = 0;
+    bool m_truncated = false;
+
+    std::chrono::nanoseconds m_time = std::chrono::nanoseconds::zero();
+    std::array<std::uint64_t, TraceEncoder::TICK_FIELD_COUNT> m_tick = {};
+    std::array<std::uint64_t, TraceEncoder::GUITAR_PRO_STATE_FIELD_COUNT> m_guitar_pro_state = {};
+};
+
+}
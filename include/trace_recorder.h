@@ -0,0 +1,50 @@
+#pragma once
+
+#include "guitar_pro.h"
+#include "reaper.h"
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+
+namespace tnt {
+
+// Records a sync session into a trace file, see trace_format.h
+// Records are encoded into memory on the recording thread, a writer thread appends them to the file
+// so the UI thread never waits for the disk
+// Records are handed over about once a second, a crash loses the ones recorded since
+class TraceRecorder final
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TraceRecorder();
+    ~TraceRecorder();
+
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    // Creates the file and starts the writer thread, record times are stored relative to the start time
+    // Throws std::runtime_error if the file can't be created
+    void Start(const std::filesystem::path& path, const Clock::time_point start);
+
+    // Writes out everything recorded so far and waits for the writer thread to exit
+    // Throws std::runtime_error if any write failed
+    void Stop();
+
+    bool IsRecording() const;
+
+    // Do nothing while not recording, all of them must be called from the same thread
+    void RecordExtState(const Clock::time_point time, const std::string_view key, const std::string_view value);
+    void RecordTick(const Clock::time_point time, const ReaperState& state, const double output_latency);
+    void RecordGuitarProState(const Clock::time_point time, const GuitarProState& state);
+    void RecordGuitarProReadFailed(const Clock::time_point time);
+    void RecordReaperCommand(const Clock::time_point time, const ReaperCommand& command);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "reaper.h"
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace tnt {
+
+// A tick where the replayed plugin didn't issue the command that was recorded
+struct TraceDivergence final
+{
+    // Counted from the first tick of the trace
+    std::size_t tick = 0;
+    std::chrono::nanoseconds time = std::chrono::nanoseconds::zero();
+
+    // Only one of them is set if a command was missing from either side
+    std::optional<ReaperCommand> recorded;
+    std::optional<ReaperCommand> replayed;
+};
+
+struct TraceReplayResult final
+{
+    std::size_t tick_count = 0;
+    std::size_t recorded_command_count = 0;
+    std::size_t replayed_command_count = 0;
+    std::vector<TraceDivergence> divergences;
+
+    // Length of the recorded session
+    std::chrono::nanoseconds trace_duration = std::chrono::nanoseconds::zero();
+
+    // The trace ended in the middle of a record, everything before it was replayed
+    bool truncated = false;
+};
+
+// Feeds a recorded trace through the sync logic against a SimulatedReaper and a SyntheticGuitarPro, as fast as possible
+// REAPER's recorded transport state is restored before every tick, so every tick only compares the plugin's own decisions
+// Guitar Pro states are rounded to the encoding of the newest Guitar Pro layout, audio hook drift is not replayed,
+// and states from background polling are replayed as if they had been read on the tick
+class TraceReplayer final
+{
+public:
+    // Maps the trace file
+    // Throws std::runtime_error if it can't be mapped or isn't a trace
+    explicit TraceReplayer(const std::filesystem::path& path);
+    ~TraceReplayer();
+
+    TraceReplayer(const TraceReplayer&) = delete;
+    TraceReplayer& operator=(const TraceReplayer&) = delete;
+
+    // Throws std::runtime_error if the trace is corrupt
+    TraceReplayResult Run() const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+}
@@ -1,21 +1,57 @@
 #pragma once
 
+#ifdef _WIN32
 #include <windows.h>
+#endif
+
 #include <string>
 
 namespace tnt {
 
 // Utility function to convert a std::wstring into a std::string
-std::string WStringToString(const std::wstring& wstr)
+inline std::string WStringToString(const std::wstring& wstr)
 {
     if (wstr.empty()) return {};
 
+#ifdef _WIN32
     int size_needed = WideCharToMultiByte(CP_UTF8, 0, wstr.data(), static_cast<int>(wstr.size()), nullptr, 0, nullptr, nullptr);
 
     std::string result(size_needed, 0);
     WideCharToMultiByte(CP_UTF8, 0, wstr.data(), static_cast<int>(wstr.size()), result.data(), size_needed, nullptr, nullptr);
+#else
+    // wchar_t holds UTF-32 code points everywhere except Windows
+    std::string result;
+    result.reserve(wstr.size());
+
+    for (const wchar_t wc : wstr)
+    {
+        const char32_t c = static_cast<char32_t>(wc);
+        if (c < 0x80)
+        {
+            result += static_cast<char>(c);
+        }
+        else if (c < 0x800)
+        {
+            result += static_cast<char>(0xC0 | (c >> 6));
+            result += static_cast<char>(0x80 | (c & 0x3F));
+        }
+        else if (c < 0x10000)
+        {
+            result += static_cast<char>(0xE0 | (c >> 12));
+            result += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            result += static_cast<char>(0x80 | (c & 0x3F));
+        }
+        else
+        {
+            result += static_cast<char>(0xF0 | (c >> 18));
+            result += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+            result += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            result += static_cast<char>(0x80 | (c & 0x3F));
+        }
+    }
+#endif
 
     return result;
 }
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string_view>
+
+namespace tnt {
+
+// Read-only access to the entries of a zip file, e.g. a Guitar Pro 7/8 .gp file
+// The archive is memory mapped and entries are inflated in fixed size chunks, nothing is extracted to disk
+class ZipArchive final
+{
+public:
+    // Throws std::runtime_error if the file can't be mapped or has no valid central directory
+    explicit ZipArchive(const std::filesystem::path& path);
+
+    bool Contains(const std::string_view name) const;
+
+    // Calls the consumer with consecutive chunks of the uncompressed entry, each only valid during the call
+    // Only stored and deflated entries are supported
+    // Throws std::runtime_error if the entry is missing or corrupt
+    void ReadEntry(const std::string_view name, const std::function<void(std::string_view chunk)>& consumer) const;
+
+private:
+    struct Entry final
+    {
+        std::uint16_t method = 0;
+        std::uint32_t compressed_size = 0;
+        std::uint32_t local_header_offset = 0;
+    };
+
+    bool FindEntry(const std::string_view name, Entry& entry) const;
+
+    std::filesystem::path m_path;
+    MappedFile m_file;
+
+    // Central directory inside the mapping
+    std::size_t m_directory_offset = 0;
+    std::size_t m_directory_size = 0;
+    std::size_t m_entry_count = 0;
+};
+
+}
@@ -0,0 +1,103 @@
+// Only defines the REAPER API function pointers reaper.cpp links against, they stay null since the plugin runs on SimulatedReaper
+#define REAPERAPI_IMPLEMENT
+
+#include "reaper.h"
+#include "trace_replayer.h"
+
+#include <WDL/wdltypes.h> // Must be included before reaper_plugin_functions
+#include <reaper_plugin_functions.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace tnt;
+
+static constexpr std::size_t DEFAULT_MAX_DIVERGENCES = 20;
+
+static void PrintUsage()
+{
+    std::cerr << "Usage: GuitarProSyncReplay trace [--max-divergences N]\n";
+}
+
+int main(int argc, char* argv[])
+{
+    std::filesystem::path trace_path;
+    std::size_t max_divergences = DEFAULT_MAX_DIVERGENCES;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string argument = argv[i];
+        if (argument == "--max-divergences" && i + 1 < argc)
+        {
+            max_divergences = static_cast<std::size_t>(std::max(0, std::atoi(argv[++i])));
+        }
+        else if (trace_path.empty() && !argument.starts_with("--"))
+        {
+            trace_path = argument;
+        }
+        else
+        {
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    if (trace_path.empty())
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    try
+    {
+        const TraceReplayer replayer(trace_path);
+
+        const auto start = std::chrono::steady_clock::now();
+        const TraceReplayResult result = replayer.Run();
+        const auto end = std::chrono::steady_clock::now();
+
+        const double trace_seconds = std::chrono::duration<double>(result.trace_duration).count();
+        const double replay_seconds = std::chrono::duration<double>(end - start).count();
+
+        std::cout << std::format("Replayed {} ticks ({:.1f} s of session) in {:.3f} s, {:.0f}x real time\n",
+            result.tick_count, trace_seconds, replay_seconds, replay_seconds > 0.0 ? trace_seconds / replay_seconds : 0.0);
+        std::cout << std::format("Commands: {} recorded, {} replayed\n", result.recorded_command_count, result.replayed_command_count);
+
+        if (result.truncated)
+        {
+            std::cout << "The trace ends in the middle of a record, it was probably cut off by a crash.\n";
+        }
+
+        for (std::size_t i = 0; i < std::min(max_divergences, result.divergences.size()); i++)
+        {
+            const TraceDivergence& divergence = result.divergences[i];
+            std::cout << std::format("Tick {} at {:.3f} s: recorded {}, replayed {}\n",
+                divergence.tick,
+                std::chrono::duration<double>(divergence.time).count(),
+                divergence.recorded ? ToString(*divergence.recorded) : "nothing",
+                divergence.replayed ? ToString(*divergence.replayed) : "nothing");
+        }
+
+        if (!result.divergences.empty())
+        {
+            std::cout << std::format("{} divergences\n", result.divergences.size());
+            return 1;
+        }
+
+        std::cout << "No divergences\n";
+    }
+    catch (const std::exception& error)
+    {
+        std::cerr << error.what();
+        return 1;
+    }
+
+    return 0;
+}
@@ -1,79 +1,469 @@
 #include "guitar_pro.h"
 
+#include "guitar_pro_events.h"
+#include "guitar_pro_layout.h"
+#include "memory_dump.h"
+#include "offset_database.h"
+#include "process_memory.h"
 #include "process_reader.h"
+#include "profiler.h"
+#include "signature_scanner.h"
 #include "wstring_utils.h"
 
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
 #include <format>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <thread>
 #include <utility>
 
 namespace tnt {
 
-// Constants
-static constexpr int SAMPLE_RATE = 44100;
-static constexpr int PLAY_STATE_FLAG_POSITION = 8;
-static constexpr int COUNT_IN_STATE_FLAG_POSITION = 8;
-static constexpr int LOOP_STATE_FLAG_POSITION = 8;
+// Everything needed to read an attached Guitar Pro process, built by the attach worker or on the calling thread
+struct GuitarProSession final
+{
+    std::unique_ptr<ProcessReader> process_reader;
+
+    // Kept alive across database reloads until the next attach
+    std::shared_ptr<const GuitarProLayout> layout;
+
+    // Read plan index of every layout field
+    ReadPlan read_plan;
+    std::array<std::size_t, GUITAR_PRO_FIELD_COUNT> fields = {};
+
+    // Pointer cache generation the read plan was resolved from
+    std::uint64_t read_plan_generation = 0;
+};
 
 struct GuitarPro::Impl final
 {
-    GuitarProState ReadProcessMemory()
+    Impl(MemorySourceFactory memory_source_factory)
+        : m_memory_source_factory(std::move(memory_source_factory))
+    {}
+
+    GuitarProState ReadProcessMemory(const std::chrono::steady_clock::time_point timestamp)
     {
-        const ProcessReader process_reader(L"GuitarPro.exe", L"GPCore.dll");
+        TNT_PROFILE_SCOPE("GuitarPro::ReadProcessMemory");
 
-        const auto module_offset = [&] {
-            const auto process_version = process_reader.GetProcessVersion();
+        // A failed read reports no events
+        m_events = GuitarProEvents();
 
-            if (process_version == L"8.1.3.121")
+        // Reuse the attach session until Guitar Pro exits or a read fails
+        if (!m_session || !m_session->process_reader->IsProcessRunning())
+        {
+            m_session.reset();
+
+            if (m_async_attach)
             {
-                return 0x00A24F80;
+                this->TakeAttachResult();
             }
-            else if (process_version == L"8.1.4.43")
+            else
             {
-                return 0x00A26F80;
+                m_session = this->Attach(m_memory_source_factory);
             }
+        }
+
+        try
+        {
+            const GuitarProState state = this->ReadState(timestamp);
+
+            // Changes are found right where the data is read so nothing in between is missed
+            m_events = DetectGuitarProEvents(m_previous_state, state);
+            m_previous_state = state;
+
+            return state;
+        }
+        catch (const std::runtime_error&)
+        {
+            // Force a fresh attach on the next call
+            m_session.reset();
+            throw;
+        }
+    }
+
+    const GuitarProEvents& GetEvents() const
+    {
+        return m_events;
+    }
+
+    void SetConsistentReads(const bool enabled)
+    {
+        m_consistent_reads = enabled;
+    }
+
+    void SetAsyncAttach(const bool enabled)
+    {
+        m_async_attach = enabled;
+    }
+
+    void SetOffsetDatabasePath(const std::filesystem::path& path)
+    {
+        std::lock_guard lock(m_database_mutex);
+        m_offset_database.SetPath(path);
+    }
+
+    void ReloadOffsetDatabase()
+    {
+        {
+            std::lock_guard lock(m_database_mutex);
+            m_offset_database.Reload();
+        }
+
+        // Attach again so the new layout is picked up, a session the worker is still building uses the old one
+        std::lock_guard lock(m_attach_mutex);
+        m_attach_generation++;
+        m_attach_result.reset();
+        m_session.reset();
+    }
+
+    void CaptureMemoryDump(const std::filesystem::path& path)
+    {
+        // A separate session so the one in use keeps its cache, owns the recorder until the dump is saved
+        MemoryDumpRecorder* recorder = nullptr;
+        const std::unique_ptr<GuitarProSession> session = this->Attach([&] {
+            auto memory_source = std::make_unique<MemoryDumpRecorder>(m_memory_source_factory());
+            recorder = memory_source.get();
+            return memory_source;
+        });
+
+        recorder->Save(path);
+    }
+
+private:
+    // Either a session ready to read or the reason attaching failed
+    struct AttachResult final
+    {
+        std::unique_ptr<GuitarProSession> session;
+        std::string error;
+    };
+
+    // Hands a session attached in the background over to the caller without ever waiting for the worker
+    // Throws GuitarProAttachPending while the worker is still looking for Guitar Pro
+    void TakeAttachResult()
+    {
+        {
+            std::lock_guard lock(m_attach_mutex);
+            if (m_attach_result)
+            {
+                std::optional<AttachResult> result = std::exchange(m_attach_result, std::nullopt);
+                if (result->session)
+                {
+                    m_attach_error.clear();
+                    m_session = std::move(result->session);
+                    return;
+                }
+
+                // Retried on the next call, the caller paces the retries
+                m_attach_error = std::move(result->error);
+                throw std::runtime_error(m_attach_error);
+            }
+
+            if (!m_attach_requested)
+            {
+                m_attach_requested = true;
+                this->StartAttachWorker();
+                m_attach_condition.notify_one();
+            }
+        }
+
+        // Keep reporting the last failure while retrying so it isn't reported again as new
+        if (!m_attach_error.empty())
+        {
+            throw std::runtime_error(m_attach_error);
+        }
+
+        throw GuitarProAttachPending("Looking for Guitar Pro process.\n");
+    }
+
+    void StartAttachWorker()
+    {
+        if (m_attach_thread.joinable())
+        {
+            return;
+        }
+
+        m_attach_thread = std::jthread([this](std::stop_token stop_token) {
+            this->RunAttachWorker(stop_token);
+        });
+    }
+
+    void RunAttachWorker(const std::stop_token& stop_token)
+    {
+        while (true)
+        {
+            std::uint64_t generation = 0;
+            {
+                std::unique_lock lock(m_attach_mutex);
+                if (!m_attach_condition.wait(lock, stop_token, [this] { return m_attach_requested; }))
+                {
+                    return;
+                }
+
+                generation = m_attach_generation;
+            }
+
+            AttachResult result;
+            try
+            {
+                result.session = this->Attach(m_memory_source_factory);
+            }
+            catch (const std::runtime_error& error)
+            {
+                result.error = error.what();
+            }
+
+            std::lock_guard lock(m_attach_mutex);
+            m_attach_requested = false;
+
+            // Dropped if the offset database was reloaded meanwhile, the next call asks again
+            if (generation == m_attach_generation)
+            {
+                m_attach_result = std::move(result);
+            }
+        }
+    }
+
+    // Enumerates processes, opens the Guitar Pro process, finds its layout and reads it once to validate the offsets
+    // Only touches the offset database under its lock so it can run on the attach worker
+    std::unique_ptr<GuitarProSession> Attach(const MemorySourceFactory& memory_source_factory)
+    {
+        TNT_PROFILE_SCOPE("GuitarPro::Attach");
+
+        auto session = std::make_unique<GuitarProSession>();
+        {
+            TNT_PROFILE_SCOPE("ProcessReader::ProcessReader");
+            session->process_reader = std::make_unique<ProcessReader>(memory_source_factory());
+        }
+
+        ProcessReader& process_reader = *session->process_reader;
+        const auto& process_version = process_reader.GetProcessVersion();
+        const std::uint64_t module_hash = process_reader.GetModuleHash();
 
+        std::shared_ptr<const GuitarProLayout> layout;
+        {
+            std::lock_guard lock(m_database_mutex);
+
+            // Picks up edits to the database file without restarting REAPER
+            m_offset_database.Refresh();
+            layout = m_offset_database.Find(process_version, module_hash);
+        }
+
+        if (!layout)
+        {
+            layout = this->ScanForLayout(process_reader, process_version, module_hash);
+        }
+
+        if (!layout)
+        {
             throw std::runtime_error(std::format("Unsupported Guitar Pro version detected: '{}'\n.", WStringToString(process_version)));
-        }();
+        }
 
-        // Addresses and offsets acquired from CheatEngine with Guitar Pro version 8.1.3 - Build 121
-        const int cursor_location = process_reader.ReadMemoryAddress<int>(module_offset, { 0x18, 0xA0, 0x38, 0x1A8, 0x20, 0x1D8, 0x0 });
-        int time_selection_start_location = process_reader.ReadMemoryAddress<int>(module_offset, { 0x18, 0xA0, 0x38, 0x1A8, 0x20, 0x1E0, 0x0 });
-        int time_selection_end_location = process_reader.ReadMemoryAddress<int>(module_offset, { 0x18, 0xA0, 0x38, 0x1A8, 0x20, 0x1E0, 0x8 });
-        const float play_rate = process_reader.ReadMemoryAddress<float>(module_offset, { 0x18, 0xA0, 0x38, 0x80, 0x18, 0x68, 0x28, 0x74 });
-        const DWORD play_state_flag_container = process_reader.ReadMemoryAddress<DWORD>(module_offset, { 0x18, 0xA0, 0x38, 0x70, 0x30, 0x4E0, 0x0, 0x20, 0x20, 0x0 });
-        const DWORD count_in_state_flag_container = process_reader.ReadMemoryAddress<DWORD>(module_offset, { 0x18, 0xE0, 0x0, 0x28, 0x10, 0x18, 0x60, 0x0 });
-        const DWORD loop_state_flag_container = process_reader.ReadMemoryAddress<DWORD>(module_offset, { 0x18, 0xA0, 0x38, 0x70, 0x30, 0x4B8, 0x28, 0x88, 0x80, 0x0 });
+        session->layout = std::move(layout);
 
-        // Make sure the time selection start is always before the end
-        // If you drag from right to left in Guitar Pro the values may be flipped
-        if (time_selection_start_location > time_selection_end_location)
+        // Resolves every chain once so the first read after the handoff only fetches the values
+        BuildReadPlan(*session);
+        process_reader.ExecuteReadPlan(session->read_plan, false);
+
+        return session;
+    }
+
+    // Finds the root pointer of an unknown build by scanning GPCore.dll for the newest known root signature
+    // The chains below the root pointer are assumed to be unchanged, the result is cached per module hash
+    std::shared_ptr<const GuitarProLayout> ScanForLayout(ProcessReader& process_reader, const std::wstring& process_version, const std::uint64_t module_hash)
+    {
+        std::shared_ptr<const GuitarProLayout> signature_layout;
+        {
+            std::lock_guard lock(m_database_mutex);
+            signature_layout = m_offset_database.FindSignatureLayout();
+            if (!signature_layout || !module_hash || module_hash == m_failed_scan_module_hash)
+            {
+                return nullptr;
+            }
+        }
+
+        // The scan reads the whole code section, the database stays available meanwhile
+        const RootSignature& signature = signature_layout->root_signature;
+        const std::uintptr_t module_offset = process_reader.FindRipRelativeTarget(BytePattern(signature.pattern), signature.displacement_offset, signature.instruction_size);
+
+        std::lock_guard lock(m_database_mutex);
+        if (!module_offset)
         {
-            std::swap(time_selection_start_location, time_selection_end_location);
+            // Scanning again won't help until Guitar Pro is updated
+            m_failed_scan_module_hash = module_hash;
+            return nullptr;
+        }
+
+        GuitarProLayout layout = *signature_layout;
+        layout.module_offset = module_offset;
+
+        return m_offset_database.AddScannedLayout(process_version, module_hash, layout);
+    }
+
+    GuitarProState ReadState(const std::chrono::steady_clock::time_point timestamp)
+    {
+        TNT_PROFILE_SCOPE("GuitarPro::ReadState");
+
+        GuitarProSession& session = *m_session;
+        ProcessReader& process_reader = *session.process_reader;
+        const GuitarProLayout& layout = *session.layout;
+
+        // Resolved chains are cached between reads, re-check the document pointer shared by most chains
+        // so everything gets resolved again when Guitar Pro opens or switches to another score
+        process_reader.ValidatePointerCache(layout.module_offset, layout.document_chain);
+
+        // Guitar Pro also reallocates objects below that prefix, a few cached hops are re-checked per read to catch those
+        process_reader.ValidateCachedHops();
+
+        // The plan only has to be resolved again when a check above or a failed read dropped the cache
+        if (session.read_plan_generation != process_reader.GetPointerCacheGeneration())
+        {
+            BuildReadPlan(session);
+        }
+
+        if (!process_reader.TryExecuteReadPlan(session.read_plan, m_consistent_reads))
+        {
+            // Cached chains may have gone stale, resolve them again once before giving up
+            process_reader.ClearPointerCache();
+            BuildReadPlan(session);
+            process_reader.ExecuteReadPlan(session.read_plan, m_consistent_reads);
         }
 
         GuitarProState state{};
-        state.play_position = static_cast<double>(cursor_location) / SAMPLE_RATE;
-        state.time_selection_start_position = static_cast<double>(time_selection_start_location) / SAMPLE_RATE;
-        state.time_selection_end_position = static_cast<double>(time_selection_end_location) / SAMPLE_RATE;
-        state.play_rate = static_cast<double>(play_rate);
-        state.play_state = play_state_flag_container & (1U << PLAY_STATE_FLAG_POSITION);
-        state.count_in_state = count_in_state_flag_container & (1U << COUNT_IN_STATE_FLAG_POSITION);
-        state.loop_state = loop_state_flag_container & (1U << LOOP_STATE_FLAG_POSITION);
+
+        // Every field is decoded from the same read so they all share this timestamp
+        state.timestamp = timestamp;
+
+        for (std::size_t i = 0; i < layout.fields.size(); i++)
+        {
+            const GuitarProField& field = layout.fields[i];
+
+            switch (field.type)
+            {
+            case GuitarProFieldType::INT32:
+                state.*field.value = static_cast<double>(session.read_plan.Get<std::int32_t>(session.fields[i])) * field.scale;
+                break;
+            case GuitarProFieldType::FLOAT32:
+                state.*field.value = static_cast<double>(session.read_plan.Get<float>(session.fields[i])) * field.scale;
+                break;
+            case GuitarProFieldType::FLAG32:
+                state.*field.flag = (session.read_plan.Get<std::uint32_t>(session.fields[i]) & (1U << field.flag_bit)) != 0;
+                break;
+            }
+        }
+
+        // Make sure the time selection start is always before the end
+        // If you drag from right to left in Guitar Pro the values may be flipped
+        if (state.time_selection_start_position > state.time_selection_end_position)
+        {
+            std::swap(state.time_selection_start_position, state.time_selection_end_position);
+        }
 
         return state;
     }
+
+    // Resolves the address of every field and groups them into as few reads as possible
+    static void BuildReadPlan(GuitarProSession& session)
+    {
+        session.read_plan.Clear();
+
+        for (std::size_t i = 0; i < session.layout->fields.size(); i++)
+        {
+            const GuitarProField& field = session.layout->fields[i];
+            const std::uintptr_t address = session.process_reader->ResolvePointer(session.layout->module_offset, field.pointer_chain);
+            session.fields[i] = session.read_plan.AddField(address, GUITAR_PRO_FIELD_SIZE);
+        }
+
+        session.read_plan.Build();
+        session.read_plan_generation = session.process_reader->GetPointerCacheGeneration();
+    }
+
+    MemorySourceFactory m_memory_source_factory;
+    std::unique_ptr<GuitarProSession> m_session;
+
+    // Shared with the attach worker
+    std::mutex m_database_mutex;
+    OffsetDatabase m_offset_database;
+
+    // Module hash of the last build the root signature was not found in, guarded by the database mutex
+    std::uint64_t m_failed_scan_module_hash = 0;
+
+    // Compared against the next read, kept across attaches so a reconnect only reports what changed meanwhile
+    GuitarProState m_previous_state;
+    GuitarProEvents m_events;
+
+    // Re-reads the snapshot until two consecutive reads match
+    bool m_consistent_reads = false;
+
+    // Attach worker state, everything but the thread and the last error is guarded by the attach mutex
+    bool m_async_attach = false;
+    std::mutex m_attach_mutex;
+    std::condition_variable_any m_attach_condition;
+    bool m_attach_requested = false;
+    std::uint64_t m_attach_generation = 0;
+    std::optional<AttachResult> m_attach_result;
+    std::string m_attach_error;
+
+    // Declared last so it is joined before anything the worker uses is destroyed
+    std::jthread m_attach_thread;
 };
 
 GuitarPro::GuitarPro()
-    : m_impl(std::make_unique<Impl>())
+    : GuitarPro([] { return std::make_unique<ProcessMemory>(L"GuitarPro.exe", L"GPCore.dll"); })
+{}
+
+GuitarPro::GuitarPro(MemorySourceFactory memory_source_factory)
+    : m_impl(std::make_unique<Impl>(std::move(memory_source_factory)))
 {}
 
 GuitarPro::~GuitarPro() = default;
 
 GuitarProState GuitarPro::ReadProcessMemory()
 {
-    return m_impl->ReadProcessMemory();
+    return m_impl->ReadProcessMemory(std::chrono::steady_clock::now());
+}
+
+GuitarProState GuitarPro::ReadProcessMemory(const std::chrono::steady_clock::time_point timestamp)
+{
+    return m_impl->ReadProcessMemory(timestamp);
+}
+
+const GuitarProEvents& GuitarPro::GetEvents() const
+{
+    return m_impl->GetEvents();
+}
+
+void GuitarPro::SetConsistentReads(const bool enabled)
+{
+    m_impl->SetConsistentReads(enabled);
+}
+
+void GuitarPro::SetAsyncAttach(const bool enabled)
+{
+    m_impl->SetAsyncAttach(enabled);
+}
+
+void GuitarPro::CaptureMemoryDump(const std::filesystem::path& path)
+{
+    m_impl->CaptureMemoryDump(path);
+}
+
+void GuitarPro::SetOffsetDatabasePath(const std::filesystem::path& path)
+{
+    m_impl->SetOffsetDatabasePath(path);
+}
+
+void GuitarPro::ReloadOffsetDatabase()
+{
+    m_impl->ReloadOffsetDatabase();
 }
 
 }
\ No newline at end of file
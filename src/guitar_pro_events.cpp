@@ -0,0 +1,133 @@
+#include "guitar_pro_events.h"
+
+#include "position_estimator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace tnt {
+
+static std::uint32_t Bit(const GuitarProEventType type)
+{
+    return std::uint32_t(1) << static_cast<int>(type);
+}
+
+static bool Changed(const double a, const double b, const double step)
+{
+    return !(std::fabs(a - b) < step);
+}
+
+std::string_view ToString(const GuitarProEventType type)
+{
+    switch (type)
+    {
+    case GuitarProEventType::CURSOR_MOVED:
+        return "cursor_moved";
+    case GuitarProEventType::CURSOR_JUMPED:
+        return "cursor_jumped";
+    case GuitarProEventType::PLAY_STARTED:
+        return "play_started";
+    case GuitarProEventType::PLAY_STOPPED:
+        return "play_stopped";
+    case GuitarProEventType::COUNT_IN_BEGAN:
+        return "count_in_began";
+    case GuitarProEventType::LOOP_TOGGLED:
+        return "loop_toggled";
+    case GuitarProEventType::SELECTION_CHANGED:
+        return "selection_changed";
+    case GuitarProEventType::RATE_CHANGED:
+        return "rate_changed";
+    default:
+        // This should never happen
+        return "unknown";
+    }
+}
+
+void GuitarProEvents::Add(const GuitarProEventType type, const Clock::time_point timestamp)
+{
+    mask |= Bit(type);
+    timestamps[static_cast<std::size_t>(type)] = timestamp;
+}
+
+void GuitarProEvents::Merge(const GuitarProEvents& events)
+{
+    for (std::size_t i = 0; i < timestamps.size(); i++)
+    {
+        const auto type = static_cast<GuitarProEventType>(i);
+        if (events.Has(type) && (!this->Has(type) || events.timestamps[i] > timestamps[i]))
+        {
+            timestamps[i] = events.timestamps[i];
+        }
+    }
+
+    mask |= events.mask;
+}
+
+bool GuitarProEvents::Has(const GuitarProEventType type) const
+{
+    return (mask & Bit(type)) != 0;
+}
+
+bool GuitarProEvents::Any() const
+{
+    return mask != 0;
+}
+
+GuitarProEvents::Clock::time_point GuitarProEvents::GetTimestamp(const GuitarProEventType type) const
+{
+    return timestamps[static_cast<std::size_t>(type)];
+}
+
+GuitarProEvents DetectGuitarProEvents(const GuitarProState& previous, const GuitarProState& state)
+{
+    GuitarProEvents events;
+    const auto time = state.timestamp;
+
+    if (Changed(state.play_position, previous.play_position, MINIMUM_TIME_STEP))
+    {
+        events.Add(GuitarProEventType::CURSOR_MOVED, time);
+
+        // Playback only explains the move if Guitar Pro was already playing
+        double expected_position = previous.play_position;
+        if (previous.play_state && state.play_state)
+        {
+            const double play_rate = previous.play_rate > MINIMUM_PLAY_RATE_STEP ? previous.play_rate : 1.0;
+            expected_position += std::chrono::duration<double>(time - previous.timestamp).count() * play_rate;
+        }
+
+        if (std::fabs(state.play_position - expected_position) > PositionEstimator::JUMP_THRESHOLD || !state.play_state)
+        {
+            events.Add(GuitarProEventType::CURSOR_JUMPED, time);
+        }
+    }
+
+    if (state.play_state != previous.play_state)
+    {
+        events.Add(state.play_state ? GuitarProEventType::PLAY_STARTED : GuitarProEventType::PLAY_STOPPED, time);
+    }
+
+    if (state.count_in_state && !previous.count_in_state)
+    {
+        events.Add(GuitarProEventType::COUNT_IN_BEGAN, time);
+    }
+
+    if (state.loop_state != previous.loop_state)
+    {
+        events.Add(GuitarProEventType::LOOP_TOGGLED, time);
+    }
+
+    if (Changed(state.time_selection_start_position, previous.time_selection_start_position, MINIMUM_TIME_STEP)
+     || Changed(state.time_selection_end_position, previous.time_selection_end_position, MINIMUM_TIME_STEP))
+    {
+        events.Add(GuitarProEventType::SELECTION_CHANGED, time);
+    }
+
+    if (Changed(state.play_rate, previous.play_rate, MINIMUM_PLAY_RATE_STEP))
+    {
+        events.Add(GuitarProEventType::RATE_CHANGED, time);
+    }
+
+    return events;
+}
+
+}
@@ -0,0 +1,257 @@
+#include "guitar_pro_poller.h"
+
+#include "poll_scheduler.h"
+#include "seqlock.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <timeapi.h>
+#pragma comment(lib, "Winmm.lib")
+#endif
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <thread>
+
+namespace tnt {
+
+// What the polling thread publishes after every read
+struct GuitarProSnapshot final
+{
+    GuitarProState state;
+
+    // Number of reads so far, 0 until the first read finished
+    std::uint64_t sample = 0;
+
+    // Occurrences of every event type so far and when each was last seen
+    // The UI thread compares the counts with the ones it already handled
+    std::array<std::uint32_t, static_cast<std::size_t>(GuitarProEventType::COUNT)> event_counts = {};
+    GuitarProEvents latest_events;
+
+    // Set if the read failed, the message is kept next to the SeqLock since strings can't be copied through it
+    bool failed = false;
+    std::uint64_t error_generation = 0;
+};
+
+struct GuitarProPoller::Impl final
+{
+    Impl(GuitarPro& guitar_pro)
+        : m_guitar_pro(guitar_pro)
+    {}
+
+    ~Impl()
+    {
+        this->Stop();
+    }
+
+    void Start(const double rate)
+    {
+        this->Stop();
+
+        const double clamped_rate = std::clamp(rate, MIN_POLLING_RATE, MAX_POLLING_RATE);
+        const auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / clamped_rate));
+
+        m_snapshot.Store(GuitarProSnapshot{});
+        m_handled_event_counts = {};
+        m_poll_state.store(PollState::ACTIVE, std::memory_order_relaxed);
+        m_poll_interval.store(interval.count(), std::memory_order_relaxed);
+        m_thread = std::jthread([this, interval](std::stop_token stop_token) {
+            this->Run(stop_token, interval);
+        });
+    }
+
+    void Stop()
+    {
+        if (!m_thread.joinable())
+        {
+            return;
+        }
+
+        m_thread.request_stop();
+        m_thread.join();
+    }
+
+    bool IsRunning() const
+    {
+        return m_thread.joinable();
+    }
+
+    PollState GetPollState() const
+    {
+        return m_poll_state.load(std::memory_order_relaxed);
+    }
+
+    std::chrono::steady_clock::duration GetPollInterval() const
+    {
+        return std::chrono::steady_clock::duration(m_poll_interval.load(std::memory_order_relaxed));
+    }
+
+    bool GetLatestState(GuitarProState& state, GuitarProEvents& events)
+    {
+        const GuitarProSnapshot snapshot = m_snapshot.Load();
+        if (snapshot.failed)
+        {
+            // Only taken when a read failed, never on the normal path
+            std::lock_guard lock(m_error_mutex);
+            throw std::runtime_error(m_error);
+        }
+
+        if (snapshot.sample == 0)
+        {
+            return false;
+        }
+
+        state = snapshot.state;
+
+        events = GuitarProEvents();
+        for (std::size_t i = 0; i < snapshot.event_counts.size(); i++)
+        {
+            if (snapshot.event_counts[i] != m_handled_event_counts[i])
+            {
+                const auto type = static_cast<GuitarProEventType>(i);
+                events.Add(type, snapshot.latest_events.GetTimestamp(type));
+            }
+        }
+
+        m_handled_event_counts = snapshot.event_counts;
+        return true;
+    }
+
+private:
+    void Run(const std::stop_token& stop_token, const std::chrono::steady_clock::duration interval)
+    {
+#ifdef _WIN32
+        // The default 15.6 ms timer resolution is far too coarse for these rates
+        timeBeginPeriod(1);
+#endif
+
+        GuitarProSnapshot snapshot;
+        PollScheduler poll_scheduler(interval);
+
+        std::mutex wait_mutex;
+        std::condition_variable_any wait_condition;
+
+        while (!stop_token.stop_requested())
+        {
+            // Scheduled from the start of the read so slow reads don't lower the rate
+            const auto now = std::chrono::steady_clock::now();
+
+            try
+            {
+                snapshot.state = m_guitar_pro.ReadProcessMemory();
+                snapshot.failed = false;
+                this->CountEvents(snapshot, m_guitar_pro.GetEvents());
+                poll_scheduler.OnRead(now, snapshot.state);
+            }
+            catch (const GuitarProAttachPending&)
+            {
+                // Nothing to publish yet, check again after one interval
+                std::unique_lock lock(wait_mutex);
+                wait_condition.wait_until(lock, stop_token, now + interval, [] { return false; });
+                continue;
+            }
+            catch (const std::runtime_error& error)
+            {
+                poll_scheduler.OnReadFailed(now);
+
+                std::lock_guard lock(m_error_mutex);
+                if (!snapshot.failed || m_error != error.what())
+                {
+                    m_error = error.what();
+                    snapshot.error_generation++;
+                }
+
+                snapshot.failed = true;
+            }
+
+            snapshot.sample++;
+            m_snapshot.Store(snapshot);
+
+            m_poll_state.store(poll_scheduler.GetState(), std::memory_order_relaxed);
+            m_poll_interval.store(poll_scheduler.GetInterval().count(), std::memory_order_relaxed);
+
+            std::unique_lock lock(wait_mutex);
+            wait_condition.wait_until(lock, stop_token, poll_scheduler.GetNextPoll(), [] { return false; });
+        }
+
+#ifdef _WIN32
+        timeEndPeriod(1);
+#endif
+    }
+
+    static void CountEvents(GuitarProSnapshot& snapshot, const GuitarProEvents& events)
+    {
+        for (std::size_t i = 0; i < snapshot.event_counts.size(); i++)
+        {
+            if (events.Has(static_cast<GuitarProEventType>(i)))
+            {
+                snapshot.event_counts[i]++;
+            }
+        }
+
+        snapshot.latest_events.Merge(events);
+    }
+
+    GuitarPro& m_guitar_pro;
+    std::jthread m_thread;
+
+    SeqLock<GuitarProSnapshot> m_snapshot;
+
+    // UI thread only
+    std::array<std::uint32_t, static_cast<std::size_t>(GuitarProEventType::COUNT)> m_handled_event_counts = {};
+
+    // Only informational, may briefly disagree with each other
+    std::atomic<PollState> m_poll_state = PollState::ACTIVE;
+    std::atomic<std::chrono::steady_clock::rep> m_poll_interval = 0;
+
+    mutable std::mutex m_error_mutex;
+    std::string m_error;
+};
+
+GuitarProPoller::GuitarProPoller(GuitarPro& guitar_pro)
+    : m_impl(std::make_unique<Impl>(guitar_pro))
+{}
+
+GuitarProPoller::~GuitarProPoller() = default;
+
+void GuitarProPoller::Start(const double rate)
+{
+    m_impl->Start(rate);
+}
+
+void GuitarProPoller::Stop()
+{
+    m_impl->Stop();
+}
+
+bool GuitarProPoller::IsRunning() const
+{
+    return m_impl->IsRunning();
+}
+
+PollState GuitarProPoller::GetPollState() const
+{
+    return m_impl->GetPollState();
+}
+
+std::chrono::steady_clock::duration GuitarProPoller::GetPollInterval() const
+{
+    return m_impl->GetPollInterval();
+}
+
+bool GuitarProPoller::GetLatestState(GuitarProState& state, GuitarProEvents& events)
+{
+    return m_impl->GetLatestState(state, events);
+}
+
+}
@@ -0,0 +1,495 @@
+#include "guitar_pro_score.h"
+
+#include "zip_archive.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <format>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace tnt {
+
+static constexpr std::string_view SCORE_ENTRY_NAME = "Content/score.gpif";
+
+// Element names along the paths the parser cares about
+static constexpr std::string_view GPIF_ELEMENT = "GPIF";
+static constexpr std::string_view MASTER_TRACK_ELEMENT = "MasterTrack";
+static constexpr std::string_view AUTOMATIONS_ELEMENT = "Automations";
+static constexpr std::string_view AUTOMATION_ELEMENT = "Automation";
+static constexpr std::string_view MASTER_BARS_ELEMENT = "MasterBars";
+static constexpr std::string_view MASTER_BAR_ELEMENT = "MasterBar";
+static constexpr std::string_view TIME_ELEMENT = "Time";
+static constexpr std::string_view REPEAT_ELEMENT = "Repeat";
+static constexpr std::string_view ALTERNATE_ENDINGS_ELEMENT = "AlternateEndings";
+static constexpr std::string_view DIRECTIONS_ELEMENT = "Directions";
+
+static constexpr std::string_view TEMPO_AUTOMATION_TYPE = "Tempo";
+
+// Quarter notes per tempo unit, the unit is the second number of a tempo automation value (e.g. "120 2")
+// 1 = eighth, 2 = quarter, 3 = dotted quarter, 4 = half, 5 = dotted half
+static constexpr std::array<double, 5> TEMPO_UNIT_QUARTER_NOTES = { 0.5, 1.0, 1.5, 2.0, 3.0 };
+static constexpr int DEFAULT_TEMPO_UNIT = 2;
+
+// Changes closer than this are at the same position
+static constexpr double BEAT_EPSILON = 0.000001;
+
+static std::string_view Trim(std::string_view text)
+{
+    static constexpr std::string_view WHITESPACE = " \t\r\n";
+
+    const std::size_t start = text.find_first_not_of(WHITESPACE);
+    if (start == std::string_view::npos)
+    {
+        return {};
+    }
+
+    return text.substr(start, text.find_last_not_of(WHITESPACE) - start + 1);
+}
+
+// Value of an attribute in the text following a tag's name, empty if it is missing
+static std::string_view GetAttribute(const std::string_view attributes, const std::string_view name)
+{
+    for (std::size_t position = attributes.find(name); position != std::string_view::npos; position = attributes.find(name, position + 1))
+    {
+        // Only whole attribute names, not the end of a longer one or a value
+        if (position == 0 || !std::isspace(static_cast<unsigned char>(attributes[position - 1])))
+        {
+            continue;
+        }
+
+        std::string_view rest = Trim(attributes.substr(position + name.size()));
+        if (!rest.starts_with('='))
+        {
+            continue;
+        }
+
+        rest = Trim(rest.substr(1));
+        if (rest.empty() || (rest.front() != '"' && rest.front() != '\''))
+        {
+            continue;
+        }
+
+        const std::size_t end = rest.find(rest.front(), 1);
+        return end == std::string_view::npos ? std::string_view() : rest.substr(1, end - 1);
+    }
+
+    return {};
+}
+
+template <typename T>
+static bool ParseNumber(std::string_view text, T& value)
+{
+    text = Trim(text);
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return error == std::errc() && end == text.data() + text.size();
+}
+
+// Event driven score.gpif parser, only the elements the tempo map needs are looked at
+// The XML can be fed in chunks of any size, only an incomplete tag or text is carried over to the next chunk
+class GpifParser final
+{
+public:
+    // The path only names the file in error messages
+    explicit GpifParser(const std::filesystem::path& path)
+        : m_file_path(path)
+    {}
+
+    void Parse(const std::string_view chunk)
+    {
+        m_buffer.append(chunk);
+
+        std::size_t position = 0;
+        while (this->ParseNext(position))
+        {
+        }
+
+        m_buffer.erase(0, position);
+    }
+
+    GuitarProScore Finish()
+    {
+        if (m_depth != 0 || !Trim(m_buffer).empty())
+        {
+            throw std::runtime_error(std::format("The score in '{}' ends early.\n", m_file_path.string()));
+        }
+
+        if (m_score.bars.empty())
+        {
+            throw std::runtime_error(std::format("The score in '{}' has no bars.\n", m_file_path.string()));
+        }
+
+        // Automations are grouped by track, not necessarily by position
+        std::stable_sort(m_score.tempos.begin(), m_score.tempos.end(), [](const BarTempo& a, const BarTempo& b) {
+            return a.bar != b.bar ? a.bar < b.bar : a.bar_position < b.bar_position;
+        });
+
+        return std::move(m_score);
+    }
+
+private:
+    struct Automation final
+    {
+        std::string type;
+        BarTempo tempo;
+    };
+
+    // Returns false once the rest of the buffer needs more data
+    bool ParseNext(std::size_t& position)
+    {
+        if (position == m_buffer.size())
+        {
+            return false;
+        }
+
+        if (m_buffer[position] != '<')
+        {
+            const std::size_t end = m_buffer.find('<', position);
+            if (end == std::string::npos)
+            {
+                return false;
+            }
+
+            this->OnText(std::string_view(m_buffer).substr(position, end - position));
+            position = end;
+            return true;
+        }
+
+        const std::string_view markup = std::string_view(m_buffer).substr(position);
+        if (markup.starts_with("<![CDATA["))
+        {
+            const std::size_t end = markup.find("]]>");
+            if (end == std::string_view::npos)
+            {
+                return false;
+            }
+
+            this->OnText(markup.substr(9, end - 9));
+            position += end + 3;
+            return true;
+        }
+
+        if (markup.starts_with("<!--"))
+        {
+            const std::size_t end = markup.find("-->");
+            if (end == std::string_view::npos)
+            {
+                return false;
+            }
+
+            position += end + 3;
+            return true;
+        }
+
+        const std::size_t end = markup.find('>');
+        if (end == std::string_view::npos)
+        {
+            return false;
+        }
+
+        position += end + 1;
+
+        // Declarations and processing instructions carry nothing of interest
+        const std::string_view tag = markup.substr(1, end - 1);
+        if (tag.empty() || tag.front() == '?' || tag.front() == '!')
+        {
+            return true;
+        }
+
+        if (tag.front() == '/')
+        {
+            this->OnEndElement();
+            return true;
+        }
+
+        const std::size_t name_end = std::min(tag.find_first_of(" \t\r\n/"), tag.size());
+        this->OnStartElement(tag.substr(0, name_end), tag.substr(name_end));
+        if (tag.back() == '/')
+        {
+            this->OnEndElement();
+        }
+
+        return true;
+    }
+
+    void OnStartElement(const std::string_view name, const std::string_view attributes)
+    {
+        if (m_depth < m_elements.size())
+        {
+            m_elements[m_depth].assign(name);
+        }
+        else
+        {
+            m_elements.emplace_back(name);
+        }
+
+        m_depth++;
+        m_text.clear();
+
+        if (m_depth == 4 && this->IsAt({ GPIF_ELEMENT, MASTER_TRACK_ELEMENT, AUTOMATIONS_ELEMENT, AUTOMATION_ELEMENT }))
+        {
+            m_automation = Automation();
+            m_automation_value.clear();
+        }
+        else if (m_depth == 4 && this->IsAt({ GPIF_ELEMENT, MASTER_BARS_ELEMENT, MASTER_BAR_ELEMENT, REPEAT_ELEMENT }))
+        {
+            // Written on every bar by some versions, only the flags tell whether a repeat starts or ends here
+            if (GetAttribute(attributes, "start") == "true" || GetAttribute(attributes, "end") == "true")
+            {
+                this->AddPlaybackJump(GuitarProPlaybackJump::Type::REPEAT);
+            }
+        }
+        else if (m_depth == 4 && this->IsAt({ GPIF_ELEMENT, MASTER_BARS_ELEMENT, MASTER_BAR_ELEMENT, DIRECTIONS_ELEMENT }))
+        {
+            this->AddPlaybackJump(GuitarProPlaybackJump::Type::DIRECTION);
+        }
+    }
+
+    void OnText(const std::string_view text)
+    {
+        // Only leaf elements below the master track and master bars hold values that are used
+        if (m_depth >= 4 && m_elements[0] == GPIF_ELEMENT && (m_elements[1] == MASTER_TRACK_ELEMENT || m_elements[1] == MASTER_BARS_ELEMENT))
+        {
+            m_text.append(text);
+        }
+    }
+
+    void OnEndElement()
+    {
+        if (m_depth == 0)
+        {
+            throw std::runtime_error(std::format("The score in '{}' is not valid XML.\n", m_file_path.string()));
+        }
+
+        if (m_depth == 5 && this->IsAt({ GPIF_ELEMENT, MASTER_TRACK_ELEMENT, AUTOMATIONS_ELEMENT, AUTOMATION_ELEMENT }))
+        {
+            this->OnAutomationField(m_elements[4]);
+        }
+        else if (m_depth == 4 && this->IsAt({ GPIF_ELEMENT, MASTER_TRACK_ELEMENT, AUTOMATIONS_ELEMENT, AUTOMATION_ELEMENT }))
+        {
+            this->OnAutomation();
+        }
+        else if (m_depth == 4 && this->IsAt({ GPIF_ELEMENT, MASTER_BARS_ELEMENT, MASTER_BAR_ELEMENT, TIME_ELEMENT }))
+        {
+            this->OnTimeSignature();
+        }
+        else if (m_depth == 4 && this->IsAt({ GPIF_ELEMENT, MASTER_BARS_ELEMENT, MASTER_BAR_ELEMENT, ALTERNATE_ENDINGS_ELEMENT }))
+        {
+            if (!Trim(m_text).empty())
+            {
+                this->AddPlaybackJump(GuitarProPlaybackJump::Type::ALTERNATE_ENDING);
+            }
+        }
+        else if (m_depth == 3 && this->IsAt({ GPIF_ELEMENT, MASTER_BARS_ELEMENT, MASTER_BAR_ELEMENT }))
+        {
+            m_score.bars.push_back(m_time_signature);
+        }
+
+        m_depth--;
+        m_text.clear();
+    }
+
+    void OnAutomationField(const std::string_view name)
+    {
+        const std::string_view text = Trim(m_text);
+
+        if (name == "Type")
+        {
+            m_automation.type.assign(text);
+        }
+        else if (name == "Linear")
+        {
+            m_automation.tempo.linear = text == "true";
+        }
+        else if (name == "Bar" && !ParseNumber(text, m_automation.tempo.bar))
+        {
+            throw std::runtime_error(std::format("Invalid automation bar '{}' in '{}'.\n", text, m_file_path.string()));
+        }
+        else if (name == "Position" && !ParseNumber(text, m_automation.tempo.bar_position))
+        {
+            throw std::runtime_error(std::format("Invalid automation position '{}' in '{}'.\n", text, m_file_path.string()));
+        }
+        else if (name == "Value")
+        {
+            // Other automation types have other values, they are only parsed once the type is known
+            m_automation_value.assign(text);
+        }
+    }
+
+    void OnAutomation()
+    {
+        if (m_automation.type != TEMPO_AUTOMATION_TYPE)
+        {
+            return;
+        }
+
+        const std::string_view value = m_automation_value;
+        const std::size_t separator = value.find(' ');
+
+        double bpm = 0.0;
+        int tempo_unit = DEFAULT_TEMPO_UNIT;
+        if (!ParseNumber(value.substr(0, separator), bpm)
+         || bpm <= 0.0
+         || (separator != std::string_view::npos && !ParseNumber(value.substr(separator + 1), tempo_unit))
+         || tempo_unit < 1
+         || tempo_unit > static_cast<int>(TEMPO_UNIT_QUARTER_NOTES.size()))
+        {
+            throw std::runtime_error(std::format("Invalid tempo '{}' in '{}'.\n", value, m_file_path.string()));
+        }
+
+        m_automation.tempo.bpm = bpm * TEMPO_UNIT_QUARTER_NOTES[tempo_unit - 1];
+        m_score.tempos.push_back(m_automation.tempo);
+    }
+
+    void OnTimeSignature()
+    {
+        const std::string_view text = Trim(m_text);
+        const std::size_t separator = text.find('/');
+
+        TimeSignature time_signature;
+        if (separator == std::string_view::npos
+         || !ParseNumber(text.substr(0, separator), time_signature.numerator)
+         || !ParseNumber(text.substr(separator + 1), time_signature.denominator)
+         || time_signature.numerator <= 0
+         || time_signature.denominator <= 0)
+        {
+            throw std::runtime_error(std::format("Invalid time signature '{}' in '{}'.\n", text, m_file_path.string()));
+        }
+
+        m_time_signature = time_signature;
+    }
+
+    // At the master bar being parsed, it is only added to the bars once it ends
+    void AddPlaybackJump(const GuitarProPlaybackJump::Type type)
+    {
+        m_score.playback_jumps.push_back({ static_cast<int>(m_score.bars.size()), type });
+    }
+
+    // True if the innermost open elements start with the given path
+    bool IsAt(std::initializer_list<std::string_view> path) const
+    {
+        if (m_depth < path.size())
+        {
+            return false;
+        }
+
+        return std::equal(path.begin(), path.end(), m_elements.begin());
+    }
+
+    std::filesystem::path m_file_path;
+    std::string m_buffer;
+
+    // Names of the open elements, only the first m_depth are valid so their storage is reused
+    std::vector<std::string> m_elements;
+    std::size_t m_depth = 0;
+
+    std::string m_text;
+    Automation m_automation;
+    std::string m_automation_value;
+
+    // Bars without a time signature keep the previous one
+    TimeSignature m_time_signature;
+
+    GuitarProScore m_score;
+};
+
+std::string ToString(const GuitarProPlaybackJump& playback_jump)
+{
+    switch (playback_jump.type)
+    {
+    case GuitarProPlaybackJump::Type::REPEAT:
+        return std::format("Bar {} has a repeat sign", playback_jump.bar + 1);
+    case GuitarProPlaybackJump::Type::ALTERNATE_ENDING:
+        return std::format("Bar {} is an alternate ending", playback_jump.bar + 1);
+    case GuitarProPlaybackJump::Type::DIRECTION:
+        return std::format("Bar {} has a direction", playback_jump.bar + 1);
+    default:
+        // This should never happen
+        return std::format("Bar {} changes the playback order", playback_jump.bar + 1);
+    }
+}
+
+TempoMap GuitarProScore::GetTempoMap() const
+{
+    return TempoMap::FromBars(bars, tempos);
+}
+
+std::vector<TempoMarker> GuitarProScore::GetTempoMarkers() const
+{
+    const TempoMap map = this->GetTempoMap();
+
+    // Time signature changes are bar indices, tempo changes are tempo indices, both sorted by beat
+    std::vector<std::pair<double, int>> time_signature_changes;
+    for (std::size_t i = 0; i < bars.size(); i++)
+    {
+        if (i == 0 || bars[i] != bars[i - 1])
+        {
+            time_signature_changes.push_back({ map.GetBarBeat(static_cast<int>(i)), static_cast<int>(i) });
+        }
+    }
+
+    std::vector<TempoMarker> markers;
+    markers.reserve(time_signature_changes.size() + tempos.size());
+
+    bool linear = false;
+    std::size_t time_signature_index = 0;
+    std::size_t tempo_index = 0;
+    while (time_signature_index < time_signature_changes.size() || tempo_index < tempos.size())
+    {
+        const double time_signature_beat = time_signature_index < time_signature_changes.size() ? time_signature_changes[time_signature_index].first : std::numeric_limits<double>::infinity();
+        const double tempo_beat = tempo_index < tempos.size() ? map.GetBeat(tempos[tempo_index].bar, tempos[tempo_index].bar_position) : std::numeric_limits<double>::infinity();
+        const double beat = std::min(time_signature_beat, tempo_beat);
+
+        TempoMarker marker;
+
+        // Everything at the same beat ends up in one marker, the last tempo change there wins
+        while (time_signature_index < time_signature_changes.size() && time_signature_changes[time_signature_index].first - beat < BEAT_EPSILON)
+        {
+            const TimeSignature& time_signature = bars[time_signature_changes[time_signature_index].second];
+            marker.numerator = time_signature.numerator;
+            marker.denominator = time_signature.denominator;
+            time_signature_index++;
+        }
+
+        while (tempo_index < tempos.size() && map.GetBeat(tempos[tempo_index].bar, tempos[tempo_index].bar_position) - beat < BEAT_EPSILON)
+        {
+            linear = tempos[tempo_index].linear;
+            tempo_index++;
+        }
+
+        // A time signature change in the middle of a ramp carries it on to the next tempo change
+        marker.time = map.BeatToTime(beat);
+        marker.bpm = map.GetTempo(beat);
+        marker.linear = linear && tempo_index < tempos.size();
+        markers.push_back(marker);
+    }
+
+    return markers;
+}
+
+GuitarProScore ReadGuitarProScore(const std::filesystem::path& path)
+{
+    const ZipArchive archive(path);
+    if (!archive.Contains(SCORE_ENTRY_NAME))
+    {
+        throw std::runtime_error(std::format("'{}' is not a Guitar Pro 7 or later file.\n", path.string()));
+    }
+
+    GpifParser parser(path);
+    archive.ReadEntry(SCORE_ENTRY_NAME, [&parser](const std::string_view chunk) {
+        parser.Parse(chunk);
+    });
+
+    return parser.Finish();
+}
+
+}
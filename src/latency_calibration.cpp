@@ -0,0 +1,413 @@
+#include "latency_calibration.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <format>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace tnt {
+
+// Play rates measured during calibration, everything in between is interpolated
+static constexpr std::array<double, 5> CALIBRATION_PLAY_RATES = { 0.5, 0.75, 1.0, 1.25, 1.5 };
+
+static constexpr int SEEKS_PER_PLAY_RATE = 4;
+
+// Seeks alternate between these offsets from the starting position so both directions are measured
+static constexpr double NEAR_SEEK_OFFSET = 1.0; // Seconds
+static constexpr double FAR_SEEK_OFFSET = 3.0;  // Seconds
+
+// Wait for stretching to settle after a play rate change
+static constexpr double PLAY_RATE_SETTLE_TIME = 0.3; // Seconds
+
+// Samples are taken once the seek has certainly been heard, until the next seek
+static constexpr double SEEK_SETTLE_TIME = 0.25; // Seconds
+static constexpr double SEEK_DURATION = 0.6;     // Seconds
+
+// Anything outside this range is a glitch rather than a latency
+static constexpr double MAX_SEEK_LATENCY = 0.5; // Seconds
+
+static constexpr std::string_view OUTPUT_LATENCY_KEY = "output_latency";
+
+using Clock = std::chrono::steady_clock;
+
+static std::optional<double> ParseDouble(const std::string_view text)
+{
+    double value = 0.0;
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc() || end != text.data() + text.size())
+    {
+        return std::nullopt;
+    }
+
+    return value;
+}
+
+static double Median(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    const std::size_t middle = values.size() / 2;
+    return values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) / 2.0;
+}
+
+std::optional<LatencyTable> LatencyTable::Parse(const std::string_view text)
+{
+    LatencyTable table;
+
+    std::size_t start = 0;
+    while (start < text.size())
+    {
+        const std::size_t end = std::min(text.find(';', start), text.size());
+        const std::string_view entry = text.substr(start, end - start);
+        start = end + 1;
+
+        const std::size_t separator = entry.find('=');
+        if (separator == std::string_view::npos)
+        {
+            return std::nullopt;
+        }
+
+        const std::string_view key = entry.substr(0, separator);
+        const std::optional<double> value = ParseDouble(entry.substr(separator + 1));
+        if (!value)
+        {
+            return std::nullopt;
+        }
+
+        if (key == OUTPUT_LATENCY_KEY)
+        {
+            table.SetOutputLatency(*value);
+            continue;
+        }
+
+        const std::optional<double> play_rate = ParseDouble(key);
+        if (!play_rate || *play_rate <= 0.0)
+        {
+            return std::nullopt;
+        }
+
+        table.Set(*play_rate, *value);
+    }
+
+    return table;
+}
+
+std::string LatencyTable::Serialize() const
+{
+    std::string text = std::format("{}={:.4f}", OUTPUT_LATENCY_KEY, m_output_latency);
+    for (const auto& [play_rate, latency] : m_latencies)
+    {
+        text += std::format(";{}={:.4f}", play_rate, latency);
+    }
+
+    return text;
+}
+
+bool LatencyTable::empty() const
+{
+    return m_latencies.empty();
+}
+
+void LatencyTable::Set(const double play_rate, const double latency)
+{
+    const auto it = std::lower_bound(m_latencies.begin(), m_latencies.end(), play_rate, [](const auto& entry, const double rate) {
+        return entry.first < rate;
+    });
+
+    if (it != m_latencies.end() && it->first == play_rate)
+    {
+        it->second = latency;
+        return;
+    }
+
+    m_latencies.insert(it, { play_rate, latency });
+}
+
+double LatencyTable::GetLatency(const double play_rate, const double output_latency) const
+{
+    if (m_latencies.empty())
+    {
+        return DEFAULT_SEEK_LATENCY;
+    }
+
+    const double output_latency_change = output_latency - m_output_latency;
+
+    if (play_rate <= m_latencies.front().first)
+    {
+        return m_latencies.front().second + output_latency_change;
+    }
+
+    if (play_rate >= m_latencies.back().first)
+    {
+        return m_latencies.back().second + output_latency_change;
+    }
+
+    const auto upper = std::lower_bound(m_latencies.begin(), m_latencies.end(), play_rate, [](const auto& entry, const double rate) {
+        return entry.first < rate;
+    });
+    const auto lower = upper - 1;
+
+    const double t = (play_rate - lower->first) / (upper->first - lower->first);
+    return lower->second + t * (upper->second - lower->second) + output_latency_change;
+}
+
+double LatencyTable::GetOutputLatency() const
+{
+    return m_output_latency;
+}
+
+void LatencyTable::SetOutputLatency(const double output_latency)
+{
+    m_output_latency = output_latency;
+}
+
+struct LatencyCalibrator::Impl final
+{
+    enum class Phase
+    {
+        IDLE,
+        CHANGE_PLAY_RATE,
+        SETTLE_PLAY_RATE,
+        MEASURE_SEEK,
+        DONE,
+        FAILED,
+    };
+
+    Impl(Reaper& reaper)
+        : m_reaper(reaper)
+    {}
+
+    void Start()
+    {
+        this->Cancel();
+
+        m_saved_position = m_reaper.GetPlayPosition();
+        m_saved_play_rate = m_reaper.GetPlayRate();
+        m_saved_repeat = m_reaper.GetRepeat();
+
+        // Looping could wrap playback around in the middle of a measurement
+        m_reaper.SetRepeat(false);
+
+        m_result = LatencyTable();
+        m_result.SetOutputLatency(m_reaper.GetOutputLatency());
+        m_error.clear();
+
+        m_play_rate_index = 0;
+        m_phase = Phase::CHANGE_PLAY_RATE;
+    }
+
+    void Cancel()
+    {
+        if (this->IsRunning())
+        {
+            this->Restore();
+        }
+
+        m_phase = Phase::IDLE;
+    }
+
+    bool IsRunning() const
+    {
+        return m_phase != Phase::IDLE && m_phase != Phase::DONE && m_phase != Phase::FAILED;
+    }
+
+    bool Tick()
+    {
+        const Clock::time_point now = m_reaper.GetTime();
+
+        switch (m_phase)
+        {
+        case Phase::CHANGE_PLAY_RATE:
+            // REAPER handles stretching much more efficiently if the song is paused
+            m_reaper.SetPlayState(ReaperPlayState::PAUSED);
+            m_reaper.SetPlayRate(this->GetPlayRate());
+            m_reaper.SetEditCursorPosition(m_saved_position, false, true);
+            m_reaper.SetPlayState(ReaperPlayState::PLAYING);
+
+            m_seek_index = 0;
+            m_seek_latencies.clear();
+            m_phase_start = now;
+            m_phase = Phase::SETTLE_PLAY_RATE;
+            break;
+
+        case Phase::SETTLE_PLAY_RATE:
+            if (this->Seconds(now - m_phase_start) >= PLAY_RATE_SETTLE_TIME)
+            {
+                this->Seek(now);
+            }
+            break;
+
+        case Phase::MEASURE_SEEK:
+            this->MeasureSeek(now);
+            break;
+
+        default:
+            break;
+        }
+
+        return this->IsRunning();
+    }
+
+    LatencyTable GetResult() const
+    {
+        if (m_phase == Phase::FAILED)
+        {
+            throw std::runtime_error(m_error);
+        }
+
+        if (m_phase != Phase::DONE)
+        {
+            throw std::runtime_error("Latency calibration has not finished.\n");
+        }
+
+        return m_result;
+    }
+
+private:
+    void Seek(const Clock::time_point now)
+    {
+        m_seek_target = m_saved_position + (m_seek_index % 2 == 0 ? NEAR_SEEK_OFFSET : FAR_SEEK_OFFSET);
+        m_reaper.SetEditCursorPosition(m_seek_target, false, true);
+
+        m_seek_samples.clear();
+        m_phase_start = now;
+        m_phase = Phase::MEASURE_SEEK;
+    }
+
+    void MeasureSeek(const Clock::time_point now)
+    {
+        if (m_reaper.GetPlayState() != ReaperPlayState::PLAYING)
+        {
+            this->Fail("Latency calibration was interrupted because REAPER stopped playing.\n");
+            return;
+        }
+
+        // Once playback has caught up the heard position is target + rate * (elapsed - latency)
+        const double elapsed = this->Seconds(now - m_phase_start);
+        if (elapsed >= SEEK_SETTLE_TIME)
+        {
+            const double latency = elapsed - (m_reaper.GetPlayPosition() - m_seek_target) / this->GetPlayRate();
+            if (latency >= 0.0 && latency <= MAX_SEEK_LATENCY)
+            {
+                m_seek_samples.push_back(latency);
+            }
+        }
+
+        if (elapsed < SEEK_DURATION)
+        {
+            return;
+        }
+
+        if (m_seek_samples.empty())
+        {
+            this->Fail(std::format("Latency calibration failed, REAPER did not follow the seek at play rate {}.\n", this->GetPlayRate()));
+            return;
+        }
+
+        m_seek_latencies.push_back(Median(m_seek_samples));
+
+        if (++m_seek_index < SEEKS_PER_PLAY_RATE)
+        {
+            this->Seek(now);
+            return;
+        }
+
+        m_result.Set(this->GetPlayRate(), Median(m_seek_latencies));
+
+        if (++m_play_rate_index < CALIBRATION_PLAY_RATES.size())
+        {
+            m_phase = Phase::CHANGE_PLAY_RATE;
+            return;
+        }
+
+        this->Restore();
+        m_phase = Phase::DONE;
+    }
+
+    void Fail(const std::string& error)
+    {
+        this->Restore();
+        m_error = error;
+        m_phase = Phase::FAILED;
+    }
+
+    void Restore()
+    {
+        m_reaper.SetPlayState(ReaperPlayState::STOPPED);
+        m_reaper.SetPlayRate(m_saved_play_rate);
+        m_reaper.SetEditCursorPosition(m_saved_position, false, false);
+        m_reaper.SetRepeat(m_saved_repeat);
+    }
+
+    double GetPlayRate() const
+    {
+        return CALIBRATION_PLAY_RATES[m_play_rate_index];
+    }
+
+    double Seconds(const Clock::duration duration) const
+    {
+        return std::chrono::duration<double>(duration).count();
+    }
+
+    Reaper& m_reaper;
+
+    Phase m_phase = Phase::IDLE;
+    Clock::time_point m_phase_start;
+
+    // Transport state to return to when done
+    double m_saved_position = 0.0;
+    double m_saved_play_rate = 1.0;
+    bool m_saved_repeat = false;
+
+    std::size_t m_play_rate_index = 0;
+    int m_seek_index = 0;
+    double m_seek_target = 0.0;
+
+    // Latency samples of the current seek and the per seek medians of the current play rate
+    std::vector<double> m_seek_samples;
+    std::vector<double> m_seek_latencies;
+
+    LatencyTable m_result;
+    std::string m_error;
+};
+
+LatencyCalibrator::LatencyCalibrator(Reaper& reaper)
+    : m_impl(std::make_unique<Impl>(reaper))
+{}
+
+LatencyCalibrator::~LatencyCalibrator() = default;
+
+void LatencyCalibrator::Start()
+{
+    m_impl->Start();
+}
+
+void LatencyCalibrator::Cancel()
+{
+    m_impl->Cancel();
+}
+
+bool LatencyCalibrator::IsRunning() const
+{
+    return m_impl->IsRunning();
+}
+
+bool LatencyCalibrator::Tick()
+{
+    return m_impl->Tick();
+}
+
+LatencyTable LatencyCalibrator::GetResult() const
+{
+    return m_impl->GetResult();
+}
+
+}
@@ -1,16 +1,111 @@
 #define REAPERAPI_IMPLEMENT
 
+#include "guitar_pro.h"
 #include "plugin.h"
+#include "position_estimator.h"
 
 #include <WDL/wdltypes.h> // Must be included before reaper_plugin_functions
 #include <reaper_plugin_functions.h>
 
+#include <array>
+#include <filesystem>
+
 using namespace tnt;
 
+// Lives in REAPER's resource path so it survives plugin updates
+static constexpr const char* OFFSET_DATABASE_FILE_NAME = "tnt_guitar_pro_offsets.txt";
+static constexpr const char* METRICS_FILE_NAME = "tnt_guitar_pro_sync_metrics";
+static constexpr const char* MEMORY_DUMP_FILE_NAME = "tnt_guitar_pro_memory.dmp";
+
+// Asks for a Guitar Pro file, returns false if the dialog was cancelled
+static bool ChooseGuitarProFile(std::filesystem::path& path)
+{
+    // GetUserFileNameForRead needs a 4096 character buffer
+    std::array<char, 4096> file_name = {};
+    if (!GetUserFileNameForRead(file_name.data(), "Select a Guitar Pro file", "gp"))
+    {
+        return false;
+    }
+
+    path = std::filesystem::path(file_name.data());
+    return true;
+}
+
 // Global plugin state required for registration
 static PluginState g_plugin_state;
 static Plugin g_plugin(g_plugin_state);
 
+// ReaScript API, only hands out what the sync loop already read so scripts can call it at any rate
+// Timestamps are in time_precise() seconds, out parameters may be null when called from C/C++
+static bool TNT_GetGuitarProState(double* timestampOut, double* playPositionOut, double* loopStartOut, double* loopEndOut, double* playRateOut, bool* playingOut, bool* countInOut, bool* loopOut)
+{
+    GuitarProState state;
+    double age = 0.0;
+    if (!g_plugin.GetCachedGuitarProState(state, age))
+    {
+        return false;
+    }
+
+    if (timestampOut) *timestampOut = time_precise() - age;
+    if (playPositionOut) *playPositionOut = state.play_position;
+    if (loopStartOut) *loopStartOut = state.time_selection_start_position;
+    if (loopEndOut) *loopEndOut = state.time_selection_end_position;
+    if (playRateOut) *playRateOut = state.play_rate;
+    if (playingOut) *playingOut = state.play_state;
+    if (countInOut) *countInOut = state.count_in_state;
+    if (loopOut) *loopOut = state.loop_state;
+
+    return true;
+}
+
+static bool TNT_GetGuitarProPositionPredicted(double* positionOut, double* confidenceOut)
+{
+    PositionEstimate estimate;
+    if (!g_plugin.PredictGuitarProPosition(estimate))
+    {
+        return false;
+    }
+
+    if (positionOut) *positionOut = estimate.position;
+    if (confidenceOut) *confidenceOut = estimate.confidence;
+
+    return true;
+}
+
+// ReaScript calls every exported function through an argument list
+static void* TNT_GetGuitarProState_vararg(void** arglist, int numparms)
+{
+    if (numparms < 8)
+    {
+        return nullptr;
+    }
+
+    return (void*)(INT_PTR)TNT_GetGuitarProState((double*)arglist[0], (double*)arglist[1], (double*)arglist[2], (double*)arglist[3], (double*)arglist[4], (bool*)arglist[5], (bool*)arglist[6], (bool*)arglist[7]);
+}
+
+static void* TNT_GetGuitarProPositionPredicted_vararg(void** arglist, int numparms)
+{
+    if (numparms < 2)
+    {
+        return nullptr;
+    }
+
+    return (void*)(INT_PTR)TNT_GetGuitarProPositionPredicted((double*)arglist[0], (double*)arglist[1]);
+}
+
+// Return type, parameter types, parameter names and help text, separated by null characters
+static constexpr const char TNT_GET_GUITAR_PRO_STATE_DEF[] =
+    "bool\0double*,double*,double*,double*,double*,bool*,bool*,bool*\0"
+    "timestampOut,playPositionOut,loopStartOut,loopEndOut,playRateOut,playingOut,countInOut,loopOut\0"
+    "Latest Guitar Pro state read by TNT Guitar Pro sync, positions in seconds, timestamp in time_precise() seconds. "
+    "Returns false while sync is off or Guitar Pro isn't connected. Doesn't read Guitar Pro itself so it can be called at any rate.";
+
+static constexpr const char TNT_GET_GUITAR_PRO_POSITION_PREDICTED_DEF[] =
+    "bool\0double*,double*\0"
+    "positionOut,confidenceOut\0"
+    "Guitar Pro's play position in seconds extrapolated to now from the reads of TNT Guitar Pro sync. "
+    "Confidence goes from 0 to 1 as the reads agree, it is 1 while Guitar Pro isn't playing. Returns false while sync is off or Guitar Pro isn't connected.";
+
 // Runs repeatedly on a timer
 void MainLoop()
 {
@@ -18,6 +113,21 @@ void MainLoop()
     g_plugin.MainLoop();
 }
 
+// Runs on a timer while the latency calibration is in progress
+void LatencyCalibrationLoop()
+{
+    if (!g_plugin.LatencyCalibrationLoop())
+    {
+        plugin_register("-timer", (void*)LatencyCalibrationLoop);
+    }
+}
+
+// Runs on the audio thread for every audio buffer while the audio hook is registered
+void OnAudioBuffer(bool is_post, int length, double sample_rate, audio_hook_register_t*)
+{
+    g_plugin.OnAudioBuffer(is_post, length, sample_rate);
+}
+
 // REAPER calls this to check guitar pro sync toggle state
 int ToggleActionCallback(int command)
 {
@@ -38,6 +148,53 @@ int ToggleActionCallback(int command)
 // this gets called when guitar pro sync action is run (e.g. from action list)
 bool OnAction(KbdSectionInfo* sec, int command, int val, int valhw, int relmode, HWND hwnd)
 {
+    if (command == g_plugin_state.reload_offsets_command_id)
+    {
+        g_plugin.ReloadOffsetDatabase();
+        return true;
+    }
+
+    if (command == g_plugin_state.export_metrics_command_id)
+    {
+        g_plugin.ExportMetrics();
+        return true;
+    }
+
+    if (command == g_plugin_state.capture_memory_dump_command_id)
+    {
+        g_plugin.CaptureMemoryDump(std::filesystem::path(GetResourcePath()) / "Data" / MEMORY_DUMP_FILE_NAME);
+        return true;
+    }
+
+    if (command == g_plugin_state.import_tempo_map_command_id || command == g_plugin_state.check_tempo_map_command_id)
+    {
+        std::filesystem::path path;
+        if (!ChooseGuitarProFile(path))
+        {
+            return true;
+        }
+
+        if (command == g_plugin_state.import_tempo_map_command_id)
+        {
+            g_plugin.ImportTempoMap(path);
+        }
+        else
+        {
+            g_plugin.CheckTempoMap(path);
+        }
+
+        return true;
+    }
+
+    if (command == g_plugin_state.calibrate_latency_command_id)
+    {
+        // Restarting a calibration that is already running must not register the timer twice
+        plugin_register("-timer", (void*)LatencyCalibrationLoop);
+        g_plugin.StartLatencyCalibration();
+        plugin_register("timer", (void*)LatencyCalibrationLoop);
+        return true;
+    }
+
     // check command
     if (command != g_plugin_state.command_id)
     {
@@ -49,11 +206,24 @@ bool OnAction(KbdSectionInfo* sec, int command, int val, int valhw, int relmode,
 
     if (g_plugin_state.action_state)
     {
+        g_plugin.Start();
         plugin_register("timer", (void*)MainLoop);
+
+        if (g_plugin.UsesAudioHook())
+        {
+            g_plugin_state.audio_hook_registered = Audio_RegHardwareHook(true, &g_plugin_state.audio_hook) != 0;
+        }
     }
     else
     {
+        if (g_plugin_state.audio_hook_registered)
+        {
+            Audio_RegHardwareHook(false, &g_plugin_state.audio_hook);
+            g_plugin_state.audio_hook_registered = false;
+        }
+
         plugin_register("-timer", (void*)MainLoop);
+        g_plugin.Stop();
     }
 
     return true;
@@ -65,20 +235,62 @@ void Register()
 {
     // register action name and get command_id
     g_plugin_state.command_id = plugin_register("custom_action", &g_plugin_state.action);
+    g_plugin_state.reload_offsets_command_id = plugin_register("custom_action", &g_plugin_state.reload_offsets_action);
+    g_plugin_state.calibrate_latency_command_id = plugin_register("custom_action", &g_plugin_state.calibrate_latency_action);
+    g_plugin_state.export_metrics_command_id = plugin_register("custom_action", &g_plugin_state.export_metrics_action);
+    g_plugin_state.import_tempo_map_command_id = plugin_register("custom_action", &g_plugin_state.import_tempo_map_action);
+    g_plugin_state.check_tempo_map_command_id = plugin_register("custom_action", &g_plugin_state.check_tempo_map_action);
+    g_plugin_state.capture_memory_dump_command_id = plugin_register("custom_action", &g_plugin_state.capture_memory_dump_action);
+
+    // REAPER's API is only available from here on
+    g_plugin.SetOffsetDatabasePath(std::filesystem::path(GetResourcePath()) / "Data" / OFFSET_DATABASE_FILE_NAME);
+    g_plugin.SetMetricsPath(std::filesystem::path(GetResourcePath()) / "Data" / METRICS_FILE_NAME);
+
+    g_plugin_state.audio_hook.OnAudioBuffer = OnAudioBuffer;
 
     // register action on/off state and callback function
     plugin_register("toggleaction", (void*)ToggleActionCallback);
 
     // register run action/command
     plugin_register("hookcommand2", (void*)OnAction);
+
+    // Exported to ReaScript and other extensions
+    plugin_register("API_TNT_GetGuitarProState", (void*)TNT_GetGuitarProState);
+    plugin_register("APIdef_TNT_GetGuitarProState", (void*)TNT_GET_GUITAR_PRO_STATE_DEF);
+    plugin_register("APIvararg_TNT_GetGuitarProState", (void*)TNT_GetGuitarProState_vararg);
+    plugin_register("API_TNT_GetGuitarProPositionPredicted", (void*)TNT_GetGuitarProPositionPredicted);
+    plugin_register("APIdef_TNT_GetGuitarProPositionPredicted", (void*)TNT_GET_GUITAR_PRO_POSITION_PREDICTED_DEF);
+    plugin_register("APIvararg_TNT_GetGuitarProPositionPredicted", (void*)TNT_GetGuitarProPositionPredicted_vararg);
 }
 
 // shutdown, time to exit
 void Unregister()
 {
+    if (g_plugin_state.audio_hook_registered)
+    {
+        Audio_RegHardwareHook(false, &g_plugin_state.audio_hook);
+        g_plugin_state.audio_hook_registered = false;
+    }
+
+    // Joining the polling thread from a static destructor can deadlock on Windows
+    g_plugin.Stop();
+
     plugin_register("-custom_action", &g_plugin_state.action);
+    plugin_register("-custom_action", &g_plugin_state.reload_offsets_action);
+    plugin_register("-custom_action", &g_plugin_state.calibrate_latency_action);
+    plugin_register("-custom_action", &g_plugin_state.export_metrics_action);
+    plugin_register("-custom_action", &g_plugin_state.import_tempo_map_action);
+    plugin_register("-custom_action", &g_plugin_state.check_tempo_map_action);
+    plugin_register("-custom_action", &g_plugin_state.capture_memory_dump_action);
+    plugin_register("-timer", (void*)LatencyCalibrationLoop);
     plugin_register("-toggleaction", (void*)ToggleActionCallback);
     plugin_register("-hookcommand2", (void*)OnAction);
+    plugin_register("-API_TNT_GetGuitarProState", (void*)TNT_GetGuitarProState);
+    plugin_register("-APIdef_TNT_GetGuitarProState", (void*)TNT_GET_GUITAR_PRO_STATE_DEF);
+    plugin_register("-APIvararg_TNT_GetGuitarProState", (void*)TNT_GetGuitarProState_vararg);
+    plugin_register("-API_TNT_GetGuitarProPositionPredicted", (void*)TNT_GetGuitarProPositionPredicted);
+    plugin_register("-APIdef_TNT_GetGuitarProPositionPredicted", (void*)TNT_GET_GUITAR_PRO_POSITION_PREDICTED_DEF);
+    plugin_register("-APIvararg_TNT_GetGuitarProPositionPredicted", (void*)TNT_GetGuitarProPositionPredicted_vararg);
 }
 
 extern "C"
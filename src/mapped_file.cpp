@@ -0,0 +1,97 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <format>
+#include <stdexcept>
+#include <string>
+
+namespace tnt {
+
+MappedFile::MappedFile(const std::filesystem::path& path, const std::string& description)
+{
+#ifdef _WIN32
+    const HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error(std::format("Failed to open {} '{}'.\n", description, path.string()));
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        throw std::runtime_error(std::format("Failed to map {} '{}'.\n", description, path.string()));
+    }
+
+    m_size = static_cast<std::size_t>(size.QuadPart);
+
+    const HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        CloseHandle(file);
+        throw std::runtime_error(std::format("Failed to map {} '{}'.\n", description, path.string()));
+    }
+
+    m_data = static_cast<const std::byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!m_data)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        throw std::runtime_error(std::format("Failed to map {} '{}'.\n", description, path.string()));
+    }
+
+    m_file = file;
+    m_mapping = mapping;
+#else
+    const int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        throw std::runtime_error(std::format("Failed to open {} '{}'.\n", description, path.string()));
+    }
+
+    struct stat file_status;
+    if (fstat(file, &file_status) != 0 || file_status.st_size == 0)
+    {
+        close(file);
+        throw std::runtime_error(std::format("Failed to map {} '{}'.\n", description, path.string()));
+    }
+
+    m_size = static_cast<std::size_t>(file_status.st_size);
+
+    void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+
+    if (data == MAP_FAILED)
+    {
+        throw std::runtime_error(std::format("Failed to map {} '{}'.\n", description, path.string()));
+    }
+
+    m_data = static_cast<const std::byte*>(data);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+    CloseHandle(m_mapping);
+    CloseHandle(m_file);
+#else
+    munmap(const_cast<std::byte*>(m_data), m_size);
+#endif
+}
+
+std::span<const std::byte> MappedFile::GetData() const
+{
+    return { m_data, m_size };
+}
+
+}
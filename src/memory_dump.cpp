@@ -0,0 +1,303 @@
+#include "memory_dump.h"
+
+#include "mapped_file.h"
+#include "wstring_utils.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tnt {
+
+static constexpr std::array<char, 8> MEMORY_DUMP_MAGIC = { 'T', 'N', 'T', 'G', 'P', 'M', 'E', 'M' };
+static constexpr std::uint32_t MEMORY_DUMP_FORMAT_VERSION = 1;
+static constexpr std::size_t MEMORY_DUMP_VERSION_SIZE = 32;
+
+#pragma pack(push, 1)
+struct MemoryDumpHeader final
+{
+    std::array<char, 8> magic;
+    std::uint32_t format_version;
+    std::uint32_t region_count;
+    std::uint64_t module_base_address;
+    std::array<char, MEMORY_DUMP_VERSION_SIZE> process_version;
+};
+
+struct MemoryDumpRegionEntry final
+{
+    std::uint64_t address;
+    std::uint64_t size;
+    std::uint64_t file_offset;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(MemoryDumpHeader) == 56, "Memory dump header layout changed");
+static_assert(sizeof(MemoryDumpRegionEntry) == 24, "Memory dump region layout changed");
+
+struct MemoryDump::Impl final
+{
+    Impl(const std::filesystem::path& path)
+        : m_path(path)
+        , m_file(path, "memory dump")
+        , m_data(m_file.GetData().data())
+        , m_size(m_file.GetData().size())
+    {
+        if (m_size < sizeof(MemoryDumpHeader))
+        {
+            throw std::runtime_error(std::format("Memory dump '{}' is too small.\n", m_path.string()));
+        }
+
+        std::memcpy(&m_header, m_data, sizeof(m_header));
+
+        const std::size_t table_size = static_cast<std::size_t>(m_header.region_count) * sizeof(MemoryDumpRegionEntry);
+        if (m_header.magic != MEMORY_DUMP_MAGIC
+         || m_header.format_version != MEMORY_DUMP_FORMAT_VERSION
+         || m_size < sizeof(MemoryDumpHeader) + table_size)
+        {
+            throw std::runtime_error(std::format("'{}' is not a valid memory dump.\n", m_path.string()));
+        }
+
+        m_regions.resize(m_header.region_count);
+        std::memcpy(m_regions.data(), m_data + sizeof(MemoryDumpHeader), table_size);
+
+        for (const MemoryDumpRegionEntry& region : m_regions)
+        {
+            if (region.file_offset > m_size || region.size > m_size - region.file_offset)
+            {
+                throw std::runtime_error(std::format("Memory dump '{}' is truncated.\n", m_path.string()));
+            }
+        }
+
+        // Versions are plain ASCII digits and dots
+        const std::string version(m_header.process_version.data(), strnlen(m_header.process_version.data(), MEMORY_DUMP_VERSION_SIZE));
+        m_process_version.assign(version.begin(), version.end());
+    }
+
+    std::string GetName() const
+    {
+        return std::format("memory dump '{}'", m_path.string());
+    }
+
+    const std::wstring& GetProcessVersion() const
+    {
+        return m_process_version;
+    }
+
+    std::uintptr_t GetModuleBaseAddress() const
+    {
+        return static_cast<std::uintptr_t>(m_header.module_base_address);
+    }
+
+    const std::byte* GetPointer(const std::uintptr_t address, const std::size_t size) const
+    {
+        // Last region starting at or before the address
+        auto region = std::upper_bound(m_regions.begin(), m_regions.end(), address, [](const std::uintptr_t address, const MemoryDumpRegionEntry& region) {
+            return address < region.address;
+        });
+
+        if (region == m_regions.begin())
+        {
+            return nullptr;
+        }
+
+        --region;
+
+        const std::uint64_t offset = address - region->address;
+        if (offset > region->size || size > region->size - offset)
+        {
+            return nullptr;
+        }
+
+        return m_data + region->file_offset + offset;
+    }
+
+private:
+    std::filesystem::path m_path;
+    std::wstring m_process_version;
+    MemoryDumpHeader m_header = {};
+    std::vector<MemoryDumpRegionEntry> m_regions;
+
+    MappedFile m_file;
+    const std::byte* m_data = nullptr;
+    std::size_t m_size = 0;
+};
+
+MemoryDump::MemoryDump(const std::filesystem::path& path)
+    : m_impl(std::make_unique<Impl>(path))
+{}
+
+MemoryDump::~MemoryDump() = default;
+
+void MemoryDump::Save(const std::filesystem::path& path, const std::wstring& process_version, const std::uintptr_t module_base_address, std::vector<MemoryDumpRegion> regions)
+{
+    std::sort(regions.begin(), regions.end(), [](const MemoryDumpRegion& a, const MemoryDumpRegion& b) {
+        return a.address < b.address;
+    });
+
+    MemoryDumpHeader header = {};
+    header.magic = MEMORY_DUMP_MAGIC;
+    header.format_version = MEMORY_DUMP_FORMAT_VERSION;
+    header.region_count = static_cast<std::uint32_t>(regions.size());
+    header.module_base_address = module_base_address;
+
+    const std::string version = WStringToString(process_version);
+    std::memcpy(header.process_version.data(), version.data(), std::min(version.size(), MEMORY_DUMP_VERSION_SIZE - 1));
+
+    std::vector<MemoryDumpRegionEntry> table;
+    table.reserve(regions.size());
+
+    std::uint64_t file_offset = sizeof(MemoryDumpHeader) + regions.size() * sizeof(MemoryDumpRegionEntry);
+    for (const MemoryDumpRegion& region : regions)
+    {
+        table.push_back({ region.address, region.size, file_offset });
+        file_offset += region.size;
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(table.size() * sizeof(MemoryDumpRegionEntry)));
+    for (const MemoryDumpRegion& region : regions)
+    {
+        file.write(reinterpret_cast<const char*>(region.data), static_cast<std::streamsize>(region.size));
+    }
+
+    if (!file)
+    {
+        throw std::runtime_error(std::format("Failed to write memory dump '{}'.\n", path.string()));
+    }
+}
+
+std::string MemoryDump::GetName() const
+{
+    return m_impl->GetName();
+}
+
+const std::wstring& MemoryDump::GetProcessVersion() const
+{
+    return m_impl->GetProcessVersion();
+}
+
+std::uintptr_t MemoryDump::GetModuleBaseAddress() const
+{
+    return m_impl->GetModuleBaseAddress();
+}
+
+bool MemoryDump::IsProcessRunning() const
+{
+    return true;
+}
+
+bool MemoryDump::Read(const std::uintptr_t address, void* buffer, const std::size_t size)
+{
+    const std::byte* data = m_impl->GetPointer(address, size);
+    if (!data)
+    {
+        return false;
+    }
+
+    std::memcpy(buffer, data, size);
+    return true;
+}
+
+std::string MemoryDump::GetLastErrorMessage() const
+{
+    return "The memory range is not part of the dump.";
+}
+
+const std::byte* MemoryDump::GetPointer(const std::uintptr_t address, const std::size_t size) const
+{
+    return m_impl->GetPointer(address, size);
+}
+
+MemoryDumpRecorder::MemoryDumpRecorder(std::unique_ptr<MemorySource> memory_source)
+    : m_memory_source(std::move(memory_source))
+{}
+
+std::string MemoryDumpRecorder::GetName() const
+{
+    return m_memory_source->GetName();
+}
+
+const std::wstring& MemoryDumpRecorder::GetProcessVersion() const
+{
+    return m_memory_source->GetProcessVersion();
+}
+
+std::uintptr_t MemoryDumpRecorder::GetModuleBaseAddress() const
+{
+    return m_memory_source->GetModuleBaseAddress();
+}
+
+bool MemoryDumpRecorder::IsProcessRunning() const
+{
+    return m_memory_source->IsProcessRunning();
+}
+
+bool MemoryDumpRecorder::Read(const std::uintptr_t address, void* buffer, const std::size_t size)
+{
+    if (!m_memory_source->Read(address, buffer, size))
+    {
+        return false;
+    }
+
+    const std::byte* bytes = static_cast<const std::byte*>(buffer);
+    m_reads.emplace_back(address, std::vector<std::byte>(bytes, bytes + size));
+    return true;
+}
+
+std::string MemoryDumpRecorder::GetLastErrorMessage() const
+{
+    return m_memory_source->GetLastErrorMessage();
+}
+
+void MemoryDumpRecorder::Save(const std::filesystem::path& path) const
+{
+    // Sorted by address, the stable sort keeps later reads of the same address after earlier ones
+    std::vector<const std::pair<std::uintptr_t, std::vector<std::byte>>*> reads;
+    reads.reserve(m_reads.size());
+    for (const auto& read : m_reads)
+    {
+        reads.push_back(&read);
+    }
+
+    std::stable_sort(reads.begin(), reads.end(), [](const auto* a, const auto* b) {
+        return a->first < b->first;
+    });
+
+    std::vector<std::uintptr_t> addresses;
+    std::vector<std::vector<std::byte>> blocks;
+    for (const auto* read : reads)
+    {
+        const auto& [address, data] = *read;
+        if (blocks.empty() || address > addresses.back() + blocks.back().size())
+        {
+            addresses.push_back(address);
+            blocks.emplace_back(data);
+            continue;
+        }
+
+        std::vector<std::byte>& block = blocks.back();
+        const std::size_t offset = address - addresses.back();
+        block.resize(std::max(block.size(), offset + data.size()));
+        std::copy(data.begin(), data.end(), block.begin() + static_cast<std::ptrdiff_t>(offset));
+    }
+
+    std::vector<MemoryDumpRegion> regions;
+    regions.reserve(blocks.size());
+    for (std::size_t i = 0; i < blocks.size(); i++)
+    {
+        regions.push_back({ addresses[i], blocks[i].data(), blocks[i].size() });
+    }
+
+    MemoryDump::Save(path, m_memory_source->GetProcessVersion(), m_memory_source->GetModuleBaseAddress(), std::move(regions));
+}
+
+}
@@ -0,0 +1,518 @@
+#include "offset_database.h"
+
+#include "signature_scanner.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+namespace tnt {
+
+// Appended to the database file name for the signature scan cache
+static constexpr const char* OFFSET_CACHE_EXTENSION = ".cache.txt";
+
+// Layout together with the storage its strings point to
+struct OffsetDatabaseEntry final
+{
+    std::wstring version;
+    std::string root_signature;
+    std::uint64_t module_hash = 0;
+    GuitarProLayout layout;
+};
+
+struct OffsetDatabase::Impl final
+{
+    Impl()
+        : m_built_in_entries(this->GetBuiltInEntries())
+    {
+        this->Index();
+    }
+
+    void SetPath(const std::filesystem::path& path)
+    {
+        if (path != m_path)
+        {
+            m_path = path;
+            m_cache_path = path;
+            m_cache_path += OFFSET_CACHE_EXTENSION;
+            m_write_time.reset();
+            m_cache_write_time.reset();
+        }
+    }
+
+    const std::filesystem::path& GetPath() const
+    {
+        return m_path;
+    }
+
+    void Refresh()
+    {
+        if (m_path.empty())
+        {
+            return;
+        }
+
+        // Also falls back to the built-in layouts when the files are removed
+        const auto write_time = GetWriteTime(m_path);
+        const auto cache_write_time = GetWriteTime(m_cache_path);
+        if (write_time != m_write_time || cache_write_time != m_cache_write_time)
+        {
+            this->Load(write_time, cache_write_time);
+        }
+    }
+
+    void Reload()
+    {
+        if (m_path.empty())
+        {
+            return;
+        }
+
+        this->Load(GetWriteTime(m_path), GetWriteTime(m_cache_path));
+    }
+
+    std::shared_ptr<const GuitarProLayout> Find(const std::wstring& version, const std::uint64_t module_hash) const
+    {
+        if (module_hash)
+        {
+            const auto entry = m_by_module_hash.find(module_hash);
+            if (entry != m_by_module_hash.end())
+            {
+                return std::shared_ptr<const GuitarProLayout>(entry->second, &entry->second->layout);
+            }
+        }
+
+        const auto entry = m_by_version.find(version);
+        if (entry != m_by_version.end())
+        {
+            return std::shared_ptr<const GuitarProLayout>(entry->second, &entry->second->layout);
+        }
+
+        return nullptr;
+    }
+
+    std::shared_ptr<const GuitarProLayout> FindSignatureLayout() const
+    {
+        if (!m_signature_entry)
+        {
+            return nullptr;
+        }
+
+        return std::shared_ptr<const GuitarProLayout>(m_signature_entry, &m_signature_entry->layout);
+    }
+
+    std::shared_ptr<const GuitarProLayout> AddScannedLayout(const std::wstring& version, const std::uint64_t module_hash, const GuitarProLayout& layout)
+    {
+        auto entry = std::make_shared<OffsetDatabaseEntry>();
+        entry->version = version;
+        entry->root_signature = layout.root_signature.pattern ? layout.root_signature.pattern : "";
+        entry->module_hash = module_hash;
+        entry->layout = layout;
+        this->BindStrings(*entry);
+
+        // Scanned layouts are only trusted for the exact build they were found in
+        m_scanned_entries.push_back(entry);
+        m_by_module_hash[module_hash] = entry;
+
+        if (!m_cache_path.empty())
+        {
+            std::ofstream file(m_cache_path, std::ios::app);
+            this->WriteEntry(file, *entry);
+            file.close();
+
+            // Don't reload everything just because of our own write
+            m_cache_write_time = GetWriteTime(m_cache_path);
+        }
+
+        return std::shared_ptr<const GuitarProLayout>(entry, &entry->layout);
+    }
+
+private:
+    using Entries = std::vector<std::shared_ptr<const OffsetDatabaseEntry>>;
+
+    static std::optional<std::filesystem::file_time_type> GetWriteTime(const std::filesystem::path& path)
+    {
+        std::error_code error;
+        const auto write_time = std::filesystem::last_write_time(path, error);
+        if (error)
+        {
+            return std::nullopt;
+        }
+
+        return write_time;
+    }
+
+    void Load(const std::optional<std::filesystem::file_time_type> write_time, const std::optional<std::filesystem::file_time_type> cache_write_time)
+    {
+        // Remember the attempt even if parsing fails so a broken file is only reported once
+        m_write_time = write_time;
+        m_cache_write_time = cache_write_time;
+
+        // A file that fails to parse keeps its previous entries, the other file and the built-in layouts are still used
+        std::string errors;
+        this->LoadEntries(m_cache_path, cache_write_time.has_value(), m_scanned_entries, errors);
+        this->LoadEntries(m_path, write_time.has_value(), m_user_entries, errors);
+
+        this->Index();
+
+        if (!errors.empty())
+        {
+            throw std::runtime_error(errors);
+        }
+    }
+
+    void LoadEntries(const std::filesystem::path& path, const bool exists, Entries& entries, std::string& errors) const
+    {
+        try
+        {
+            entries = exists ? this->Parse(path) : Entries();
+        }
+        catch (const std::runtime_error& error)
+        {
+            errors += error.what();
+        }
+    }
+
+    // Later entries override earlier ones, hand-written entries win over cached scan results
+    void Index()
+    {
+        m_by_version.clear();
+        m_by_module_hash.clear();
+        m_signature_entry.reset();
+
+        // Scanned layouts are only trusted for the exact build they were found in
+        for (const auto& entry : m_scanned_entries)
+        {
+            if (entry->module_hash)
+            {
+                m_by_module_hash[entry->module_hash] = entry;
+            }
+        }
+
+        for (const Entries* entries : { &m_built_in_entries, &m_user_entries })
+        {
+            for (const auto& entry : *entries)
+            {
+                m_by_version[entry->version] = entry;
+                if (entry->module_hash)
+                {
+                    m_by_module_hash[entry->module_hash] = entry;
+                }
+
+                if (entry->layout.root_signature.pattern)
+                {
+                    m_signature_entry = entry;
+                }
+            }
+        }
+    }
+
+    Entries GetBuiltInEntries() const
+    {
+        Entries entries;
+        for (const GuitarProLayout& layout : GUITAR_PRO_LAYOUTS)
+        {
+            auto entry = std::make_shared<OffsetDatabaseEntry>();
+            entry->version = layout.version;
+            entry->root_signature = layout.root_signature.pattern ? layout.root_signature.pattern : "";
+            entry->layout = layout;
+            this->BindStrings(*entry);
+            entries.push_back(std::move(entry));
+        }
+
+        return entries;
+    }
+
+    // Points the layout at the strings owned by the entry
+    void BindStrings(OffsetDatabaseEntry& entry) const
+    {
+        entry.layout.version = entry.version.c_str();
+        entry.layout.root_signature.pattern = entry.root_signature.empty() ? nullptr : entry.root_signature.c_str();
+    }
+
+    Entries Parse(const std::filesystem::path& path) const
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            throw std::runtime_error(std::format("Failed to open offset database '{}'.\n", path.string()));
+        }
+
+        Entries entries;
+        std::shared_ptr<OffsetDatabaseEntry> entry;
+        std::array<bool, GUITAR_PRO_FIELD_COUNT> defined_fields = {};
+
+        std::string line;
+        int line_number = 0;
+
+        while (std::getline(file, line))
+        {
+            line_number++;
+
+            // Strip comments
+            line = line.substr(0, line.find('#'));
+
+            std::istringstream tokens(line);
+            std::string key;
+            if (!(tokens >> key))
+            {
+                continue;
+            }
+
+            if (key == "version")
+            {
+                if (entry)
+                {
+                    entries.push_back(this->FinishEntry(path, entry, defined_fields, line_number));
+                }
+
+                std::string version;
+                if (!(tokens >> version))
+                {
+                    this->ThrowParseError(path, line_number, "Missing version.");
+                }
+
+                entry = std::make_shared<OffsetDatabaseEntry>();
+                entry->version.assign(version.begin(), version.end());
+                defined_fields.fill(false);
+                continue;
+            }
+
+            if (!entry)
+            {
+                this->ThrowParseError(path, line_number, std::format("Expected 'version' before '{}'.", key));
+            }
+
+            if (key == "module_hash")
+            {
+                entry->module_hash = this->ParseNumber(path, tokens, 16, line_number);
+            }
+            else if (key == "module_offset")
+            {
+                entry->layout.module_offset = static_cast<std::uintptr_t>(this->ParseNumber(path, tokens, 0, line_number));
+            }
+            else if (key == "document_chain")
+            {
+                entry->layout.document_chain = this->ParsePointerChain(path, tokens, line_number);
+            }
+            else if (key == "root_signature")
+            {
+                entry->layout.root_signature.displacement_offset = static_cast<std::size_t>(this->ParseNumber(path, tokens, 0, line_number));
+                entry->layout.root_signature.instruction_size = static_cast<std::size_t>(this->ParseNumber(path, tokens, 0, line_number));
+
+                std::string pattern;
+                std::getline(tokens >> std::ws, pattern);
+
+                try
+                {
+                    BytePattern{ pattern };
+                }
+                catch (const std::runtime_error& error)
+                {
+                    this->ThrowParseError(path, line_number, std::string(error.what(), std::strlen(error.what()) - 1));
+                }
+
+                entry->root_signature = pattern;
+            }
+            else
+            {
+                std::size_t field = 0;
+                while (field < GUITAR_PRO_8_FIELDS.size() && key != GUITAR_PRO_8_FIELDS[field].name)
+                {
+                    field++;
+                }
+
+                if (field == GUITAR_PRO_8_FIELDS.size())
+                {
+                    this->ThrowParseError(path, line_number, std::format("Unknown key '{}'.", key));
+                }
+
+                // Decoding stays the same across versions, only the location changes
+                entry->layout.fields[field] = GUITAR_PRO_8_FIELDS[field];
+                entry->layout.fields[field].pointer_chain = this->ParsePointerChain(path, tokens, line_number);
+                defined_fields[field] = true;
+            }
+        }
+
+        if (entry)
+        {
+            entries.push_back(this->FinishEntry(path, entry, defined_fields, line_number));
+        }
+
+        return entries;
+    }
+
+    std::shared_ptr<const OffsetDatabaseEntry> FinishEntry(const std::filesystem::path& path, std::shared_ptr<OffsetDatabaseEntry>& entry, const std::array<bool, GUITAR_PRO_FIELD_COUNT>& defined_fields, const int line_number) const
+    {
+        const std::string version(entry->version.begin(), entry->version.end());
+
+        for (std::size_t i = 0; i < defined_fields.size(); i++)
+        {
+            if (!defined_fields[i])
+            {
+                this->ThrowParseError(path, line_number, std::format("Version '{}' is missing '{}'.", version, GUITAR_PRO_8_FIELDS[i].name));
+            }
+        }
+
+        this->BindStrings(*entry);
+        if (!IsValidGuitarProLayout(entry->layout) || !MatchesGuitarProFields(entry->layout))
+        {
+            this->ThrowParseError(path, line_number, std::format("Version '{}' is not a valid layout.", version));
+        }
+
+        return std::move(entry);
+    }
+
+    std::uint64_t ParseNumber(const std::filesystem::path& path, std::istringstream& tokens, const int base, const int line_number) const
+    {
+        std::string token;
+        if (!(tokens >> token))
+        {
+            this->ThrowParseError(path, line_number, "Missing value.");
+        }
+
+        try
+        {
+            std::size_t parsed = 0;
+            const std::uint64_t value = std::stoull(token, &parsed, base);
+            if (parsed == token.size())
+            {
+                return value;
+            }
+        }
+        catch (const std::logic_error&)
+        {
+        }
+
+        this->ThrowParseError(path, line_number, std::format("'{}' is not a number.", token));
+    }
+
+    PointerChain ParsePointerChain(const std::filesystem::path& path, std::istringstream& tokens, const int line_number) const
+    {
+        PointerChain pointer_chain;
+
+        std::string token;
+        while (tokens >> token)
+        {
+            std::istringstream offset(token);
+
+            try
+            {
+                pointer_chain.push_back(static_cast<std::uintptr_t>(this->ParseNumber(path, offset, 0, line_number)));
+            }
+            catch (const std::length_error&)
+            {
+                this->ThrowParseError(path, line_number, std::format("Pointer chains can have at most {} offsets.", MAX_POINTER_CHAIN_DEPTH));
+            }
+        }
+
+        return pointer_chain;
+    }
+
+    // Writes an entry in the format Parse reads
+    void WriteEntry(std::ostream& stream, const OffsetDatabaseEntry& entry) const
+    {
+        const auto write_pointer_chain = [&](const PointerChain& pointer_chain) {
+            for (const std::uintptr_t offset : pointer_chain)
+            {
+                stream << std::format(" 0x{:X}", offset);
+            }
+
+            stream << '\n';
+        };
+
+        stream << std::format("\nversion {}\n", std::string(entry.version.begin(), entry.version.end()));
+        stream << std::format("module_hash {:016X}\n", entry.module_hash);
+        stream << std::format("module_offset 0x{:08X}\n", entry.layout.module_offset);
+
+        stream << "document_chain";
+        write_pointer_chain(entry.layout.document_chain);
+
+        if (entry.layout.root_signature.pattern)
+        {
+            stream << std::format("root_signature {} {} {}\n", entry.layout.root_signature.displacement_offset, entry.layout.root_signature.instruction_size, entry.root_signature);
+        }
+
+        for (const GuitarProField& field : entry.layout.fields)
+        {
+            stream << field.name;
+            write_pointer_chain(field.pointer_chain);
+        }
+    }
+
+    [[noreturn]] void ThrowParseError(const std::filesystem::path& path, const int line_number, const std::string& message) const
+    {
+        throw std::runtime_error(std::format("Offset database '{}' line {}: {}\n", path.string(), line_number, message));
+    }
+
+    std::filesystem::path m_path;
+    std::filesystem::path m_cache_path;
+
+    // Write times of the files when they were last loaded
+    std::optional<std::filesystem::file_time_type> m_write_time;
+    std::optional<std::filesystem::file_time_type> m_cache_write_time;
+
+    // Last successfully parsed entries of each source
+    Entries m_built_in_entries;
+    Entries m_scanned_entries;
+    Entries m_user_entries;
+
+    std::unordered_map<std::wstring, std::shared_ptr<const OffsetDatabaseEntry>> m_by_version;
+    std::unordered_map<std::uint64_t, std::shared_ptr<const OffsetDatabaseEntry>> m_by_module_hash;
+    std::shared_ptr<const OffsetDatabaseEntry> m_signature_entry;
+};
+
+OffsetDatabase::OffsetDatabase()
+    : m_impl(std::make_unique<Impl>())
+{}
+
+OffsetDatabase::~OffsetDatabase() = default;
+
+void OffsetDatabase::SetPath(const std::filesystem::path& path)
+{
+    m_impl->SetPath(path);
+}
+
+const std::filesystem::path& OffsetDatabase::GetPath() const
+{
+    return m_impl->GetPath();
+}
+
+void OffsetDatabase::Refresh()
+{
+    m_impl->Refresh();
+}
+
+void OffsetDatabase::Reload()
+{
+    m_impl->Reload();
+}
+
+std::shared_ptr<const GuitarProLayout> OffsetDatabase::Find(const std::wstring& version, const std::uint64_t module_hash) const
+{
+    return m_impl->Find(version, module_hash);
+}
+
+std::shared_ptr<const GuitarProLayout> OffsetDatabase::FindSignatureLayout() const
+{
+    return m_impl->FindSignatureLayout();
+}
+
+std::shared_ptr<const GuitarProLayout> OffsetDatabase::AddScannedLayout(const std::wstring& version, const std::uint64_t module_hash, const GuitarProLayout& layout)
+{
+    return m_impl->AddScannedLayout(version, module_hash, layout);
+}
+
+}
@@ -0,0 +1,85 @@
+#include "pe_image.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace tnt {
+
+// IMAGE_DOS_HEADER
+static constexpr std::uint16_t DOS_SIGNATURE = 0x5A4D; // "MZ"
+static constexpr std::uintptr_t DOS_NEW_HEADER_OFFSET = 0x3C;
+
+// IMAGE_NT_HEADERS
+static constexpr std::uint32_t NT_SIGNATURE = 0x00004550; // "PE\0\0"
+static constexpr std::uintptr_t NT_NUMBER_OF_SECTIONS_OFFSET = 0x06;
+static constexpr std::uintptr_t NT_TIME_DATE_STAMP_OFFSET = 0x08;
+static constexpr std::uintptr_t NT_SIZE_OF_OPTIONAL_HEADER_OFFSET = 0x14;
+static constexpr std::uintptr_t NT_OPTIONAL_HEADER_OFFSET = 0x18;
+static constexpr std::uintptr_t NT_SIZE_OF_IMAGE_OFFSET = 0x50;
+
+// IMAGE_SECTION_HEADER
+static constexpr std::size_t SECTION_HEADER_SIZE = 40;
+static constexpr std::size_t SECTION_VIRTUAL_SIZE_OFFSET = 0x08;
+static constexpr std::size_t SECTION_VIRTUAL_ADDRESS_OFFSET = 0x0C;
+static constexpr std::size_t SECTION_CHARACTERISTICS_OFFSET = 0x24;
+static constexpr std::uint32_t SECTION_MEMORY_EXECUTE = 0x20000000;
+
+// Anything beyond these limits is not a real header
+static constexpr std::uint32_t MAX_NT_HEADER_OFFSET = 0x1000;
+static constexpr std::uint16_t MAX_SECTION_COUNT = 96;
+
+bool ReadPeImage(MemorySource& memory_source, const std::uintptr_t base_address, PeImage& image)
+{
+    std::uint16_t dos_signature = 0;
+    std::uint32_t nt_header_offset = 0;
+    if (!memory_source.Read(base_address, &dos_signature, sizeof(dos_signature))
+     || dos_signature != DOS_SIGNATURE
+     || !memory_source.Read(base_address + DOS_NEW_HEADER_OFFSET, &nt_header_offset, sizeof(nt_header_offset))
+     || nt_header_offset > MAX_NT_HEADER_OFFSET)
+    {
+        return false;
+    }
+
+    const std::uintptr_t nt_header = base_address + nt_header_offset;
+
+    std::uint32_t nt_signature = 0;
+    std::uint16_t section_count = 0;
+    std::uint16_t optional_header_size = 0;
+    if (!memory_source.Read(nt_header, &nt_signature, sizeof(nt_signature))
+     || nt_signature != NT_SIGNATURE
+     || !memory_source.Read(nt_header + NT_NUMBER_OF_SECTIONS_OFFSET, &section_count, sizeof(section_count))
+     || !memory_source.Read(nt_header + NT_TIME_DATE_STAMP_OFFSET, &image.time_date_stamp, sizeof(image.time_date_stamp))
+     || !memory_source.Read(nt_header + NT_SIZE_OF_OPTIONAL_HEADER_OFFSET, &optional_header_size, sizeof(optional_header_size))
+     || !memory_source.Read(nt_header + NT_SIZE_OF_IMAGE_OFFSET, &image.size_of_image, sizeof(image.size_of_image))
+     || section_count > MAX_SECTION_COUNT)
+    {
+        return false;
+    }
+
+    image.sections.clear();
+    image.sections.reserve(section_count);
+
+    const std::uintptr_t section_table = nt_header + NT_OPTIONAL_HEADER_OFFSET + optional_header_size;
+    for (std::uint16_t i = 0; i < section_count; i++)
+    {
+        std::array<std::uint8_t, SECTION_HEADER_SIZE> header;
+        if (!memory_source.Read(section_table + i * SECTION_HEADER_SIZE, header.data(), header.size()))
+        {
+            return false;
+        }
+
+        PeSection section;
+        std::uint32_t characteristics = 0;
+        std::memcpy(&section.virtual_size, header.data() + SECTION_VIRTUAL_SIZE_OFFSET, sizeof(section.virtual_size));
+        std::memcpy(&section.virtual_address, header.data() + SECTION_VIRTUAL_ADDRESS_OFFSET, sizeof(section.virtual_address));
+        std::memcpy(&characteristics, header.data() + SECTION_CHARACTERISTICS_OFFSET, sizeof(characteristics));
+        section.executable = (characteristics & SECTION_MEMORY_EXECUTE) != 0;
+
+        image.sections.push_back(section);
+    }
+
+    return true;
+}
+
+}
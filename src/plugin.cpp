@@ -1,37 +1,468 @@
 #include "plugin.h"
 
 #include "guitar_pro.h"
+#include "guitar_pro_events.h"
+#include "guitar_pro_poller.h"
+#include "guitar_pro_score.h"
+#include "latency_calibration.h"
+#include "poll_scheduler.h"
+#include "position_estimator.h"
+#include "profiler.h"
 #include "reaper.h"
+#include "spsc_ring.h"
+#include "sync_metrics.h"
+#include "tempo_map.h"
+#include "trace_recorder.h"
 
-#include <array>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <format>
+#include <fstream>
+#include <optional>
+#include <vector>
+#include <filesystem>
 #include <memory>
 #include <stdexcept>
+#include <string>
+#include <utility>
 
 namespace tnt {
 
-// REAPER runs this periodically 30 times/second so a desync window of 9 is approximately 300ms
-static constexpr int DESYNC_WINDOW_SIZE = 9;
+// A desync must show up in this many consecutive samples before REAPER is moved, rides out Guitar Pro's jitter
+static constexpr int DESYNC_CONFIRM_SAMPLES = 2;
+
+// The predicted Guitar Pro position is only trusted for desync corrections above this confidence
+static constexpr double MINIMUM_DESYNC_CONFIDENCE = 0.5;
 
 static constexpr double DESYNC_THRESHOLD = 0.3;                 // Seconds
-static constexpr double MINIMUM_TIME_STEP = 0.001;              // Seconds
-static constexpr double MINIMUM_PLAY_RATE_STEP = 0.001;         // Seconds
-static constexpr double GUITAR_PRO_CURSOR_JUMP_THRESHOLD = 0.1; // Seconds
-static constexpr double LATENCY_COMPENSATION = 0.05;           // Seconds
+
+// Audio blocks recorded between two timer ticks, about 100 blocks/second at common buffer sizes
+static constexpr std::size_t AUDIO_BLOCK_CAPACITY = 256;
+
+// Published for scripts and troubleshooting, not persisted
+static constexpr const char* POLL_STATE_KEY = "poll_state";
+static constexpr const char* POLL_INTERVAL_KEY = "poll_interval_ms";
+static constexpr const char* METRICS_KEY = "metrics";
+
+// Exported next to each other with .json and .csv extensions
+static constexpr const char* METRICS_FILE_NAME = "tnt_guitar_pro_sync_metrics";
+static constexpr const char* PROFILE_FILE_SUFFIX = "_profile.json";
+
+// Bar boundaries further apart than this between REAPER and Guitar Pro are reported by the tempo map check
+static constexpr double TEMPO_MAP_TOLERANCE = 0.001; // Seconds
+
+// The console only lists this many mismatching bars, the first ones are the ones to fix anyway
+static constexpr std::size_t MAX_REPORTED_TEMPO_MAP_MISMATCHES = 20;
 
 struct Plugin::Impl final {
     Impl(PluginState& plugin_state)
         : m_plugin_state(plugin_state)
+        , m_guitar_pro_poller(m_guitar_pro)
+        , m_latency_calibrator(m_reaper)
+        , m_poll_scheduler(PollScheduler::Clock::duration::zero())
+    {
+        // Process discovery can take a while on busy machines, keep it off REAPER's UI thread
+        m_guitar_pro.SetAsyncAttach(true);
+    }
+
+    Impl(PluginState& plugin_state, MemorySourceFactory memory_source_factory)
+        : m_plugin_state(plugin_state)
+        , m_guitar_pro(std::move(memory_source_factory))
+        , m_guitar_pro_poller(m_guitar_pro)
+        , m_latency_calibrator(m_reaper)
+        , m_poll_scheduler(PollScheduler::Clock::duration::zero())
     {}
 
+    Impl(PluginState& plugin_state, MemorySourceFactory memory_source_factory, std::unique_ptr<ReaperBackend> reaper_backend)
+        : m_plugin_state(plugin_state)
+        , m_guitar_pro(std::move(memory_source_factory))
+        , m_guitar_pro_poller(m_guitar_pro)
+        , m_reaper(std::move(reaper_backend))
+        , m_latency_calibrator(m_reaper)
+        , m_poll_scheduler(PollScheduler::Clock::duration::zero())
+    {}
+
+    void Start()
+    {
+        m_sync_metrics.Reset(m_reaper.GetTime());
+        m_play_requested_time.reset();
+        m_play_stop_pending = false;
+        m_read_guitar_pro_state.reset();
+
+        this->StartProfiler();
+
+        this->StartPolling();
+        this->StartTrace();
+    }
+
+    void Stop()
+    {
+        m_guitar_pro_poller.Stop();
+        this->StopTrace();
+        m_read_guitar_pro_state.reset();
+
+        // Spans are kept for the export
+        Profiler::SetEnabled(false);
+
+        m_reaper.SetExtState(EXT_STATE_SECTION, METRICS_KEY, m_sync_metrics.Serialize(), false);
+    }
+
+    // Reloading the offset database restarts polling, that stays in the same session
+    void StartPolling()
+    {
+        this->LoadLatencyTable();
+
+        m_audio_hook = m_reaper.GetExtState(EXT_STATE_SECTION, AUDIO_HOOK_KEY) == "1";
+        m_audio_drift.reset();
+        m_audio_blocks.reserve(AUDIO_BLOCK_CAPACITY);
+        m_audio_drifts.reserve(AUDIO_BLOCK_CAPACITY);
+        this->DrainAudioBlocks();
+
+        // Always read right away when sync is turned on
+        m_poll_scheduler = PollScheduler(PollScheduler::Clock::duration::zero());
+
+        const std::string value = m_reaper.GetExtState(EXT_STATE_SECTION, BACKGROUND_POLLING_RATE_KEY);
+
+        double rate = 0.0;
+        std::from_chars(value.data(), value.data() + value.size(), rate);
+        if (rate > 0.0)
+        {
+            m_guitar_pro_poller.Start(rate);
+        }
+    }
+
+    bool UsesAudioHook() const
+    {
+        return m_audio_hook;
+    }
+
+    void OnAudioBuffer(const bool is_post, const int, const double)
+    {
+        // The position is read before the block is rendered
+        if (is_post)
+        {
+            return;
+        }
+
+        // Nothing can be done about a full ring on the audio thread, the timer tick only needs the latest blocks anyway
+        m_audio_block_ring.TryPush(m_reaper.ReadAudioBlock());
+    }
+
     void MainLoop()
     {
+        TNT_PROFILE_SCOPE("Plugin::MainLoop");
+
+        // Measures the real time taken, the REAPER clock may be simulated
+        const auto tick_start = std::chrono::steady_clock::now();
+        const auto now = m_reaper.GetTime();
+
+        if (m_trace_recorder.IsRecording())
+        {
+            m_trace_recorder.RecordTick(now, m_reaper.PeekState(), m_reaper.GetOutputLatency());
+        }
+
+        this->Sync(now);
+
+        // Everything the tick decided is applied at once
+        m_reaper.FlushCommands();
+
+        m_sync_metrics.RecordTick(now, std::chrono::steady_clock::now() - tick_start);
+    }
+
+    void SetMetricsPath(const std::filesystem::path& path)
+    {
+        m_metrics_path = path;
+    }
+
+    void ExportMetrics()
+    {
+        const std::string summary = m_sync_metrics.Serialize();
+        m_reaper.SetExtState(EXT_STATE_SECTION, METRICS_KEY, summary, false);
+
+        std::filesystem::path json_path = m_metrics_path;
+        json_path.replace_extension(".json");
+        std::filesystem::path csv_path = m_metrics_path;
+        csv_path.replace_extension(".csv");
+
+        try
+        {
+            this->WriteMetricsFile(json_path, m_sync_metrics.ToJson());
+            this->WriteMetricsFile(csv_path, m_sync_metrics.ToCsv());
+            m_reaper.ShowConsoleMessage(std::format("Exported Guitar Pro sync metrics to '{}' and '{}'.\n", json_path.string(), csv_path.string()));
+
+            if (m_profiling)
+            {
+                std::filesystem::path profile_path = m_metrics_path;
+                profile_path += PROFILE_FILE_SUFFIX;
+
+                this->WriteMetricsFile(profile_path, Profiler::ExportChromeTrace());
+                m_reaper.ShowConsoleMessage(std::format("Exported Guitar Pro sync profile to '{}'.\n", profile_path.string()));
+            }
+        }
+        catch (const std::runtime_error& error)
+        {
+            m_reaper.ShowConsoleMessage(error.what());
+        }
+    }
+
+    void SetOffsetDatabasePath(const std::filesystem::path& path)
+    {
+        m_guitar_pro.SetOffsetDatabasePath(path);
+    }
+
+    void CaptureMemoryDump(const std::filesystem::path& path)
+    {
+        try
+        {
+            m_guitar_pro.CaptureMemoryDump(path);
+            m_reaper.ShowConsoleMessage(std::format("Saved Guitar Pro memory dump to '{}'.\n", path.string()));
+        }
+        catch (const std::runtime_error& error)
+        {
+            m_reaper.ShowConsoleMessage(error.what());
+        }
+    }
+
+    void ImportTempoMap(const std::filesystem::path& path)
+    {
+        try
+        {
+            const auto start = std::chrono::steady_clock::now();
+
+            const GuitarProScore score = ReadGuitarProScore(path);
+
+            // REAPER's timeline follows playback, a tempo map in the written order would be wrong after the first jump
+            if (!score.playback_jumps.empty())
+            {
+                throw std::runtime_error(std::format("Can't import the tempo map of '{}', Guitar Pro doesn't play its bars in the written order. {}.\n",
+                    path.string(), ToString(score.playback_jumps.front())));
+            }
+
+            const std::vector<TempoMarker> markers = score.GetTempoMarkers();
+            m_reaper.ReplaceTempoMarkers(markers, "Import Guitar Pro tempo map");
+
+            const std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+            m_reaper.ShowConsoleMessage(std::format("Imported the tempo map of '{}': {} bars, {} tempo/time signature markers in {:.1f} ms.\n",
+                path.string(), score.bars.size(), markers.size(), duration.count()));
+        }
+        catch (const std::runtime_error& error)
+        {
+            m_reaper.ShowConsoleMessage(error.what());
+        }
+    }
+
+    void CheckTempoMap(const std::filesystem::path& path)
+    {
+        try
+        {
+            const GuitarProScore score = ReadGuitarProScore(path);
+            const TempoMap guitar_pro_tempo_map = score.GetTempoMap();
+            const std::vector<TempoMarker> markers = m_reaper.GetTempoMarkers();
+            const TempoMap reaper_tempo_map = TempoMap::FromMarkers(markers);
+
+            const std::vector<TempoMapMismatch> mismatches = DiffTempoMaps(guitar_pro_tempo_map, reaper_tempo_map, TEMPO_MAP_TOLERANCE);
+
+            // Bars are compared in the written order, which stops matching REAPER's timeline at the first jump
+            if (!score.playback_jumps.empty())
+            {
+                m_reaper.ShowConsoleMessage(std::format("Warning: '{}' isn't played in the written order, bars after the first jump are compared as written. {}.\n",
+                    path.string(), ToString(score.playback_jumps.front())));
+            }
+
+            if (mismatches.empty())
+            {
+                m_reaper.ShowConsoleMessage(std::format("REAPER's tempo map matches all {} bars of '{}'.\n", guitar_pro_tempo_map.GetBarCount(), path.string()));
+                return;
+            }
+
+            std::string message = std::format("REAPER's tempo map differs from '{}' in {} of {} bars:\n", path.string(), mismatches.size(), guitar_pro_tempo_map.GetBarCount());
+            for (std::size_t i = 0; i < std::min(mismatches.size(), MAX_REPORTED_TEMPO_MAP_MISMATCHES); i++)
+            {
+                message += ToString(mismatches[i]) + "\n";
+            }
+
+            if (mismatches.size() > MAX_REPORTED_TEMPO_MAP_MISMATCHES)
+            {
+                message += std::format("... and {} more.\n", mismatches.size() - MAX_REPORTED_TEMPO_MAP_MISMATCHES);
+            }
+
+            m_reaper.ShowConsoleMessage(message);
+        }
+        catch (const std::runtime_error& error)
+        {
+            m_reaper.ShowConsoleMessage(error.what());
+        }
+    }
+
+    void ReloadOffsetDatabase()
+    {
+        // The polling thread must not read while the layout is swapped
+        const bool polling = m_guitar_pro_poller.IsRunning();
+        m_guitar_pro_poller.Stop();
+
+        try
+        {
+            m_guitar_pro.ReloadOffsetDatabase();
+            m_reaper.ShowConsoleMessage("Reloaded Guitar Pro offset database.\n");
+        }
+        catch (const std::runtime_error& error)
+        {
+            m_reaper.ShowConsoleMessage(error.what());
+        }
+
+        // Don't wait out a backoff, the new offsets may be what was missing
+        m_poll_scheduler = PollScheduler(PollScheduler::Clock::duration::zero());
+
+        if (polling)
+        {
+            this->StartPolling();
+        }
+    }
+
+    void StartLatencyCalibration()
+    {
+        m_reaper.ShowConsoleMessage("Calibrating seek latency, this takes about 15 seconds. Leave REAPER's transport alone until it is done.\n");
+        m_latency_calibrator.Start();
+    }
+
+    bool LatencyCalibrationLoop()
+    {
+        if (m_latency_calibrator.Tick())
+        {
+            return true;
+        }
+
         try
         {
+            m_latency_table = m_latency_calibrator.GetResult();
+            m_reaper.SetExtState(EXT_STATE_SECTION, LATENCY_CALIBRATION_KEY, m_latency_table.Serialize(), true);
+            m_reaper.ShowConsoleMessage(std::format("Calibrated seek latency: {}\n", m_latency_table.Serialize()));
+        }
+        catch (const std::runtime_error& error)
+        {
+            m_reaper.ShowConsoleMessage(error.what());
+        }
+
+        // Make sure the next tick doesn't act on a state from before the calibration
+        m_poll_scheduler = PollScheduler(PollScheduler::Clock::duration::zero());
+        m_position_estimator.Reset();
+        m_prev_guitar_pro_state = GuitarProState();
+        m_play_stop_pending = false;
+        m_resync_events = true;
+
+        return false;
+    }
+
+    bool GetCachedGuitarProState(GuitarProState& state, double& age) const
+    {
+        if (!m_read_guitar_pro_state)
+        {
+            return false;
+        }
+
+        state = *m_read_guitar_pro_state;
+        age = std::chrono::duration<double>(m_reaper.GetTime() - state.timestamp).count();
+        return true;
+    }
+
+    bool PredictGuitarProPosition(PositionEstimate& estimate) const
+    {
+        if (!m_read_guitar_pro_state)
+        {
+            return false;
+        }
+
+        // The estimator only has samples while Guitar Pro plays
+        if (m_position_estimator.HasSamples())
+        {
+            estimate = m_position_estimator.Predict(m_reaper.GetTime());
+        }
+        else
+        {
+            estimate.position = m_read_guitar_pro_state->play_position;
+            estimate.confidence = m_read_guitar_pro_state->play_state ? 0.0 : 1.0;
+        }
+
+        return true;
+    }
+
+private:
+    // One pass of reading both applications and deciding what REAPER should do, commands are only queued
+    void Sync(const std::chrono::steady_clock::time_point now)
+    {
+        TNT_PROFILE_SCOPE("Plugin::Sync");
+
+        this->DrainAudioBlocks();
+
+        // The calibration owns the transport until it is done
+        if (m_latency_calibrator.IsRunning())
+        {
+            return;
+        }
+
+        // Poll at the full rate as soon as the REAPER transport changes too
+        // Only the play state is checked here so skipped ticks stay cheap
+        const ReaperPlayState reaper_play_state = m_reaper.GetPlayState();
+        if (reaper_play_state != m_prev_reaper_play_state)
+        {
+            m_poll_scheduler.Wake(now);
+            m_prev_reaper_play_state = reaper_play_state;
+        }
+
+        if (m_play_requested_time && reaper_play_state == ReaperPlayState::PLAYING)
+        {
+            m_sync_metrics.RecordTimeToPlay(now - *m_play_requested_time);
+            m_play_requested_time.reset();
+        }
+
+        // Reads are skipped entirely while Guitar Pro is idle or absent
+        const bool polling = m_guitar_pro_poller.IsRunning();
+        if (!polling && !m_poll_scheduler.IsDue(now))
+        {
+            return;
+        }
+
+        try
+        {
+            TNT_PROFILE_SCOPE("Plugin::ReadGuitarPro");
+
             // Read current Guitar Pro and REAPER states
-            m_guitar_pro_state = m_guitar_pro.ReadProcessMemory();
+            if (!polling)
+            {
+                // Stamped with REAPER's clock, which may be simulated, so jumps are judged by the time it says has passed
+                m_guitar_pro_state = m_guitar_pro.ReadProcessMemory(now);
+                m_guitar_pro_events = m_guitar_pro.GetEvents();
+                m_poll_scheduler.OnRead(now, m_guitar_pro_state);
+            }
+
+            // Nothing to sync until the polling thread finished its first read
+            else if (!m_guitar_pro_poller.GetLatestState(m_guitar_pro_state, m_guitar_pro_events))
+            {
+                return;
+            }
+        }
+        catch (const GuitarProAttachPending&)
+        {
+            // Checked again next tick, finding Guitar Pro is not a failed read
+            return;
         }
         catch (const std::runtime_error& error)
         {
+            TNT_PROFILE_SCOPE("Plugin::HandleReadError");
+
+            m_trace_recorder.RecordGuitarProReadFailed(now);
+            m_sync_metrics.RecordReadFailure();
+            m_read_guitar_pro_state.reset();
+
+            if (!polling)
+            {
+                m_poll_scheduler.OnReadFailed(now);
+            }
+
+            this->PublishPollState();
+
             if (m_last_error != error.what())
             {
                 m_reaper.ShowConsoleMessage(error.what());
@@ -41,40 +472,74 @@ struct Plugin::Impl final {
             return;
         }
 
+        m_trace_recorder.RecordGuitarProState(now, m_guitar_pro_state);
+        m_read_guitar_pro_state = m_guitar_pro_state;
+
+        // Everything that differs from a blank state counts as changed after a calibration
+        if (m_resync_events)
+        {
+            m_guitar_pro_events.Merge(DetectGuitarProEvents(GuitarProState(), m_guitar_pro_state));
+            m_resync_events = false;
+        }
+
+        this->PublishPollState();
+        this->UpdatePositionEstimate();
+        this->UpdateAudioDrift();
+
+        // Counted from the first read that saw Guitar Pro playing
+        if (m_guitar_pro_state.play_state && m_guitar_pro_events.Has(GuitarProEventType::PLAY_STARTED))
+        {
+            m_play_requested_time = m_guitar_pro_events.GetTimestamp(GuitarProEventType::PLAY_STARTED);
+        }
+        else if (!m_guitar_pro_state.play_state)
+        {
+            m_play_requested_time.reset();
+        }
+
         if (!m_last_error.empty())
         {
             m_reaper.ShowConsoleMessage("Successfully connected to Guitar Pro process.\n");
             m_last_error = "";
         }
+
+        // Nothing below acts while both reads saw Guitar Pro idle and nothing changed in between
+        if (!m_guitar_pro_events.Any() && !m_guitar_pro_state.play_state && !m_prev_guitar_pro_state.play_state && !m_play_stop_pending)
+        {
+            m_prev_guitar_pro_state = m_guitar_pro_state;
+            return;
+        }
+
+        // Read REAPER once, every decision below works off this snapshot
+        ReaperState reaper_state = m_reaper.GetState();
         
         // Ensure REAPER stays in sync while Guitar Pro is playing
         if (m_guitar_pro_state.play_state)
         {
-            this->SyncLoopState();
-            this->SyncTimeSelection();
-            this->SyncPlayPosition();
-            this->SyncPlayRate();
+            this->SyncLoopState(reaper_state);
+            this->SyncTimeSelection(reaper_state);
+            this->SyncPlayPosition(reaper_state);
+            this->SyncPlayRate(reaper_state);
         }
 
         // Allow some control while Guitar Pro and REAPER are both paused
-        else if (this->ReaperStoppedOrPaused())
+        else if (this->ReaperStoppedOrPaused(reaper_state))
         {
             // Sync loop state
             if (this->GuitarProLoopStateChanged())
             {
-                this->SyncLoopState();
+                this->SyncLoopState(reaper_state);
             }
 
             // Sync time selection and cursor
             if (this->GuitarProTimeSelectionChanged() && m_guitar_pro_state.time_selection_end_position > MINIMUM_PLAY_RATE_STEP)
             {
-                this->SyncTimeSelection();
-                this->SetPlayPosition(m_guitar_pro_state.time_selection_start_position);
+                this->SyncTimeSelection(reaper_state);
+                this->SetPlayPosition(reaper_state, m_guitar_pro_state.time_selection_start_position, SeekReason::CURSOR_MOVED);
             }
             else if (this->GuitarProCursorMoved())
             {
-                this->SyncTimeSelection();
-                this->SetPlayPosition(m_guitar_pro_state.play_position);
+                this->SyncTimeSelection(reaper_state);
+                this->SetPlayPosition(reaper_state, m_guitar_pro_state.play_position, SeekReason::CURSOR_MOVED);
             }
 
             // Sync play rate
@@ -82,156 +547,401 @@ struct Plugin::Impl final {
             {
                 // TODO this doesn't work while paused because the value read from memory only updates at runtime.
                 // We need to find a new memory address to get this to work more effectively
-                this->SyncPlayRate();
+                this->SyncPlayRate(reaper_state);
             }
         }
 
         // Ensure REAPER is playing if Guitar Pro is playing
-        this->SyncPlayState();
+        this->SyncPlayState(reaper_state);
 
         // Save previous Guitar Pro state
         m_prev_guitar_pro_state = m_guitar_pro_state;
     }
 
-private:
-    void SyncLoopState()
+    void StartProfiler()
+    {
+        m_profiling = m_reaper.GetExtState(EXT_STATE_SECTION, PROFILER_KEY) == "1";
+        if (m_profiling && !Profiler::IsCompiledIn())
+        {
+            m_reaper.ShowConsoleMessage("Profiling spans are not compiled into this build, configure with -DGUITAR_PRO_SYNC_PROFILER=ON.\n");
+            m_profiling = false;
+        }
+
+        Profiler::Clear();
+        Profiler::SetEnabled(m_profiling);
+    }
+
+    void StartTrace()
+    {
+        const std::string path = m_reaper.GetExtState(EXT_STATE_SECTION, TRACE_PATH_KEY);
+        if (path.empty())
+        {
+            return;
+        }
+
+        try
+        {
+            m_trace_recorder.Start(std::filesystem::path(path), m_reaper.GetTime());
+        }
+        catch (const std::runtime_error& error)
+        {
+            m_reaper.ShowConsoleMessage(error.what());
+            return;
+        }
+
+        // Settings that change how the session plays out
+        for (const char* key : { LATENCY_CALIBRATION_KEY, BACKGROUND_POLLING_RATE_KEY, AUDIO_HOOK_KEY })
+        {
+            m_trace_recorder.RecordExtState(m_reaper.GetTime(), key, m_reaper.GetExtState(EXT_STATE_SECTION, key));
+        }
+
+        m_reaper.SetCommandListener([this](const ReaperCommand& command) {
+            m_trace_recorder.RecordReaperCommand(m_reaper.GetTime(), command);
+        });
+
+        m_reaper.ShowConsoleMessage(std::format("Recording sync trace to '{}'.\n", path));
+    }
+
+    void StopTrace()
+    {
+        if (!m_trace_recorder.IsRecording())
+        {
+            return;
+        }
+
+        m_reaper.SetCommandListener(nullptr);
+
+        try
+        {
+            m_trace_recorder.Stop();
+        }
+        catch (const std::runtime_error& error)
+        {
+            m_reaper.ShowConsoleMessage(error.what());
+        }
+    }
+
+    void WriteMetricsFile(const std::filesystem::path& path, const std::string& text) const
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(text.data(), static_cast<std::streamsize>(text.size()));
+        if (!file)
+        {
+            throw std::runtime_error(std::format("Failed to write Guitar Pro sync metrics to '{}'.\n", path.string()));
+        }
+    }
+
+    void LoadLatencyTable()
     {
+        const std::string value = m_reaper.GetExtState(EXT_STATE_SECTION, LATENCY_CALIBRATION_KEY);
+        if (value.empty())
+        {
+            m_latency_table = LatencyTable();
+            return;
+        }
+
+        const std::optional<LatencyTable> table = LatencyTable::Parse(value);
+        if (!table)
+        {
+            m_reaper.ShowConsoleMessage(std::format("Ignoring invalid seek latency calibration '{}', run the calibration action again.\n", value));
+            m_latency_table = LatencyTable();
+            return;
+        }
+
+        m_latency_table = *table;
+    }
+
+    // Guitar Pro briefly reports a play rate of 0 when playback starts
+    double GetGuitarProPlayRate() const
+    {
+        return m_guitar_pro_state.play_rate > MINIMUM_PLAY_RATE_STEP ? m_guitar_pro_state.play_rate : 1.0;
+    }
+
+    // Seconds between a seek and REAPER being heard from the new position at the current play rate
+    double GetSeekLatency() const
+    {
+        return m_latency_table.GetLatency(this->GetGuitarProPlayRate(), m_reaper.GetOutputLatency());
+    }
+
+    void PublishPollState()
+    {
+        const bool polling = m_guitar_pro_poller.IsRunning();
+        const PollState state = polling ? m_guitar_pro_poller.GetPollState() : m_poll_scheduler.GetState();
+        const auto interval = polling ? m_guitar_pro_poller.GetPollInterval() : m_poll_scheduler.GetInterval();
+
+        // Only touch ExtState when something changed
+        if (state == m_published_poll_state && interval == m_published_poll_interval)
+        {
+            return;
+        }
+
+        m_reaper.SetExtState(EXT_STATE_SECTION, POLL_STATE_KEY, std::string(ToString(state)), false);
+        m_reaper.SetExtState(EXT_STATE_SECTION, POLL_INTERVAL_KEY, std::format("{:.1f}", std::chrono::duration<double, std::milli>(interval).count()), false);
+
+        m_published_poll_state = state;
+        m_published_poll_interval = interval;
+    }
+
+    void UpdatePositionEstimate()
+    {
+        if (!m_guitar_pro_state.play_state)
+        {
+            m_position_estimator.Reset();
+        }
+
+        // The polling thread may hand over the same snapshot on several ticks
+        else if (m_guitar_pro_state.timestamp != m_prev_guitar_pro_state.timestamp)
+        {
+            m_position_estimator.AddSample(m_guitar_pro_state.timestamp, m_guitar_pro_state.play_position, m_guitar_pro_state.play_rate);
+        }
+    }
+
+    // Collects the audio blocks recorded since the last tick, runs on every tick so none of them go stale
+    void DrainAudioBlocks()
+    {
+        m_audio_blocks.clear();
+
+        ReaperAudioBlock sample;
+        while (m_audio_block_ring.TryPop(sample))
+        {
+            m_audio_blocks.push_back(sample);
+        }
+    }
+
+    // Matches the audio blocks against the predicted Guitar Pro position
+    void UpdateAudioDrift()
+    {
+        m_audio_drift.reset();
+        m_audio_drifts.clear();
+
+        if (!m_audio_hook || !m_position_estimator.HasSamples())
+        {
+            return;
+        }
+
+        // Blocks are heard one output latency after they were processed
+        const auto output_latency = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(m_reaper.GetOutputLatency()));
+
+        for (const ReaperAudioBlock& block : m_audio_blocks)
+        {
+            // Blocks from before the last seek took effect would report a desync that was already corrected
+            if (block.playing && block.timestamp >= m_seek_settled_time)
+            {
+                m_audio_drifts.push_back(block.position - m_position_estimator.Predict(block.timestamp + output_latency).position);
+            }
+        }
+
+        if (m_audio_drifts.empty())
+        {
+            return;
+        }
+
+        // The median ignores the odd block processed right around a transport change
+        const auto middle = m_audio_drifts.begin() + m_audio_drifts.size() / 2;
+        std::nth_element(m_audio_drifts.begin(), middle, m_audio_drifts.end());
+        m_audio_drift = *middle;
+    }
+
+    void SyncLoopState(ReaperState& reaper_state)
+    {
+        TNT_PROFILE_SCOPE("Plugin::SyncLoopState");
+
         // Sync the loop state (unless we are playing and there is a count in timer)
         if (m_guitar_pro_state.loop_state && !(m_guitar_pro_state.play_state && m_guitar_pro_state.count_in_state))
         {
-            m_reaper.SetRepeat(true);
+            m_reaper.QueueRepeat(true);
+            reaper_state.repeat = true;
         }
         else
         {
-            m_reaper.SetRepeat(false);
+            m_reaper.QueueRepeat(false);
+            reaper_state.repeat = false;
         }
     }
 
-    void SyncTimeSelection()
+    void SyncTimeSelection(ReaperState& reaper_state)
     {
+        TNT_PROFILE_SCOPE("Plugin::SyncTimeSelection");
+
         // Sync the time selection
-        m_reaper.SetTimeSelection(m_guitar_pro_state.time_selection_start_position, m_guitar_pro_state.time_selection_end_position);
+        m_reaper.QueueTimeSelection(m_guitar_pro_state.time_selection_start_position, m_guitar_pro_state.time_selection_end_position);
+        reaper_state.time_selection_start_position = m_guitar_pro_state.time_selection_start_position;
+        reaper_state.time_selection_end_position = m_guitar_pro_state.time_selection_end_position;
     }
 
-    void SyncPlayPosition()
+    void SyncPlayPosition(ReaperState& reaper_state)
     {
-        if (this->GuitarProCursorMoved() && !CompareDoubles(m_reaper.GetPlayPosition(), m_guitar_pro_state.play_position, DESYNC_THRESHOLD))
+        TNT_PROFILE_SCOPE("Plugin::SyncPlayPosition");
+
+        if (!this->GuitarProCursorMoved())
         {
-            // DO NOT SYNC if REAPER is right at the start or end of the loop
-            if (this->CompareDoubles(m_reaper.GetPlayPosition(), m_guitar_pro_state.time_selection_start_position, DESYNC_THRESHOLD)
-             || this->CompareDoubles(m_reaper.GetPlayPosition(), m_guitar_pro_state.time_selection_end_position, DESYNC_THRESHOLD))
-            {
-                return;
-            }
+            return;
+        }
 
-            // If the guitar pro cursor has jumped, follow the jump
-            if (!this->CompareDoubles(m_prev_guitar_pro_state.play_position, m_guitar_pro_state.play_position, GUITAR_PRO_CURSOR_JUMP_THRESHOLD))
-            {
-                this->SetPlayPosition(m_guitar_pro_state.play_position + LATENCY_COMPENSATION);
-            }
+        // Compare against where Guitar Pro is now rather than where it was when it was read
+        // With the audio hook the drift was already measured for every audio block since the last tick
+        const PositionEstimate estimate = m_position_estimator.Predict(m_reaper.GetTime());
+        const double reaper_position = reaper_state.play_position;
+        const double drift = m_audio_drift ? *m_audio_drift : reaper_position - estimate.position;
 
-            // If a desync occurs for any other reason, get it back in sync
-            // Guitar Pro can be a bit inconsistent so this needs to be checked over the course of a few loops though to ensure accuracy
-            else if (this->Desync(DESYNC_THRESHOLD))
-            {
-                this->SetPlayPosition(m_guitar_pro_state.play_position + LATENCY_COMPENSATION);
-            }
+        const bool at_loop_edge = this->CompareDoubles(reaper_position, m_guitar_pro_state.time_selection_start_position, DESYNC_THRESHOLD)
+                               || this->CompareDoubles(reaper_position, m_guitar_pro_state.time_selection_end_position, DESYNC_THRESHOLD);
+
+        // Around the loop edges one side may already have wrapped around
+        if (reaper_state.play_state == ReaperPlayState::PLAYING && !at_loop_edge)
+        {
+            m_sync_metrics.RecordDrift(drift);
+        }
+
+        if (fabs(drift) < DESYNC_THRESHOLD)
+        {
+            m_desync_count = 0;
+            return;
+        }
+
+        // DO NOT SYNC if REAPER is right at the start or end of the loop
+        if (at_loop_edge)
+        {
+            return;
+        }
+
+        // If the guitar pro cursor has jumped, follow the jump
+        if (this->GuitarProCursorJumped())
+        {
+            this->SetPlayPosition(reaper_state, this->PredictSeekPosition(), SeekReason::JUMP);
+        }
+
+        // If a desync occurs for any other reason, get it back in sync
+        // The prediction already filters Guitar Pro's jitter, so a settled estimate only needs confirming once
+        else if (estimate.confidence >= MINIMUM_DESYNC_CONFIDENCE && ++m_desync_count >= DESYNC_CONFIRM_SAMPLES)
+        {
+            this->SetPlayPosition(reaper_state, this->PredictSeekPosition(), SeekReason::DESYNC);
         }
     }
 
-    void SyncPlayRate()
+    void SyncPlayRate(ReaperState& reaper_state)
     {
+        TNT_PROFILE_SCOPE("Plugin::SyncPlayRate");
+
         // TODO: The running playback rate memory location seems to take a bit to update when playing the song
         // Because of this, the playback rate may register as 0 for a fraction of a second.
         // Look for a better address in Cheat Engine so this can be done faster
         if (m_guitar_pro_state.play_rate > MINIMUM_PLAY_RATE_STEP)
         {
             // If playback rates don't match, sync them
-            if (!this->CompareDoubles(m_reaper.GetPlayRate(), m_guitar_pro_state.play_rate, MINIMUM_PLAY_RATE_STEP))
+            if (!this->CompareDoubles(reaper_state.play_rate, m_guitar_pro_state.play_rate, MINIMUM_PLAY_RATE_STEP))
             {
                 // Always ensure preserve pitch is set before stretching
-                this->EnablePreservePitch();
+                this->EnablePreservePitch(reaper_state);
+
+                // REAPER is paused while the play rate changes
+                m_reaper.QueuePlayRate(m_guitar_pro_state.play_rate);
+                m_sync_metrics.RecordPlayRateChange();
+                if (reaper_state.play_state == ReaperPlayState::PLAYING)
+                {
+                    reaper_state.play_state = ReaperPlayState::PAUSED;
+                }
 
-                // REAPER handles stretching much more efficiently if the song is paused
-                m_reaper.SetPlayState(ReaperPlayState::PAUSED);
-                m_reaper.SetPlayRate(m_guitar_pro_state.play_rate);
+                reaper_state.play_rate = m_guitar_pro_state.play_rate;
             }
         }
     }
 
-    void SyncPlayState()
+    void SyncPlayState(ReaperState& reaper_state)
     {
+        TNT_PROFILE_SCOPE("Plugin::SyncPlayState");
+
         if (m_guitar_pro_state.play_state)
         {
+            m_play_stop_pending = false;
+
             // Stop REAPER if Guitar Pro is currently counting in and the cursor is not moving
             if (m_guitar_pro_state.count_in_state
-             && (!this->GuitarProCursorMoved() || (m_guitar_pro_state.time_selection_start_position > MINIMUM_TIME_STEP && m_prev_guitar_pro_state.play_position < MINIMUM_TIME_STEP)))
+             && (!this->GuitarProCursorMoved() || this->GuitarProCountInBegan()))
             {
                 // DO NOT cut a loop short
-                if (!this->CompareDoubles(m_reaper.GetPlayPosition(), m_guitar_pro_state.time_selection_start_position, MINIMUM_TIME_STEP)
-                 && m_reaper.GetPlayPosition() < m_guitar_pro_state.time_selection_end_position)
+                if (!this->CompareDoubles(reaper_state.play_position, m_guitar_pro_state.time_selection_start_position, MINIMUM_TIME_STEP)
+                 && reaper_state.play_position < m_guitar_pro_state.time_selection_end_position)
                 {
                     return;
                 }
 
-                m_reaper.SetPlayState(ReaperPlayState::STOPPED);
+                // Counted once per count in, REAPER stays stopped until it is over
+                if (reaper_state.play_state != ReaperPlayState::STOPPED)
+                {
+                    m_sync_metrics.RecordCountInStop();
+                }
+
+                m_reaper.QueuePlayState(ReaperPlayState::STOPPED);
+                reaper_state.play_state = ReaperPlayState::STOPPED;
             }
 
-            else if (this->ReaperStoppedOrPaused())
+            else if (this->ReaperStoppedOrPaused(reaper_state))
             {
                 // If a loop is specified start there
                 if (m_guitar_pro_state.time_selection_start_position > MINIMUM_TIME_STEP)
                 {
-                    this->SetPlayPosition(m_guitar_pro_state.time_selection_start_position + LATENCY_COMPENSATION);
+                    this->SetPlayPosition(reaper_state, m_guitar_pro_state.time_selection_start_position + this->GetSeekLatency() * this->GetGuitarProPlayRate(), SeekReason::PLAY_START);
                 }
 
                 else
                 {
-                    this->SetPlayPosition(m_guitar_pro_state.play_position + LATENCY_COMPENSATION);
+                    this->SetPlayPosition(reaper_state, this->PredictSeekPosition(), SeekReason::PLAY_START);
                 }
 
-                m_reaper.SetPlayState(ReaperPlayState::PLAYING);
+                m_reaper.QueuePlayState(ReaperPlayState::PLAYING);
+                reaper_state.play_state = ReaperPlayState::PLAYING;
             }
         }
 
-        // Stop REAPER if Guitar Pro is not playing
-        else if (!this->ReaperStoppedOrPaused() && m_prev_guitar_pro_state.play_state)
+        // Stop REAPER if Guitar Pro stopped playing
+        else if (this->GuitarProPlayStopped() || m_play_stop_pending)
         {
-            // DO NOT cut a time selection short
-            if (m_reaper.GetPlayPosition() < m_guitar_pro_state.time_selection_end_position
-             && this->CompareDoubles(m_reaper.GetPlayPosition(), m_guitar_pro_state.time_selection_end_position, DESYNC_THRESHOLD)
-             && !this->CompareDoubles(m_reaper.GetPlayPosition(), m_guitar_pro_state.time_selection_start_position, DESYNC_THRESHOLD))
+            m_play_stop_pending = false;
+            if (this->ReaperStoppedOrPaused(reaper_state))
             {
-                m_guitar_pro_state.play_state = true;
                 return;
             }
 
-            m_reaper.SetPlayState(ReaperPlayState::STOPPED);
+            // DO NOT cut a time selection short, checked again every tick until REAPER reaches its end
+            if (reaper_state.play_position < m_guitar_pro_state.time_selection_end_position
+             && this->CompareDoubles(reaper_state.play_position, m_guitar_pro_state.time_selection_end_position, DESYNC_THRESHOLD)
+             && !this->CompareDoubles(reaper_state.play_position, m_guitar_pro_state.time_selection_start_position, DESYNC_THRESHOLD))
+            {
+                m_play_stop_pending = true;
+                return;
+            }
+
+            m_reaper.QueuePlayState(ReaperPlayState::STOPPED);
+            reaper_state.play_state = ReaperPlayState::STOPPED;
         }
     }
 
-    bool Desync(const double threshold)
+    // Where Guitar Pro will be by the time a seek issued now is heard
+    double PredictSeekPosition() const
     {
-        std::rotate(m_desync_window.rbegin(), m_desync_window.rbegin() + 1, m_desync_window.rend());
-        m_desync_window[0] = fabs(m_reaper.GetPlayPosition() - m_guitar_pro_state.play_position);
-
-        // Return false if ANY value in the window is not greater than the threshold
-        for (const double value : m_desync_window)
+        const double latency = this->GetSeekLatency();
+        if (!m_position_estimator.HasSamples())
         {
-            if (value < threshold)
-            {
-                return false;
-            }
+            return m_guitar_pro_state.play_position + latency * this->GetGuitarProPlayRate();
         }
 
-        // Desync has definitively occurred
-        return true;
+        const auto seek_latency = std::chrono::duration_cast<PositionEstimator::Clock::duration>(std::chrono::duration<double>(latency));
+        return m_position_estimator.Predict(m_reaper.GetTime() + seek_latency).position;
     }
-    
-    void SetPlayPosition(const double time)
+
+    void SetPlayPosition(ReaperState& reaper_state, const double time, const SeekReason reason)
     {
-        m_reaper.SetEditCursorPosition(time, false, true);
-        m_desync_window.fill(0.0);
+        m_reaper.QueueEditCursorPosition(time, false, true);
+        m_sync_metrics.RecordSeek(reason);
+
+        // The seek only happens at the end of the tick, until then the snapshot goes by the target
+        reaper_state.play_position = time;
+
+        m_desync_count = 0;
+
+        const auto seek_latency = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(this->GetSeekLatency()));
+        m_seek_settled_time = m_reaper.GetTime() + seek_latency;
     }
 
     // Returns true if the two values are within epsilon of each other
@@ -240,30 +950,47 @@ private:
         return (fabs(val1 - val2) < epsilon);
     }
 
+    // Changes since the previous tick, with background polling also the ones in between ticks
     bool GuitarProLoopStateChanged() const
     {
-        return m_guitar_pro_state.loop_state != m_prev_guitar_pro_state.loop_state;
+        return m_guitar_pro_events.Has(GuitarProEventType::LOOP_TOGGLED);
     }
 
     bool GuitarProTimeSelectionChanged() const
     {
-        return !this->CompareDoubles(m_guitar_pro_state.time_selection_start_position, m_prev_guitar_pro_state.time_selection_start_position, MINIMUM_TIME_STEP)
-            || !this->CompareDoubles(m_guitar_pro_state.time_selection_end_position, m_prev_guitar_pro_state.time_selection_end_position, MINIMUM_TIME_STEP);
+        return m_guitar_pro_events.Has(GuitarProEventType::SELECTION_CHANGED);
     }
 
     bool GuitarProCursorMoved() const
     {
-        return !this->CompareDoubles(m_guitar_pro_state.play_position, m_prev_guitar_pro_state.play_position, MINIMUM_TIME_STEP);
+        return m_guitar_pro_events.Has(GuitarProEventType::CURSOR_MOVED);
     }
 
     bool GuitarProPlayRateChanged() const
     {
-        return !this->CompareDoubles(m_guitar_pro_state.play_rate, m_prev_guitar_pro_state.play_rate, MINIMUM_PLAY_RATE_STEP);
+        return m_guitar_pro_events.Has(GuitarProEventType::RATE_CHANGED);
     }
 
-    bool ReaperStoppedOrPaused() const
+    // Moved further than playback explains, e.g. the user clicked elsewhere in the score
+    bool GuitarProCursorJumped() const
     {
-        switch (m_reaper.GetPlayState())
+        return m_guitar_pro_events.Has(GuitarProEventType::CURSOR_JUMPED);
+    }
+
+    bool GuitarProPlayStopped() const
+    {
+        return m_guitar_pro_events.Has(GuitarProEventType::PLAY_STOPPED);
+    }
+
+    // The cursor moves to where the count in starts as it begins
+    bool GuitarProCountInBegan() const
+    {
+        return m_guitar_pro_events.Has(GuitarProEventType::COUNT_IN_BEGAN);
+    }
+
+    bool ReaperStoppedOrPaused(const ReaperState& reaper_state) const
+    {
+        switch (reaper_state.play_state)
         {
         case ReaperPlayState::STOPPED:
         case ReaperPlayState::PAUSED:
@@ -276,22 +1003,63 @@ private:
         }
     }
 
-    void EnablePreservePitch() const
+    void EnablePreservePitch(ReaperState& reaper_state) const
     {
-        // If Preserve Pitch is OFF, enable it
-        if (!m_reaper.GetToggleCommandState(ReaperToggleCommand::PRESERVE_PITCH)) {
-            m_reaper.ToggleCommand(ReaperToggleCommand::PRESERVE_PITCH);
-        }
+        // Queued every time, FlushCommands drops it when Preserve Pitch is already on
+        m_reaper.QueuePreservePitch(true);
+        reaper_state.preserve_pitch = true;
     }
 
     PluginState& m_plugin_state;
     GuitarPro m_guitar_pro;
+    GuitarProPoller m_guitar_pro_poller;
     Reaper m_reaper;
 
+    LatencyCalibrator m_latency_calibrator;
+    TraceRecorder m_trace_recorder;
+    LatencyTable m_latency_table;
+
+    // Reset every time sync is turned on
+    SyncMetrics m_sync_metrics;
+    std::filesystem::path m_metrics_path = METRICS_FILE_NAME;
+    std::optional<std::chrono::steady_clock::time_point> m_play_requested_time;
+
+    // Set for the session by the "profiler" ExtState
+    bool m_profiling = false;
+
+    // Written by the audio thread, drained on every tick
+    bool m_audio_hook = false;
+    SpscRing<ReaperAudioBlock, AUDIO_BLOCK_CAPACITY> m_audio_block_ring;
+    std::vector<ReaperAudioBlock> m_audio_blocks;
+    std::vector<double> m_audio_drifts;
+    std::optional<double> m_audio_drift;
+    std::chrono::steady_clock::time_point m_seek_settled_time;
+
+    PollScheduler m_poll_scheduler;
+    ReaperPlayState m_prev_reaper_play_state = ReaperPlayState::STOPPED;
+
+    // Last values written to ExtState, the interval starts out impossible so the first tick publishes
+    PollState m_published_poll_state = PollState::ACTIVE;
+    PollScheduler::Clock::duration m_published_poll_interval = PollScheduler::Clock::duration::min();
+
     GuitarProState m_prev_guitar_pro_state;
     GuitarProState m_guitar_pro_state;
+    GuitarProEvents m_guitar_pro_events;
+
+    // Set after a calibration so the next tick treats the whole state as new
+    bool m_resync_events = false;
+
+    // Last successful read of this session as Guitar Pro reported it, published through the ReaScript API
+    // The sync passes work on m_guitar_pro_state, this copy is never changed by them
+    std::optional<GuitarProState> m_read_guitar_pro_state;
 
-    std::array<double, DESYNC_WINDOW_SIZE> m_desync_window = { 0.0 };
+    PositionEstimator m_position_estimator;
+
+    // Guitar Pro stopped while REAPER was about to finish the time selection, REAPER is stopped once it has
+    bool m_play_stop_pending = false;
+
+    // Consecutive samples in which REAPER was out of sync
+    int m_desync_count = 0;
 
     // Keeps track of the last error (prevents spamming the log with errors)
     std::string m_last_error = "";
@@ -301,11 +1069,94 @@ Plugin::Plugin(PluginState& plugin_state)
     : m_impl(std::make_unique<Impl>(plugin_state))
 {}
 
+Plugin::Plugin(PluginState& plugin_state, MemorySourceFactory memory_source_factory)
+    : m_impl(std::make_unique<Impl>(plugin_state, std::move(memory_source_factory)))
+{}
+
+Plugin::Plugin(PluginState& plugin_state, MemorySourceFactory memory_source_factory, std::unique_ptr<ReaperBackend> reaper_backend)
+    : m_impl(std::make_unique<Impl>(plugin_state, std::move(memory_source_factory), std::move(reaper_backend)))
+{}
+
 Plugin::~Plugin() = default;
 
+void Plugin::Start()
+{
+    m_impl->Start();
+}
+
+void Plugin::Stop()
+{
+    m_impl->Stop();
+}
+
+bool Plugin::GetCachedGuitarProState(GuitarProState& state, double& age) const
+{
+    return m_impl->GetCachedGuitarProState(state, age);
+}
+
+bool Plugin::PredictGuitarProPosition(PositionEstimate& estimate) const
+{
+    return m_impl->PredictGuitarProPosition(estimate);
+}
+
+void Plugin::StartLatencyCalibration()
+{
+    m_impl->StartLatencyCalibration();
+}
+
+bool Plugin::LatencyCalibrationLoop()
+{
+    return m_impl->LatencyCalibrationLoop();
+}
+
+bool Plugin::UsesAudioHook() const
+{
+    return m_impl->UsesAudioHook();
+}
+
+void Plugin::OnAudioBuffer(const bool is_post, const int length, const double sample_rate)
+{
+    m_impl->OnAudioBuffer(is_post, length, sample_rate);
+}
+
 void Plugin::MainLoop()
 {
     m_impl->MainLoop();
 }
 
+void Plugin::SetOffsetDatabasePath(const std::filesystem::path& path)
+{
+    m_impl->SetOffsetDatabasePath(path);
+}
+
+void Plugin::ReloadOffsetDatabase()
+{
+    m_impl->ReloadOffsetDatabase();
+}
+
+void Plugin::SetMetricsPath(const std::filesystem::path& path)
+{
+    m_impl->SetMetricsPath(path);
+}
+
+void Plugin::ExportMetrics()
+{
+    m_impl->ExportMetrics();
+}
+
+void Plugin::CaptureMemoryDump(const std::filesystem::path& path)
+{
+    m_impl->CaptureMemoryDump(path);
+}
+
+void Plugin::ImportTempoMap(const std::filesystem::path& path)
+{
+    m_impl->ImportTempoMap(path);
+}
+
+void Plugin::CheckTempoMap(const std::filesystem::path& path)
+{
+    m_impl->CheckTempoMap(path);
+}
+
 }
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "poll_scheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string_view>
+
+namespace tnt {
+
+// Smallest changes that count as user activity
+static constexpr double POSITION_EPSILON = 0.001;  // Seconds
+static constexpr double PLAY_RATE_EPSILON = 0.001;
+
+std::string_view ToString(const PollState state)
+{
+    switch (state)
+    {
+    case PollState::ACTIVE:
+        return "active";
+    case PollState::IDLE:
+        return "idle";
+    case PollState::DISCONNECTED:
+        return "disconnected";
+    default:
+        // This should never happen
+        return "unknown";
+    }
+}
+
+PollScheduler::PollScheduler(const Clock::duration active_interval)
+    : m_active_interval(active_interval)
+    , m_interval(active_interval)
+{}
+
+bool PollScheduler::IsDue(const Clock::time_point now) const
+{
+    return now >= m_next_poll;
+}
+
+PollScheduler::Clock::time_point PollScheduler::GetNextPoll() const
+{
+    return m_next_poll;
+}
+
+PollState PollScheduler::GetState() const
+{
+    return m_state;
+}
+
+PollScheduler::Clock::duration PollScheduler::GetInterval() const
+{
+    return m_interval;
+}
+
+void PollScheduler::OnRead(const Clock::time_point now, const GuitarProState& state)
+{
+    if (state.play_state || this->Changed(state) || m_state == PollState::DISCONNECTED)
+    {
+        m_last_change = now;
+    }
+
+    m_previous_state = state;
+    m_has_previous_state = true;
+
+    if (now - m_last_change < ACTIVE_HOLD)
+    {
+        this->Schedule(now, PollState::ACTIVE, m_active_interval);
+    }
+    else
+    {
+        this->Schedule(now, PollState::IDLE, std::max(IDLE_INTERVAL, m_active_interval));
+    }
+}
+
+void PollScheduler::OnReadFailed(const Clock::time_point now)
+{
+    m_has_previous_state = false;
+
+    // Double the wait after every failed attempt
+    const Clock::duration interval = m_state == PollState::DISCONNECTED
+        ? std::min(m_interval * 2, MAX_BACKOFF_INTERVAL)
+        : MIN_BACKOFF_INTERVAL;
+
+    this->Schedule(now, PollState::DISCONNECTED, interval);
+}
+
+void PollScheduler::Wake(const Clock::time_point now)
+{
+    // Keep backing off, a REAPER transport change won't bring Guitar Pro back
+    if (m_state == PollState::DISCONNECTED)
+    {
+        return;
+    }
+
+    m_last_change = now;
+    this->Schedule(now, PollState::ACTIVE, m_active_interval);
+    m_next_poll = now;
+}
+
+bool PollScheduler::Changed(const GuitarProState& state) const
+{
+    if (!m_has_previous_state)
+    {
+        return true;
+    }
+
+    return state.play_state != m_previous_state.play_state
+        || state.count_in_state != m_previous_state.count_in_state
+        || state.loop_state != m_previous_state.loop_state
+        || std::fabs(state.play_position - m_previous_state.play_position) >= POSITION_EPSILON
+        || std::fabs(state.time_selection_start_position - m_previous_state.time_selection_start_position) >= POSITION_EPSILON
+        || std::fabs(state.time_selection_end_position - m_previous_state.time_selection_end_position) >= POSITION_EPSILON
+        || std::fabs(state.play_rate - m_previous_state.play_rate) >= PLAY_RATE_EPSILON;
+}
+
+void PollScheduler::Schedule(const Clock::time_point now, const PollState state, const Clock::duration interval)
+{
+    m_state = state;
+    m_interval = interval;
+    m_next_poll = now + interval;
+}
+
+}
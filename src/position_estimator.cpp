@@ -0,0 +1,130 @@
+#include "position_estimator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace tnt {
+
+// Samples lose half their weight about every 0.2 seconds
+static constexpr double FORGETTING_TIME_CONSTANT = 0.3; // Seconds
+
+// How strongly the slope is held to the play rate, in the same units as the weighted spread of sample times
+static constexpr double SLOPE_PRIOR_WEIGHT = 0.05;
+
+// Play rate changes larger than this invalidate the fitted slope
+static constexpr double PLAY_RATE_EPSILON = 0.001;
+
+// Samples needed before the estimate is fully trusted
+static constexpr double CONFIDENT_SAMPLE_COUNT = 4.0;
+
+// Prediction error at which confidence drops to 0
+static constexpr double MAX_ERROR = 0.1; // Seconds
+
+void PositionEstimator::Reset()
+{
+    m_sample_count = 0;
+}
+
+bool PositionEstimator::AddSample(const Clock::time_point time, const double position, const double play_rate)
+{
+    if (m_sample_count == 0 || std::fabs(play_rate - m_play_rate) > PLAY_RATE_EPSILON)
+    {
+        this->Restart(time, position, play_rate);
+        return false;
+    }
+
+    const double error = position - this->Predict(time).position;
+    if (std::fabs(error) > JUMP_THRESHOLD)
+    {
+        this->Restart(time, position, play_rate);
+        return true;
+    }
+
+    // Age every sum by the time passed since the previous sample
+    const double decay = std::exp(-std::chrono::duration<double>(time - m_last_time).count() / FORGETTING_TIME_CONSTANT);
+    m_sum_w *= decay;
+    m_sum_wx *= decay;
+    m_sum_wy *= decay;
+    m_sum_wxx *= decay;
+    m_sum_wxy *= decay;
+
+    const double x = this->Seconds(time);
+    m_sum_w += 1.0;
+    m_sum_wx += x;
+    m_sum_wy += position;
+    m_sum_wxx += x * x;
+    m_sum_wxy += x * position;
+
+    m_error_variance = decay * m_error_variance + (1.0 - decay) * error * error;
+    if (m_sample_count == 1)
+    {
+        m_error_variance = error * error;
+    }
+
+    m_last_time = time;
+    m_sample_count++;
+
+    this->Fit();
+    return false;
+}
+
+PositionEstimate PositionEstimator::Predict(const Clock::time_point time) const
+{
+    if (m_sample_count == 0)
+    {
+        return {};
+    }
+
+    PositionEstimate estimate;
+    estimate.position = m_intercept + m_slope * this->Seconds(time);
+
+    const double sample_factor = std::min(1.0, static_cast<double>(m_sample_count) / CONFIDENT_SAMPLE_COUNT);
+    const double error_factor = std::clamp(1.0 - std::sqrt(m_error_variance) / MAX_ERROR, 0.0, 1.0);
+    estimate.confidence = sample_factor * error_factor;
+
+    return estimate;
+}
+
+bool PositionEstimator::HasSamples() const
+{
+    return m_sample_count > 0;
+}
+
+void PositionEstimator::Restart(const Clock::time_point time, const double position, const double play_rate)
+{
+    m_origin = time;
+    m_last_time = time;
+    m_sample_count = 1;
+    m_play_rate = play_rate;
+
+    m_sum_w = 1.0;
+    m_sum_wx = 0.0;
+    m_sum_wy = position;
+    m_sum_wxx = 0.0;
+    m_sum_wxy = 0.0;
+
+    m_error_variance = 0.0;
+
+    m_intercept = position;
+    m_slope = play_rate;
+}
+
+void PositionEstimator::Fit()
+{
+    const double mean_x = m_sum_wx / m_sum_w;
+    const double mean_y = m_sum_wy / m_sum_w;
+    const double spread_xx = m_sum_wxx - m_sum_w * mean_x * mean_x;
+    const double spread_xy = m_sum_wxy - m_sum_w * mean_x * mean_y;
+
+    // Least squares with a penalty on straying from the play rate, falls back to the play rate without spread
+    m_slope = (spread_xy + SLOPE_PRIOR_WEIGHT * m_play_rate) / (spread_xx + SLOPE_PRIOR_WEIGHT);
+    m_intercept = mean_y - m_slope * mean_x;
+}
+
+double PositionEstimator::Seconds(const Clock::time_point time) const
+{
+    return std::chrono::duration<double>(time - m_origin).count();
+}
+
+}
@@ -0,0 +1,341 @@
+#ifdef __linux__
+
+#include "process_memory.h"
+
+#include "wstring_utils.h"
+
+#include <dirent.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace tnt {
+
+// Signature of VS_FIXEDFILEINFO inside a PE version resource
+static constexpr std::uint32_t VS_FIXEDFILEINFO_SIGNATURE = 0xFEEF04BD;
+static constexpr std::uint32_t VS_FIXEDFILEINFO_STRUCTURE_VERSION = 0x00010000;
+
+// Chunk size used when scanning the executable for its version resource
+static constexpr std::size_t VERSION_SCAN_CHUNK_SIZE = 1 << 20;
+
+struct ProcessMemory::Impl final
+{
+    Impl(const std::wstring& process_name, const std::wstring& module_name)
+        : m_process_name(WStringToString(process_name))
+        , m_module_name(WStringToString(module_name))
+    {
+        m_process_id = this->GetProcessID(m_process_name);
+        if (!m_process_id)
+        {
+            throw std::runtime_error(std::format("Failed to get process ID for process '{}'.\n", m_process_name));
+        }
+
+        // Wine maps PE images straight from their files so both the module base and the executable path are in the maps file
+        this->ReadMemoryMaps();
+        if (!m_module_base_address)
+        {
+            throw std::runtime_error(std::format("Failed to get module base address for module '{}'.\n", m_module_name));
+        }
+
+        // The version resource is read from disk so only do it once per attach
+        m_process_version = this->ReadProcessVersion();
+
+        // Enough for every region of a Guitar Pro snapshot
+        m_local_iovecs.reserve(16);
+        m_remote_iovecs.reserve(16);
+    }
+
+    std::string GetName() const
+    {
+        return std::format("process '{}'", m_process_name);
+    }
+
+    const std::wstring& GetProcessVersion() const
+    {
+        return m_process_version;
+    }
+
+    std::uintptr_t GetModuleBaseAddress() const
+    {
+        return m_module_base_address;
+    }
+
+    bool IsProcessRunning() const
+    {
+        // EPERM still means the process exists, we just can't signal it
+        return kill(m_process_id, 0) == 0 || errno == EPERM;
+    }
+
+    bool Read(const std::uintptr_t address, void* buffer, const std::size_t size)
+    {
+        iovec local = { buffer, size };
+        iovec remote = { reinterpret_cast<void*>(address), size };
+
+        const ssize_t bytes_read = process_vm_readv(m_process_id, &local, 1, &remote, 1, 0);
+        if (bytes_read != static_cast<ssize_t>(size))
+        {
+            m_last_error = bytes_read < 0 ? errno : EFAULT;
+            return false;
+        }
+
+        return true;
+    }
+
+    bool ReadRegions(const std::vector<ReadPlan::Region>& regions, std::byte* buffer, std::uintptr_t& failed_address)
+    {
+        // One iovec per region so the whole snapshot costs a single kernel crossing
+        m_local_iovecs.clear();
+        m_remote_iovecs.clear();
+
+        std::size_t total_size = 0;
+        for (const ReadPlan::Region& region : regions)
+        {
+            m_local_iovecs.push_back({ buffer + region.buffer_offset, region.size });
+            m_remote_iovecs.push_back({ reinterpret_cast<void*>(region.address), region.size });
+            total_size += region.size;
+        }
+
+        const ssize_t bytes_read = process_vm_readv(m_process_id, m_local_iovecs.data(), m_local_iovecs.size(), m_remote_iovecs.data(), m_remote_iovecs.size(), 0);
+        if (bytes_read == static_cast<ssize_t>(total_size))
+        {
+            return true;
+        }
+
+        m_last_error = bytes_read < 0 ? errno : EFAULT;
+
+        // process_vm_readv stops at the first region it can't read, find out which one that was
+        std::size_t remaining = bytes_read < 0 ? 0 : static_cast<std::size_t>(bytes_read);
+        for (const ReadPlan::Region& region : regions)
+        {
+            if (remaining < region.size)
+            {
+                failed_address = region.address + remaining;
+                break;
+            }
+
+            remaining -= region.size;
+        }
+
+        return false;
+    }
+
+    std::string GetLastErrorMessage() const
+    {
+        switch (m_last_error)
+        {
+        case EPERM:
+            return "Access denied. Make sure ptrace is allowed (see /proc/sys/kernel/yama/ptrace_scope).";
+        case EFAULT:
+            return "Partial copy, the memory range is inaccessible.";
+        case ESRCH:
+            return "The process no longer exists.";
+        case EINVAL:
+            return "Invalid parameter passed to process_vm_readv.";
+        default:
+            return "Unknown error.";
+        }
+    }
+
+private:
+    static std::string ToLower(std::string value)
+    {
+        std::transform(value.begin(), value.end(), value.begin(), [](const unsigned char c) {
+            return static_cast<char>(std::tolower(c));
+        });
+
+        return value;
+    }
+
+    // Returns the file name of a Windows or Unix style path
+    static std::string GetFileName(const std::string& path)
+    {
+        const std::size_t separator = path.find_last_of("/\\");
+        return separator == std::string::npos ? path : path.substr(separator + 1);
+    }
+
+    pid_t GetProcessID(const std::string& process_name) const
+    {
+        DIR* proc_directory = opendir("/proc");
+        if (!proc_directory)
+        {
+            return 0;
+        }
+
+        const std::string name = ToLower(process_name);
+
+        pid_t process_id = 0;
+        while (const dirent* entry = readdir(proc_directory))
+        {
+            if (!std::isdigit(static_cast<unsigned char>(entry->d_name[0])))
+            {
+                continue;
+            }
+
+            // Wine keeps the Windows path of the executable as the first command line argument
+            std::ifstream cmdline(std::format("/proc/{}/cmdline", entry->d_name), std::ios::binary);
+            std::string argument;
+            if (std::getline(cmdline, argument, '\0') && ToLower(GetFileName(argument)) == name)
+            {
+                process_id = static_cast<pid_t>(std::stol(entry->d_name));
+                break;
+            }
+        }
+
+        closedir(proc_directory);
+
+        return process_id;
+    }
+
+    void ReadMemoryMaps()
+    {
+        std::ifstream maps(std::format("/proc/{}/maps", m_process_id));
+
+        const std::string module_name = ToLower(m_module_name);
+        const std::string process_name = ToLower(m_process_name);
+
+        m_module_base_address = std::numeric_limits<std::uintptr_t>::max();
+
+        // Format: start-end perms offset dev inode path
+        std::string line;
+        while (std::getline(maps, line))
+        {
+            const std::size_t path_start = line.find('/');
+            if (path_start == std::string::npos)
+            {
+                continue;
+            }
+
+            const std::string path = line.substr(path_start);
+            const std::string file_name = ToLower(GetFileName(path));
+
+            if (file_name == module_name)
+            {
+                // The lowest mapping of the image is its base address
+                const std::uintptr_t start = std::stoull(line.substr(0, line.find('-')), nullptr, 16);
+                m_module_base_address = std::min(m_module_base_address, start);
+            }
+            else if (file_name == process_name && m_process_path.empty())
+            {
+                m_process_path = path;
+            }
+        }
+
+        if (m_module_base_address == std::numeric_limits<std::uintptr_t>::max())
+        {
+            m_module_base_address = 0;
+        }
+    }
+
+    // There is no version API under Wine so find the VS_FIXEDFILEINFO structure in the executable directly
+    std::wstring ReadProcessVersion() const
+    {
+        std::ifstream file(m_process_path, std::ios::binary);
+        if (!file)
+        {
+            return L"";
+        }
+
+        // Signature, structure version, then the file version
+        static constexpr std::size_t FIXED_FILE_INFO_SIZE = 16;
+
+        std::vector<char> buffer(VERSION_SCAN_CHUNK_SIZE + FIXED_FILE_INFO_SIZE);
+        std::size_t carried = 0;
+
+        while (file)
+        {
+            file.read(buffer.data() + carried, VERSION_SCAN_CHUNK_SIZE);
+            const std::size_t size = carried + static_cast<std::size_t>(file.gcount());
+
+            // The structure is DWORD aligned inside the resource
+            for (std::size_t i = 0; i + FIXED_FILE_INFO_SIZE <= size; i += 4)
+            {
+                std::array<std::uint32_t, 4> info;
+                std::memcpy(info.data(), buffer.data() + i, sizeof(info));
+
+                if (info[0] == VS_FIXEDFILEINFO_SIGNATURE && info[1] == VS_FIXEDFILEINFO_STRUCTURE_VERSION)
+                {
+                    return std::to_wstring(info[2] >> 16) + L"."
+                        + std::to_wstring(info[2] & 0xFFFF) + L"."
+                        + std::to_wstring(info[3] >> 16) + L"."
+                        + std::to_wstring(info[3] & 0xFFFF);
+                }
+            }
+
+            // Keep the tail so a structure straddling two chunks is still found
+            carried = std::min(size, FIXED_FILE_INFO_SIZE) & ~std::size_t{ 3 };
+            std::memmove(buffer.data(), buffer.data() + size - carried, carried);
+        }
+
+        return L"";
+    }
+
+    std::string m_process_name;
+    std::string m_module_name;
+    std::string m_process_path;
+    std::wstring m_process_version;
+    pid_t m_process_id = 0;
+    std::uintptr_t m_module_base_address = 0;
+    int m_last_error = 0;
+
+    std::vector<iovec> m_local_iovecs;
+    std::vector<iovec> m_remote_iovecs;
+};
+
+ProcessMemory::ProcessMemory(const std::wstring& process_name, const std::wstring& module_name)
+    : m_impl(std::make_unique<Impl>(process_name, module_name))
+{}
+
+ProcessMemory::~ProcessMemory() = default;
+
+std::string ProcessMemory::GetName() const
+{
+    return m_impl->GetName();
+}
+
+const std::wstring& ProcessMemory::GetProcessVersion() const
+{
+    return m_impl->GetProcessVersion();
+}
+
+std::uintptr_t ProcessMemory::GetModuleBaseAddress() const
+{
+    return m_impl->GetModuleBaseAddress();
+}
+
+bool ProcessMemory::IsProcessRunning() const
+{
+    return m_impl->IsProcessRunning();
+}
+
+bool ProcessMemory::Read(const std::uintptr_t address, void* buffer, const std::size_t size)
+{
+    return m_impl->Read(address, buffer, size);
+}
+
+bool ProcessMemory::ReadRegions(const std::vector<ReadPlan::Region>& regions, std::byte* buffer, std::uintptr_t& failed_address)
+{
+    return m_impl->ReadRegions(regions, buffer, failed_address);
+}
+
+std::string ProcessMemory::GetLastErrorMessage() const
+{
+    return m_impl->GetLastErrorMessage();
+}
+
+}
+
+#endif
@@ -0,0 +1,62 @@
+#if !defined(_WIN32) && !defined(__linux__)
+
+#include "process_memory.h"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace tnt {
+
+// Guitar Pro memory can only be read on Windows and on Linux through Wine
+struct ProcessMemory::Impl final
+{
+};
+
+ProcessMemory::ProcessMemory(const std::wstring&, const std::wstring&)
+{
+    throw std::runtime_error("Reading Guitar Pro memory is not supported on this platform.\n");
+}
+
+ProcessMemory::~ProcessMemory() = default;
+
+std::string ProcessMemory::GetName() const
+{
+    return "unsupported process";
+}
+
+const std::wstring& ProcessMemory::GetProcessVersion() const
+{
+    static const std::wstring version;
+    return version;
+}
+
+std::uintptr_t ProcessMemory::GetModuleBaseAddress() const
+{
+    return 0;
+}
+
+bool ProcessMemory::IsProcessRunning() const
+{
+    return false;
+}
+
+bool ProcessMemory::Read(const std::uintptr_t, void*, const std::size_t)
+{
+    return false;
+}
+
+bool ProcessMemory::ReadRegions(const std::vector<ReadPlan::Region>&, std::byte*, std::uintptr_t&)
+{
+    return false;
+}
+
+std::string ProcessMemory::GetLastErrorMessage() const
+{
+    return "Unsupported platform.";
+}
+
+}
+
+#endif
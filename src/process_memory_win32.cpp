@@ -0,0 +1,280 @@
+#ifdef _WIN32
+
+#include "process_memory.h"
+
+#include "wstring_utils.h"
+
+#include <windows.h> // Must be included before tlhelp32.h
+#include <tlhelp32.h>
+#include <winver.h>
+
+#include <format>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#pragma comment(lib, "Version.lib") // Ensure linking to Version.lib
+
+namespace tnt {
+
+struct ProcessMemory::Impl final
+{
+    Impl(const std::wstring& process_name, const std::wstring& module_name)
+        : m_process_name(process_name)
+        , m_module_name(module_name)
+    {
+        m_process_id = this->GetProcessID(m_process_name.c_str());
+        if (!m_process_id)
+        {
+            throw std::runtime_error(std::format("Failed to get process ID for process '{}'.\n", WStringToString(m_process_name)));
+        }
+
+        m_process_path = this->GetProcessPath(m_process_id);
+
+        m_module_base_address = this->GetModuleBaseAddress(m_module_name.c_str());
+        if (!m_module_base_address)
+        {
+            throw std::runtime_error(std::format("Failed to get module base address for module '{}'.\n", WStringToString(m_module_name)));
+        }
+
+        // SYNCHRONIZE allows checking whether the process is still alive without another snapshot
+        m_process_handle = OpenProcess(PROCESS_VM_READ | SYNCHRONIZE, FALSE, m_process_id);
+        if (!m_process_handle) {
+            throw std::runtime_error(std::format("Failed to open process '{}'.\n", WStringToString(m_process_name)));
+        }
+
+        // The version resource is read from disk so only do it once per attach
+        m_process_version = this->ReadProcessVersion();
+    }
+
+    ~Impl()
+    {
+        CloseHandle(m_process_handle);
+    }
+
+    std::string GetName() const
+    {
+        return std::format("process '{}'", WStringToString(m_process_name));
+    }
+
+    const std::wstring& GetProcessVersion() const
+    {
+        return m_process_version;
+    }
+
+    std::uintptr_t GetModuleBaseAddress() const
+    {
+        return m_module_base_address;
+    }
+
+    bool IsProcessRunning() const
+    {
+        return WaitForSingleObject(m_process_handle, 0) == WAIT_TIMEOUT;
+    }
+
+    bool Read(const std::uintptr_t address, void* buffer, const std::size_t size)
+    {
+        if (!ReadProcessMemory(m_process_handle, reinterpret_cast<LPCVOID>(address), buffer, size, nullptr))
+        {
+            m_last_error = GetLastError();
+            return false;
+        }
+
+        return true;
+    }
+
+    bool ReadRegions(const std::vector<ReadPlan::Region>& regions, std::byte* buffer, std::uintptr_t& failed_address)
+    {
+        // Windows has no vectored read so each region costs one call
+        for (const ReadPlan::Region& region : regions)
+        {
+            if (!this->Read(region.address, buffer + region.buffer_offset, region.size))
+            {
+                failed_address = region.address;
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    std::string GetLastErrorMessage() const
+    {
+        switch(m_last_error)
+        {
+        case ERROR_ACCESS_DENIED:
+            return "Access denied. Make sure the process is accessible.";
+        case ERROR_INVALID_PARAMETER:
+            return "Invalid parameter passed to ReadProcessMemory.";
+        case ERROR_PARTIAL_COPY:
+            return "Partial copy, the memory range is inaccessible.";
+        default:
+            return "Unknown error.";
+        }
+    }
+
+private:
+    std::wstring ReadProcessVersion() const
+    {
+        DWORD handle = 0;
+        const DWORD size = GetFileVersionInfoSizeW(m_process_path.c_str(), &handle);
+        if (size == 0)
+        {
+            return L"";
+        }
+
+        std::vector<BYTE> data(size);
+        if (!GetFileVersionInfoW(m_process_path.c_str(), handle, size, data.data()))
+        {
+            return L"";
+        }
+
+        VS_FIXEDFILEINFO* fileInfo = nullptr;
+        UINT len = 0;
+        if (!VerQueryValueW(data.data(), L"\\", reinterpret_cast<LPVOID*>(&fileInfo), &len))
+        {
+            return L"";
+        }
+
+        if (fileInfo)
+        {
+            return std::to_wstring(HIWORD(fileInfo->dwFileVersionMS)) + L"."
+                + std::to_wstring(LOWORD(fileInfo->dwFileVersionMS)) + L"."
+                + std::to_wstring(HIWORD(fileInfo->dwFileVersionLS)) + L"."
+                + std::to_wstring(LOWORD(fileInfo->dwFileVersionLS));
+        }
+
+        return L"";
+    }
+
+    DWORD GetProcessID(const wchar_t* process_name) const
+    {
+        HANDLE snapshot_handle = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+        if (snapshot_handle == INVALID_HANDLE_VALUE)
+        {
+            return 0;
+        }
+
+        PROCESSENTRY32 process_entry;
+        process_entry.dwSize = sizeof(PROCESSENTRY32);
+
+        if (Process32First(snapshot_handle, &process_entry))
+        {
+            do
+            {
+                if (_wcsicmp(process_entry.szExeFile, process_name) == 0)
+                {
+                    CloseHandle(snapshot_handle);
+                    return process_entry.th32ProcessID;
+                }
+            } while (Process32Next(snapshot_handle, &process_entry));
+        }
+
+        CloseHandle(snapshot_handle);
+
+        return 0;
+    }
+
+    std::wstring GetProcessPath(const DWORD pid) const
+    {
+        std::wstring path;
+        const HANDLE process_handle = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+        if (process_handle)
+        {
+            wchar_t buffer[MAX_PATH];
+            DWORD size = MAX_PATH;
+
+            if (QueryFullProcessImageNameW(process_handle, 0, buffer, &size))
+            {
+                path.assign(buffer, size);
+            }
+
+            CloseHandle(process_handle);
+        }
+
+        return path;
+    }
+
+    DWORD_PTR GetModuleBaseAddress(const wchar_t* module_name) const
+    {
+        const HANDLE snapshot_handle = CreateToolhelp32Snapshot(TH32CS_SNAPMODULE | TH32CS_SNAPMODULE32, m_process_id);
+        if (snapshot_handle == INVALID_HANDLE_VALUE)
+        {
+            return 0;
+        }
+
+        MODULEENTRY32W module_entry;
+        module_entry.dwSize = sizeof(module_entry);
+
+        if (Module32FirstW(snapshot_handle, &module_entry))
+        {
+            do
+            {
+                if (_wcsicmp(module_entry.szModule, module_name) == 0)
+                {
+                    CloseHandle(snapshot_handle);
+                    return reinterpret_cast<DWORD_PTR>(module_entry.modBaseAddr);
+                }
+            } while (Module32NextW(snapshot_handle, &module_entry));
+        }
+
+        CloseHandle(snapshot_handle);
+
+        return 0;
+    }
+
+    std::wstring m_process_name;
+    std::wstring m_module_name;
+    std::wstring m_process_path;
+    std::wstring m_process_version;
+    DWORD m_process_id;
+    DWORD_PTR m_module_base_address;
+    HANDLE m_process_handle;
+    DWORD m_last_error = 0;
+};
+
+ProcessMemory::ProcessMemory(const std::wstring& process_name, const std::wstring& module_name)
+    : m_impl(std::make_unique<Impl>(process_name, module_name))
+{}
+
+ProcessMemory::~ProcessMemory() = default;
+
+std::string ProcessMemory::GetName() const
+{
+    return m_impl->GetName();
+}
+
+const std::wstring& ProcessMemory::GetProcessVersion() const
+{
+    return m_impl->GetProcessVersion();
+}
+
+std::uintptr_t ProcessMemory::GetModuleBaseAddress() const
+{
+    return m_impl->GetModuleBaseAddress();
+}
+
+bool ProcessMemory::IsProcessRunning() const
+{
+    return m_impl->IsProcessRunning();
+}
+
+bool ProcessMemory::Read(const std::uintptr_t address, void* buffer, const std::size_t size)
+{
+    return m_impl->Read(address, buffer, size);
+}
+
+bool ProcessMemory::ReadRegions(const std::vector<ReadPlan::Region>& regions, std::byte* buffer, std::uintptr_t& failed_address)
+{
+    return m_impl->ReadRegions(regions, buffer, failed_address);
+}
+
+std::string ProcessMemory::GetLastErrorMessage() const
+{
+    return m_impl->GetLastErrorMessage();
+}
+
+}
+
+#endif
@@ -0,0 +1,198 @@
+#include "profiler.h"
+
+#include "seqlock.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <format>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace tnt {
+
+// One recorded span, index is one based so an empty slot never matches
+struct ProfileEvent final
+{
+    std::uint64_t index = 0;
+    const char* name = nullptr;
+    std::int64_t start = 0;     // Nanoseconds since the clock's epoch
+    std::int64_t duration = 0;  // Nanoseconds
+};
+
+// Written by exactly one thread at a time, read by the export from any thread
+struct ProfileRing final
+{
+    std::array<SeqLock<ProfileEvent>, Profiler::SPANS_PER_THREAD> events;
+    std::atomic<std::uint64_t> head = 0;
+
+    // Spans below this index were cleared
+    std::atomic<std::uint64_t> first = 0;
+
+    // Rings outlive their threads and are handed to the next thread that starts recording
+    std::atomic<bool> in_use = false;
+    std::size_t thread_id = 0;
+};
+
+// Rings are only ever added, so a ring pointer stays valid until the plugin is unloaded
+struct ProfileRegistry final
+{
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ProfileRing>> rings;
+};
+
+static ProfileRegistry& GetRegistry()
+{
+    static ProfileRegistry registry;
+    return registry;
+}
+
+// Holds the calling thread's ring until the thread exits
+class ProfileRingLease final
+{
+public:
+    ~ProfileRingLease()
+    {
+        if (m_ring)
+        {
+            m_ring->in_use.store(false, std::memory_order_release);
+        }
+    }
+
+    ProfileRing& Get()
+    {
+        if (!m_ring)
+        {
+            m_ring = this->Acquire();
+        }
+
+        return *m_ring;
+    }
+
+private:
+    ProfileRing* Acquire() const
+    {
+        ProfileRegistry& registry = GetRegistry();
+        std::lock_guard lock(registry.mutex);
+
+        for (const auto& ring : registry.rings)
+        {
+            bool expected = false;
+            if (ring->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire))
+            {
+                return ring.get();
+            }
+        }
+
+        auto ring = std::make_unique<ProfileRing>();
+        ring->in_use.store(true, std::memory_order_relaxed);
+        ring->thread_id = registry.rings.size() + 1;
+        registry.rings.push_back(std::move(ring));
+        return registry.rings.back().get();
+    }
+
+    ProfileRing* m_ring = nullptr;
+};
+
+static thread_local ProfileRingLease t_ring_lease;
+
+static std::int64_t Nanoseconds(const Profiler::Clock::time_point time)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+bool Profiler::IsCompiledIn()
+{
+#ifdef TNT_PROFILER
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Profiler::SetEnabled(const bool enabled)
+{
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Profiler::Record(const char* name, const Clock::time_point start, const Clock::time_point end)
+{
+    ProfileRing& ring = t_ring_lease.Get();
+
+    const std::uint64_t head = ring.head.load(std::memory_order_relaxed);
+
+    ProfileEvent event;
+    event.index = head + 1;
+    event.name = name;
+    event.start = Nanoseconds(start);
+    event.duration = Nanoseconds(end) - event.start;
+
+    ring.events[head % SPANS_PER_THREAD].Store(event);
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+std::string Profiler::ExportChromeTrace()
+{
+    struct ExportedEvent final
+    {
+        ProfileEvent event;
+        std::size_t thread_id = 0;
+    };
+
+    std::vector<ExportedEvent> exported;
+
+    {
+        ProfileRegistry& registry = GetRegistry();
+        std::lock_guard lock(registry.mutex);
+
+        for (const auto& ring : registry.rings)
+        {
+            const std::uint64_t head = ring->head.load(std::memory_order_acquire);
+            const std::uint64_t first = std::max(ring->first.load(std::memory_order_relaxed), head > SPANS_PER_THREAD ? head - SPANS_PER_THREAD : 0);
+
+            for (std::uint64_t index = first; index < head; index++)
+            {
+                // Slots the thread overwrote meanwhile hold a newer span and are skipped
+                const ProfileEvent event = ring->events[index % SPANS_PER_THREAD].Load();
+                if (event.index == index + 1)
+                {
+                    exported.push_back({ event, ring->thread_id });
+                }
+            }
+        }
+    }
+
+    std::int64_t origin = std::numeric_limits<std::int64_t>::max();
+    for (const ExportedEvent& exported_event : exported)
+    {
+        origin = std::min(origin, exported_event.event.start);
+    }
+
+    std::string text = "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    for (std::size_t i = 0; i < exported.size(); i++)
+    {
+        const ProfileEvent& event = exported[i].event;
+
+        // Chrome expects microseconds
+        text += std::format("{{\"name\": \"{}\", \"ph\": \"X\", \"pid\": 1, \"tid\": {}, \"ts\": {:.3f}, \"dur\": {:.3f}}}{}\n",
+            event.name, exported[i].thread_id, (event.start - origin) / 1000.0, event.duration / 1000.0, i + 1 < exported.size() ? "," : "");
+    }
+
+    text += "]}\n";
+    return text;
+}
+
+void Profiler::Clear()
+{
+    ProfileRegistry& registry = GetRegistry();
+    std::lock_guard lock(registry.mutex);
+
+    for (const auto& ring : registry.rings)
+    {
+        ring->first.store(ring->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+}
+
+}
@@ -1,56 +1,454 @@
 #include "reaper.h"
 
+#include "profiler.h"
+#include "reaper_backend.h"
+
 #include <WDL/wdltypes.h> // Must be included before reaper_plugin_functions
 #include <reaper_plugin_functions.h>
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <stdexcept>
+#include <utility>
+#include <vector>
 
 namespace tnt {
 
 // Constants
 static constexpr int PRESERVE_PITCH_COMMAND = 40671;
 
-struct Reaper::Impl final
+// Undo_EndBlock flag for changes to the whole project
+static constexpr int UNDO_STATE_ALL = -1;
+
+// Values closer than this are the same as far as REAPER's UI is concerned
+static constexpr double COMMAND_EPSILON = 0.000001;
+
+// Decodes the bits returned by GetPlayState, paused takes precedence over playing
+static ReaperPlayState ToReaperPlayState(const int play_state)
 {
-    // double GetPlayPosition()
-    double GetPlayPosition() const
+    if (play_state & 2)
+    {
+        return ReaperPlayState::PAUSED;
+    }
+    else if (play_state & 1)
+    {
+        return ReaperPlayState::PLAYING;
+    }
+
+    return ReaperPlayState::STOPPED;
+}
+
+struct EditCursorCommand final
+{
+    double time = 0.0;
+    bool move_view = false;
+    bool seek_play = false;
+};
+
+// Last write of every kind of command since the previous flush
+struct PendingCommands final
+{
+    std::optional<bool> preserve_pitch;
+    std::optional<bool> repeat;
+    std::optional<std::pair<double, double>> time_selection;
+    std::optional<double> play_rate;
+    std::optional<EditCursorCommand> edit_cursor;
+    std::optional<ReaperPlayState> play_state;
+};
+
+// Forwards straight to the REAPER API
+class ReaperApiBackend final : public ReaperBackend
+{
+public:
+    std::chrono::steady_clock::time_point GetTime() const override
+    {
+        return std::chrono::steady_clock::now();
+    }
+
+    double GetPlayPosition() const override
     {
         return ::GetPlayPosition();
     }
-    
-    // double Master_GetPlayRate(ReaProject* project)
-    double GetPlayRate() const
+
+    double GetPlayPosition2() const override
+    {
+        return ::GetPlayPosition2();
+    }
+
+    double GetOutputLatency() const override
+    {
+        return ::GetOutputLatency();
+    }
+
+    double GetMasterPlayRate() const override
     {
         return ::Master_GetPlayRate(nullptr);
     }
 
-    // int GetPlayState()
-    ReaperPlayState GetPlayState() const
+    int GetPlayState() const override
+    {
+        return ::GetPlayState();
+    }
+
+    int GetSetRepeat(const int value) override
+    {
+        return ::GetSetRepeat(value);
+    }
+
+    void GetSetLoopTimeRange(const bool is_set, double& start_time, double& end_time) override
+    {
+        ::GetSet_LoopTimeRange(is_set, false, &start_time, &end_time, false);
+    }
+
+    int GetToggleCommandState(const int command_id) const override
+    {
+        return ::GetToggleCommandState(command_id);
+    }
+
+    void MainOnCommand(const int command_id, const int flag) override
+    {
+        ::Main_OnCommand(command_id, flag);
+    }
+
+    void SetEditCurPos(const double time, const bool move_view, const bool seek_play) override
+    {
+        ::SetEditCurPos(time, move_view, seek_play);
+    }
+
+    void OnPlayRateChange(const double play_rate) override
+    {
+        ::CSurf_OnPlayRateChange(play_rate);
+    }
+
+    void OnStop() override
+    {
+        ::CSurf_OnStop();
+    }
+
+    void OnPlay() override
+    {
+        ::CSurf_OnPlay();
+    }
+
+    void OnPause() override
+    {
+        ::CSurf_OnPause();
+    }
+
+    int CountTempoTimeSigMarkers() const override
+    {
+        return ::CountTempoTimeSigMarkers(nullptr);
+    }
+
+    bool GetTempoTimeSigMarker(const int index, double& time, int& measure, double& beat, double& bpm, int& numerator, int& denominator, bool& linear) const override
+    {
+        return ::GetTempoTimeSigMarker(nullptr, index, &time, &measure, &beat, &bpm, &numerator, &denominator, &linear);
+    }
+
+    bool SetTempoTimeSigMarker(const int index, const double time, const int measure, const double beat, const double bpm, const int numerator, const int denominator, const bool linear) override
+    {
+        return ::SetTempoTimeSigMarker(nullptr, index, time, measure, beat, bpm, numerator, denominator, linear);
+    }
+
+    bool DeleteTempoTimeSigMarker(const int index) override
+    {
+        return ::DeleteTempoTimeSigMarker(nullptr, index);
+    }
+
+    void UpdateTimeline() override
+    {
+        ::UpdateTimeline();
+    }
+
+    void UndoBeginBlock() override
+    {
+        ::Undo_BeginBlock();
+    }
+
+    void UndoEndBlock(const std::string& description, const int flags) override
+    {
+        ::Undo_EndBlock(description.c_str(), flags);
+    }
+
+    void PreventUIRefresh(const int prevent_count) override
+    {
+        ::PreventUIRefresh(prevent_count);
+    }
+
+    std::string GetExtState(const std::string& section, const std::string& key) const override
+    {
+        const char* value = ::GetExtState(section.c_str(), key.c_str());
+        return value != nullptr ? value : "";
+    }
+
+    void SetExtState(const std::string& section, const std::string& key, const std::string& value, const bool persist) override
+    {
+        ::SetExtState(section.c_str(), key.c_str(), value.c_str(), persist);
+    }
+
+    void ShowConsoleMsg(const std::string& message) override
+    {
+        ::ShowConsoleMsg(message.c_str());
+    }
+};
+
+std::unique_ptr<ReaperBackend> CreateReaperApiBackend()
+{
+    return std::make_unique<ReaperApiBackend>();
+}
+
+std::string ToString(const ReaperCommand& command)
+{
+    static constexpr std::array<const char*, 3> PLAY_STATE_NAMES = { "stopped", "playing", "paused" };
+
+    switch (command.type)
+    {
+    case ReaperCommandType::EDIT_CURSOR_POSITION:
+        return std::format("edit cursor {:.6f}{}", command.value, command.state ? " (seek)" : "");
+    case ReaperCommandType::PLAY_RATE:
+        return std::format("play rate {:.6f}", command.value);
+    case ReaperCommandType::PLAY_STATE:
+        return std::format("play state {}", command.state >= 0 && command.state < 3 ? PLAY_STATE_NAMES[command.state] : "unknown");
+    case ReaperCommandType::REPEAT:
+        return std::format("repeat {}", command.state ? "on" : "off");
+    case ReaperCommandType::TIME_SELECTION:
+        return std::format("time selection {:.6f}-{:.6f}", command.value, command.end_value);
+    case ReaperCommandType::PRESERVE_PITCH:
+        return std::format("preserve pitch {}", command.state ? "on" : "off");
+    default:
+        // This should never happen
+        return "unknown command";
+    }
+}
+
+struct Reaper::Impl final
+{
+    Impl(std::unique_ptr<ReaperBackend> backend)
+        : m_backend(std::move(backend))
+    {}
+
+    std::chrono::steady_clock::time_point GetTime() const
+    {
+        return m_backend->GetTime();
+    }
+
+    ReaperState GetState()
     {
-        const int play_state = ::GetPlayState();
-        if (play_state & 2)
+        const ReaperState state = this->PeekState();
+
+        m_known_state = state;
+        m_known_state_valid = true;
+
+        return state;
+    }
+
+    ReaperState PeekState() const
+    {
+        TNT_PROFILE_SCOPE("Reaper::PeekState");
+
+        ReaperState state;
+        state.play_position = this->GetPlayPosition();
+        state.play_rate = this->GetPlayRate();
+        state.play_state = this->GetPlayState();
+        state.repeat = this->GetRepeat();
+        m_backend->GetSetLoopTimeRange(false, state.time_selection_start_position, state.time_selection_end_position);
+        state.preserve_pitch = this->GetToggleCommandState(ReaperToggleCommand::PRESERVE_PITCH);
+
+        return state;
+    }
+
+    void SetCommandListener(std::function<void(const ReaperCommand&)> listener)
+    {
+        m_command_listener = std::move(listener);
+    }
+
+    void QueuePreservePitch(const bool enabled)
+    {
+        std::lock_guard lock(m_pending_mutex);
+        m_pending.preserve_pitch = enabled;
+    }
+
+    void QueueRepeat(const bool repeat)
+    {
+        std::lock_guard lock(m_pending_mutex);
+        m_pending.repeat = repeat;
+    }
+
+    void QueueTimeSelection(const double start_time, const double end_time)
+    {
+        std::lock_guard lock(m_pending_mutex);
+        m_pending.time_selection = { start_time, end_time };
+    }
+
+    void QueueEditCursorPosition(const double time, const bool move_view, const bool seek_play)
+    {
+        std::lock_guard lock(m_pending_mutex);
+        m_pending.edit_cursor = EditCursorCommand{ time, move_view, seek_play };
+    }
+
+    void QueuePlayRate(const double play_rate)
+    {
+        std::lock_guard lock(m_pending_mutex);
+        m_pending.play_rate = play_rate;
+    }
+
+    void QueuePlayState(const ReaperPlayState& play_state)
+    {
+        std::lock_guard lock(m_pending_mutex);
+        m_pending.play_state = play_state;
+    }
+
+    void FlushCommands()
+    {
+        TNT_PROFILE_SCOPE("Reaper::FlushCommands");
+
+        PendingCommands pending = this->TakePendingCommands();
+
+        // Drop everything that wouldn't change REAPER's state
+        if (m_known_state_valid)
         {
-            return ReaperPlayState::PAUSED;
+            if (pending.preserve_pitch == m_known_state.preserve_pitch)
+            {
+                pending.preserve_pitch.reset();
+            }
+
+            if (pending.repeat == m_known_state.repeat)
+            {
+                pending.repeat.reset();
+            }
+
+            if (pending.time_selection
+             && std::fabs(pending.time_selection->first - m_known_state.time_selection_start_position) < COMMAND_EPSILON
+             && std::fabs(pending.time_selection->second - m_known_state.time_selection_end_position) < COMMAND_EPSILON)
+            {
+                pending.time_selection.reset();
+            }
+
+            if (pending.play_rate && std::fabs(*pending.play_rate - m_known_state.play_rate) < COMMAND_EPSILON)
+            {
+                pending.play_rate.reset();
+            }
         }
-        else if (play_state & 1)
+
+        // The play state is only compared once the play rate had its chance to pause REAPER
+        if (!pending.preserve_pitch && !pending.repeat && !pending.time_selection && !pending.play_rate && !pending.edit_cursor
+         && (!pending.play_state || (m_known_state_valid && pending.play_state == m_known_state.play_state)))
         {
-            return ReaperPlayState::PLAYING;
+            return;
         }
-        else
+
+        m_backend->PreventUIRefresh(1);
+
+        // Only a toggle exists, so it needs the known state to be valid
+        if (pending.preserve_pitch && m_known_state_valid)
         {
-            return ReaperPlayState::STOPPED;
+            this->ToggleCommand(ReaperToggleCommand::PRESERVE_PITCH);
         }
+
+        if (pending.repeat)
+        {
+            this->SetRepeat(*pending.repeat);
+        }
+
+        if (pending.time_selection)
+        {
+            this->SetTimeSelection(pending.time_selection->first, pending.time_selection->second);
+        }
+
+        if (pending.play_rate)
+        {
+            // REAPER handles stretching much more efficiently if the song is paused
+            if (!m_known_state_valid || m_known_state.play_state == ReaperPlayState::PLAYING)
+            {
+                this->SetPlayState(ReaperPlayState::PAUSED);
+            }
+
+            this->SetPlayRate(*pending.play_rate);
+        }
+
+        if (pending.edit_cursor)
+        {
+            this->SetEditCursorPosition(pending.edit_cursor->time, pending.edit_cursor->move_view, pending.edit_cursor->seek_play);
+        }
+
+        // SetPlayState keeps the known state current, so after the pause for a rate change a queued PLAYING resumes in this flush
+        if (pending.play_state && (!m_known_state_valid || pending.play_state != m_known_state.play_state))
+        {
+            this->SetPlayState(*pending.play_state);
+        }
+
+        m_backend->PreventUIRefresh(-1);
+    }
+
+    // double GetPlayPosition()
+    double GetPlayPosition() const
+    {
+        TNT_PROFILE_SCOPE("Reaper::GetPlayPosition");
+
+        return m_backend->GetPlayPosition();
+    }
+    
+    // double GetPlayPosition2() and int GetPlayState()
+    ReaperAudioBlock ReadAudioBlock() const
+    {
+        // No profiling span, the first span on a thread leases a ring under a lock and allocates it
+        ReaperAudioBlock block;
+        block.timestamp = m_backend->GetTime();
+        block.position = m_backend->GetPlayPosition2();
+        block.playing = ToReaperPlayState(m_backend->GetPlayState()) == ReaperPlayState::PLAYING;
+        return block;
+    }
+
+    // double GetOutputLatency()
+    double GetOutputLatency() const
+    {
+        TNT_PROFILE_SCOPE("Reaper::GetOutputLatency");
+
+        return m_backend->GetOutputLatency();
+    }
+
+    // double Master_GetPlayRate(ReaProject* project)
+    double GetPlayRate() const
+    {
+        TNT_PROFILE_SCOPE("Reaper::GetPlayRate");
+
+        return m_backend->GetMasterPlayRate();
+    }
+
+    // int GetPlayState()
+    ReaperPlayState GetPlayState() const
+    {
+        TNT_PROFILE_SCOPE("Reaper::GetPlayState");
+
+        return ToReaperPlayState(m_backend->GetPlayState());
+    }
+
+    // int GetSetRepeat(int val)
+    bool GetRepeat() const
+    {
+        TNT_PROFILE_SCOPE("Reaper::GetRepeat");
+
+        // Negative values only query the state
+        return m_backend->GetSetRepeat(-1) != 0;
     }
 
     // int GetToggleCommandState(int command_id)
     bool GetToggleCommandState(const ReaperToggleCommand& command) const
     {
+        TNT_PROFILE_SCOPE("Reaper::GetToggleCommandState");
+
         switch (command)
         {
         case ReaperToggleCommand::PRESERVE_PITCH:
-            return ::GetToggleCommandState(PRESERVE_PITCH_COMMAND) != 0;
+            return m_backend->GetToggleCommandState(PRESERVE_PITCH_COMMAND) != 0;
         default:
             // This should never happen
             throw std::runtime_error("GetToggleCommandState: Command not found!\n");
@@ -58,86 +456,279 @@ struct Reaper::Impl final
     }
 
     // void SetEditCurPos(double time, bool moveview, bool seekplay)
-    void SetEditCursorPosition(const double time, const bool move_view, const bool seek_play) const
+    void SetEditCursorPosition(const double time, const bool move_view, const bool seek_play)
     {
-        ::SetEditCurPos(time, move_view, seek_play);
+        TNT_PROFILE_SCOPE("Reaper::SetEditCursorPosition");
+
+        m_backend->SetEditCurPos(time, move_view, seek_play);
+        m_known_state.play_position = time;
+        this->NotifyCommand({ ReaperCommandType::EDIT_CURSOR_POSITION, time, 0.0, seek_play ? 1 : 0 });
     }
 
     // void CSurf_OnPlayRateChange(double playrate)
-    void SetPlayRate(const double play_rate) const
+    void SetPlayRate(const double play_rate)
     {
-        ::CSurf_OnPlayRateChange(play_rate);
+        TNT_PROFILE_SCOPE("Reaper::SetPlayRate");
+
+        m_backend->OnPlayRateChange(play_rate);
+        m_known_state.play_rate = play_rate;
+        this->NotifyCommand({ ReaperCommandType::PLAY_RATE, play_rate, 0.0, 0 });
     }
 
     // void CSurf_OnStop()
     // void CSurf_OnPlay()
     // void CSurf_OnPause()
     // void CSurf_OnRecord()
-    void SetPlayState(const ReaperPlayState& play_state) const
+    void SetPlayState(const ReaperPlayState& play_state)
     {
+        TNT_PROFILE_SCOPE("Reaper::SetPlayState");
+
+        m_known_state.play_state = play_state;
+
         switch (play_state)
         {
         case ReaperPlayState::STOPPED:
-            ::CSurf_OnStop();
+            m_backend->OnStop();
             break;
         case ReaperPlayState::PLAYING:
-            ::CSurf_OnPlay();
+            m_backend->OnPlay();
             break;
         case ReaperPlayState::PAUSED:
-            ::CSurf_OnPause();
+            m_backend->OnPause();
             break;
         default:
             // This should never happen
             throw std::runtime_error("SetPlayState: Invalid play state!\n");
         }
+
+        this->NotifyCommand({ ReaperCommandType::PLAY_STATE, 0.0, 0.0, static_cast<int>(play_state) });
     }
 
     // int GetSetRepeat(int val)
-    void SetRepeat(const bool repeat) const
+    void SetRepeat(const bool repeat)
     {
+        TNT_PROFILE_SCOPE("Reaper::SetRepeat");
+
         const int val = repeat ? 1 : 0;
-        ::GetSetRepeat(val);
+        m_backend->GetSetRepeat(val);
+        m_known_state.repeat = repeat;
+        this->NotifyCommand({ ReaperCommandType::REPEAT, 0.0, 0.0, val });
     }
 
     // void GetSet_LoopTimeRange(bool isSet, bool isLoop, double* startOut, double* endOut, bool allowautoseek)
-    void SetTimeSelection(const double start_time, const double end_time) const
+    void SetTimeSelection(const double start_time, const double end_time)
     {
-        // Const cast is used here because we are explicitly setting the value, not getting it.
-        ::GetSet_LoopTimeRange(true, false, const_cast<double*>(&start_time), const_cast<double*>(&end_time), false);
+        TNT_PROFILE_SCOPE("Reaper::SetTimeSelection");
+
+        double start = start_time;
+        double end = end_time;
+        m_backend->GetSetLoopTimeRange(true, start, end);
+        m_known_state.time_selection_start_position = start_time;
+        m_known_state.time_selection_end_position = end_time;
+        this->NotifyCommand({ ReaperCommandType::TIME_SELECTION, start_time, end_time, 0 });
+    }
+
+    // int CountTempoTimeSigMarkers(ReaProject* proj)
+    // bool GetTempoTimeSigMarker(ReaProject* proj, int ptidx, ...)
+    std::vector<TempoMarker> GetTempoMarkers() const
+    {
+        TNT_PROFILE_SCOPE("Reaper::GetTempoMarkers");
+
+        std::vector<TempoMarker> markers;
+
+        const int count = m_backend->CountTempoTimeSigMarkers();
+        markers.reserve(std::max(count, 0));
+
+        for (int i = 0; i < count; i++)
+        {
+            TempoMarker marker;
+            int measure = 0;
+            double beat = 0.0;
+            if (m_backend->GetTempoTimeSigMarker(i, marker.time, measure, beat, marker.bpm, marker.numerator, marker.denominator, marker.linear))
+            {
+                markers.push_back(marker);
+            }
+        }
+
+        return markers;
+    }
+
+    // bool DeleteTempoTimeSigMarker(ReaProject* project, int markerindex)
+    // bool SetTempoTimeSigMarker(ReaProject* proj, int ptidx, double timepos, ...)
+    void ReplaceTempoMarkers(const std::vector<TempoMarker>& markers, const std::string& undo_description) const
+    {
+        TNT_PROFILE_SCOPE("Reaper::ReplaceTempoMarkers");
+
+        m_backend->PreventUIRefresh(1);
+        m_backend->UndoBeginBlock();
+
+        // Deleting from the back keeps the remaining indices valid
+        for (int i = m_backend->CountTempoTimeSigMarkers() - 1; i >= 0; i--)
+        {
+            m_backend->DeleteTempoTimeSigMarker(i);
+        }
+
+        // Inserted in time order every marker lands after the previous ones, so none of them move
+        for (const TempoMarker& marker : markers)
+        {
+            m_backend->SetTempoTimeSigMarker(-1, marker.time, -1, -1.0, marker.bpm, marker.numerator, marker.denominator, marker.linear);
+        }
+
+        m_backend->UndoEndBlock(undo_description, UNDO_STATE_ALL);
+        m_backend->UpdateTimeline();
+        m_backend->PreventUIRefresh(-1);
+    }
+
+    // const char* GetExtState(const char* section, const char* key)
+    std::string GetExtState(const std::string& section, const std::string& key) const
+    {
+        TNT_PROFILE_SCOPE("Reaper::GetExtState");
+
+        return m_backend->GetExtState(section, key);
+    }
+
+    // void SetExtState(const char* section, const char* key, const char* value, bool persist)
+    void SetExtState(const std::string& section, const std::string& key, const std::string& value, const bool persist) const
+    {
+        TNT_PROFILE_SCOPE("Reaper::SetExtState");
+
+        m_backend->SetExtState(section, key, value, persist);
     }
 
     // void ShowConsoleMsg(const char* msg)
     void ShowConsoleMessage(const std::string& message) const
     {
-        ::ShowConsoleMsg(message.c_str());
+        TNT_PROFILE_SCOPE("Reaper::ShowConsoleMessage");
+
+        m_backend->ShowConsoleMsg(message);
     }
 
     // void Main_OnCommand(int command, int flag)
-    void ToggleCommand(const ReaperToggleCommand& command) const
+    void ToggleCommand(const ReaperToggleCommand& command)
     {
+        TNT_PROFILE_SCOPE("Reaper::ToggleCommand");
+
         switch (command)
         {
         case ReaperToggleCommand::PRESERVE_PITCH:
-            ::Main_OnCommand(PRESERVE_PITCH_COMMAND, 0);
+            m_backend->MainOnCommand(PRESERVE_PITCH_COMMAND, 0);
+            m_known_state.preserve_pitch = !m_known_state.preserve_pitch;
+            this->NotifyCommand({ ReaperCommandType::PRESERVE_PITCH, 0.0, 0.0, m_known_state.preserve_pitch ? 1 : 0 });
             break;
         default:
             // This should never happen
             throw std::runtime_error("ToggleCommand: Command not found!\n");
         }
     }
+
+private:
+    void NotifyCommand(const ReaperCommand& command) const
+    {
+        if (m_command_listener)
+        {
+            m_command_listener(command);
+        }
+    }
+
+    PendingCommands TakePendingCommands()
+    {
+        std::lock_guard lock(m_pending_mutex);
+        return std::exchange(m_pending, PendingCommands());
+    }
+
+    std::unique_ptr<ReaperBackend> m_backend;
+    std::function<void(const ReaperCommand&)> m_command_listener;
+
+    // Commands submitted from any thread since the last flush
+    std::mutex m_pending_mutex;
+    PendingCommands m_pending;
+
+    // REAPER's state as of the last GetState, kept up to date by every command applied since
+    // UI thread only
+    ReaperState m_known_state;
+    bool m_known_state_valid = false;
 };
 
 Reaper::Reaper()
-    : m_impl(std::make_unique<Impl>())
+    : m_impl(std::make_unique<Impl>(CreateReaperApiBackend()))
+{}
+
+Reaper::Reaper(std::unique_ptr<ReaperBackend> backend)
+    : m_impl(std::make_unique<Impl>(std::move(backend)))
 {}
 
 Reaper::~Reaper() = default;
 
+std::chrono::steady_clock::time_point Reaper::GetTime() const
+{
+    return m_impl->GetTime();
+}
+
+ReaperState Reaper::GetState() const
+{
+    return m_impl->GetState();
+}
+
+ReaperState Reaper::PeekState() const
+{
+    return m_impl->PeekState();
+}
+
+void Reaper::SetCommandListener(std::function<void(const ReaperCommand&)> listener) const
+{
+    m_impl->SetCommandListener(std::move(listener));
+}
+
+void Reaper::QueuePreservePitch(const bool enabled) const
+{
+    m_impl->QueuePreservePitch(enabled);
+}
+
+void Reaper::QueueRepeat(const bool repeat) const
+{
+    m_impl->QueueRepeat(repeat);
+}
+
+void Reaper::QueueTimeSelection(const double start_time, const double end_time) const
+{
+    m_impl->QueueTimeSelection(start_time, end_time);
+}
+
+void Reaper::QueueEditCursorPosition(const double time, const bool move_view, const bool seek_play) const
+{
+    m_impl->QueueEditCursorPosition(time, move_view, seek_play);
+}
+
+void Reaper::QueuePlayRate(const double play_rate) const
+{
+    m_impl->QueuePlayRate(play_rate);
+}
+
+void Reaper::QueuePlayState(const ReaperPlayState& play_state) const
+{
+    m_impl->QueuePlayState(play_state);
+}
+
+void Reaper::FlushCommands() const
+{
+    m_impl->FlushCommands();
+}
+
 double Reaper::GetPlayPosition() const
 {
     return m_impl->GetPlayPosition();
 }
 
+ReaperAudioBlock Reaper::ReadAudioBlock() const
+{
+    return m_impl->ReadAudioBlock();
+}
+
+double Reaper::GetOutputLatency() const
+{
+    return m_impl->GetOutputLatency();
+}
+
 double Reaper::GetPlayRate() const
 {
     return m_impl->GetPlayRate();
@@ -148,6 +739,11 @@ ReaperPlayState Reaper::GetPlayState() const
     return m_impl->GetPlayState();
 }
 
+bool Reaper::GetRepeat() const
+{
+    return m_impl->GetRepeat();
+}
+
 bool Reaper::GetToggleCommandState(const ReaperToggleCommand& command) const
 {
     return m_impl->GetToggleCommandState(command);
@@ -178,6 +774,26 @@ void Reaper::SetTimeSelection(const double start_time, const double end_time) co
     m_impl->SetTimeSelection(start_time, end_time);
 }
 
+std::vector<TempoMarker> Reaper::GetTempoMarkers() const
+{
+    return m_impl->GetTempoMarkers();
+}
+
+void Reaper::ReplaceTempoMarkers(const std::vector<TempoMarker>& markers, const std::string& undo_description) const
+{
+    m_impl->ReplaceTempoMarkers(markers, undo_description);
+}
+
+std::string Reaper::GetExtState(const std::string& section, const std::string& key) const
+{
+    return m_impl->GetExtState(section, key);
+}
+
+void Reaper::SetExtState(const std::string& section, const std::string& key, const std::string& value, const bool persist) const
+{
+    m_impl->SetExtState(section, key, value, persist);
+}
+
 void Reaper::ShowConsoleMessage(const std::string& message) const
 {
     m_impl->ShowConsoleMessage(message);    
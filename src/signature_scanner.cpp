@@ -0,0 +1,284 @@
+#include "signature_scanner.h"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SIGNATURE_SCANNER_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(SIGNATURE_SCANNER_X86) && !defined(_MSC_VER)
+#define SIGNATURE_SCANNER_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SIGNATURE_SCANNER_TARGET(isa)
+#endif
+
+namespace tnt {
+
+#ifdef SIGNATURE_SCANNER_X86
+static bool IsAvx2Supported()
+{
+#ifdef _MSC_VER
+    // AVX2 needs both CPU support and the OS saving the YMM registers
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+
+    __cpuid(info, 1);
+    const bool os_saves_ymm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 0x6) == 0x6;
+
+    __cpuidex(info, 7, 0);
+    return os_saves_ymm && (info[1] & (1 << 5));
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+// Only queries the CPU once
+static bool HasAvx2()
+{
+#ifdef SIGNATURE_SCANNER_X86
+    static const bool avx2_supported = IsAvx2Supported();
+    return avx2_supported;
+#else
+    return false;
+#endif
+}
+
+BytePattern::BytePattern(const std::string_view pattern)
+{
+    std::size_t i = 0;
+    while (i < pattern.size())
+    {
+        if (std::isspace(static_cast<unsigned char>(pattern[i])))
+        {
+            i++;
+            continue;
+        }
+
+        const std::string_view token = pattern.substr(i, std::min(pattern.find_first_of(" \t", i), pattern.size()) - i);
+        i += token.size();
+
+        if (token == "?" || token == "??")
+        {
+            m_bytes.push_back(0);
+            m_mask.push_back(0);
+            continue;
+        }
+
+        if (token.size() != 2 || !std::isxdigit(static_cast<unsigned char>(token[0])) || !std::isxdigit(static_cast<unsigned char>(token[1])))
+        {
+            throw std::runtime_error(std::format("Invalid byte '{}' in signature '{}'.\n", token, pattern));
+        }
+
+        m_bytes.push_back(static_cast<std::uint8_t>(std::stoul(std::string(token), nullptr, 16)));
+        m_mask.push_back(0xFF);
+    }
+
+    const auto first = std::find(m_mask.begin(), m_mask.end(), 0xFF);
+    if (first == m_mask.end())
+    {
+        throw std::runtime_error(std::format("Signature '{}' has no fixed bytes.\n", pattern));
+    }
+
+    m_first_anchor = static_cast<std::size_t>(first - m_mask.begin());
+    m_last_anchor = m_mask.size() - 1 - static_cast<std::size_t>(std::find(m_mask.rbegin(), m_mask.rend(), 0xFF) - m_mask.rbegin());
+}
+
+std::size_t BytePattern::Find(const std::byte* data, const std::size_t size) const
+{
+    // SSE2 is part of every x86-64 CPU, elsewhere it falls back to the scalar search
+    return this->Find(data, size, HasAvx2() ? SearchPath::AVX2 : SearchPath::SSE2);
+}
+
+std::size_t BytePattern::Find(const std::byte* data, const std::size_t size, const SearchPath path) const
+{
+    if (size < m_bytes.size())
+    {
+        return NOT_FOUND;
+    }
+
+    // Last offset a match can start at
+    const std::size_t last = size - m_bytes.size();
+
+    switch (path)
+    {
+    case SearchPath::SCALAR:
+        return this->FindScalar(data, 0, last);
+    case SearchPath::SSE2:
+        return this->FindSse2(data, last);
+    case SearchPath::AVX2:
+        return HasAvx2() ? this->FindAvx2(data, last) : this->FindScalar(data, 0, last);
+    default: // This should never happen
+        return this->FindScalar(data, 0, last);
+    }
+}
+
+bool BytePattern::Matches(const std::byte* data) const
+{
+    for (std::size_t i = 0; i < m_bytes.size(); i++)
+    {
+        if ((static_cast<std::uint8_t>(data[i]) & m_mask[i]) != m_bytes[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::size_t BytePattern::FindScalar(const std::byte* data, const std::size_t start, const std::size_t last) const
+{
+    const std::uint8_t first_byte = m_bytes[m_first_anchor];
+
+    for (std::size_t i = start; i <= last; i++)
+    {
+        if (static_cast<std::uint8_t>(data[i + m_first_anchor]) == first_byte && this->Matches(data + i))
+        {
+            return i;
+        }
+    }
+
+    return NOT_FOUND;
+}
+
+#ifdef SIGNATURE_SCANNER_X86
+
+// Compares 16 candidate offsets at a time against both anchors and only verifies the survivors
+SIGNATURE_SCANNER_TARGET("sse2")
+std::size_t BytePattern::FindSse2(const std::byte* data, const std::size_t last) const
+{
+    constexpr std::size_t WIDTH = sizeof(__m128i);
+
+    const __m128i first_byte = _mm_set1_epi8(static_cast<char>(m_bytes[m_first_anchor]));
+    const __m128i last_byte = _mm_set1_epi8(static_cast<char>(m_bytes[m_last_anchor]));
+
+    std::size_t i = 0;
+    for (; i + WIDTH - 1 <= last; i += WIDTH)
+    {
+        const __m128i first_block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + m_first_anchor));
+        const __m128i last_block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + m_last_anchor));
+
+        auto candidates = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first_block, first_byte), _mm_cmpeq_epi8(last_block, last_byte))));
+        while (candidates)
+        {
+            const std::size_t offset = i + static_cast<std::size_t>(std::countr_zero(candidates));
+            if (this->Matches(data + offset))
+            {
+                return offset;
+            }
+
+            candidates &= candidates - 1;
+        }
+    }
+
+    return this->FindScalar(data, i, last);
+}
+
+// Same as FindSse2 with 32 candidate offsets at a time
+SIGNATURE_SCANNER_TARGET("avx2")
+std::size_t BytePattern::FindAvx2(const std::byte* data, const std::size_t last) const
+{
+    constexpr std::size_t WIDTH = sizeof(__m256i);
+
+    const __m256i first_byte = _mm256_set1_epi8(static_cast<char>(m_bytes[m_first_anchor]));
+    const __m256i last_byte = _mm256_set1_epi8(static_cast<char>(m_bytes[m_last_anchor]));
+
+    std::size_t i = 0;
+    for (; i + WIDTH - 1 <= last; i += WIDTH)
+    {
+        const __m256i first_block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + m_first_anchor));
+        const __m256i last_block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + m_last_anchor));
+
+        auto candidates = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first_block, first_byte), _mm256_cmpeq_epi8(last_block, last_byte))));
+        while (candidates)
+        {
+            const std::size_t offset = i + static_cast<std::size_t>(std::countr_zero(candidates));
+            if (this->Matches(data + offset))
+            {
+                return offset;
+            }
+
+            candidates &= candidates - 1;
+        }
+    }
+
+    return this->FindScalar(data, i, last);
+}
+
+#else
+
+std::size_t BytePattern::FindSse2(const std::byte* data, const std::size_t last) const
+{
+    return this->FindScalar(data, 0, last);
+}
+
+std::size_t BytePattern::FindAvx2(const std::byte* data, const std::size_t last) const
+{
+    return this->FindScalar(data, 0, last);
+}
+
+#endif
+
+std::uintptr_t ScanModule(MemorySource& memory_source, const std::uintptr_t base_address, const PeImage& image, const BytePattern& pattern)
+{
+    // Each chunk is preceded by the tail of the previous one so matches across chunk boundaries are found
+    const std::size_t overlap = pattern.size() - 1;
+    std::vector<std::byte> buffer(SIGNATURE_SCAN_CHUNK_SIZE + overlap);
+
+    for (const PeSection& section : image.sections)
+    {
+        if (!section.executable)
+        {
+            continue;
+        }
+
+        const std::uintptr_t section_end = base_address + section.virtual_address + section.virtual_size;
+        std::uintptr_t address = base_address + section.virtual_address;
+        std::size_t carried = 0;
+
+        while (address < section_end)
+        {
+            const std::size_t read_size = static_cast<std::size_t>(std::min<std::uintptr_t>(SIGNATURE_SCAN_CHUNK_SIZE, section_end - address));
+            if (!memory_source.Read(address, buffer.data() + carried, read_size))
+            {
+                // Skip pages that can't be read
+                carried = 0;
+                address += read_size;
+                continue;
+            }
+
+            const std::size_t size = carried + read_size;
+            const std::size_t offset = pattern.Find(buffer.data(), size);
+            if (offset != BytePattern::NOT_FOUND)
+            {
+                return address - carried + offset;
+            }
+
+            carried = std::min(size, overlap);
+            std::memmove(buffer.data(), buffer.data() + size - carried, carried);
+            address += read_size;
+        }
+    }
+
+    return 0;
+}
+
+}
@@ -0,0 +1,531 @@
+#include "simulated_reaper.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tnt {
+
+// Same command id REAPER uses, every other command is ignored
+static constexpr int SIMULATED_PRESERVE_PITCH_COMMAND = 40671;
+
+// Bits of GetPlayState
+static constexpr int SIMULATED_PLAYING = 1;
+static constexpr int SIMULATED_PAUSED = 2;
+
+// Starts well past the epoch so default constructed time points are in the past
+static constexpr auto SIMULATED_START_TIME = std::chrono::hours(1);
+
+struct SimulatedReaper::Impl final
+{
+    Clock::time_point GetTime() const
+    {
+        return m_time;
+    }
+
+    void Advance(const Clock::duration duration)
+    {
+        m_time += duration;
+
+        if (m_state.play_state != ReaperPlayState::PLAYING)
+        {
+            return;
+        }
+
+        const double seconds = std::chrono::duration<double>(duration).count();
+        this->AdvancePosition(m_state.play_position, m_play_hold, seconds);
+        this->AdvancePosition(m_buffer_position, m_buffer_hold, seconds);
+    }
+
+    void Seek(const double time)
+    {
+        m_state.play_position = time;
+        m_buffer_position = time;
+
+        if (m_state.play_state != ReaperPlayState::PLAYING)
+        {
+            m_play_hold = 0.0;
+            m_buffer_hold = 0.0;
+            return;
+        }
+
+        // The buffer position is the heard position one output latency later
+        m_play_hold = m_seek_latency;
+        m_buffer_hold = std::max(0.0, m_seek_latency - m_output_latency);
+    }
+
+    void SetEditCursorPosition(const double time, const bool seek_play)
+    {
+        m_edit_cursor_position = time;
+
+        // REAPER only moves the play position along while playing or paused
+        if (seek_play || m_state.play_state == ReaperPlayState::STOPPED)
+        {
+            this->Seek(time);
+        }
+    }
+
+    void SetPlayState(const ReaperPlayState play_state)
+    {
+        const ReaperPlayState previous_play_state = m_state.play_state;
+        m_state.play_state = play_state;
+
+        switch (play_state)
+        {
+        case ReaperPlayState::STOPPED:
+            // Stopping returns to the edit cursor
+            this->Seek(m_edit_cursor_position);
+            break;
+        case ReaperPlayState::PLAYING:
+            if (previous_play_state == ReaperPlayState::STOPPED)
+            {
+                this->Seek(m_edit_cursor_position);
+            }
+            else if (previous_play_state == ReaperPlayState::PAUSED)
+            {
+                this->Seek(m_state.play_position);
+            }
+            break;
+        case ReaperPlayState::PAUSED:
+            if (previous_play_state == ReaperPlayState::STOPPED)
+            {
+                this->Seek(m_edit_cursor_position);
+            }
+            m_buffer_position = m_state.play_position;
+            break;
+        default:
+            break;
+        }
+    }
+
+    void SetState(const ReaperState& state)
+    {
+        m_state = state;
+        m_buffer_position = state.play_position;
+        m_play_hold = 0.0;
+        m_buffer_hold = 0.0;
+
+        if (state.play_state != ReaperPlayState::PLAYING)
+        {
+            m_edit_cursor_position = state.play_position;
+        }
+    }
+
+    // CSurf_OnPause toggles between playing and paused
+    void TogglePause()
+    {
+        this->SetPlayState(m_state.play_state == ReaperPlayState::PAUSED ? ReaperPlayState::PLAYING : ReaperPlayState::PAUSED);
+    }
+
+    int GetPlayStateBits() const
+    {
+        switch (m_state.play_state)
+        {
+        case ReaperPlayState::PLAYING:
+            return SIMULATED_PLAYING;
+        case ReaperPlayState::PAUSED:
+            return SIMULATED_PAUSED;
+        default:
+            return 0;
+        }
+    }
+
+    std::string GetExtState(const std::string& section, const std::string& key) const
+    {
+        const auto it = m_ext_state.find({ section, key });
+        return it != m_ext_state.end() ? it->second : std::string();
+    }
+
+    ReaperState m_state;
+    Clock::time_point m_time = Clock::time_point(SIMULATED_START_TIME);
+    double m_edit_cursor_position = 0.0;
+    double m_buffer_position = 0.0;
+
+    // Seconds the heard and buffer positions still hold still after the last seek
+    double m_play_hold = 0.0;
+    double m_buffer_hold = 0.0;
+
+    double m_seek_latency = 0.0;
+    double m_output_latency = 0.0;
+
+    int m_ui_refresh_prevent_count = 0;
+
+    std::map<std::pair<std::string, std::string>, std::string> m_ext_state;
+    std::vector<TempoMarker> m_tempo_markers;
+    std::vector<std::string> m_console_messages;
+    SimulatedReaperCounters m_counters;
+    std::vector<ReaperCommand> m_commands;
+
+private:
+    void AdvancePosition(double& position, double& hold, const double seconds) const
+    {
+        const double held = std::min(hold, seconds);
+        hold -= held;
+        position += (seconds - held) * m_state.play_rate;
+
+        const double loop_length = m_state.time_selection_end_position - m_state.time_selection_start_position;
+        if (m_state.repeat && loop_length > 0.0 && position >= m_state.time_selection_end_position)
+        {
+            position = m_state.time_selection_start_position + std::fmod(position - m_state.time_selection_end_position, loop_length);
+        }
+    }
+};
+
+// Counts every change the plugin makes on top of forwarding it to the transport
+class SimulatedReaperBackend final : public ReaperBackend
+{
+public:
+    SimulatedReaperBackend(SimulatedReaper::Impl& reaper)
+        : m_reaper(reaper)
+    {}
+
+    std::chrono::steady_clock::time_point GetTime() const override
+    {
+        return m_reaper.GetTime();
+    }
+
+    double GetPlayPosition() const override
+    {
+        return m_reaper.m_state.play_position;
+    }
+
+    double GetPlayPosition2() const override
+    {
+        return m_reaper.m_buffer_position;
+    }
+
+    double GetOutputLatency() const override
+    {
+        return m_reaper.m_output_latency;
+    }
+
+    double GetMasterPlayRate() const override
+    {
+        return m_reaper.m_state.play_rate;
+    }
+
+    int GetPlayState() const override
+    {
+        return m_reaper.GetPlayStateBits();
+    }
+
+    int GetSetRepeat(const int value) override
+    {
+        // Negative values only query, 2 toggles
+        if (value >= 0)
+        {
+            m_reaper.m_state.repeat = value == 2 ? !m_reaper.m_state.repeat : value != 0;
+            m_reaper.m_counters.repeat_changes++;
+            m_reaper.m_commands.push_back({ ReaperCommandType::REPEAT, 0.0, 0.0, m_reaper.m_state.repeat ? 1 : 0 });
+        }
+
+        return m_reaper.m_state.repeat ? 1 : 0;
+    }
+
+    void GetSetLoopTimeRange(const bool is_set, double& start_time, double& end_time) override
+    {
+        if (!is_set)
+        {
+            start_time = m_reaper.m_state.time_selection_start_position;
+            end_time = m_reaper.m_state.time_selection_end_position;
+            return;
+        }
+
+        m_reaper.m_state.time_selection_start_position = start_time;
+        m_reaper.m_state.time_selection_end_position = end_time;
+        m_reaper.m_counters.time_selection_changes++;
+        m_reaper.m_commands.push_back({ ReaperCommandType::TIME_SELECTION, start_time, end_time, 0 });
+    }
+
+    int GetToggleCommandState(const int command_id) const override
+    {
+        if (command_id != SIMULATED_PRESERVE_PITCH_COMMAND)
+        {
+            return -1;
+        }
+
+        return m_reaper.m_state.preserve_pitch ? 1 : 0;
+    }
+
+    void MainOnCommand(const int command_id, const int) override
+    {
+        if (command_id == SIMULATED_PRESERVE_PITCH_COMMAND)
+        {
+            m_reaper.m_state.preserve_pitch = !m_reaper.m_state.preserve_pitch;
+            m_reaper.m_counters.preserve_pitch_changes++;
+            m_reaper.m_commands.push_back({ ReaperCommandType::PRESERVE_PITCH, 0.0, 0.0, m_reaper.m_state.preserve_pitch ? 1 : 0 });
+        }
+    }
+
+    void SetEditCurPos(const double time, const bool, const bool seek_play) override
+    {
+        m_reaper.SetEditCursorPosition(time, seek_play);
+        m_reaper.m_counters.seeks++;
+        m_reaper.m_commands.push_back({ ReaperCommandType::EDIT_CURSOR_POSITION, time, 0.0, seek_play ? 1 : 0 });
+    }
+
+    void OnPlayRateChange(const double play_rate) override
+    {
+        m_reaper.m_state.play_rate = play_rate;
+        m_reaper.m_counters.play_rate_changes++;
+        m_reaper.m_commands.push_back({ ReaperCommandType::PLAY_RATE, play_rate, 0.0, 0 });
+    }
+
+    void OnStop() override
+    {
+        m_reaper.SetPlayState(ReaperPlayState::STOPPED);
+        m_reaper.m_counters.play_state_changes++;
+        m_reaper.m_commands.push_back({ ReaperCommandType::PLAY_STATE, 0.0, 0.0, static_cast<int>(ReaperPlayState::STOPPED) });
+    }
+
+    void OnPlay() override
+    {
+        m_reaper.SetPlayState(ReaperPlayState::PLAYING);
+        m_reaper.m_counters.play_state_changes++;
+        m_reaper.m_commands.push_back({ ReaperCommandType::PLAY_STATE, 0.0, 0.0, static_cast<int>(ReaperPlayState::PLAYING) });
+    }
+
+    void OnPause() override
+    {
+        m_reaper.TogglePause();
+        m_reaper.m_counters.play_state_changes++;
+
+        // Reaper only pauses through the toggle
+        m_reaper.m_commands.push_back({ ReaperCommandType::PLAY_STATE, 0.0, 0.0, static_cast<int>(ReaperPlayState::PAUSED) });
+    }
+
+    int CountTempoTimeSigMarkers() const override
+    {
+        return static_cast<int>(m_reaper.m_tempo_markers.size());
+    }
+
+    // The measure and beat outputs aren't simulated
+    bool GetTempoTimeSigMarker(const int index, double& time, int& measure, double& beat, double& bpm, int& numerator, int& denominator, bool& linear) const override
+    {
+        if (index < 0 || index >= static_cast<int>(m_reaper.m_tempo_markers.size()))
+        {
+            return false;
+        }
+
+        const TempoMarker& marker = m_reaper.m_tempo_markers[index];
+        time = marker.time;
+        measure = 0;
+        beat = 0.0;
+        bpm = marker.bpm;
+        numerator = marker.numerator;
+        denominator = marker.denominator;
+        linear = marker.linear;
+        return true;
+    }
+
+    // Markers are kept sorted by time like REAPER does, the measure and beat position aren't simulated
+    bool SetTempoTimeSigMarker(const int index, const double time, const int, const double, const double bpm, const int numerator, const int denominator, const bool linear) override
+    {
+        std::vector<TempoMarker>& markers = m_reaper.m_tempo_markers;
+        if (index >= static_cast<int>(markers.size()))
+        {
+            return false;
+        }
+
+        if (index >= 0)
+        {
+            markers.erase(markers.begin() + index);
+        }
+
+        const TempoMarker marker = { time, bpm, numerator, denominator, linear };
+        const auto it = std::upper_bound(markers.begin(), markers.end(), time, [](const double value, const TempoMarker& other) {
+            return value < other.time;
+        });
+
+        markers.insert(it, marker);
+        m_reaper.m_counters.tempo_marker_changes++;
+        return true;
+    }
+
+    bool DeleteTempoTimeSigMarker(const int index) override
+    {
+        std::vector<TempoMarker>& markers = m_reaper.m_tempo_markers;
+        if (index < 0 || index >= static_cast<int>(markers.size()))
+        {
+            return false;
+        }
+
+        markers.erase(markers.begin() + index);
+        m_reaper.m_counters.tempo_marker_changes++;
+        return true;
+    }
+
+    void UpdateTimeline() override
+    {}
+
+    void UndoBeginBlock() override
+    {
+        m_reaper.m_counters.undo_blocks++;
+    }
+
+    void UndoEndBlock(const std::string&, const int) override
+    {}
+
+    void PreventUIRefresh(const int prevent_count) override
+    {
+        if (m_reaper.m_ui_refresh_prevent_count == 0 && prevent_count > 0)
+        {
+            m_reaper.m_counters.ui_refresh_blocks++;
+        }
+
+        m_reaper.m_ui_refresh_prevent_count += prevent_count;
+    }
+
+    std::string GetExtState(const std::string& section, const std::string& key) const override
+    {
+        return m_reaper.GetExtState(section, key);
+    }
+
+    void SetExtState(const std::string& section, const std::string& key, const std::string& value, const bool) override
+    {
+        m_reaper.m_ext_state[{ section, key }] = value;
+    }
+
+    void ShowConsoleMsg(const std::string& message) override
+    {
+        m_reaper.m_console_messages.push_back(message);
+    }
+
+private:
+    SimulatedReaper::Impl& m_reaper;
+};
+
+SimulatedReaper::SimulatedReaper()
+    : m_impl(std::make_unique<Impl>())
+{}
+
+SimulatedReaper::~SimulatedReaper() = default;
+
+std::unique_ptr<ReaperBackend> SimulatedReaper::CreateBackend()
+{
+    return std::make_unique<SimulatedReaperBackend>(*m_impl);
+}
+
+SimulatedReaper::Clock::time_point SimulatedReaper::GetTime() const
+{
+    return m_impl->GetTime();
+}
+
+void SimulatedReaper::Advance(const Clock::duration duration)
+{
+    m_impl->Advance(duration);
+}
+
+void SimulatedReaper::SetSeekLatency(const double seek_latency)
+{
+    m_impl->m_seek_latency = seek_latency;
+}
+
+void SimulatedReaper::SetOutputLatency(const double output_latency)
+{
+    m_impl->m_output_latency = output_latency;
+}
+
+void SimulatedReaper::SetEditCursorPosition(const double time, const bool seek_play)
+{
+    m_impl->SetEditCursorPosition(time, seek_play);
+}
+
+void SimulatedReaper::SetPlayRate(const double play_rate)
+{
+    m_impl->m_state.play_rate = play_rate;
+}
+
+void SimulatedReaper::SetPlayState(const ReaperPlayState play_state)
+{
+    m_impl->SetPlayState(play_state);
+}
+
+void SimulatedReaper::SetRepeat(const bool repeat)
+{
+    m_impl->m_state.repeat = repeat;
+}
+
+void SimulatedReaper::SetTimeSelection(const double start_time, const double end_time)
+{
+    m_impl->m_state.time_selection_start_position = start_time;
+    m_impl->m_state.time_selection_end_position = end_time;
+}
+
+void SimulatedReaper::SetPreservePitch(const bool preserve_pitch)
+{
+    m_impl->m_state.preserve_pitch = preserve_pitch;
+}
+
+void SimulatedReaper::SetExtState(const std::string& section, const std::string& key, const std::string& value)
+{
+    m_impl->m_ext_state[{ section, key }] = value;
+}
+
+void SimulatedReaper::SetTempoMarkers(const std::vector<TempoMarker>& markers)
+{
+    m_impl->m_tempo_markers = markers;
+}
+
+void SimulatedReaper::SetState(const ReaperState& state)
+{
+    m_impl->SetState(state);
+}
+
+double SimulatedReaper::GetPlayPosition() const
+{
+    return m_impl->m_state.play_position;
+}
+
+double SimulatedReaper::GetBufferPlayPosition() const
+{
+    return m_impl->m_buffer_position;
+}
+
+double SimulatedReaper::GetEditCursorPosition() const
+{
+    return m_impl->m_edit_cursor_position;
+}
+
+ReaperState SimulatedReaper::GetState() const
+{
+    return m_impl->m_state;
+}
+
+std::string SimulatedReaper::GetExtState(const std::string& section, const std::string& key) const
+{
+    return m_impl->GetExtState(section, key);
+}
+
+const std::vector<TempoMarker>& SimulatedReaper::GetTempoMarkers() const
+{
+    return m_impl->m_tempo_markers;
+}
+
+const std::vector<std::string>& SimulatedReaper::GetConsoleMessages() const
+{
+    return m_impl->m_console_messages;
+}
+
+const SimulatedReaperCounters& SimulatedReaper::GetCounters() const
+{
+    return m_impl->m_counters;
+}
+
+const std::vector<ReaperCommand>& SimulatedReaper::GetCommands() const
+{
+    return m_impl->m_commands;
+}
+
+void SimulatedReaper::ResetCounters()
+{
+    m_impl->m_counters = SimulatedReaperCounters{};
+    m_impl->m_commands.clear();
+}
+
+}
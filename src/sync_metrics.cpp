@@ -0,0 +1,278 @@
+#include "sync_metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <string>
+
+namespace tnt {
+
+// Bucket upper bounds in milliseconds
+static constexpr double TICK_DURATION_BUCKETS[] = { 0.001, 0.002, 0.005, 0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1.0, 2.0, 5.0, 10.0, 20.0, 33.0, 50.0, 100.0 };
+static constexpr double DRIFT_BUCKETS[] = { 1.0, 2.0, 5.0, 10.0, 20.0, 50.0, 100.0, 200.0, 300.0, 500.0, 1000.0 };
+static constexpr double TIME_TO_PLAY_BUCKETS[] = { 10.0, 20.0, 50.0, 100.0, 200.0, 500.0, 1000.0, 2000.0, 5000.0 };
+
+static constexpr int PERCENTILES[] = { 50, 90, 99 };
+
+static double Milliseconds(const SyncMetrics::Clock::duration duration)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+std::string_view ToString(const SeekReason reason)
+{
+    switch (reason)
+    {
+    case SeekReason::JUMP:
+        return "jump";
+    case SeekReason::DESYNC:
+        return "desync";
+    case SeekReason::PLAY_START:
+        return "play_start";
+    case SeekReason::CURSOR_MOVED:
+        return "cursor_moved";
+    default:
+        // This should never happen
+        return "unknown";
+    }
+}
+
+Histogram::Histogram(const std::span<const double> upper_bounds)
+    : m_upper_bounds(upper_bounds.begin(), upper_bounds.end())
+    , m_counts(upper_bounds.size() + 1, 0)
+{}
+
+void Histogram::Reset()
+{
+    std::fill(m_counts.begin(), m_counts.end(), 0);
+    m_count = 0;
+    m_sum = 0.0;
+    m_max = 0.0;
+}
+
+void Histogram::Add(const double value)
+{
+    const auto bucket = std::lower_bound(m_upper_bounds.begin(), m_upper_bounds.end(), value) - m_upper_bounds.begin();
+    m_counts[bucket]++;
+    m_count++;
+    m_sum += value;
+    m_max = m_count == 1 ? value : std::max(m_max, value);
+}
+
+std::uint64_t Histogram::GetCount() const
+{
+    return m_count;
+}
+
+double Histogram::GetMean() const
+{
+    return m_count > 0 ? m_sum / static_cast<double>(m_count) : 0.0;
+}
+
+double Histogram::GetMax() const
+{
+    return m_max;
+}
+
+double Histogram::GetPercentile(const double p) const
+{
+    if (m_count == 0)
+    {
+        return 0.0;
+    }
+
+    const double rank = p * static_cast<double>(m_count);
+    double below = 0.0;
+
+    for (std::size_t i = 0; i < m_counts.size(); i++)
+    {
+        const double count = static_cast<double>(m_counts[i]);
+        if (count > 0.0 && below + count >= rank)
+        {
+            // The overflow bucket ends at the largest value seen
+            const double lower = i > 0 ? m_upper_bounds[i - 1] : 0.0;
+            const double upper = i < m_upper_bounds.size() ? m_upper_bounds[i] : m_max;
+            return std::min(lower + (upper - lower) * (rank - below) / count, m_max);
+        }
+
+        below += count;
+    }
+
+    return m_max;
+}
+
+std::span<const double> Histogram::GetUpperBounds() const
+{
+    return m_upper_bounds;
+}
+
+std::span<const std::uint64_t> Histogram::GetBucketCounts() const
+{
+    return m_counts;
+}
+
+SyncMetrics::SyncMetrics()
+    : m_tick_durations(TICK_DURATION_BUCKETS)
+    , m_drifts(DRIFT_BUCKETS)
+    , m_times_to_play(TIME_TO_PLAY_BUCKETS)
+{}
+
+void SyncMetrics::Reset(const Clock::time_point start)
+{
+    m_start = start;
+    m_last_tick = start;
+
+    m_tick_durations.Reset();
+    m_drifts.Reset();
+    m_times_to_play.Reset();
+
+    m_seeks.fill(0);
+    m_play_rate_changes = 0;
+    m_count_in_stops = 0;
+    m_read_failures = 0;
+}
+
+void SyncMetrics::RecordTick(const Clock::time_point now, const Clock::duration duration)
+{
+    m_last_tick = now;
+    m_tick_durations.Add(Milliseconds(duration));
+}
+
+void SyncMetrics::RecordDrift(const double drift)
+{
+    m_drifts.Add(std::fabs(drift) * 1000.0);
+}
+
+void SyncMetrics::RecordSeek(const SeekReason reason)
+{
+    m_seeks[static_cast<std::size_t>(reason)]++;
+}
+
+void SyncMetrics::RecordPlayRateChange()
+{
+    m_play_rate_changes++;
+}
+
+void SyncMetrics::RecordCountInStop()
+{
+    m_count_in_stops++;
+}
+
+void SyncMetrics::RecordReadFailure()
+{
+    m_read_failures++;
+}
+
+void SyncMetrics::RecordTimeToPlay(const Clock::duration duration)
+{
+    m_times_to_play.Add(Milliseconds(duration));
+}
+
+std::vector<std::pair<std::string, double>> SyncMetrics::GetValues() const
+{
+    std::vector<std::pair<std::string, double>> values;
+
+    values.emplace_back("session_s", std::chrono::duration<double>(m_last_tick - m_start).count());
+
+    const auto add_histogram = [&values](const std::string_view name, const Histogram& histogram) {
+        values.emplace_back(std::format("{}_count", name), static_cast<double>(histogram.GetCount()));
+        values.emplace_back(std::format("{}_mean_ms", name), histogram.GetMean());
+
+        for (const int percentile : PERCENTILES)
+        {
+            values.emplace_back(std::format("{}_p{}_ms", name, percentile), histogram.GetPercentile(percentile / 100.0));
+        }
+
+        values.emplace_back(std::format("{}_max_ms", name), histogram.GetMax());
+    };
+
+    add_histogram("tick", m_tick_durations);
+    add_histogram("drift", m_drifts);
+    add_histogram("time_to_play", m_times_to_play);
+
+    for (std::size_t i = 0; i < m_seeks.size(); i++)
+    {
+        values.emplace_back(std::format("seeks_{}", ToString(static_cast<SeekReason>(i))), static_cast<double>(m_seeks[i]));
+    }
+
+    values.emplace_back("play_rate_changes", static_cast<double>(m_play_rate_changes));
+    values.emplace_back("count_in_stops", static_cast<double>(m_count_in_stops));
+    values.emplace_back("read_failures", static_cast<double>(m_read_failures));
+
+    return values;
+}
+
+std::string SyncMetrics::Serialize() const
+{
+    std::string text;
+    for (const auto& [name, value] : this->GetValues())
+    {
+        text += std::format("{}{}={:.6g}", text.empty() ? "" : ";", name, value);
+    }
+
+    return text;
+}
+
+std::string SyncMetrics::ToJson() const
+{
+    std::string text = "{\n";
+    for (const auto& [name, value] : this->GetValues())
+    {
+        text += std::format("  \"{}\": {:.6g},\n", name, value);
+    }
+
+    const auto add_buckets = [&text](const std::string_view name, const Histogram& histogram, const bool last) {
+        text += std::format("  \"{}_buckets\": [", name);
+
+        const std::span<const double> upper_bounds = histogram.GetUpperBounds();
+        const std::span<const std::uint64_t> counts = histogram.GetBucketCounts();
+        for (std::size_t i = 0; i < counts.size(); i++)
+        {
+            // The overflow bucket has no upper bound
+            const std::string upper_bound = i < upper_bounds.size() ? std::format("{:g}", upper_bounds[i]) : "null";
+            text += std::format("{}{{\"le_ms\": {}, \"count\": {}}}", i > 0 ? ", " : "", upper_bound, counts[i]);
+        }
+
+        text += last ? "]\n" : "],\n";
+    };
+
+    add_buckets("tick", m_tick_durations, false);
+    add_buckets("drift", m_drifts, false);
+    add_buckets("time_to_play", m_times_to_play, true);
+
+    text += "}\n";
+    return text;
+}
+
+std::string SyncMetrics::ToCsv() const
+{
+    std::string text = "metric,value\n";
+    for (const auto& [name, value] : this->GetValues())
+    {
+        text += std::format("{},{:.6g}\n", name, value);
+    }
+
+    const auto add_buckets = [&text](const std::string_view name, const Histogram& histogram) {
+        const std::span<const double> upper_bounds = histogram.GetUpperBounds();
+        const std::span<const std::uint64_t> counts = histogram.GetBucketCounts();
+        for (std::size_t i = 0; i < counts.size(); i++)
+        {
+            if (i < upper_bounds.size())
+            {
+                text += std::format("{}_le_{:g}_ms,{}\n", name, upper_bounds[i], counts[i]);
+            }
+            else
+            {
+                text += std::format("{}_gt_{:g}_ms,{}\n", name, upper_bounds.back(), counts[i]);
+            }
+        }
+    };
+
+    add_buckets("tick", m_tick_durations);
+    add_buckets("drift", m_drifts);
+    add_buckets("time_to_play", m_times_to_play);
+
+    return text;
+}
+
+}
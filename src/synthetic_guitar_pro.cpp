@@ -0,0 +1,510 @@
+#include "synthetic_guitar_pro.h"
+
+#include "memory_dump.h"
+#include "pe_image.h"
+#include "signature_scanner.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace tnt {
+
+// Fake addresses of the GPCore.dll image and the heap, low enough to be valid on 32 bit builds as well
+static constexpr std::uintptr_t SYNTHETIC_MODULE_BASE_ADDRESS = 0x10000000;
+static constexpr std::uintptr_t SYNTHETIC_HEAP_BASE_ADDRESS = 0x40000000;
+
+// Every object in the pointer graph gets this many bytes, enough for the largest offset Guitar Pro uses
+static constexpr std::size_t SYNTHETIC_OBJECT_SIZE = 0x1000;
+
+// Only the PE headers, the code section and the root pointer of the GPCore.dll image are backed by memory
+static constexpr std::size_t SYNTHETIC_MODULE_HEADER_SIZE = 0x1000;
+
+// Where the fake PE header puts its NT headers
+static constexpr std::uintptr_t SYNTHETIC_NT_HEADER_OFFSET = 0x80;
+
+// Executable section of pseudo-random bytes that contains the root signature, if the layout has one
+// A little over one scan chunk so the signature can straddle the first chunk boundary
+static constexpr std::uintptr_t SYNTHETIC_CODE_OFFSET = 0x1000;
+static constexpr std::size_t SYNTHETIC_CODE_SIZE = SIGNATURE_SCAN_CHUNK_SIZE + 0x10000;
+
+struct SyntheticGuitarPro::Impl final
+{
+    Impl(const GuitarProLayout& layout)
+        : m_layout(layout)
+    {
+        if (layout.module_offset < SYNTHETIC_CODE_OFFSET + SYNTHETIC_CODE_SIZE)
+        {
+            throw std::logic_error("Module offset overlaps the synthetic code section.\n");
+        }
+
+        m_blocks[MODULE_HEADER_BLOCK] = { SYNTHETIC_MODULE_BASE_ADDRESS, std::vector<std::byte>(SYNTHETIC_MODULE_HEADER_SIZE) };
+        m_blocks[CODE_BLOCK] = { SYNTHETIC_MODULE_BASE_ADDRESS + SYNTHETIC_CODE_OFFSET, std::vector<std::byte>(SYNTHETIC_CODE_SIZE) };
+        m_blocks[ROOT_POINTER_BLOCK] = { SYNTHETIC_MODULE_BASE_ADDRESS + layout.module_offset, std::vector<std::byte>(sizeof(std::uintptr_t)) };
+        m_blocks[HEAP_BLOCK] = { SYNTHETIC_HEAP_BASE_ADDRESS, {} };
+
+        for (const GuitarProField& field : m_layout.fields)
+        {
+            for (const std::uintptr_t offset : field.pointer_chain)
+            {
+                if (offset + sizeof(std::uintptr_t) > SYNTHETIC_OBJECT_SIZE)
+                {
+                    throw std::logic_error("Pointer chain offset does not fit in a synthetic object.\n");
+                }
+            }
+        }
+
+        this->WritePeHeader();
+        this->WriteCode();
+        this->BuildPointerGraph();
+        this->SetState(GuitarProState{});
+    }
+
+    void SetState(const GuitarProState& state)
+    {
+        m_state = state;
+
+        for (std::size_t i = 0; i < m_layout.fields.size(); i++)
+        {
+            const GuitarProField& field = m_layout.fields[i];
+            const std::uintptr_t address = m_leaf_addresses[i];
+
+            switch (field.type)
+            {
+            case GuitarProFieldType::INT32:
+            {
+                const auto raw = static_cast<std::int32_t>(std::llround(state.*field.value / field.scale));
+                this->Write(address, &raw, sizeof(raw));
+                break;
+            }
+            case GuitarProFieldType::FLOAT32:
+            {
+                const auto raw = static_cast<float>(state.*field.value / field.scale);
+                this->Write(address, &raw, sizeof(raw));
+                break;
+            }
+            case GuitarProFieldType::FLAG32:
+            {
+                // Only touch the flag bit, the rest of the container belongs to Guitar Pro
+                std::uint32_t raw = 0;
+                this->ReadMemory(address, &raw, sizeof(raw));
+                raw = state.*field.flag ? (raw | (1U << field.flag_bit)) : (raw & ~(1U << field.flag_bit));
+                this->Write(address, &raw, sizeof(raw));
+                break;
+            }
+            }
+        }
+    }
+
+    const GuitarProState& GetState() const
+    {
+        return m_state;
+    }
+
+    void ReplaceDocument()
+    {
+        // Everything allocated before this point now belongs to the old document
+        m_generation_start = SYNTHETIC_HEAP_BASE_ADDRESS + m_blocks[HEAP_BLOCK].data.size();
+
+        this->BuildPointerGraph();
+        this->SetState(m_state);
+    }
+
+    void ReplaceBranch(const std::string_view field_name)
+    {
+        const auto field = std::ranges::find_if(m_layout.fields, [&](const GuitarProField& field) { return field.name == field_name; });
+        if (field == m_layout.fields.end())
+        {
+            throw std::logic_error("Unknown synthetic Guitar Pro field.\n");
+        }
+
+        // The object reached after a hop is shared with every chain that has the same offsets up to that hop
+        const PointerChain& chain = field->pointer_chain;
+        std::size_t first_hop = 1;
+        for (const GuitarProField& other : m_layout.fields)
+        {
+            if (&other != &*field)
+            {
+                std::size_t hop = 0;
+                while (hop < chain.size() && hop < other.pointer_chain.size() && chain[hop] == other.pointer_chain[hop])
+                {
+                    hop++;
+                }
+
+                first_hop = std::max(first_hop, hop + 1);
+            }
+        }
+
+        if (first_hop >= chain.size())
+        {
+            throw std::logic_error("Synthetic Guitar Pro field has no objects of its own.\n");
+        }
+
+        std::uintptr_t address = SYNTHETIC_MODULE_BASE_ADDRESS + m_layout.module_offset;
+        for (std::size_t hop = 0; hop < chain.size(); hop++)
+        {
+            std::uintptr_t object = 0;
+            this->ReadMemory(address, &object, sizeof(object));
+
+            if (hop >= first_hop)
+            {
+                object = this->Allocate();
+                this->Write(address, &object, sizeof(object));
+            }
+
+            address = object + chain[hop];
+        }
+
+        m_leaf_addresses[field - m_layout.fields.begin()] = address;
+        this->SetState(m_state);
+    }
+
+    void SetRunning(const bool running)
+    {
+        m_running = running;
+    }
+
+    bool IsRunning() const
+    {
+        return m_running;
+    }
+
+    const GuitarProLayout& GetLayout() const
+    {
+        return m_layout;
+    }
+
+    std::uint64_t GetModuleHash() const
+    {
+        return m_module_image.GetModuleHash();
+    }
+
+    bool ReadMemory(const std::uintptr_t address, void* buffer, const std::size_t size) const
+    {
+        const std::byte* data = this->GetPointer(address, size);
+        if (!data)
+        {
+            return false;
+        }
+
+        std::memcpy(buffer, data, size);
+        return true;
+    }
+
+    void SaveMemoryDump(const std::filesystem::path& path) const
+    {
+        std::vector<MemoryDumpRegion> regions;
+        for (const Block& block : m_blocks)
+        {
+            regions.push_back({ block.address, block.data.data(), block.data.size() });
+        }
+
+        MemoryDump::Save(path, m_layout.version, SYNTHETIC_MODULE_BASE_ADDRESS, std::move(regions));
+    }
+
+private:
+    // Just enough of a PE header for ReadPeImage, the time stamp is derived from the version so every layout gets its own module hash
+    void WritePeHeader()
+    {
+        std::uint32_t time_date_stamp = 2166136261U;
+        for (const wchar_t* c = m_layout.version; *c; c++)
+        {
+            time_date_stamp = (time_date_stamp ^ static_cast<std::uint32_t>(*c)) * 16777619U;
+        }
+
+        m_module_image.time_date_stamp = time_date_stamp;
+        m_module_image.size_of_image = static_cast<std::uint32_t>((m_layout.module_offset + 0xFFFF) & ~std::uintptr_t{ 0xFFFF });
+
+        const std::uint16_t dos_signature = 0x5A4D;
+        const std::uint32_t nt_header_offset = SYNTHETIC_NT_HEADER_OFFSET;
+        const std::uint32_t nt_signature = 0x00004550;
+        const std::uint16_t section_count = 1;
+        const std::uint16_t optional_header_size = 0xF0;
+
+        const std::uintptr_t nt_header = SYNTHETIC_MODULE_BASE_ADDRESS + SYNTHETIC_NT_HEADER_OFFSET;
+        this->Write(SYNTHETIC_MODULE_BASE_ADDRESS, &dos_signature, sizeof(dos_signature));
+        this->Write(SYNTHETIC_MODULE_BASE_ADDRESS + 0x3C, &nt_header_offset, sizeof(nt_header_offset));
+        this->Write(nt_header, &nt_signature, sizeof(nt_signature));
+        this->Write(nt_header + 0x06, &section_count, sizeof(section_count));
+        this->Write(nt_header + 0x08, &m_module_image.time_date_stamp, sizeof(m_module_image.time_date_stamp));
+        this->Write(nt_header + 0x14, &optional_header_size, sizeof(optional_header_size));
+        this->Write(nt_header + 0x50, &m_module_image.size_of_image, sizeof(m_module_image.size_of_image));
+
+        // .text
+        const std::uintptr_t section_header = nt_header + 0x18 + optional_header_size;
+        const std::uint32_t virtual_size = SYNTHETIC_CODE_SIZE;
+        const std::uint32_t virtual_address = SYNTHETIC_CODE_OFFSET;
+        const std::uint32_t characteristics = 0x60000020;
+        this->Write(section_header, ".text", 5);
+        this->Write(section_header + 0x08, &virtual_size, sizeof(virtual_size));
+        this->Write(section_header + 0x0C, &virtual_address, sizeof(virtual_address));
+        this->Write(section_header + 0x24, &characteristics, sizeof(characteristics));
+    }
+
+    // Fills the code section with noise and places the root signature across the first scan chunk boundary, pointing at the root pointer
+    void WriteCode()
+    {
+        std::vector<std::byte>& code = m_blocks[CODE_BLOCK].data;
+
+        std::uint32_t state = 0x9E3779B9;
+        for (std::byte& byte : code)
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            byte = static_cast<std::byte>(state);
+        }
+
+        const RootSignature& signature = m_layout.root_signature;
+        if (!signature.pattern)
+        {
+            return;
+        }
+
+        const BytePattern pattern(signature.pattern);
+        const std::uintptr_t instruction = SYNTHETIC_MODULE_BASE_ADDRESS + SYNTHETIC_CODE_OFFSET + SIGNATURE_SCAN_CHUNK_SIZE - pattern.size() / 2;
+        for (std::size_t i = 0; i < pattern.size(); i++)
+        {
+            if (!pattern.IsWildcard(i))
+            {
+                const std::uint8_t byte = pattern[i];
+                this->Write(instruction + i, &byte, sizeof(byte));
+            }
+        }
+
+        const std::uintptr_t root_address = SYNTHETIC_MODULE_BASE_ADDRESS + m_layout.module_offset;
+        const auto displacement = static_cast<std::int32_t>(root_address - (instruction + signature.instruction_size));
+        this->Write(instruction + signature.displacement_offset, &displacement, sizeof(displacement));
+    }
+
+    // Creates every object along every field chain that does not exist in the current document yet
+    void BuildPointerGraph()
+    {
+        for (std::size_t i = 0; i < m_layout.fields.size(); i++)
+        {
+            std::uintptr_t address = SYNTHETIC_MODULE_BASE_ADDRESS + m_layout.module_offset;
+
+            for (const std::uintptr_t offset : m_layout.fields[i].pointer_chain)
+            {
+                std::uintptr_t object = 0;
+                this->ReadMemory(address, &object, sizeof(object));
+
+                if (object < m_generation_start)
+                {
+                    object = this->Allocate();
+                    this->Write(address, &object, sizeof(object));
+                }
+
+                address = object + offset;
+            }
+
+            m_leaf_addresses[i] = address;
+        }
+    }
+
+    std::uintptr_t Allocate()
+    {
+        std::vector<std::byte>& heap = m_blocks[HEAP_BLOCK].data;
+        const std::uintptr_t address = SYNTHETIC_HEAP_BASE_ADDRESS + heap.size();
+        heap.resize(heap.size() + SYNTHETIC_OBJECT_SIZE);
+        return address;
+    }
+
+    void Write(const std::uintptr_t address, const void* data, const std::size_t size)
+    {
+        std::byte* destination = const_cast<std::byte*>(this->GetPointer(address, size));
+        if (!destination)
+        {
+            throw std::logic_error("Synthetic Guitar Pro write outside of the image.\n");
+        }
+
+        std::memcpy(destination, data, size);
+    }
+
+    const std::byte* GetPointer(const std::uintptr_t address, const std::size_t size) const
+    {
+        for (const Block& block : m_blocks)
+        {
+            if (address >= block.address && address - block.address <= block.data.size()
+             && size <= block.data.size() - (address - block.address))
+            {
+                return block.data.data() + (address - block.address);
+            }
+        }
+
+        return nullptr;
+    }
+
+    const GuitarProLayout& m_layout;
+    PeImage m_module_image;
+    GuitarProState m_state;
+    bool m_running = true;
+
+    // Contiguous ranges of the fake address space
+    struct Block final
+    {
+        std::uintptr_t address = 0;
+        std::vector<std::byte> data;
+    };
+
+    static constexpr std::size_t MODULE_HEADER_BLOCK = 0;
+    static constexpr std::size_t CODE_BLOCK = 1;
+    static constexpr std::size_t ROOT_POINTER_BLOCK = 2;
+    static constexpr std::size_t HEAP_BLOCK = 3;
+
+    std::array<Block, 4> m_blocks;
+
+    // Objects below this address belong to a previous document
+    std::uintptr_t m_generation_start = SYNTHETIC_HEAP_BASE_ADDRESS;
+
+    std::array<std::uintptr_t, GUITAR_PRO_FIELD_COUNT> m_leaf_addresses = {};
+};
+
+// Memory source view of a SyntheticGuitarPro image
+class SyntheticMemorySource final : public MemorySource
+{
+public:
+    SyntheticMemorySource(const SyntheticGuitarPro::Impl& image)
+        : m_image(image)
+        , m_version(image.GetLayout().version)
+    {}
+
+    std::string GetName() const override
+    {
+        return "synthetic Guitar Pro";
+    }
+
+    const std::wstring& GetProcessVersion() const override
+    {
+        return m_version;
+    }
+
+    std::uintptr_t GetModuleBaseAddress() const override
+    {
+        return SYNTHETIC_MODULE_BASE_ADDRESS;
+    }
+
+    bool IsProcessRunning() const override
+    {
+        return m_image.IsRunning();
+    }
+
+    bool Read(const std::uintptr_t address, void* buffer, const std::size_t size) override
+    {
+        return m_image.IsRunning() && m_image.ReadMemory(address, buffer, size);
+    }
+
+    std::string GetLastErrorMessage() const override
+    {
+        return m_image.IsRunning() ? "The memory range is not part of the image." : "Synthetic Guitar Pro is not running.";
+    }
+
+private:
+    const SyntheticGuitarPro::Impl& m_image;
+    std::wstring m_version;
+};
+
+SyntheticGuitarPro::SyntheticGuitarPro(const GuitarProLayout& layout)
+    : m_impl(std::make_unique<Impl>(layout))
+{}
+
+SyntheticGuitarPro::~SyntheticGuitarPro() = default;
+
+void SyntheticGuitarPro::SetState(const GuitarProState& state)
+{
+    m_impl->SetState(state);
+}
+
+void SyntheticGuitarPro::SetPlayPosition(const double play_position)
+{
+    GuitarProState state = m_impl->GetState();
+    state.play_position = play_position;
+    m_impl->SetState(state);
+}
+
+void SyntheticGuitarPro::SetTimeSelection(const double start_position, const double end_position)
+{
+    GuitarProState state = m_impl->GetState();
+    state.time_selection_start_position = start_position;
+    state.time_selection_end_position = end_position;
+    m_impl->SetState(state);
+}
+
+void SyntheticGuitarPro::SetPlayRate(const double play_rate)
+{
+    GuitarProState state = m_impl->GetState();
+    state.play_rate = play_rate;
+    m_impl->SetState(state);
+}
+
+void SyntheticGuitarPro::SetPlayState(const bool play_state)
+{
+    GuitarProState state = m_impl->GetState();
+    state.play_state = play_state;
+    m_impl->SetState(state);
+}
+
+void SyntheticGuitarPro::SetCountInState(const bool count_in_state)
+{
+    GuitarProState state = m_impl->GetState();
+    state.count_in_state = count_in_state;
+    m_impl->SetState(state);
+}
+
+void SyntheticGuitarPro::SetLoopState(const bool loop_state)
+{
+    GuitarProState state = m_impl->GetState();
+    state.loop_state = loop_state;
+    m_impl->SetState(state);
+}
+
+void SyntheticGuitarPro::ReplaceDocument()
+{
+    m_impl->ReplaceDocument();
+}
+
+void SyntheticGuitarPro::ReplaceBranch(const std::string_view field_name)
+{
+    m_impl->ReplaceBranch(field_name);
+}
+
+std::uint64_t SyntheticGuitarPro::GetModuleHash() const
+{
+    return m_impl->GetModuleHash();
+}
+
+void SyntheticGuitarPro::SetRunning(const bool running)
+{
+    m_impl->SetRunning(running);
+}
+
+std::unique_ptr<MemorySource> SyntheticGuitarPro::CreateMemorySource()
+{
+    return std::make_unique<SyntheticMemorySource>(*m_impl);
+}
+
+MemorySourceFactory SyntheticGuitarPro::GetMemorySourceFactory()
+{
+    return [this] {
+        if (!m_impl->IsRunning())
+        {
+            throw std::runtime_error("Failed to get process ID for process 'GuitarPro.exe'.\n");
+        }
+
+        return this->CreateMemorySource();
+    };
+}
+
+void SyntheticGuitarPro::SaveMemoryDump(const std::filesystem::path& path) const
+{
+    m_impl->SaveMemoryDump(path);
+}
+
+}
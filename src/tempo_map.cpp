@@ -0,0 +1,307 @@
+#include "tempo_map.h"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+
+namespace tnt {
+
+// Tempos closer than this are treated as constant, which also keeps the ramp formulas away from dividing by zero
+static constexpr double TEMPO_EPSILON = 0.000001;
+
+// Markers closer than this are at the same position, the later one wins
+static constexpr double POSITION_EPSILON = 0.000001;
+
+static double GetBarLength(const TimeSignature& time_signature)
+{
+    return time_signature.numerator * 4.0 / time_signature.denominator;
+}
+
+// Quarter notes played in the given seconds while the tempo ramps linearly (in beats) from bpm to end_bpm
+static double GetRampBeats(const double seconds, const double bpm, const double end_bpm)
+{
+    if (std::fabs(end_bpm - bpm) < TEMPO_EPSILON)
+    {
+        return seconds * bpm / 60.0;
+    }
+
+    return seconds * (end_bpm - bpm) / (60.0 * std::log(end_bpm / bpm));
+}
+
+TempoMap::TempoMap()
+{
+    m_segments.push_back(Segment{});
+    m_time_signatures.push_back(TimeSignatureChange{});
+    m_bar_count = 1;
+}
+
+TempoMap TempoMap::FromMarkers(std::span<const TempoMarker> markers)
+{
+    TempoMap map;
+    if (markers.empty())
+    {
+        return map;
+    }
+
+    map.m_segments.clear();
+
+    // REAPER plays the first marker's tempo from the start of the project
+    double time = 0.0;
+    double beat = 0.0;
+    if (markers.front().time > POSITION_EPSILON)
+    {
+        map.m_segments.push_back({ 0.0, 0.0, markers.front().bpm, 0.0 });
+        time = markers.front().time;
+        beat = GetRampBeats(time, markers.front().bpm, markers.front().bpm);
+    }
+
+    int bar = 0;
+    double bar_beat = 0.0;
+    TimeSignature time_signature;
+
+    for (std::size_t i = 0; i < markers.size(); i++)
+    {
+        const TempoMarker& marker = markers[i];
+        time = marker.time;
+
+        // Time signature markers always start a new bar
+        if (marker.numerator > 0 && marker.denominator > 0)
+        {
+            bar += static_cast<int>(std::lround((beat - bar_beat) / GetBarLength(time_signature)));
+            bar_beat = beat;
+            time_signature = { marker.numerator, marker.denominator };
+            map.AddTimeSignature(bar, beat, time_signature);
+        }
+
+        if (i + 1 == markers.size())
+        {
+            map.m_segments.push_back({ time, beat, marker.bpm, 0.0 });
+            break;
+        }
+
+        const TempoMarker& next = markers[i + 1];
+        const double seconds = next.time - marker.time;
+        if (seconds < POSITION_EPSILON)
+        {
+            continue;
+        }
+
+        const double end_bpm = marker.linear ? next.bpm : marker.bpm;
+        const double beats = GetRampBeats(seconds, marker.bpm, end_bpm);
+        map.m_segments.push_back({ time, beat, marker.bpm, (end_bpm - marker.bpm) / beats });
+        beat += beats;
+    }
+
+    map.m_bar_count = bar + static_cast<int>(std::floor((beat - bar_beat) / GetBarLength(time_signature) + POSITION_EPSILON)) + 1;
+    return map;
+}
+
+TempoMap TempoMap::FromBars(std::span<const TimeSignature> bars, std::span<const BarTempo> tempos)
+{
+    TempoMap map;
+
+    double beat = 0.0;
+    for (std::size_t i = 0; i < bars.size(); i++)
+    {
+        if (i == 0 || bars[i] != bars[i - 1])
+        {
+            map.AddTimeSignature(static_cast<int>(i), beat, bars[i]);
+        }
+
+        beat += GetBarLength(bars[i]);
+    }
+
+    map.m_bar_count = std::max(1, static_cast<int>(bars.size()));
+
+    if (tempos.empty())
+    {
+        return map;
+    }
+
+    map.m_segments.clear();
+
+    // The first tempo also applies to everything before it
+    double time = 0.0;
+    double tempo_beat = map.GetBeat(tempos.front().bar, tempos.front().bar_position);
+    if (tempo_beat > POSITION_EPSILON)
+    {
+        map.m_segments.push_back({ 0.0, 0.0, tempos.front().bpm, 0.0 });
+        time = tempo_beat * 60.0 / tempos.front().bpm;
+    }
+
+    for (std::size_t i = 0; i < tempos.size(); i++)
+    {
+        const BarTempo& tempo = tempos[i];
+
+        if (i + 1 == tempos.size())
+        {
+            map.m_segments.push_back({ time, tempo_beat, tempo.bpm, 0.0 });
+            break;
+        }
+
+        const double next_beat = map.GetBeat(tempos[i + 1].bar, tempos[i + 1].bar_position);
+        const double beats = next_beat - tempo_beat;
+        if (beats < POSITION_EPSILON)
+        {
+            tempo_beat = next_beat;
+            continue;
+        }
+
+        const double end_bpm = tempo.linear ? tempos[i + 1].bpm : tempo.bpm;
+        const Segment segment = { time, tempo_beat, tempo.bpm, (end_bpm - tempo.bpm) / beats };
+        map.m_segments.push_back(segment);
+
+        time = map.BeatToTime(next_beat);
+        tempo_beat = next_beat;
+    }
+
+    return map;
+}
+
+double TempoMap::TimeToBeat(const double time) const
+{
+    const Segment& segment = this->FindSegmentByTime(time);
+    const double seconds = time - segment.time;
+
+    // Before the first segment its start tempo applies
+    if (std::fabs(segment.slope) < TEMPO_EPSILON || seconds < 0.0)
+    {
+        return segment.beat + seconds * segment.bpm / 60.0;
+    }
+
+    return segment.beat + segment.bpm * (std::exp(seconds * segment.slope / 60.0) - 1.0) / segment.slope;
+}
+
+double TempoMap::BeatToTime(const double beat) const
+{
+    const Segment& segment = this->FindSegmentByBeat(beat);
+    const double beats = beat - segment.beat;
+
+    if (std::fabs(segment.slope) < TEMPO_EPSILON || beats < 0.0)
+    {
+        return segment.time + beats * 60.0 / segment.bpm;
+    }
+
+    return segment.time + 60.0 / segment.slope * std::log((segment.bpm + segment.slope * beats) / segment.bpm);
+}
+
+double TempoMap::GetTempo(const double beat) const
+{
+    const Segment& segment = this->FindSegmentByBeat(beat);
+    return segment.bpm + segment.slope * std::max(0.0, beat - segment.beat);
+}
+
+double TempoMap::GetBarBeat(const int bar) const
+{
+    const TimeSignatureChange& change = this->FindTimeSignature(bar);
+    return change.beat + (std::max(bar, 0) - change.bar) * GetBarLength(change.time_signature);
+}
+
+double TempoMap::GetBarTime(const int bar) const
+{
+    return this->BeatToTime(this->GetBarBeat(bar));
+}
+
+double TempoMap::GetBeat(const int bar, const double bar_position) const
+{
+    return this->GetBarBeat(bar) + bar_position * GetBarLength(this->GetTimeSignature(bar));
+}
+
+TimeSignature TempoMap::GetTimeSignature(const int bar) const
+{
+    return this->FindTimeSignature(bar).time_signature;
+}
+
+int TempoMap::GetBarCount() const
+{
+    return m_bar_count;
+}
+
+void TempoMap::AddTimeSignature(const int bar, const double beat, const TimeSignature& time_signature)
+{
+    // A later marker on the same bar replaces the earlier one
+    if (!m_time_signatures.empty() && m_time_signatures.back().bar >= bar)
+    {
+        m_time_signatures.back() = { m_time_signatures.back().bar, beat, time_signature };
+        return;
+    }
+
+    m_time_signatures.push_back({ bar, beat, time_signature });
+}
+
+const TempoMap::Segment& TempoMap::FindSegmentByTime(const double time) const
+{
+    const auto it = std::upper_bound(m_segments.begin(), m_segments.end(), time, [](const double value, const Segment& segment) {
+        return value < segment.time;
+    });
+
+    return it == m_segments.begin() ? *it : *(it - 1);
+}
+
+const TempoMap::Segment& TempoMap::FindSegmentByBeat(const double beat) const
+{
+    const auto it = std::upper_bound(m_segments.begin(), m_segments.end(), beat, [](const double value, const Segment& segment) {
+        return value < segment.beat;
+    });
+
+    return it == m_segments.begin() ? *it : *(it - 1);
+}
+
+const TempoMap::TimeSignatureChange& TempoMap::FindTimeSignature(const int bar) const
+{
+    const auto it = std::upper_bound(m_time_signatures.begin(), m_time_signatures.end(), bar, [](const int value, const TimeSignatureChange& change) {
+        return value < change.bar;
+    });
+
+    return it == m_time_signatures.begin() ? *it : *(it - 1);
+}
+
+std::vector<TempoMapMismatch> DiffTempoMaps(const TempoMap& expected, const TempoMap& actual, const double tolerance)
+{
+    std::vector<TempoMapMismatch> mismatches;
+
+    // The end of a bar is the start of the next one, so every bar boundary is only converted once
+    double expected_start = expected.GetBarTime(0);
+    double actual_start = actual.GetBarTime(0);
+
+    for (int bar = 0; bar < expected.GetBarCount(); bar++)
+    {
+        const double expected_end = expected.GetBarTime(bar + 1);
+        const double actual_end = actual.GetBarTime(bar + 1);
+
+        const TimeSignature expected_time_signature = expected.GetTimeSignature(bar);
+        const TimeSignature actual_time_signature = actual.GetTimeSignature(bar);
+
+        if (expected_time_signature != actual_time_signature
+         || std::fabs(expected_start - actual_start) > tolerance
+         || std::fabs(expected_end - actual_end) > tolerance)
+        {
+            TempoMapMismatch mismatch;
+            mismatch.bar = bar;
+            mismatch.expected_start_time = expected_start;
+            mismatch.expected_end_time = expected_end;
+            mismatch.actual_start_time = actual_start;
+            mismatch.actual_end_time = actual_end;
+            mismatch.expected_bpm = expected.GetTempo(expected.GetBarBeat(bar));
+            mismatch.actual_bpm = actual.GetTempo(actual.GetBarBeat(bar));
+            mismatch.expected_time_signature = expected_time_signature;
+            mismatch.actual_time_signature = actual_time_signature;
+            mismatches.push_back(mismatch);
+        }
+
+        expected_start = expected_end;
+        actual_start = actual_end;
+    }
+
+    return mismatches;
+}
+
+std::string ToString(const TempoMapMismatch& mismatch)
+{
+    return std::format("Bar {} spans {:.3f}-{:.3f} s instead of {:.3f}-{:.3f} s ({:.2f} bpm {}/{} instead of {:.2f} bpm {}/{})",
+        mismatch.bar + 1, mismatch.actual_start_time, mismatch.actual_end_time, mismatch.expected_start_time, mismatch.expected_end_time,
+        mismatch.actual_bpm, mismatch.actual_time_signature.numerator, mismatch.actual_time_signature.denominator,
+        mismatch.expected_bpm, mismatch.expected_time_signature.numerator, mismatch.expected_time_signature.denominator);
+}
+
+}
@@ -0,0 +1,445 @@
+#include "trace_format.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+namespace tnt {
+
+static constexpr std::array<char, 8> TRACE_MAGIC = { 'T', 'N', 'T', 'T', 'R', 'A', 'C', 'E' };
+static constexpr std::uint32_t TRACE_FORMAT_VERSION = 1;
+static constexpr std::size_t TRACE_HEADER_SIZE = TRACE_MAGIC.size() + sizeof(std::uint32_t);
+
+// Longest varint of a 64 bit value
+static constexpr std::size_t MAX_VARINT_SIZE = 10;
+
+static void WriteByte(std::vector<std::byte>& buffer, const std::uint8_t value)
+{
+    buffer.push_back(static_cast<std::byte>(value));
+}
+
+static void WriteVarint(std::vector<std::byte>& buffer, std::uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        WriteByte(buffer, static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+
+    WriteByte(buffer, static_cast<std::uint8_t>(value));
+}
+
+static void WriteFixed64(std::vector<std::byte>& buffer, const std::uint64_t value)
+{
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        WriteByte(buffer, static_cast<std::uint8_t>(value >> shift));
+    }
+}
+
+// Maps small negative differences to small varints
+static std::uint64_t ZigZagEncode(const std::uint64_t difference)
+{
+    const auto value = static_cast<std::int64_t>(difference);
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+static std::uint64_t ZigZagDecode(const std::uint64_t value)
+{
+    return (value >> 1) ^ (~(value & 1) + 1);
+}
+
+static std::uint64_t ToField(const double value)
+{
+    return std::bit_cast<std::uint64_t>(value);
+}
+
+static double ToDouble(const std::uint64_t field)
+{
+    return std::bit_cast<double>(field);
+}
+
+template <std::size_t N>
+static void WriteFields(std::vector<std::byte>& buffer, const std::array<std::uint64_t, N>& fields, std::array<std::uint64_t, N>& previous_fields)
+{
+    std::uint64_t changed = 0;
+    for (std::size_t i = 0; i < N; i++)
+    {
+        if (fields[i] != previous_fields[i])
+        {
+            changed |= std::uint64_t(1) << i;
+        }
+    }
+
+    WriteVarint(buffer, changed);
+
+    for (std::size_t i = 0; i < N; i++)
+    {
+        if (changed & (std::uint64_t(1) << i))
+        {
+            // Unsigned wrap around keeps the difference exact for every bit pattern
+            WriteVarint(buffer, ZigZagEncode(fields[i] - previous_fields[i]));
+        }
+    }
+
+    previous_fields = fields;
+}
+
+static std::array<std::uint64_t, TraceEncoder::TICK_FIELD_COUNT> ToFields(const ReaperState& state, const double output_latency)
+{
+    return {
+        ToField(state.play_position),
+        ToField(state.play_rate),
+        static_cast<std::uint64_t>(state.play_state),
+        state.repeat,
+        ToField(state.time_selection_start_position),
+        ToField(state.time_selection_end_position),
+        state.preserve_pitch,
+        ToField(output_latency),
+    };
+}
+
+static ReaperState ToReaperState(const std::array<std::uint64_t, TraceEncoder::TICK_FIELD_COUNT>& fields)
+{
+    ReaperState state;
+    state.play_position = ToDouble(fields[0]);
+    state.play_rate = ToDouble(fields[1]);
+    state.play_state = static_cast<ReaperPlayState>(fields[2]);
+    state.repeat = fields[3] != 0;
+    state.time_selection_start_position = ToDouble(fields[4]);
+    state.time_selection_end_position = ToDouble(fields[5]);
+    state.preserve_pitch = fields[6] != 0;
+    return state;
+}
+
+// One field per layout descriptor in the same order, followed by the timestamp
+static std::array<std::uint64_t, TraceEncoder::GUITAR_PRO_STATE_FIELD_COUNT> ToFields(const GuitarProState& state, const std::chrono::nanoseconds timestamp)
+{
+    std::array<std::uint64_t, TraceEncoder::GUITAR_PRO_STATE_FIELD_COUNT> fields = {};
+    for (std::size_t i = 0; i < GUITAR_PRO_8_FIELDS.size(); i++)
+    {
+        const GuitarProField& field = GUITAR_PRO_8_FIELDS[i];
+        fields[i] = field.flag ? static_cast<std::uint64_t>(state.*field.flag) : ToField(state.*field.value);
+    }
+
+    fields.back() = static_cast<std::uint64_t>(timestamp.count());
+    return fields;
+}
+
+static GuitarProState ToGuitarProState(const std::array<std::uint64_t, TraceEncoder::GUITAR_PRO_STATE_FIELD_COUNT>& fields)
+{
+    GuitarProState state;
+    for (std::size_t i = 0; i < GUITAR_PRO_8_FIELDS.size(); i++)
+    {
+        const GuitarProField& field = GUITAR_PRO_8_FIELDS[i];
+        if (field.flag)
+        {
+            state.*field.flag = fields[i] != 0;
+        }
+        else
+        {
+            state.*field.value = ToDouble(fields[i]);
+        }
+    }
+
+    state.timestamp = std::chrono::steady_clock::time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(static_cast<std::int64_t>(fields.back()))));
+    return state;
+}
+
+TraceEncoder::TraceEncoder(const Clock::time_point start)
+    : m_start(start)
+    , m_previous_time(start)
+{}
+
+void TraceEncoder::EncodeHeader(std::vector<std::byte>& buffer)
+{
+    for (const char c : TRACE_MAGIC)
+    {
+        WriteByte(buffer, static_cast<std::uint8_t>(c));
+    }
+
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        WriteByte(buffer, static_cast<std::uint8_t>(TRACE_FORMAT_VERSION >> shift));
+    }
+}
+
+void TraceEncoder::EncodeExtState(std::vector<std::byte>& buffer, const Clock::time_point time, const std::string_view key, const std::string_view value)
+{
+    this->EncodeRecordStart(buffer, TraceRecordType::EXT_STATE, time);
+
+    for (const std::string_view text : { key, value })
+    {
+        WriteVarint(buffer, text.size());
+        const auto bytes = std::as_bytes(std::span(text));
+        buffer.insert(buffer.end(), bytes.begin(), bytes.end());
+    }
+}
+
+void TraceEncoder::EncodeTick(std::vector<std::byte>& buffer, const Clock::time_point time, const ReaperState& state, const double output_latency)
+{
+    this->EncodeRecordStart(buffer, TraceRecordType::TICK, time);
+    WriteFields(buffer, ToFields(state, output_latency), m_previous_tick);
+}
+
+void TraceEncoder::EncodeGuitarProState(std::vector<std::byte>& buffer, const Clock::time_point time, const GuitarProState& state)
+{
+    this->EncodeRecordStart(buffer, TraceRecordType::GUITAR_PRO_STATE, time);
+    WriteFields(buffer, ToFields(state, state.timestamp - m_start), m_previous_guitar_pro_state);
+}
+
+void TraceEncoder::EncodeGuitarProReadFailed(std::vector<std::byte>& buffer, const Clock::time_point time)
+{
+    this->EncodeRecordStart(buffer, TraceRecordType::GUITAR_PRO_READ_FAILED, time);
+}
+
+void TraceEncoder::EncodeReaperCommand(std::vector<std::byte>& buffer, const Clock::time_point time, const ReaperCommand& command)
+{
+    this->EncodeRecordStart(buffer, TraceRecordType::REAPER_COMMAND, time);
+    WriteByte(buffer, static_cast<std::uint8_t>(command.type));
+    WriteVarint(buffer, ZigZagEncode(static_cast<std::uint64_t>(command.state)));
+    WriteFixed64(buffer, ToField(command.value));
+    WriteFixed64(buffer, ToField(command.end_value));
+}
+
+void TraceEncoder::EncodeRecordStart(std::vector<std::byte>& buffer, const TraceRecordType type, const Clock::time_point time)
+{
+    // Records are written in time order, a clock going backwards is stored as no time passing
+    const Clock::time_point record_time = std::max(time, m_previous_time);
+
+    WriteByte(buffer, static_cast<std::uint8_t>(type));
+    WriteVarint(buffer, static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(record_time - m_previous_time).count()));
+
+    m_previous_time = record_time;
+}
+
+// Bounds checked reads, any of them failing means the record was cut off
+class TraceReader final
+{
+public:
+    TraceReader(const std::span<const std::byte> data, std::size_t& offset)
+        : m_data(data)
+        , m_offset(offset)
+    {}
+
+    bool ReadByte(std::uint8_t& value)
+    {
+        if (m_offset >= m_data.size())
+        {
+            return false;
+        }
+
+        value = static_cast<std::uint8_t>(m_data[m_offset++]);
+        return true;
+    }
+
+    bool ReadVarint(std::uint64_t& value)
+    {
+        value = 0;
+        for (std::size_t i = 0; i < MAX_VARINT_SIZE; i++)
+        {
+            std::uint8_t byte = 0;
+            if (!this->ReadByte(byte))
+            {
+                return false;
+            }
+
+            value |= static_cast<std::uint64_t>(byte & 0x7F) << (7 * i);
+            if (!(byte & 0x80))
+            {
+                return true;
+            }
+        }
+
+        throw std::runtime_error("Trace contains an invalid varint.\n");
+    }
+
+    bool ReadFixed64(std::uint64_t& value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 8)
+        {
+            std::uint8_t byte = 0;
+            if (!this->ReadByte(byte))
+            {
+                return false;
+            }
+
+            value |= static_cast<std::uint64_t>(byte) << shift;
+        }
+
+        return true;
+    }
+
+    bool ReadString(std::string_view& value)
+    {
+        std::uint64_t size = 0;
+        if (!this->ReadVarint(size) || size > m_data.size() - m_offset)
+        {
+            return false;
+        }
+
+        value = std::string_view(reinterpret_cast<const char*>(m_data.data() + m_offset), static_cast<std::size_t>(size));
+        m_offset += static_cast<std::size_t>(size);
+        return true;
+    }
+
+    template <std::size_t N>
+    bool ReadFields(std::array<std::uint64_t, N>& fields)
+    {
+        std::uint64_t changed = 0;
+        if (!this->ReadVarint(changed))
+        {
+            return false;
+        }
+
+        if (changed >> N)
+        {
+            throw std::runtime_error("Trace contains an invalid field mask.\n");
+        }
+
+        // Only commit once the whole record was read, a cut off record must not change the state
+        std::array<std::uint64_t, N> new_fields = fields;
+        for (std::size_t i = 0; i < N; i++)
+        {
+            if (changed & (std::uint64_t(1) << i))
+            {
+                std::uint64_t difference = 0;
+                if (!this->ReadVarint(difference))
+                {
+                    return false;
+                }
+
+                new_fields[i] += ZigZagDecode(difference);
+            }
+        }
+
+        fields = new_fields;
+        return true;
+    }
+
+private:
+    std::span<const std::byte> m_data;
+    std::size_t& m_offset;
+};
+
+TraceDecoder::TraceDecoder(const std::span<const std::byte> data)
+    : m_data(data)
+{
+    std::uint32_t version = 0;
+    if (m_data.size() >= TRACE_HEADER_SIZE)
+    {
+        for (std::size_t i = 0; i < sizeof(version); i++)
+        {
+            version |= static_cast<std::uint32_t>(m_data[TRACE_MAGIC.size() + i]) << (8 * i);
+        }
+    }
+
+    if (m_data.size() < TRACE_HEADER_SIZE
+     || std::memcmp(m_data.data(), TRACE_MAGIC.data(), TRACE_MAGIC.size()) != 0)
+    {
+        throw std::runtime_error("Data is not a Guitar Pro sync trace.\n");
+    }
+
+    if (version != TRACE_FORMAT_VERSION)
+    {
+        throw std::runtime_error(std::format("Trace format version {} is not supported, expected {}.\n", version, TRACE_FORMAT_VERSION));
+    }
+
+    m_offset = TRACE_HEADER_SIZE;
+}
+
+bool TraceDecoder::Next(TraceRecord& record)
+{
+    if (m_offset >= m_data.size() || m_truncated)
+    {
+        return false;
+    }
+
+    const std::size_t record_offset = m_offset;
+    TraceReader reader(m_data, m_offset);
+
+    const auto truncated = [&] {
+        m_offset = record_offset;
+        m_truncated = true;
+        return false;
+    };
+
+    std::uint8_t type = 0;
+    std::uint64_t time_delta = 0;
+    if (!reader.ReadByte(type) || !reader.ReadVarint(time_delta))
+    {
+        return truncated();
+    }
+
+    record.type = static_cast<TraceRecordType>(type);
+
+    switch (record.type)
+    {
+    case TraceRecordType::EXT_STATE:
+        if (!reader.ReadString(record.key) || !reader.ReadString(record.value))
+        {
+            return truncated();
+        }
+        break;
+
+    case TraceRecordType::TICK:
+        if (!reader.ReadFields(m_tick))
+        {
+            return truncated();
+        }
+        record.reaper_state = ToReaperState(m_tick);
+        record.output_latency = ToDouble(m_tick[7]);
+        break;
+
+    case TraceRecordType::GUITAR_PRO_STATE:
+        if (!reader.ReadFields(m_guitar_pro_state))
+        {
+            return truncated();
+        }
+        record.guitar_pro_state = ToGuitarProState(m_guitar_pro_state);
+        break;
+
+    case TraceRecordType::GUITAR_PRO_READ_FAILED:
+        break;
+
+    case TraceRecordType::REAPER_COMMAND:
+    {
+        std::uint8_t command_type = 0;
+        std::uint64_t state = 0;
+        std::uint64_t value = 0;
+        std::uint64_t end_value = 0;
+        if (!reader.ReadByte(command_type) || !reader.ReadVarint(state) || !reader.ReadFixed64(value) || !reader.ReadFixed64(end_value))
+        {
+            return truncated();
+        }
+
+        if (command_type > static_cast<std::uint8_t>(ReaperCommandType::PRESERVE_PITCH))
+        {
+            throw std::runtime_error(std::format("Trace contains an unknown REAPER command {}.\n", command_type));
+        }
+
+        record.command.type = static_cast<ReaperCommandType>(command_type);
+        record.command.state = static_cast<int>(static_cast<std::int64_t>(ZigZagDecode(state)));
+        record.command.value = ToDouble(value);
+        record.command.end_value = ToDouble(end_value);
+        break;
+    }
+
+    default:
+        throw std::runtime_error(std::format("Trace contains an unknown record type {} at offset {}.\n", type, record_offset));
+    }
+
+    m_time += std::chrono::nanoseconds(static_cast<std::int64_t>(time_delta));
+    record.time = m_time;
+    return true;
+}
+
+bool TraceDecoder::IsTruncated() const
+{
+    return m_truncated;
+}
+
+}
@@ -0,0 +1,262 @@
+#include "trace_recorder.h"
+
+#include "trace_format.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace tnt {
+
+// Records are handed to the writer thread once this much is buffered, or once this long has passed
+static constexpr std::size_t TRACE_HANDOFF_SIZE = 64 * 1024; // Bytes
+static constexpr auto TRACE_HANDOFF_INTERVAL = std::chrono::seconds(1);
+
+struct TraceRecorder::Impl final
+{
+    ~Impl()
+    {
+        this->StopWriter();
+    }
+
+    void Start(const std::filesystem::path& path, const Clock::time_point start)
+    {
+        this->Stop();
+
+        m_file.open(path, std::ios::binary | std::ios::trunc);
+        if (!m_file)
+        {
+            throw std::runtime_error(std::format("Failed to create trace '{}'.\n", path.string()));
+        }
+
+        m_path = path;
+        m_encoder.emplace(start);
+        m_last_handoff = start;
+        m_write_failed.store(false, std::memory_order_relaxed);
+
+        m_buffer.clear();
+        m_buffer.reserve(TRACE_HANDOFF_SIZE * 2);
+        m_pending.reserve(TRACE_HANDOFF_SIZE * 2);
+        TraceEncoder::EncodeHeader(m_buffer);
+
+        m_thread = std::jthread([this](std::stop_token stop_token) {
+            this->Run(stop_token);
+        });
+    }
+
+    void Stop()
+    {
+        if (!this->IsRecording())
+        {
+            return;
+        }
+
+        this->StopWriter();
+
+        if (m_write_failed.load(std::memory_order_relaxed))
+        {
+            throw std::runtime_error(std::format("Failed to write trace '{}', it is incomplete.\n", m_path.string()));
+        }
+    }
+
+    bool IsRecording() const
+    {
+        return m_thread.joinable();
+    }
+
+    void RecordExtState(const Clock::time_point time, const std::string_view key, const std::string_view value)
+    {
+        if (this->IsRecording())
+        {
+            m_encoder->EncodeExtState(m_buffer, time, key, value);
+            this->HandOffIfDue(time);
+        }
+    }
+
+    void RecordTick(const Clock::time_point time, const ReaperState& state, const double output_latency)
+    {
+        if (this->IsRecording())
+        {
+            m_encoder->EncodeTick(m_buffer, time, state, output_latency);
+            this->HandOffIfDue(time);
+        }
+    }
+
+    void RecordGuitarProState(const Clock::time_point time, const GuitarProState& state)
+    {
+        if (this->IsRecording())
+        {
+            m_encoder->EncodeGuitarProState(m_buffer, time, state);
+            this->HandOffIfDue(time);
+        }
+    }
+
+    void RecordGuitarProReadFailed(const Clock::time_point time)
+    {
+        if (this->IsRecording())
+        {
+            m_encoder->EncodeGuitarProReadFailed(m_buffer, time);
+            this->HandOffIfDue(time);
+        }
+    }
+
+    void RecordReaperCommand(const Clock::time_point time, const ReaperCommand& command)
+    {
+        if (this->IsRecording())
+        {
+            m_encoder->EncodeReaperCommand(m_buffer, time, command);
+            this->HandOffIfDue(time);
+        }
+    }
+
+private:
+    void HandOffIfDue(const Clock::time_point time)
+    {
+        if (m_buffer.size() >= TRACE_HANDOFF_SIZE || time - m_last_handoff >= TRACE_HANDOFF_INTERVAL)
+        {
+            this->HandOff();
+            m_last_handoff = time;
+        }
+    }
+
+    void HandOff()
+    {
+        {
+            std::lock_guard lock(m_mutex);
+
+            // Buffers are swapped so their capacity keeps being reused, unless the writer is behind
+            if (m_pending.empty())
+            {
+                std::swap(m_buffer, m_pending);
+            }
+            else
+            {
+                m_pending.insert(m_pending.end(), m_buffer.begin(), m_buffer.end());
+                m_buffer.clear();
+            }
+        }
+
+        m_condition.notify_one();
+    }
+
+    void StopWriter()
+    {
+        if (!m_thread.joinable())
+        {
+            return;
+        }
+
+        this->HandOff();
+        m_thread.request_stop();
+        m_thread.join();
+        m_file.close();
+    }
+
+    void Run(const std::stop_token& stop_token)
+    {
+        std::vector<std::byte> writing;
+        writing.reserve(TRACE_HANDOFF_SIZE * 2);
+
+        while (true)
+        {
+            {
+                std::unique_lock lock(m_mutex);
+                m_condition.wait(lock, stop_token, [this] { return !m_pending.empty(); });
+
+                // Only empty once stopping and everything was written
+                if (m_pending.empty())
+                {
+                    break;
+                }
+
+                std::swap(m_pending, writing);
+            }
+
+            m_file.write(reinterpret_cast<const char*>(writing.data()), static_cast<std::streamsize>(writing.size()));
+            m_file.flush();
+            writing.clear();
+
+            if (!m_file)
+            {
+                m_write_failed.store(true, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::filesystem::path m_path;
+    std::optional<TraceEncoder> m_encoder;
+    Clock::time_point m_last_handoff;
+
+    // Filled by the recording thread
+    std::vector<std::byte> m_buffer;
+
+    // Waiting for the writer thread
+    std::mutex m_mutex;
+    std::condition_variable_any m_condition;
+    std::vector<std::byte> m_pending;
+
+    // Only used by the writer thread while it runs
+    std::ofstream m_file;
+    std::atomic<bool> m_write_failed = false;
+
+    std::jthread m_thread;
+};
+
+TraceRecorder::TraceRecorder()
+    : m_impl(std::make_unique<Impl>())
+{}
+
+TraceRecorder::~TraceRecorder() = default;
+
+void TraceRecorder::Start(const std::filesystem::path& path, const Clock::time_point start)
+{
+    m_impl->Start(path, start);
+}
+
+void TraceRecorder::Stop()
+{
+    m_impl->Stop();
+}
+
+bool TraceRecorder::IsRecording() const
+{
+    return m_impl->IsRecording();
+}
+
+void TraceRecorder::RecordExtState(const Clock::time_point time, const std::string_view key, const std::string_view value)
+{
+    m_impl->RecordExtState(time, key, value);
+}
+
+void TraceRecorder::RecordTick(const Clock::time_point time, const ReaperState& state, const double output_latency)
+{
+    m_impl->RecordTick(time, state, output_latency);
+}
+
+void TraceRecorder::RecordGuitarProState(const Clock::time_point time, const GuitarProState& state)
+{
+    m_impl->RecordGuitarProState(time, state);
+}
+
+void TraceRecorder::RecordGuitarProReadFailed(const Clock::time_point time)
+{
+    m_impl->RecordGuitarProReadFailed(time);
+}
+
+void TraceRecorder::RecordReaperCommand(const Clock::time_point time, const ReaperCommand& command)
+{
+    m_impl->RecordReaperCommand(time, command);
+}
+
+}
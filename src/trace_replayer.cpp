@@ -0,0 +1,204 @@
+#include "trace_replayer.h"
+
+#include "mapped_file.h"
+#include "plugin.h"
+#include "simulated_reaper.h"
+#include "synthetic_guitar_pro.h"
+#include "trace_format.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace tnt {
+
+// Guitar Pro is read on the recorded tick times, so changes are detected exactly as live and this only absorbs rounding
+static constexpr double REPLAY_COMMAND_EPSILON = 0.000001;
+
+// Everything recorded for one MainLoop
+struct ReplayTick final
+{
+    std::chrono::nanoseconds time = std::chrono::nanoseconds::zero();
+    ReaperState reaper_state;
+    double output_latency = 0.0;
+    std::optional<GuitarProState> guitar_pro_state;
+    bool guitar_pro_read_failed = false;
+    std::vector<ReaperCommand> commands;
+};
+
+static bool CommandsMatch(const ReaperCommand& a, const ReaperCommand& b)
+{
+    return a.type == b.type
+        && a.state == b.state
+        && std::fabs(a.value - b.value) < REPLAY_COMMAND_EPSILON
+        && std::fabs(a.end_value - b.end_value) < REPLAY_COMMAND_EPSILON;
+}
+
+struct TraceReplayer::Impl final
+{
+    Impl(const std::filesystem::path& path)
+        : m_file(path, "trace")
+    {
+        // Only checks the header
+        TraceDecoder decoder(m_file.GetData());
+    }
+
+    TraceReplayResult Run() const
+    {
+        TraceReplayResult result;
+        TraceDecoder decoder(m_file.GetData());
+
+        SyntheticGuitarPro guitar_pro;
+        SimulatedReaper reaper;
+        PluginState plugin_state;
+        std::unique_ptr<Plugin> plugin;
+
+        std::optional<ReplayTick> tick;
+        std::chrono::nanoseconds previous_tick_time = std::chrono::nanoseconds::zero();
+
+        const auto run_tick = [&] {
+            reaper.Advance(std::chrono::duration_cast<SimulatedReaper::Clock::duration>(tick->time - previous_tick_time));
+            reaper.SetState(tick->reaper_state);
+            reaper.SetOutputLatency(tick->output_latency);
+            previous_tick_time = tick->time;
+
+            if (tick->guitar_pro_state)
+            {
+                guitar_pro.SetRunning(true);
+                guitar_pro.SetState(*tick->guitar_pro_state);
+            }
+
+            if (tick->guitar_pro_read_failed)
+            {
+                guitar_pro.SetRunning(false);
+            }
+
+            reaper.ResetCounters();
+            plugin->MainLoop();
+
+            this->Compare(result, tick->commands, reaper.GetCommands(), tick->time);
+            result.recorded_command_count += tick->commands.size();
+            result.replayed_command_count += reaper.GetCommands().size();
+            result.tick_count++;
+        };
+
+        TraceRecord record;
+        while (decoder.Next(record))
+        {
+            result.trace_duration = record.time;
+
+            switch (record.type)
+            {
+            case TraceRecordType::EXT_STATE:
+                reaper.SetExtState(EXT_STATE_SECTION, std::string(record.key), std::string(record.value));
+                break;
+
+            case TraceRecordType::TICK:
+                if (tick)
+                {
+                    run_tick();
+                }
+                else
+                {
+                    // Settings come first, they are all known by now
+                    // Guitar Pro is read on the tick and the audio thread isn't simulated
+                    reaper.SetExtState(EXT_STATE_SECTION, BACKGROUND_POLLING_RATE_KEY, "");
+                    reaper.SetExtState(EXT_STATE_SECTION, AUDIO_HOOK_KEY, "");
+                    reaper.SetExtState(EXT_STATE_SECTION, TRACE_PATH_KEY, "");
+
+                    plugin = std::make_unique<Plugin>(plugin_state, guitar_pro.GetMemorySourceFactory(), reaper.CreateBackend());
+                    plugin->Start();
+                }
+
+                tick.emplace();
+                tick->time = record.time;
+                tick->reaper_state = record.reaper_state;
+                tick->output_latency = record.output_latency;
+                break;
+
+            case TraceRecordType::GUITAR_PRO_STATE:
+                if (tick)
+                {
+                    tick->guitar_pro_state = record.guitar_pro_state;
+                    tick->guitar_pro_read_failed = false;
+                }
+                break;
+
+            case TraceRecordType::GUITAR_PRO_READ_FAILED:
+                if (tick)
+                {
+                    tick->guitar_pro_read_failed = true;
+                }
+                break;
+
+            case TraceRecordType::REAPER_COMMAND:
+                if (tick)
+                {
+                    tick->commands.push_back(record.command);
+                }
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        if (tick)
+        {
+            run_tick();
+            plugin->Stop();
+        }
+
+        result.truncated = decoder.IsTruncated();
+        return result;
+    }
+
+private:
+    // Commands are compared in the order they were applied
+    void Compare(TraceReplayResult& result, const std::vector<ReaperCommand>& recorded, const std::vector<ReaperCommand>& replayed, const std::chrono::nanoseconds time) const
+    {
+        for (std::size_t i = 0; i < std::max(recorded.size(), replayed.size()); i++)
+        {
+            if (i < recorded.size() && i < replayed.size() && CommandsMatch(recorded[i], replayed[i]))
+            {
+                continue;
+            }
+
+            TraceDivergence divergence;
+            divergence.tick = result.tick_count;
+            divergence.time = time;
+
+            if (i < recorded.size())
+            {
+                divergence.recorded = recorded[i];
+            }
+
+            if (i < replayed.size())
+            {
+                divergence.replayed = replayed[i];
+            }
+
+            result.divergences.push_back(divergence);
+        }
+    }
+
+    MappedFile m_file;
+};
+
+TraceReplayer::TraceReplayer(const std::filesystem::path& path)
+    : m_impl(std::make_unique<Impl>(path))
+{}
+
+TraceReplayer::~TraceReplayer() = default;
+
+TraceReplayResult TraceReplayer::Run() const
+{
+    return m_impl->Run();
+}
+
+}
@@ -0,0 +1,237 @@
+#include "zip_archive.h"
+
+#include <WDL/zlib/zlib.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace tnt {
+
+// End of central directory record
+static constexpr std::uint32_t END_OF_DIRECTORY_SIGNATURE = 0x06054B50;
+static constexpr std::size_t END_OF_DIRECTORY_SIZE = 22;
+static constexpr std::size_t END_OF_DIRECTORY_ENTRY_COUNT_OFFSET = 10;
+static constexpr std::size_t END_OF_DIRECTORY_SIZE_OFFSET = 12;
+static constexpr std::size_t END_OF_DIRECTORY_OFFSET_OFFSET = 16;
+static constexpr std::size_t MAX_COMMENT_SIZE = 0xFFFF;
+
+// Central directory file header
+static constexpr std::uint32_t DIRECTORY_ENTRY_SIGNATURE = 0x02014B50;
+static constexpr std::size_t DIRECTORY_ENTRY_SIZE = 46;
+static constexpr std::size_t DIRECTORY_ENTRY_FLAGS_OFFSET = 8;
+static constexpr std::size_t DIRECTORY_ENTRY_METHOD_OFFSET = 10;
+static constexpr std::size_t DIRECTORY_ENTRY_COMPRESSED_SIZE_OFFSET = 20;
+static constexpr std::size_t DIRECTORY_ENTRY_NAME_SIZE_OFFSET = 28;
+static constexpr std::size_t DIRECTORY_ENTRY_EXTRA_SIZE_OFFSET = 30;
+static constexpr std::size_t DIRECTORY_ENTRY_COMMENT_SIZE_OFFSET = 32;
+static constexpr std::size_t DIRECTORY_ENTRY_LOCAL_HEADER_OFFSET = 42;
+
+// Local file header
+static constexpr std::uint32_t LOCAL_HEADER_SIGNATURE = 0x04034B50;
+static constexpr std::size_t LOCAL_HEADER_SIZE = 30;
+static constexpr std::size_t LOCAL_HEADER_NAME_SIZE_OFFSET = 26;
+static constexpr std::size_t LOCAL_HEADER_EXTRA_SIZE_OFFSET = 28;
+
+static constexpr std::uint16_t METHOD_STORED = 0;
+static constexpr std::uint16_t METHOD_DEFLATED = 8;
+static constexpr std::uint16_t FLAG_ENCRYPTED = 0x0001;
+
+// Uncompressed bytes handed to the consumer at once
+static constexpr std::size_t CHUNK_SIZE = 64 * 1024;
+
+template <typename T>
+static T ReadValue(std::span<const std::byte> data, const std::size_t offset)
+{
+    T value = 0;
+    std::memcpy(&value, data.data() + offset, sizeof(value));
+    return value;
+}
+
+// Frees the inflate state however the entry is left
+struct InflateStream final
+{
+    ~InflateStream()
+    {
+        if (initialized)
+        {
+            inflateEnd(&stream);
+        }
+    }
+
+    z_stream stream = {};
+    bool initialized = false;
+};
+
+ZipArchive::ZipArchive(const std::filesystem::path& path)
+    : m_path(path)
+    , m_file(path, "zip archive")
+{
+    const std::span<const std::byte> data = m_file.GetData();
+    if (data.size() < END_OF_DIRECTORY_SIZE)
+    {
+        throw std::runtime_error(std::format("'{}' is not a zip archive.\n", m_path.string()));
+    }
+
+    // The record is at the very end, only followed by an optional comment
+    const std::size_t search_end = data.size() - END_OF_DIRECTORY_SIZE;
+    const std::size_t search_start = search_end > MAX_COMMENT_SIZE ? search_end - MAX_COMMENT_SIZE : 0;
+    for (std::size_t offset = search_end + 1; offset-- > search_start;)
+    {
+        if (ReadValue<std::uint32_t>(data, offset) != END_OF_DIRECTORY_SIGNATURE)
+        {
+            continue;
+        }
+
+        m_entry_count = ReadValue<std::uint16_t>(data, offset + END_OF_DIRECTORY_ENTRY_COUNT_OFFSET);
+        m_directory_size = ReadValue<std::uint32_t>(data, offset + END_OF_DIRECTORY_SIZE_OFFSET);
+        m_directory_offset = ReadValue<std::uint32_t>(data, offset + END_OF_DIRECTORY_OFFSET_OFFSET);
+
+        if (m_directory_offset > offset || m_directory_size > offset - m_directory_offset)
+        {
+            break;
+        }
+
+        return;
+    }
+
+    throw std::runtime_error(std::format("'{}' is not a zip archive.\n", m_path.string()));
+}
+
+bool ZipArchive::Contains(const std::string_view name) const
+{
+    Entry entry;
+    return this->FindEntry(name, entry);
+}
+
+void ZipArchive::ReadEntry(const std::string_view name, const std::function<void(std::string_view chunk)>& consumer) const
+{
+    Entry entry;
+    if (!this->FindEntry(name, entry))
+    {
+        throw std::runtime_error(std::format("'{}' has no entry '{}'.\n", m_path.string(), name));
+    }
+
+    const std::span<const std::byte> data = m_file.GetData();
+
+    const std::size_t header = entry.local_header_offset;
+    if (header > data.size() - std::min(data.size(), LOCAL_HEADER_SIZE) || ReadValue<std::uint32_t>(data, header) != LOCAL_HEADER_SIGNATURE)
+    {
+        throw std::runtime_error(std::format("Entry '{}' of '{}' is corrupt.\n", name, m_path.string()));
+    }
+
+    // The local header may carry different extra fields than the central directory
+    const std::size_t start = header + LOCAL_HEADER_SIZE
+                            + ReadValue<std::uint16_t>(data, header + LOCAL_HEADER_NAME_SIZE_OFFSET)
+                            + ReadValue<std::uint16_t>(data, header + LOCAL_HEADER_EXTRA_SIZE_OFFSET);
+    if (start > data.size() || entry.compressed_size > data.size() - start)
+    {
+        throw std::runtime_error(std::format("Entry '{}' of '{}' is corrupt.\n", name, m_path.string()));
+    }
+
+    const char* compressed = reinterpret_cast<const char*>(data.data() + start);
+
+    if (entry.method == METHOD_STORED)
+    {
+        for (std::size_t offset = 0; offset < entry.compressed_size; offset += CHUNK_SIZE)
+        {
+            consumer(std::string_view(compressed + offset, std::min<std::size_t>(CHUNK_SIZE, entry.compressed_size - offset)));
+        }
+
+        return;
+    }
+
+    InflateStream inflate_stream;
+    z_stream& stream = inflate_stream.stream;
+
+    // Zip entries are raw deflate streams without a zlib header
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+    {
+        throw std::runtime_error(std::format("Failed to inflate entry '{}' of '{}'.\n", name, m_path.string()));
+    }
+
+    inflate_stream.initialized = true;
+
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed));
+    stream.avail_in = entry.compressed_size;
+
+    std::vector<char> chunk(CHUNK_SIZE);
+    int result = Z_OK;
+    while (result != Z_STREAM_END)
+    {
+        stream.next_out = reinterpret_cast<Bytef*>(chunk.data());
+        stream.avail_out = static_cast<uInt>(chunk.size());
+
+        result = inflate(&stream, Z_NO_FLUSH);
+        if (result != Z_OK && result != Z_STREAM_END)
+        {
+            throw std::runtime_error(std::format("Entry '{}' of '{}' is corrupt.\n", name, m_path.string()));
+        }
+
+        const std::size_t size = chunk.size() - stream.avail_out;
+
+        // Running out of input before the end of the stream would loop forever
+        if (result == Z_OK && size == 0 && stream.avail_in == 0)
+        {
+            throw std::runtime_error(std::format("Entry '{}' of '{}' is truncated.\n", name, m_path.string()));
+        }
+
+        if (size > 0)
+        {
+            consumer(std::string_view(chunk.data(), size));
+        }
+    }
+}
+
+bool ZipArchive::FindEntry(const std::string_view name, Entry& entry) const
+{
+    const std::span<const std::byte> directory = m_file.GetData().subspan(m_directory_offset, m_directory_size);
+
+    std::size_t offset = 0;
+    for (std::size_t i = 0; i < m_entry_count; i++)
+    {
+        if (directory.size() - offset < DIRECTORY_ENTRY_SIZE || ReadValue<std::uint32_t>(directory, offset) != DIRECTORY_ENTRY_SIGNATURE)
+        {
+            throw std::runtime_error(std::format("The central directory of '{}' is corrupt.\n", m_path.string()));
+        }
+
+        const std::size_t name_size = ReadValue<std::uint16_t>(directory, offset + DIRECTORY_ENTRY_NAME_SIZE_OFFSET);
+        const std::size_t extra_size = ReadValue<std::uint16_t>(directory, offset + DIRECTORY_ENTRY_EXTRA_SIZE_OFFSET);
+        const std::size_t comment_size = ReadValue<std::uint16_t>(directory, offset + DIRECTORY_ENTRY_COMMENT_SIZE_OFFSET);
+        if (directory.size() - offset - DIRECTORY_ENTRY_SIZE < name_size)
+        {
+            throw std::runtime_error(std::format("The central directory of '{}' is corrupt.\n", m_path.string()));
+        }
+
+        const std::string_view entry_name(reinterpret_cast<const char*>(directory.data() + offset + DIRECTORY_ENTRY_SIZE), name_size);
+        if (entry_name == name)
+        {
+            const std::uint16_t flags = ReadValue<std::uint16_t>(directory, offset + DIRECTORY_ENTRY_FLAGS_OFFSET);
+            entry.method = ReadValue<std::uint16_t>(directory, offset + DIRECTORY_ENTRY_METHOD_OFFSET);
+            entry.compressed_size = ReadValue<std::uint32_t>(directory, offset + DIRECTORY_ENTRY_COMPRESSED_SIZE_OFFSET);
+            entry.local_header_offset = ReadValue<std::uint32_t>(directory, offset + DIRECTORY_ENTRY_LOCAL_HEADER_OFFSET);
+
+            if ((flags & FLAG_ENCRYPTED) || (entry.method != METHOD_STORED && entry.method != METHOD_DEFLATED))
+            {
+                throw std::runtime_error(std::format("Entry '{}' of '{}' uses an unsupported compression method.\n", name, m_path.string()));
+            }
+
+            return true;
+        }
+
+        offset += DIRECTORY_ENTRY_SIZE + name_size + extra_size + comment_size;
+        if (offset > directory.size())
+        {
+            throw std::runtime_error(std::format("The central directory of '{}' is corrupt.\n", m_path.string()));
+        }
+    }
+
+    return false;
+}
+
+}
@@ -0,0 +1,112 @@
+#include "test.h"
+#include "test_zip.h"
+
+#include "guitar_pro_score.h"
+
+#include <format>
+#include <string>
+
+using namespace tnt;
+using namespace tnt::test;
+
+static std::string MakeGpif(const std::string& automations, const std::string& master_bars)
+{
+    return std::format("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                       "<GPIF version=\"7\">\n"
+                       "<MasterTrack><Automations>{}</Automations></MasterTrack>\n"
+                       "<MasterBars>{}</MasterBars>\n"
+                       "</GPIF>\n",
+        automations, master_bars);
+}
+
+static std::string MakeTempoAutomation(const int bar, const std::string& value)
+{
+    return std::format("<Automation><Type>Tempo</Type><Linear>false</Linear><Bar>{}</Bar><Position>0</Position><Visible>true</Visible><Value>{}</Value></Automation>", bar, value);
+}
+
+static GuitarProScore ReadScore(const std::string& gpif)
+{
+    const TemporaryFile file("tnt_test_score.gp");
+    WriteTestGuitarProFile(file.GetPath(), gpif);
+    return ReadGuitarProScore(file.GetPath());
+}
+
+TNT_TEST_CASE(guitar_pro_score_self_closing_master_bar)
+{
+    const GuitarProScore score = ReadScore(MakeGpif(MakeTempoAutomation(0, "120 2"),
+        "<MasterBar><Time>3/4</Time></MasterBar><MasterBar/><MasterBar><Time>6/8</Time></MasterBar>"));
+
+    // A bar without a time signature keeps the previous one
+    TNT_CHECK(score.bars.size() == 3);
+    TNT_CHECK(score.bars[0] == (TimeSignature{ 3, 4 }));
+    TNT_CHECK(score.bars[1] == (TimeSignature{ 3, 4 }));
+    TNT_CHECK(score.bars[2] == (TimeSignature{ 6, 8 }));
+    TNT_CHECK(score.playback_jumps.empty());
+}
+
+TNT_TEST_CASE(guitar_pro_score_tempo_units)
+{
+    // Eighths, dotted quarters and the quarter default are all converted to quarter notes per minute
+    const GuitarProScore score = ReadScore(MakeGpif(MakeTempoAutomation(2, "100") + MakeTempoAutomation(0, "120 1") + MakeTempoAutomation(1, "60 3"),
+        "<MasterBar><Time>4/4</Time></MasterBar><MasterBar/><MasterBar/>"));
+
+    TNT_CHECK(score.tempos.size() == 3);
+    TNT_CHECK(score.tempos[0].bar == 0);
+    TNT_CHECK_NEAR(score.tempos[0].bpm, 60.0, 1e-9);
+    TNT_CHECK_NEAR(score.tempos[1].bpm, 90.0, 1e-9);
+    TNT_CHECK_NEAR(score.tempos[2].bpm, 100.0, 1e-9);
+
+    const std::vector<TempoMarker> markers = score.GetTempoMarkers();
+    TNT_CHECK(markers.size() == 3);
+    TNT_CHECK_NEAR(markers[1].time, 4.0, 1e-9);
+
+    TNT_CHECK_THROWS(ReadScore(MakeGpif(MakeTempoAutomation(0, "120 6"), "<MasterBar/>")));
+}
+
+TNT_TEST_CASE(guitar_pro_score_playback_jumps)
+{
+    const GuitarProScore score = ReadScore(MakeGpif(MakeTempoAutomation(0, "120 2"),
+        "<MasterBar><Time>4/4</Time><Repeat start=\"false\" end=\"false\" count=\"0\"/></MasterBar>"
+        "<MasterBar><Repeat start=\"true\" end=\"false\" count=\"0\"/></MasterBar>"
+        "<MasterBar><AlternateEndings>1</AlternateEndings><Repeat start=\"false\" end=\"true\" count=\"2\"/></MasterBar>"
+        "<MasterBar><AlternateEndings></AlternateEndings></MasterBar>"
+        "<MasterBar><Directions><Jump>DaCapoAlFine</Jump></Directions></MasterBar>"));
+
+    TNT_CHECK(score.bars.size() == 5);
+    TNT_CHECK(score.playback_jumps.size() == 4);
+    TNT_CHECK(score.playback_jumps[0].bar == 1 && score.playback_jumps[0].type == GuitarProPlaybackJump::Type::REPEAT);
+    TNT_CHECK(score.playback_jumps[1].bar == 2 && score.playback_jumps[1].type == GuitarProPlaybackJump::Type::ALTERNATE_ENDING);
+    TNT_CHECK(score.playback_jumps[2].bar == 2 && score.playback_jumps[2].type == GuitarProPlaybackJump::Type::REPEAT);
+    TNT_CHECK(score.playback_jumps[3].bar == 4 && score.playback_jumps[3].type == GuitarProPlaybackJump::Type::DIRECTION);
+    TNT_CHECK(ToString(score.playback_jumps[0]) == "Bar 2 has a repeat sign");
+}
+
+TNT_TEST_CASE(guitar_pro_score_spans_inflate_chunks)
+{
+    // Large enough that tags and text are split across the chunks handed to the parser
+    std::string master_bars = "<MasterBar><Time>4/4</Time></MasterBar>";
+    for (int i = 1; i < 5000; i++)
+    {
+        master_bars += std::format("<MasterBar><Time>{}/4</Time><!-- bar {} --></MasterBar>\n", 3 + i % 2, i);
+    }
+
+    const GuitarProScore score = ReadScore(MakeGpif(MakeTempoAutomation(4999, "90 2") + MakeTempoAutomation(0, "120 2"), master_bars));
+    TNT_CHECK(score.bars.size() == 5000);
+    TNT_CHECK(score.bars[4998] == (TimeSignature{ 3, 4 }));
+    TNT_CHECK(score.bars[4999] == (TimeSignature{ 4, 4 }));
+    TNT_CHECK(score.tempos.size() == 2);
+    TNT_CHECK(score.tempos[1].bar == 4999);
+}
+
+TNT_TEST_CASE(guitar_pro_score_rejects_broken_scores)
+{
+    const std::string gpif = MakeGpif(MakeTempoAutomation(0, "120 2"), "<MasterBar><Time>4/4</Time></MasterBar>");
+    TNT_CHECK_THROWS(ReadScore(gpif.substr(0, gpif.size() / 2)));
+    TNT_CHECK_THROWS(ReadScore(MakeGpif("", "")));
+    TNT_CHECK_THROWS(ReadScore(MakeGpif("", "<MasterBar><Time>4-4</Time></MasterBar>")));
+
+    // A zip without a score isn't a .gp file
+    const TemporaryFile file("tnt_test_other.zip");
+    WriteTestZip(file.GetPath(), { { "Content/other.xml", gpif } });
+    TNT_CHECK_THROWS(ReadGuitarProScore(file.GetPath()));
+}
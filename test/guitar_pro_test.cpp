@@ -0,0 +1,84 @@
+#include "test.h"
+
+#include "guitar_pro.h"
+#include "guitar_pro_events.h"
+#include "synthetic_guitar_pro.h"
+
+#include <chrono>
+
+using namespace tnt;
+
+TNT_TEST_CASE(guitar_pro_events_use_read_timestamps)
+{
+    SyntheticGuitarPro synthetic_guitar_pro;
+    synthetic_guitar_pro.SetPlayRate(2.0);
+    synthetic_guitar_pro.SetPlayState(true);
+
+    GuitarPro guitar_pro(synthetic_guitar_pro.GetMemorySourceFactory());
+
+    // Reads 100 ms apart on a made up clock, each one 0.2 s further at twice the speed
+    auto time = std::chrono::steady_clock::time_point() + std::chrono::hours(1);
+    double position = 10.0;
+    for (int i = 0; i < 20; i++)
+    {
+        synthetic_guitar_pro.SetPlayPosition(position);
+        const GuitarProState state = guitar_pro.ReadProcessMemory(time);
+        TNT_CHECK(state.timestamp == time);
+
+        if (i > 0)
+        {
+            TNT_CHECK(guitar_pro.GetEvents().Has(GuitarProEventType::CURSOR_MOVED));
+            TNT_CHECK(!guitar_pro.GetEvents().Has(GuitarProEventType::CURSOR_JUMPED));
+        }
+
+        time += std::chrono::milliseconds(100);
+        position += 0.2;
+    }
+
+    // A click elsewhere in the score is still a jump
+    synthetic_guitar_pro.SetPlayPosition(50.0);
+    guitar_pro.ReadProcessMemory(time);
+    TNT_CHECK(guitar_pro.GetEvents().Has(GuitarProEventType::CURSOR_JUMPED));
+    TNT_CHECK(guitar_pro.GetEvents().GetTimestamp(GuitarProEventType::CURSOR_JUMPED) == time);
+}
+
+TNT_TEST_CASE(guitar_pro_follows_reallocated_branch)
+{
+    SyntheticGuitarPro synthetic_guitar_pro;
+    GuitarPro guitar_pro(synthetic_guitar_pro.GetMemorySourceFactory());
+    TNT_CHECK(!guitar_pro.ReadProcessMemory().count_in_state);
+
+    // Only the objects below the document prefix move, the old ones keep the old value
+    synthetic_guitar_pro.ReplaceBranch("count_in_state");
+    synthetic_guitar_pro.SetCountInState(true);
+
+    // Every cached hop is re-checked within a few reads
+    bool count_in_state = false;
+    for (int i = 0; i < 16 && !count_in_state; i++)
+    {
+        count_in_state = guitar_pro.ReadProcessMemory().count_in_state;
+    }
+
+    TNT_CHECK(count_in_state);
+    TNT_CHECK(guitar_pro.ReadProcessMemory().count_in_state);
+}
+
+TNT_TEST_CASE(guitar_pro_follows_replaced_document)
+{
+    SyntheticGuitarPro synthetic_guitar_pro;
+    synthetic_guitar_pro.SetPlayPosition(5.0);
+
+    GuitarPro guitar_pro(synthetic_guitar_pro.GetMemorySourceFactory());
+    TNT_CHECK_NEAR(guitar_pro.ReadProcessMemory().play_position, 5.0, 1e-4);
+
+    // Opening another score moves every object, the old document still reads 5 s
+    synthetic_guitar_pro.ReplaceDocument();
+    synthetic_guitar_pro.SetPlayPosition(20.0);
+    synthetic_guitar_pro.SetLoopState(true);
+
+    // Caught by the document prefix check on the very next read
+    const GuitarProState state = guitar_pro.ReadProcessMemory();
+    TNT_CHECK_NEAR(state.play_position, 20.0, 1e-4);
+    TNT_CHECK(state.loop_state);
+    TNT_CHECK(guitar_pro.GetEvents().Has(GuitarProEventType::CURSOR_JUMPED));
+}
@@ -0,0 +1,51 @@
+#include "test.h"
+
+#include "latency_calibration.h"
+
+#include <optional>
+
+using namespace tnt;
+
+TNT_TEST_CASE(latency_table_round_trips)
+{
+    LatencyTable table;
+    TNT_CHECK(table.empty());
+    TNT_CHECK_NEAR(table.GetLatency(1.0, 0.0), DEFAULT_SEEK_LATENCY, 1e-9);
+
+    table.SetOutputLatency(0.0107);
+    table.Set(1.0, 0.0583);
+    table.Set(0.5, 0.0612);
+    table.Set(2.0, 0.05);
+    table.Set(2.0, 0.0401);
+
+    const std::optional<LatencyTable> parsed = LatencyTable::Parse(table.Serialize());
+    TNT_CHECK(parsed);
+    TNT_CHECK(parsed->Serialize() == table.Serialize());
+    TNT_CHECK(parsed->Serialize() == "output_latency=0.0107;0.5=0.0612;1=0.0583;2=0.0401");
+    TNT_CHECK_NEAR(parsed->GetOutputLatency(), 0.0107, 1e-9);
+}
+
+TNT_TEST_CASE(latency_table_interpolates_between_rates)
+{
+    const std::optional<LatencyTable> table = LatencyTable::Parse("output_latency=0.01;0.5=0.06;1=0.04");
+    TNT_CHECK(table);
+
+    // Clamped outside the calibrated rates, linear in between
+    TNT_CHECK_NEAR(table->GetLatency(0.25, 0.01), 0.06, 1e-9);
+    TNT_CHECK_NEAR(table->GetLatency(0.75, 0.01), 0.05, 1e-9);
+    TNT_CHECK_NEAR(table->GetLatency(2.0, 0.01), 0.04, 1e-9);
+
+    // Follows changes of the output latency since calibrating
+    TNT_CHECK_NEAR(table->GetLatency(1.0, 0.03), 0.06, 1e-9);
+}
+
+TNT_TEST_CASE(latency_table_rejects_malformed_text)
+{
+    TNT_CHECK(LatencyTable::Parse(""));
+    TNT_CHECK(!LatencyTable::Parse("output_latency"));
+    TNT_CHECK(!LatencyTable::Parse("output_latency=fast"));
+    TNT_CHECK(!LatencyTable::Parse("output_latency=0.01;;1=0.04"));
+    TNT_CHECK(!LatencyTable::Parse("0=0.04"));
+    TNT_CHECK(!LatencyTable::Parse("-1=0.04"));
+    TNT_CHECK(!LatencyTable::Parse("1=0.04 "));
+}
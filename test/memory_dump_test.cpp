@@ -0,0 +1,95 @@
+#include "test.h"
+#include "test_zip.h"
+
+#include "guitar_pro.h"
+#include "memory_dump.h"
+#include "synthetic_guitar_pro.h"
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+
+using namespace tnt;
+using namespace tnt::test;
+
+static GuitarProState GetTestState()
+{
+    GuitarProState state;
+    state.play_position = 12.5;
+    state.time_selection_start_position = 4.0;
+    state.time_selection_end_position = 8.0;
+    state.play_rate = 0.75;
+    state.play_state = true;
+    state.loop_state = true;
+    return state;
+}
+
+static void CheckTestState(const GuitarProState& state)
+{
+    const GuitarProState expected = GetTestState();
+    TNT_CHECK_NEAR(state.play_position, expected.play_position, 1e-4);
+    TNT_CHECK_NEAR(state.time_selection_start_position, expected.time_selection_start_position, 1e-4);
+    TNT_CHECK_NEAR(state.time_selection_end_position, expected.time_selection_end_position, 1e-4);
+    TNT_CHECK_NEAR(state.play_rate, expected.play_rate, 1e-6);
+    TNT_CHECK(state.play_state == expected.play_state);
+    TNT_CHECK(state.count_in_state == expected.count_in_state);
+    TNT_CHECK(state.loop_state == expected.loop_state);
+}
+
+// Reads the dump a few times so every cached hop is checked against it as well
+static void CheckDump(const std::filesystem::path& path)
+{
+    GuitarPro guitar_pro([&] { return std::make_unique<MemoryDump>(path); });
+    for (int i = 0; i < 16; i++)
+    {
+        CheckTestState(guitar_pro.ReadProcessMemory());
+    }
+}
+
+TNT_TEST_CASE(memory_dump_round_trips_synthetic_image)
+{
+    SyntheticGuitarPro synthetic_guitar_pro;
+    synthetic_guitar_pro.SetState(GetTestState());
+
+    TemporaryFile file("tnt_memory_dump_test.bin");
+    synthetic_guitar_pro.SaveMemoryDump(file.GetPath());
+    CheckDump(file.GetPath());
+
+    MemoryDump dump(file.GetPath());
+    TNT_CHECK(dump.GetProcessVersion() == L"8.1.4.43");
+    TNT_CHECK(dump.IsProcessRunning());
+
+    // Only the captured ranges can be read
+    std::uint64_t value = 0;
+    TNT_CHECK(dump.Read(dump.GetModuleBaseAddress(), &value, sizeof(value)));
+    TNT_CHECK(!dump.Read(0x1000, &value, sizeof(value)));
+    TNT_CHECK(!dump.GetPointer(0x1000, sizeof(value)));
+}
+
+TNT_TEST_CASE(memory_dump_captures_what_reads_touch)
+{
+    SyntheticGuitarPro synthetic_guitar_pro;
+    synthetic_guitar_pro.SetState(GetTestState());
+
+    TemporaryFile full_file("tnt_memory_dump_full_test.bin");
+    TemporaryFile captured_file("tnt_memory_dump_captured_test.bin");
+    synthetic_guitar_pro.SaveMemoryDump(full_file.GetPath());
+
+    GuitarPro guitar_pro(synthetic_guitar_pro.GetMemorySourceFactory());
+    guitar_pro.CaptureMemoryDump(captured_file.GetPath());
+    CheckDump(captured_file.GetPath());
+
+    // Only the bytes the reads touched are kept, not the whole image
+    TNT_CHECK(std::filesystem::file_size(captured_file.GetPath()) < std::filesystem::file_size(full_file.GetPath()) / 16);
+}
+
+TNT_TEST_CASE(memory_dump_rejects_invalid_files)
+{
+    TemporaryFile file("tnt_memory_dump_invalid_test.bin");
+    std::ofstream(file.GetPath(), std::ios::binary) << "TNTGPMEM";
+    TNT_CHECK_THROWS(MemoryDump(file.GetPath()));
+
+    std::ofstream(file.GetPath(), std::ios::binary) << "Not a memory dump at all, just some text.";
+    TNT_CHECK_THROWS(MemoryDump(file.GetPath()));
+}
@@ -0,0 +1,83 @@
+#include "test.h"
+#include "test_offset_database.h"
+#include "test_zip.h"
+
+#include "guitar_pro_layout.h"
+#include "offset_database.h"
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+using namespace tnt;
+using namespace tnt::test;
+
+static void WriteDatabase(const TemporaryFile& file, const std::string& text)
+{
+    std::ofstream(file.GetPath(), std::ios::binary) << text;
+}
+
+TNT_TEST_CASE(offset_database_adds_and_overrides_layouts)
+{
+    TemporaryFile file("tnt_offset_database_test.txt");
+    WriteDatabase(file, "# Hand-written layouts\n\n" + FormatOffsetDatabaseEntry("9.0.0.1", 0x00B00000) + FormatOffsetDatabaseEntry("8.1.4.43", 0x00C00000) + FormatOffsetDatabaseEntry("9.0.0.2", 0x00D00000, 0x1234ABCD));
+
+    OffsetDatabase database;
+    TNT_CHECK(!database.Find(L"9.0.0.1", 0));
+    TNT_CHECK(database.Find(L"8.1.4.43", 0)->module_offset == 0x00A26F80);
+
+    database.SetPath(file.GetPath());
+    database.Refresh();
+
+    const auto added = database.Find(L"9.0.0.1", 0);
+    TNT_CHECK(added && added->module_offset == 0x00B00000);
+    TNT_CHECK(IsValidGuitarProLayout(*added) && MatchesGuitarProFields(*added));
+    TNT_CHECK(database.Find(L"8.1.4.43", 0)->module_offset == 0x00C00000);
+    TNT_CHECK(database.Find(L"8.1.3.121", 0)->module_offset == 0x00A24F80);
+
+    // The module hash wins over the version string
+    TNT_CHECK(database.Find(L"9.0.0.1", 0x1234ABCD)->module_offset == 0x00D00000);
+    TNT_CHECK(database.Find(L"9.0.0.1", 0x5678)->module_offset == 0x00B00000);
+}
+
+TNT_TEST_CASE(offset_database_reload_keeps_entries_of_broken_files)
+{
+    TemporaryFile file("tnt_offset_database_reload_test.txt");
+    WriteDatabase(file, FormatOffsetDatabaseEntry("9.0.0.1", 0x00B00000));
+
+    OffsetDatabase database;
+    database.SetPath(file.GetPath());
+    database.Refresh();
+    const auto previous = database.Find(L"9.0.0.1", 0);
+
+    WriteDatabase(file, FormatOffsetDatabaseEntry("9.0.0.1", 0x00B10000));
+    database.Reload();
+    TNT_CHECK(database.Find(L"9.0.0.1", 0)->module_offset == 0x00B10000);
+
+    // Layouts handed out before the reload stay valid
+    TNT_CHECK(previous->module_offset == 0x00B00000);
+    TNT_CHECK(std::wstring(previous->version) == L"9.0.0.1");
+
+    // Each of these fails to parse and leaves the last good entries in place
+    const std::string broken_files[] = {
+        "module_offset 0x1000\n",
+        FormatOffsetDatabaseEntry("9.0.0.1", 0x00B20000) + "unknown_key 1\n",
+        FormatOffsetDatabaseEntry("9.0.0.1", 0x00B20000) + "version 9.0.0.3\nmodule_offset 0x1000\n",
+        FormatOffsetDatabaseEntry("9.0.0.1", 0x00B20000) + "module_offset nope\n",
+        "version 9.0.0.1\nroot_signature 3 7 48 8B 0\n",
+    };
+
+    for (const std::string& text : broken_files)
+    {
+        WriteDatabase(file, text);
+        TNT_CHECK_THROWS(database.Reload());
+        TNT_CHECK(database.Find(L"9.0.0.1", 0)->module_offset == 0x00B10000);
+    }
+
+    // Without the file only the built-in layouts are left
+    std::filesystem::remove(file.GetPath());
+    database.Reload();
+    TNT_CHECK(!database.Find(L"9.0.0.1", 0));
+    TNT_CHECK(database.Find(L"8.1.4.43", 0));
+}
@@ -0,0 +1,287 @@
+#include "test.h"
+#include "test_zip.h"
+
+#include "latency_calibration.h"
+#include "plugin.h"
+#include "reaper.h"
+#include "simulated_reaper.h"
+#include "synthetic_guitar_pro.h"
+
+#include <chrono>
+#include <format>
+#include <string_view>
+
+using namespace tnt;
+using namespace tnt::test;
+
+namespace {
+
+// Same rate REAPER calls the plugin's timer at by default
+static constexpr double DEFAULT_TICK_INTERVAL = 1.0 / 30.0; // Seconds
+
+// Close enough that REAPER is heard in sync, well under the plugin's desync threshold
+static constexpr double SYNC_TOLERANCE = 0.1; // Seconds
+
+// Guitar Pro and REAPER both driven by hand, one MainLoop per tick
+struct SimulatedSession final
+{
+    SyntheticGuitarPro guitar_pro;
+    SimulatedReaper reaper;
+    PluginState plugin_state;
+    Plugin plugin;
+
+    double guitar_pro_position = 0.0;
+    double guitar_pro_play_rate = 1.0;
+    bool guitar_pro_playing = false;
+
+    // Seconds between two MainLoop calls
+    double tick_interval = DEFAULT_TICK_INTERVAL;
+
+    SimulatedSession()
+        : plugin(plugin_state, guitar_pro.GetMemorySourceFactory(), reaper.CreateBackend())
+    {
+        guitar_pro.SetPlayRate(1.0);
+
+        // What the plugin assumes until a calibration measured better
+        reaper.SetSeekLatency(DEFAULT_SEEK_LATENCY);
+    }
+
+    void SetGuitarProPosition(const double position)
+    {
+        guitar_pro_position = position;
+        guitar_pro.SetPlayPosition(position);
+    }
+
+    void SetGuitarProPlayRate(const double play_rate)
+    {
+        guitar_pro_play_rate = play_rate;
+        guitar_pro.SetPlayRate(play_rate);
+    }
+
+    void SetGuitarProPlaying(const bool playing)
+    {
+        guitar_pro_playing = playing;
+        guitar_pro.SetPlayState(playing);
+    }
+
+    // Both applications move on by one tick, then the plugin syncs them
+    void Tick(const int count = 1)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            if (guitar_pro_playing)
+            {
+                this->SetGuitarProPosition(guitar_pro_position + tick_interval * guitar_pro_play_rate);
+            }
+
+            reaper.Advance(std::chrono::duration_cast<SimulatedReaper::Clock::duration>(std::chrono::duration<double>(tick_interval)));
+            plugin.MainLoop();
+        }
+    }
+};
+
+}
+
+TNT_TEST_CASE(play_start_seeks_and_plays)
+{
+    SimulatedSession session;
+    session.SetGuitarProPosition(10.0);
+    session.Tick(5);
+    TNT_CHECK(session.reaper.GetState().play_state == ReaperPlayState::STOPPED);
+
+    session.SetGuitarProPlaying(true);
+    session.Tick(30);
+
+    TNT_CHECK(session.reaper.GetState().play_state == ReaperPlayState::PLAYING);
+    TNT_CHECK(session.reaper.GetCounters().seeks >= 1);
+    TNT_CHECK_NEAR(session.reaper.GetPlayPosition(), session.guitar_pro_position, SYNC_TOLERANCE);
+}
+
+TNT_TEST_CASE(desync_is_corrected)
+{
+    SimulatedSession session;
+    session.SetGuitarProPosition(10.0);
+    session.SetGuitarProPlaying(true);
+    session.Tick(30);
+    TNT_CHECK_NEAR(session.reaper.GetPlayPosition(), session.guitar_pro_position, SYNC_TOLERANCE);
+
+    // The user seeks REAPER away while both play
+    session.reaper.ResetCounters();
+    session.reaper.SetEditCursorPosition(100.0, true);
+    session.Tick(30);
+
+    TNT_CHECK(session.reaper.GetCounters().seeks >= 1);
+    TNT_CHECK(session.reaper.GetState().play_state == ReaperPlayState::PLAYING);
+    TNT_CHECK_NEAR(session.reaper.GetPlayPosition(), session.guitar_pro_position, SYNC_TOLERANCE);
+}
+
+TNT_TEST_CASE(play_rate_change_resumes_in_same_tick)
+{
+    SimulatedSession session;
+    session.SetGuitarProPosition(10.0);
+    session.SetGuitarProPlaying(true);
+    session.Tick(30);
+
+    // REAPER is paused for the stretch, then seeks and resumes within the same flush
+    session.reaper.ResetCounters();
+    session.SetGuitarProPlayRate(0.5);
+    session.Tick();
+
+    TNT_CHECK(session.reaper.GetCounters().play_rate_changes == 1);
+    TNT_CHECK(session.reaper.GetCounters().play_state_changes == 2);
+    TNT_CHECK(session.reaper.GetCounters().seeks == 1);
+    TNT_CHECK(session.reaper.GetState().play_state == ReaperPlayState::PLAYING);
+    TNT_CHECK_NEAR(session.reaper.GetState().play_rate, 0.5, 1e-9);
+
+    session.Tick(30);
+    TNT_CHECK(session.reaper.GetCounters().seeks == 1);
+    TNT_CHECK_NEAR(session.reaper.GetPlayPosition(), session.guitar_pro_position, SYNC_TOLERANCE);
+}
+
+TNT_TEST_CASE(fast_playback_with_long_ticks_stays_in_sync)
+{
+    // Guitar Pro moves 0.2 s per tick, which is only a jump if the time between reads is ignored
+    SimulatedSession session;
+    session.tick_interval = 0.1;
+    session.SetGuitarProPlayRate(2.0);
+    session.SetGuitarProPosition(10.0);
+    session.SetGuitarProPlaying(true);
+    session.Tick(10);
+    TNT_CHECK(session.reaper.GetState().play_state == ReaperPlayState::PLAYING);
+
+    session.reaper.ResetCounters();
+    session.Tick(50);
+
+    TNT_CHECK(session.reaper.GetCounters().seeks == 0);
+    TNT_CHECK(session.reaper.GetCounters().play_state_changes == 0);
+    TNT_CHECK_NEAR(session.reaper.GetState().play_rate, 2.0, 1e-9);
+    TNT_CHECK_NEAR(session.reaper.GetPlayPosition(), session.guitar_pro_position, SYNC_TOLERANCE);
+}
+
+TNT_TEST_CASE(guitar_pro_jump_is_followed)
+{
+    SimulatedSession session;
+    session.SetGuitarProPosition(10.0);
+    session.SetGuitarProPlaying(true);
+    session.Tick(30);
+
+    // The user clicks elsewhere in the score while it plays, no desync confirmation is needed
+    session.reaper.ResetCounters();
+    session.SetGuitarProPosition(50.0);
+    session.Tick(2);
+
+    TNT_CHECK(session.reaper.GetCounters().seeks == 1);
+    TNT_CHECK_NEAR(session.reaper.GetPlayPosition(), session.guitar_pro_position, SYNC_TOLERANCE);
+}
+
+TNT_TEST_CASE(play_stop_waits_for_time_selection_end)
+{
+    SimulatedSession session;
+    session.guitar_pro.SetTimeSelection(10.0, 20.0);
+    session.guitar_pro.SetLoopState(true);
+    session.SetGuitarProPosition(19.0);
+    session.SetGuitarProPlaying(true);
+    session.Tick(24);
+    TNT_CHECK(session.reaper.GetState().repeat);
+    TNT_CHECK(session.reaper.GetState().play_state == ReaperPlayState::PLAYING);
+
+    // Guitar Pro stops just before the end of the loop, REAPER plays up to it before stopping
+    session.SetGuitarProPlaying(false);
+    session.Tick(3);
+    TNT_CHECK(session.reaper.GetState().play_state == ReaperPlayState::PLAYING);
+
+    // The cached state still reports what Guitar Pro does, not what REAPER is kept doing
+    GuitarProState cached_state;
+    double age = 0.0;
+    TNT_CHECK(session.plugin.GetCachedGuitarProState(cached_state, age));
+    TNT_CHECK(!cached_state.play_state);
+    TNT_CHECK_NEAR(cached_state.play_position, session.guitar_pro_position, 1e-3);
+
+    session.Tick(12);
+    TNT_CHECK(session.reaper.GetState().play_state == ReaperPlayState::STOPPED);
+}
+
+TNT_TEST_CASE(count_in_stops_reaper)
+{
+    SimulatedSession session;
+    session.guitar_pro.SetTimeSelection(10.0, 20.0);
+    session.guitar_pro.SetLoopState(true);
+    session.SetGuitarProPosition(10.0);
+    session.Tick(5);
+
+    // Guitar Pro starts counting in at the loop start just as REAPER starts playing there
+    session.guitar_pro.SetCountInState(true);
+    session.guitar_pro.SetPlayState(true);
+
+    ReaperState reaper_state = session.reaper.GetState();
+    reaper_state.play_position = 10.0;
+    reaper_state.play_state = ReaperPlayState::PLAYING;
+    session.reaper.SetState(reaper_state);
+    session.reaper.ResetCounters();
+    session.plugin.MainLoop();
+
+    TNT_CHECK(session.reaper.GetState().play_state == ReaperPlayState::STOPPED);
+    TNT_CHECK(session.reaper.GetCounters().play_state_changes == 1);
+
+    // REAPER waits while the cursor holds still for the rest of the count in
+    session.Tick(10);
+    TNT_CHECK(session.reaper.GetState().play_state == ReaperPlayState::STOPPED);
+}
+
+TNT_TEST_CASE(flush_commands_drops_no_ops)
+{
+    SimulatedReaper simulated_reaper;
+
+    ReaperState state;
+    state.play_position = 5.0;
+    state.play_rate = 0.75;
+    state.play_state = ReaperPlayState::PLAYING;
+    state.repeat = true;
+    state.time_selection_start_position = 4.0;
+    state.time_selection_end_position = 8.0;
+    state.preserve_pitch = true;
+    simulated_reaper.SetState(state);
+
+    Reaper reaper(simulated_reaper.CreateBackend());
+    const ReaperState known_state = reaper.GetState();
+
+    reaper.QueuePreservePitch(known_state.preserve_pitch);
+    reaper.QueueRepeat(known_state.repeat);
+    reaper.QueueTimeSelection(known_state.time_selection_start_position, known_state.time_selection_end_position);
+    reaper.QueuePlayRate(known_state.play_rate);
+    reaper.QueuePlayState(known_state.play_state);
+    reaper.FlushCommands();
+
+    TNT_CHECK(simulated_reaper.GetCommands().empty());
+    TNT_CHECK(simulated_reaper.GetCounters().play_rate_changes == 0);
+    TNT_CHECK(simulated_reaper.GetCounters().play_state_changes == 0);
+    TNT_CHECK(simulated_reaper.GetCounters().repeat_changes == 0);
+    TNT_CHECK(simulated_reaper.GetCounters().time_selection_changes == 0);
+    TNT_CHECK(simulated_reaper.GetCounters().preserve_pitch_changes == 0);
+
+    // A real change still goes through
+    reaper.QueuePlayRate(1.0);
+    reaper.FlushCommands();
+    TNT_CHECK(simulated_reaper.GetCounters().play_rate_changes == 1);
+    TNT_CHECK_NEAR(simulated_reaper.GetState().play_rate, 1.0, 1e-9);
+}
+
+TNT_TEST_CASE(import_tempo_map_refuses_repeats)
+{
+    static constexpr std::string_view GPIF = "<GPIF><MasterTrack><Automations><Automation><Type>Tempo</Type><Bar>0</Bar><Position>0</Position><Value>90 2</Value></Automation></Automations></MasterTrack>"
+                                             "<MasterBars><MasterBar><Time>4/4</Time></MasterBar><MasterBar><Time>3/4</Time>{}</MasterBar></MasterBars></GPIF>";
+
+    SimulatedSession session;
+    const TemporaryFile file("tnt_test_import.gp");
+
+    WriteTestGuitarProFile(file.GetPath(), std::format(GPIF, "<Repeat start=\"false\" end=\"true\" count=\"2\"/>"));
+    session.plugin.ImportTempoMap(file.GetPath());
+    TNT_CHECK(session.reaper.GetCounters().tempo_marker_changes == 0);
+    TNT_CHECK(session.reaper.GetConsoleMessages().back().starts_with("Can't import"));
+
+    WriteTestGuitarProFile(file.GetPath(), std::format(GPIF, ""));
+    session.plugin.ImportTempoMap(file.GetPath());
+    TNT_CHECK(session.reaper.GetCounters().tempo_marker_changes > 0);
+    TNT_CHECK(session.reaper.GetTempoMarkers().size() == 2);
+    TNT_CHECK_NEAR(session.reaper.GetTempoMarkers()[1].time, 4.0 * 60.0 / 90.0, 1e-9);
+}
@@ -0,0 +1,65 @@
+#include "test.h"
+
+#include "position_estimator.h"
+
+#include <chrono>
+
+using namespace tnt;
+
+// Guitar Pro's cursor only moves every so often, so the samples step instead of following a line
+static constexpr double CURSOR_STEP = 0.02; // Seconds
+
+static double StepPosition(const double position)
+{
+    return static_cast<int>(position / CURSOR_STEP) * CURSOR_STEP;
+}
+
+TNT_TEST_CASE(position_estimator_follows_stepped_cursor)
+{
+    PositionEstimator estimator;
+    TNT_CHECK(!estimator.HasSamples());
+
+    const auto start = PositionEstimator::Clock::time_point() + std::chrono::hours(1);
+    const double play_rate = 1.5;
+
+    auto time = start;
+    for (int i = 0; i < 60; i++)
+    {
+        const double position = 10.0 + play_rate * std::chrono::duration<double>(time - start).count();
+        TNT_CHECK(!estimator.AddSample(time, StepPosition(position), play_rate));
+        time += std::chrono::milliseconds(33);
+    }
+
+    // Extrapolates past the last sample within the cursor step
+    const PositionEstimate estimate = estimator.Predict(time);
+    const double expected = 10.0 + play_rate * std::chrono::duration<double>(time - start).count();
+    TNT_CHECK(estimator.HasSamples());
+    TNT_CHECK_NEAR(estimate.position, expected, CURSOR_STEP);
+    TNT_CHECK(estimate.confidence > 0.5);
+}
+
+TNT_TEST_CASE(position_estimator_restarts_on_jumps)
+{
+    PositionEstimator estimator;
+    TNT_CHECK(estimator.Predict(PositionEstimator::Clock::now()).confidence == 0.0);
+
+    const auto start = PositionEstimator::Clock::time_point() + std::chrono::hours(1);
+    auto time = start;
+    for (int i = 0; i < 30; i++)
+    {
+        estimator.AddSample(time, 5.0 + i * 0.033, 1.0);
+        time += std::chrono::milliseconds(33);
+    }
+
+    // A sample far off the line starts a new fit from it
+    TNT_CHECK(estimator.AddSample(time, 60.0, 1.0));
+    TNT_CHECK_NEAR(estimator.Predict(time).position, 60.0, 1e-6);
+    TNT_CHECK_NEAR(estimator.Predict(time + std::chrono::milliseconds(500)).position, 60.5, 0.01);
+
+    // Small deviations are averaged out instead
+    time += std::chrono::milliseconds(33);
+    TNT_CHECK(!estimator.AddSample(time, 60.033 + PositionEstimator::JUMP_THRESHOLD / 2.0, 1.0));
+
+    estimator.Reset();
+    TNT_CHECK(!estimator.HasSamples());
+}
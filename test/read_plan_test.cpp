@@ -0,0 +1,76 @@
+#include "test.h"
+
+#include "read_plan.h"
+
+#include <cstdint>
+
+using namespace tnt;
+
+TNT_TEST_CASE(read_plan_merges_nearby_fields)
+{
+    ReadPlan plan;
+
+    // Added out of order, the plan sorts them by address
+    const std::size_t far = plan.AddField(0x2000, 4);
+    const std::size_t second = plan.AddField(0x1010, 4);
+    const std::size_t first = plan.AddField(0x1000, 4);
+    const std::size_t overlapping = plan.AddField(0x1002, 4);
+    plan.Build();
+
+    // The gap between the first two is fetched along with them, the far field gets its own region
+    TNT_CHECK(plan.GetRegions().size() == 2);
+    TNT_CHECK(plan.GetRegions()[0].address == 0x1000);
+    TNT_CHECK(plan.GetRegions()[0].size == 0x14);
+    TNT_CHECK(plan.GetRegions()[1].address == 0x2000);
+    TNT_CHECK(plan.GetRegions()[1].size == 4);
+    TNT_CHECK(plan.GetBufferSize() == 0x18);
+
+    // Fill the buffer as a read would, every byte holds the low byte of its address
+    for (const ReadPlan::Region& region : plan.GetRegions())
+    {
+        for (std::size_t i = 0; i < region.size; i++)
+        {
+            plan.GetBuffer()[region.buffer_offset + i] = static_cast<std::byte>(region.address + i);
+        }
+    }
+
+    TNT_CHECK(plan.Get<std::uint8_t>(first) == 0x00);
+    TNT_CHECK(plan.Get<std::uint8_t>(overlapping) == 0x02);
+    TNT_CHECK(plan.Get<std::uint8_t>(second) == 0x10);
+    TNT_CHECK(plan.Get<std::uint8_t>(far) == 0x00);
+}
+
+TNT_TEST_CASE(read_plan_splits_distant_and_oversized_regions)
+{
+    ReadPlan plan;
+
+    // Just past the gap limit
+    plan.AddField(0x1000, 4);
+    plan.AddField(0x1004 + ReadPlan::MAX_REGION_GAP + 1, 4);
+
+    // Each within the gap of the one before but together larger than a region may be
+    for (std::uintptr_t address = 0x3000; address < 0x3000 + ReadPlan::MAX_REGION_SIZE; address += ReadPlan::MAX_REGION_GAP)
+    {
+        plan.AddField(address, 4);
+    }
+
+    plan.AddField(0x3000 + ReadPlan::MAX_REGION_SIZE - 4, 4);
+    plan.AddField(0x3000 + ReadPlan::MAX_REGION_SIZE + 4, 4);
+    plan.Build();
+
+    TNT_CHECK(plan.GetRegions().size() == 4);
+    for (const ReadPlan::Region& region : plan.GetRegions())
+    {
+        TNT_CHECK(region.size <= ReadPlan::MAX_REGION_SIZE);
+    }
+
+    TNT_CHECK(plan.GetRegions()[2].address == 0x3000);
+    TNT_CHECK(plan.GetRegions()[2].size == ReadPlan::MAX_REGION_SIZE);
+
+    // Clearing starts over with an empty plan
+    plan.Clear();
+    plan.AddField(0x1000, 4);
+    plan.Build();
+    TNT_CHECK(plan.GetRegions().size() == 1);
+    TNT_CHECK(plan.GetBufferSize() == 4);
+}
@@ -0,0 +1,141 @@
+#include "test.h"
+#include "test_offset_database.h"
+#include "test_zip.h"
+
+#include "guitar_pro.h"
+#include "guitar_pro_layout.h"
+#include "pe_image.h"
+#include "process_reader.h"
+#include "signature_scanner.h"
+#include "synthetic_guitar_pro.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+using namespace tnt;
+using namespace tnt::test;
+
+// mov rax, [rip + disp32]; test rax, rax
+static constexpr RootSignature TEST_ROOT_SIGNATURE = { "48 8B 05 ?? ?? ?? ?? 48 85 C0", 3, 7 };
+
+static constexpr BytePattern::SearchPath SEARCH_PATHS[] = {
+    BytePattern::SearchPath::SCALAR,
+    BytePattern::SearchPath::SSE2,
+    BytePattern::SearchPath::AVX2,
+};
+
+// Unknown to the built-in layouts so it can only be attached to through a signature scan
+static GuitarProLayout GetSignatureLayout()
+{
+    GuitarProLayout layout = GUITAR_PRO_LAYOUTS.back();
+    layout.version = L"9.9.9.999";
+    layout.module_offset = 0x00B31F80;
+    layout.root_signature = TEST_ROOT_SIGNATURE;
+    return layout;
+}
+
+// Checks every search path finds the same first match as the scalar one
+static void CheckSearchPaths(const BytePattern& pattern, const std::byte* data, const std::size_t size)
+{
+    const std::size_t expected = pattern.Find(data, size, BytePattern::SearchPath::SCALAR);
+    for (const BytePattern::SearchPath path : SEARCH_PATHS)
+    {
+        TNT_CHECK(pattern.Find(data, size, path) == expected);
+    }
+
+    TNT_CHECK(pattern.Find(data, size) == expected);
+}
+
+TNT_TEST_CASE(signature_search_paths_agree)
+{
+    // Wildcards at both ends move the anchors away from the first and last byte
+    const BytePattern patterns[] = {
+        BytePattern("48 8B 05 ?? ?? ?? ?? 48 85 C0"),
+        BytePattern("?? 8B ?? 05"),
+        BytePattern("C3"),
+    };
+
+    std::vector<std::byte> data(1024);
+    std::uint32_t state = 0x2545F491;
+    for (std::byte& byte : data)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        byte = static_cast<std::byte>(state);
+    }
+
+    for (const BytePattern& pattern : patterns)
+    {
+        // Plants a match at every offset of the first blocks and the scalar tail, with and without an earlier match
+        for (std::size_t offset = 0; offset + pattern.size() <= 96; offset++)
+        {
+            std::vector<std::byte> planted = data;
+            for (std::size_t i = 0; i < pattern.size(); i++)
+            {
+                if (!pattern.IsWildcard(i))
+                {
+                    planted[offset + i] = static_cast<std::byte>(pattern[i]);
+                }
+            }
+
+            for (std::size_t size = pattern.size(); size <= 96; size++)
+            {
+                CheckSearchPaths(pattern, planted.data(), size);
+                CheckSearchPaths(pattern, planted.data() + 1, size);
+            }
+
+            TNT_CHECK(pattern.Find(planted.data(), offset + pattern.size(), BytePattern::SearchPath::AVX2) <= offset);
+        }
+
+        CheckSearchPaths(pattern, data.data(), data.size());
+    }
+}
+
+TNT_TEST_CASE(signature_scan_finds_root_pointer_across_chunks)
+{
+    const GuitarProLayout layout = GetSignatureLayout();
+    SyntheticGuitarPro synthetic_guitar_pro(layout);
+
+    // The synthetic image puts the signature across the first chunk boundary
+    ProcessReader process_reader(synthetic_guitar_pro.CreateMemorySource());
+    TNT_CHECK(process_reader.FindRipRelativeTarget(BytePattern(TEST_ROOT_SIGNATURE.pattern), TEST_ROOT_SIGNATURE.displacement_offset, TEST_ROOT_SIGNATURE.instruction_size) == layout.module_offset);
+
+    // Every path agrees on the whole code section and on the bytes either side of the boundary
+    const auto memory_source = synthetic_guitar_pro.CreateMemorySource();
+    PeImage image;
+    TNT_CHECK(ReadPeImage(*memory_source, memory_source->GetModuleBaseAddress(), image));
+    TNT_CHECK(image.sections.size() == 1 && image.sections[0].executable);
+
+    std::vector<std::byte> code(image.sections[0].virtual_size);
+    TNT_CHECK(memory_source->Read(memory_source->GetModuleBaseAddress() + image.sections[0].virtual_address, code.data(), code.size()));
+
+    const BytePattern pattern(TEST_ROOT_SIGNATURE.pattern);
+    const std::size_t offset = pattern.Find(code.data(), code.size(), BytePattern::SearchPath::SCALAR);
+    TNT_CHECK(offset < SIGNATURE_SCAN_CHUNK_SIZE && offset + pattern.size() > SIGNATURE_SCAN_CHUNK_SIZE);
+    CheckSearchPaths(pattern, code.data(), code.size());
+    CheckSearchPaths(pattern, code.data(), SIGNATURE_SCAN_CHUNK_SIZE);
+    CheckSearchPaths(pattern, code.data() + SIGNATURE_SCAN_CHUNK_SIZE, code.size() - SIGNATURE_SCAN_CHUNK_SIZE);
+}
+
+TNT_TEST_CASE(guitar_pro_attaches_through_root_signature)
+{
+    const GuitarProLayout layout = GetSignatureLayout();
+    SyntheticGuitarPro synthetic_guitar_pro(layout);
+    synthetic_guitar_pro.SetPlayPosition(7.5);
+
+    // Only the template entry has the signature, its root pointer is somewhere else
+    TemporaryFile file("tnt_signature_scanner_test.txt");
+    TemporaryFile cache_file("tnt_signature_scanner_test.txt.cache.txt");
+    std::ofstream(file.GetPath(), std::ios::binary) << FormatOffsetDatabaseEntry("9.0.0.1", 0x00A26F80, 0, TEST_ROOT_SIGNATURE);
+
+    GuitarPro guitar_pro(synthetic_guitar_pro.GetMemorySourceFactory());
+    guitar_pro.SetOffsetDatabasePath(file.GetPath());
+    TNT_CHECK_NEAR(guitar_pro.ReadProcessMemory().play_position, 7.5, 1e-4);
+
+    // The scan result is cached for this build
+    std::ifstream cache(cache_file.GetPath());
+    TNT_CHECK(cache.good());
+}
@@ -0,0 +1,151 @@
+#include "test.h"
+
+#include "tempo_map.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace tnt;
+
+// Far below anything audible, only leaves room for floating point error
+static constexpr double TIME_TOLERANCE = 1e-9; // Seconds
+
+static void CheckRoundTrip(const TempoMap& map, const double end_time)
+{
+    for (double time = 0.0; time < end_time; time += 0.01)
+    {
+        TNT_CHECK_NEAR(map.BeatToTime(map.TimeToBeat(time)), time, TIME_TOLERANCE);
+    }
+}
+
+TNT_TEST_CASE(tempo_map_constant_segments_round_trip)
+{
+    const std::vector<TempoMarker> markers = {
+        { 0.0, 120.0, 4, 4, false },
+        { 4.0, 60.0, 0, 0, false },
+    };
+    const TempoMap map = TempoMap::FromMarkers(markers);
+
+    TNT_CHECK_NEAR(map.TimeToBeat(2.0), 4.0, TIME_TOLERANCE);
+    TNT_CHECK_NEAR(map.TimeToBeat(4.0), 8.0, TIME_TOLERANCE);
+    TNT_CHECK_NEAR(map.TimeToBeat(6.0), 10.0, TIME_TOLERANCE);
+    TNT_CHECK_NEAR(map.BeatToTime(10.0), 6.0, TIME_TOLERANCE);
+    TNT_CHECK_NEAR(map.GetTempo(9.0), 60.0, TIME_TOLERANCE);
+    CheckRoundTrip(map, 20.0);
+}
+
+TNT_TEST_CASE(tempo_map_linear_segment_round_trip)
+{
+    // Tempo ramps linearly in beats, so a ramp from 60 to 120 bpm over 10 s spans 10 / ln 2 beats
+    const std::vector<TempoMarker> markers = {
+        { 0.0, 60.0, 4, 4, true },
+        { 10.0, 120.0, 0, 0, false },
+    };
+    const TempoMap map = TempoMap::FromMarkers(markers);
+
+    const double ramp_beats = 10.0 / std::log(2.0);
+    TNT_CHECK_NEAR(map.TimeToBeat(10.0), ramp_beats, 1e-6);
+    TNT_CHECK_NEAR(map.GetTempo(0.0), 60.0, 1e-6);
+    TNT_CHECK_NEAR(map.GetTempo(ramp_beats / 2.0), 90.0, 1e-6);
+    TNT_CHECK_NEAR(map.GetTempo(ramp_beats), 120.0, 1e-6);
+    CheckRoundTrip(map, 20.0);
+
+    // The same ramp built from Guitar Pro's bars lines up with REAPER's
+    const std::vector<TimeSignature> bars(8);
+    const std::vector<BarTempo> tempos = {
+        { 0, 0.0, 60.0, true },
+        { 2, 0.0, 120.0, false },
+    };
+    const TempoMap bar_map = TempoMap::FromBars(bars, tempos);
+    const std::vector<TempoMarker> bar_markers = {
+        { 0.0, 60.0, 4, 4, true },
+        { bar_map.GetBarTime(2), 120.0, 0, 0, false },
+    };
+    TNT_CHECK(DiffTempoMaps(bar_map, TempoMap::FromMarkers(bar_markers), 0.001).empty());
+    CheckRoundTrip(bar_map, 20.0);
+}
+
+TNT_TEST_CASE(tempo_map_first_marker_after_project_start)
+{
+    // REAPER plays the first marker's tempo before it, so the marker at 2 s starts the second bar
+    const std::vector<TempoMarker> markers = {
+        { 2.0, 120.0, 3, 4, false },
+        { 5.0, 60.0, 0, 0, false },
+    };
+    const TempoMap map = TempoMap::FromMarkers(markers);
+
+    TNT_CHECK_NEAR(map.TimeToBeat(1.0), 2.0, TIME_TOLERANCE);
+    TNT_CHECK_NEAR(map.BeatToTime(4.0), 2.0, TIME_TOLERANCE);
+    TNT_CHECK_NEAR(map.GetBarTime(1), 2.0, TIME_TOLERANCE);
+    TNT_CHECK_NEAR(map.GetBarTime(2), 3.5, TIME_TOLERANCE);
+    TNT_CHECK(map.GetTimeSignature(0) == TimeSignature{});
+    TNT_CHECK(map.GetTimeSignature(1) == (TimeSignature{ 3, 4 }));
+    TNT_CHECK_NEAR(map.TimeToBeat(7.0), 12.0, TIME_TOLERANCE);
+    CheckRoundTrip(map, 20.0);
+}
+
+TNT_TEST_CASE(tempo_map_time_signature_changes)
+{
+    const std::vector<TimeSignature> bars = { { 4, 4 }, { 4, 4 }, { 3, 4 }, { 6, 8 }, { 4, 4 } };
+    const std::vector<BarTempo> tempos = { { 0, 0.0, 120.0, false } };
+    const TempoMap map = TempoMap::FromBars(bars, tempos);
+
+    TNT_CHECK(map.GetBarCount() == 5);
+    TNT_CHECK_NEAR(map.GetBarBeat(2), 8.0, TIME_TOLERANCE);
+    TNT_CHECK_NEAR(map.GetBarBeat(3), 11.0, TIME_TOLERANCE);
+    TNT_CHECK_NEAR(map.GetBarBeat(4), 14.0, TIME_TOLERANCE);
+    TNT_CHECK(map.GetTimeSignature(2) == (TimeSignature{ 3, 4 }));
+    TNT_CHECK(map.GetTimeSignature(3) == (TimeSignature{ 6, 8 }));
+
+    // Bars after the last one repeat its time signature
+    TNT_CHECK_NEAR(map.GetBarBeat(6), 22.0, TIME_TOLERANCE);
+    TNT_CHECK(map.GetTimeSignature(7) == (TimeSignature{ 4, 4 }));
+
+    // REAPER's markers for the same changes describe the same bars
+    const std::vector<TempoMarker> markers = {
+        { 0.0, 120.0, 4, 4, false },
+        { map.GetBarTime(2), 120.0, 3, 4, false },
+        { map.GetBarTime(3), 120.0, 6, 8, false },
+        { map.GetBarTime(4), 120.0, 4, 4, false },
+    };
+    const TempoMap marker_map = TempoMap::FromMarkers(markers);
+    TNT_CHECK(marker_map.GetBarCount() == 5);
+    TNT_CHECK(DiffTempoMaps(map, marker_map, 0.001).empty());
+}
+
+TNT_TEST_CASE(tempo_map_diff_reports_shifted_bars)
+{
+    // 8 bars of 4/4 at 120 bpm, 2 s each
+    const std::vector<TimeSignature> bars(8);
+    const std::vector<BarTempo> tempos = { { 0, 0.0, 120.0, false } };
+    const TempoMap expected = TempoMap::FromBars(bars, tempos);
+
+    // Bar 4 is played at half speed, everything after it starts 2 s late
+    const std::vector<TempoMarker> markers = {
+        { 0.0, 120.0, 4, 4, false },
+        { 8.0, 60.0, 0, 0, false },
+        { 12.0, 120.0, 0, 0, false },
+    };
+    const TempoMap actual = TempoMap::FromMarkers(markers);
+
+    const std::vector<TempoMapMismatch> mismatches = DiffTempoMaps(expected, actual, 0.001);
+    TNT_CHECK(mismatches.size() == 4);
+    for (std::size_t i = 0; i < mismatches.size(); i++)
+    {
+        TNT_CHECK(mismatches[i].bar == 4 + static_cast<int>(i));
+    }
+
+    TNT_CHECK_NEAR(mismatches[0].expected_start_time, 8.0, TIME_TOLERANCE);
+    TNT_CHECK_NEAR(mismatches[0].expected_end_time, 10.0, TIME_TOLERANCE);
+    TNT_CHECK_NEAR(mismatches[0].actual_start_time, 8.0, TIME_TOLERANCE);
+    TNT_CHECK_NEAR(mismatches[0].actual_end_time, 12.0, TIME_TOLERANCE);
+    TNT_CHECK_NEAR(mismatches[0].actual_bpm, 60.0, TIME_TOLERANCE);
+    TNT_CHECK_NEAR(mismatches[1].actual_start_time, 12.0, TIME_TOLERANCE);
+
+    // Differences within the tolerance are not reported
+    const std::vector<TempoMarker> close_markers = {
+        { 0.0, 120.0, 4, 4, false },
+        { 8.0, 119.99, 0, 0, false },
+    };
+    TNT_CHECK(DiffTempoMaps(expected, TempoMap::FromMarkers(close_markers), 0.05).empty());
+}
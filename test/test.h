@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cmath>
+#include <format>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace tnt::test {
+
+struct TestCase final
+{
+    const char* name = "";
+    void (*function)() = nullptr;
+};
+
+// Every TNT_TEST_CASE in the executable, run in registration order by test_main.cpp
+std::vector<TestCase>& GetTestCases();
+
+struct TestRegistration final
+{
+    TestRegistration(const char* name, void (*function)())
+    {
+        GetTestCases().push_back({ name, function });
+    }
+};
+
+// Thrown by the checks below, ends the current test case
+class TestFailure final : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+}
+
+#define TNT_TEST_CASE(name) \
+    static void name(); \
+    static const ::tnt::test::TestRegistration name##_registration(#name, name); \
+    static void name()
+
+#define TNT_CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            throw ::tnt::test::TestFailure(std::format("{}:{}: {} is false", __FILE__, __LINE__, #condition)); \
+        } \
+    } while (false)
+
+#define TNT_CHECK_NEAR(actual, expected, tolerance) \
+    do \
+    { \
+        const double tnt_actual = (actual); \
+        const double tnt_expected = (expected); \
+        if (!(std::fabs(tnt_actual - tnt_expected) <= (tolerance))) \
+        { \
+            throw ::tnt::test::TestFailure(std::format("{}:{}: {} is {}, expected {}", __FILE__, __LINE__, #actual, tnt_actual, tnt_expected)); \
+        } \
+    } while (false)
+
+#define TNT_CHECK_THROWS(expression) \
+    do \
+    { \
+        bool tnt_threw = false; \
+        try \
+        { \
+            (void)(expression); \
+        } \
+        catch (const std::runtime_error&) \
+        { \
+            tnt_threw = true; \
+        } \
+        if (!tnt_threw) \
+        { \
+            throw ::tnt::test::TestFailure(std::format("{}:{}: {} did not throw", __FILE__, __LINE__, #expression)); \
+        } \
+    } while (false)
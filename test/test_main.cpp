@@ -0,0 +1,51 @@
+// Only defines the REAPER API function pointers reaper.cpp links against, they stay null since the tests run on SimulatedReaper
+#define REAPERAPI_IMPLEMENT
+
+#include "test.h"
+
+#include <WDL/wdltypes.h> // Must be included before reaper_plugin_functions
+#include <reaper_plugin_functions.h>
+
+#include <cstring>
+#include <exception>
+#include <iostream>
+
+namespace tnt::test {
+
+std::vector<TestCase>& GetTestCases()
+{
+    static std::vector<TestCase> test_cases;
+    return test_cases;
+}
+
+}
+
+// Runs every test case, or only the ones whose name contains the first argument
+int main(int argc, char* argv[])
+{
+    const char* filter = argc > 1 ? argv[1] : "";
+
+    int run = 0;
+    int failed = 0;
+    for (const tnt::test::TestCase& test_case : tnt::test::GetTestCases())
+    {
+        if (!std::strstr(test_case.name, filter))
+        {
+            continue;
+        }
+
+        run++;
+        try
+        {
+            test_case.function();
+        }
+        catch (const std::exception& error)
+        {
+            failed++;
+            std::cerr << std::format("FAILED {}\n  {}\n", test_case.name, error.what());
+        }
+    }
+
+    std::cout << std::format("{} of {} test cases passed.\n", run - failed, run);
+    return failed == 0 && run > 0 ? 0 : 1;
+}
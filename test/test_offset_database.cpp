@@ -0,0 +1,37 @@
+#include "test_offset_database.h"
+
+#include <format>
+
+namespace tnt::test {
+
+std::string FormatOffsetDatabaseEntry(const std::string& version, const std::uintptr_t module_offset, const std::uint64_t module_hash, const RootSignature& root_signature)
+{
+    std::string text = std::format("version {}\n", version);
+    if (module_hash)
+    {
+        text += std::format("module_hash {:X}\n", module_hash);
+    }
+
+    if (root_signature.pattern)
+    {
+        text += std::format("root_signature {} {} {}\n", root_signature.displacement_offset, root_signature.instruction_size, root_signature.pattern);
+    }
+
+    text += std::format("module_offset {:#x} # Trailing comment\n", module_offset);
+    text += "document_chain 0x18 0xA0 0x38\n";
+
+    for (const GuitarProField& field : GUITAR_PRO_8_FIELDS)
+    {
+        text += field.name;
+        for (const std::uintptr_t offset : field.pointer_chain)
+        {
+            text += std::format(" {:#x}", offset);
+        }
+
+        text += '\n';
+    }
+
+    return text;
+}
+
+}
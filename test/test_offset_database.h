@@ -0,0 +1,13 @@
+#pragma once
+
+#include "guitar_pro_layout.h"
+
+#include <cstdint>
+#include <string>
+
+namespace tnt::test {
+
+// Offset database entry with the chains of the built-in layouts, see offset_database.h
+std::string FormatOffsetDatabaseEntry(const std::string& version, const std::uintptr_t module_offset, const std::uint64_t module_hash = 0, const RootSignature& root_signature = {});
+
+}
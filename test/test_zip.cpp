@@ -0,0 +1,140 @@
+#include "test_zip.h"
+
+#include <WDL/zlib/zlib.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+
+namespace tnt::test {
+
+static constexpr std::uint16_t METHOD_STORED = 0;
+static constexpr std::uint16_t METHOD_DEFLATED = 8;
+static constexpr std::uint16_t ZIP_VERSION = 20;
+
+template <typename T>
+static void AppendValue(std::string& data, const T value)
+{
+    for (std::size_t i = 0; i < sizeof(T); i++)
+    {
+        data.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+// Raw deflate stream without a zlib header, the way zip entries store it
+static std::string Deflate(const std::string& data)
+{
+    z_stream stream = {};
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        throw std::runtime_error("Failed to initialize deflate.\n");
+    }
+
+    std::string compressed(deflateBound(&stream, static_cast<uLong>(data.size())), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(compressed.data());
+    stream.avail_out = static_cast<uInt>(compressed.size());
+
+    const int result = deflate(&stream, Z_FINISH);
+    compressed.resize(stream.total_out);
+    deflateEnd(&stream);
+
+    if (result != Z_STREAM_END)
+    {
+        throw std::runtime_error("Failed to deflate test data.\n");
+    }
+
+    return compressed;
+}
+
+TemporaryFile::TemporaryFile(const std::string& name)
+    : m_path(std::filesystem::temp_directory_path() / name)
+{}
+
+TemporaryFile::~TemporaryFile()
+{
+    std::error_code error;
+    std::filesystem::remove(m_path, error);
+}
+
+const std::filesystem::path& TemporaryFile::GetPath() const
+{
+    return m_path;
+}
+
+void WriteTestZip(const std::filesystem::path& path, const std::vector<TestZipEntry>& entries)
+{
+    std::string archive;
+    std::string directory;
+
+    for (const TestZipEntry& entry : entries)
+    {
+        std::string compressed = entry.deflate ? Deflate(entry.data) : entry.data;
+        compressed.resize(compressed.size() - std::min(entry.truncate, compressed.size()));
+        const auto compressed_size = static_cast<std::uint32_t>(compressed.size());
+
+        const auto crc = static_cast<std::uint32_t>(crc32(0, reinterpret_cast<const Bytef*>(entry.data.data()), static_cast<uInt>(entry.data.size())));
+        const std::uint16_t method = entry.deflate ? METHOD_DEFLATED : METHOD_STORED;
+        const auto local_header_offset = static_cast<std::uint32_t>(archive.size());
+
+        AppendValue<std::uint32_t>(archive, 0x04034B50);
+        AppendValue<std::uint16_t>(archive, ZIP_VERSION);
+        AppendValue<std::uint16_t>(archive, 0);
+        AppendValue<std::uint16_t>(archive, method);
+        AppendValue<std::uint32_t>(archive, 0);
+        AppendValue<std::uint32_t>(archive, crc);
+        AppendValue<std::uint32_t>(archive, compressed_size);
+        AppendValue<std::uint32_t>(archive, static_cast<std::uint32_t>(entry.data.size()));
+        AppendValue<std::uint16_t>(archive, static_cast<std::uint16_t>(entry.name.size()));
+        AppendValue<std::uint16_t>(archive, 0);
+        archive += entry.name;
+        archive += compressed;
+
+        AppendValue<std::uint32_t>(directory, 0x02014B50);
+        AppendValue<std::uint16_t>(directory, ZIP_VERSION);
+        AppendValue<std::uint16_t>(directory, ZIP_VERSION);
+        AppendValue<std::uint16_t>(directory, 0);
+        AppendValue<std::uint16_t>(directory, method);
+        AppendValue<std::uint32_t>(directory, 0);
+        AppendValue<std::uint32_t>(directory, crc);
+        AppendValue<std::uint32_t>(directory, compressed_size);
+        AppendValue<std::uint32_t>(directory, static_cast<std::uint32_t>(entry.data.size()));
+        AppendValue<std::uint16_t>(directory, static_cast<std::uint16_t>(entry.name.size()));
+        AppendValue<std::uint16_t>(directory, 0);
+        AppendValue<std::uint16_t>(directory, 0);
+        AppendValue<std::uint16_t>(directory, 0);
+        AppendValue<std::uint16_t>(directory, 0);
+        AppendValue<std::uint32_t>(directory, 0);
+        AppendValue<std::uint32_t>(directory, local_header_offset);
+        directory += entry.name;
+    }
+
+    const auto directory_offset = static_cast<std::uint32_t>(archive.size());
+    archive += directory;
+
+    AppendValue<std::uint32_t>(archive, 0x06054B50);
+    AppendValue<std::uint16_t>(archive, 0);
+    AppendValue<std::uint16_t>(archive, 0);
+    AppendValue<std::uint16_t>(archive, static_cast<std::uint16_t>(entries.size()));
+    AppendValue<std::uint16_t>(archive, static_cast<std::uint16_t>(entries.size()));
+    AppendValue<std::uint32_t>(archive, static_cast<std::uint32_t>(directory.size()));
+    AppendValue<std::uint32_t>(archive, directory_offset);
+    AppendValue<std::uint16_t>(archive, 0);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(archive.data(), static_cast<std::streamsize>(archive.size()));
+    if (!file)
+    {
+        throw std::runtime_error(std::format("Failed to write '{}'.\n", path.string()));
+    }
+}
+
+void WriteTestGuitarProFile(const std::filesystem::path& path, const std::string& gpif)
+{
+    WriteTestZip(path, { { "Content/score.gpif", gpif } });
+}
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace tnt::test {
+
+struct TestZipEntry final
+{
+    std::string name;
+    std::string data;
+
+    // Deflated if true, stored otherwise
+    bool deflate = true;
+
+    // Drops this many bytes off the end of the compressed data, as if the stream had been cut off while writing
+    std::size_t truncate = 0;
+};
+
+// A file in the temporary directory that is deleted again with this object
+class TemporaryFile final
+{
+public:
+    explicit TemporaryFile(const std::string& name);
+    ~TemporaryFile();
+
+    TemporaryFile(const TemporaryFile&) = delete;
+    TemporaryFile& operator=(const TemporaryFile&) = delete;
+
+    const std::filesystem::path& GetPath() const;
+
+private:
+    std::filesystem::path m_path;
+};
+
+// Writes a zip archive the way Guitar Pro does, a local header and data per entry followed by the central directory
+void WriteTestZip(const std::filesystem::path& path, const std::vector<TestZipEntry>& entries);
+
+// A .gp file holding only Content/score.gpif
+void WriteTestGuitarProFile(const std::filesystem::path& path, const std::string& gpif);
+
+}
@@ -0,0 +1,246 @@
+#include "test.h"
+#include "test_zip.h"
+
+#include "plugin.h"
+#include "simulated_reaper.h"
+#include "synthetic_guitar_pro.h"
+#include "trace_format.h"
+#include "trace_replayer.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <limits>
+#include <span>
+#include <vector>
+
+using namespace tnt;
+using namespace tnt::test;
+
+// Doubles have to come back bit for bit, not only close
+static bool SameBits(const double a, const double b)
+{
+    return std::bit_cast<std::uint64_t>(a) == std::bit_cast<std::uint64_t>(b);
+}
+
+static std::vector<ReaperState> MakeReaperStates()
+{
+    ReaperState first;
+    first.play_position = 1234.5678;
+    first.play_rate = 1.5;
+    first.play_state = ReaperPlayState::PLAYING;
+    first.repeat = true;
+    first.time_selection_start_position = 10.0;
+    first.time_selection_end_position = 20.0;
+    first.preserve_pitch = true;
+
+    // Every field moves back down, so the deltas are negative and go through the zigzag encoding
+    ReaperState second = first;
+    second.play_position = -0.25;
+    second.play_rate = 0.5;
+    second.play_state = ReaperPlayState::STOPPED;
+    second.repeat = false;
+    second.time_selection_start_position = -std::numeric_limits<double>::max();
+    second.time_selection_end_position = std::numeric_limits<double>::denorm_min();
+
+    // Unchanged apart from one field
+    ReaperState third = second;
+    third.play_position = 1e300;
+
+    return { first, second, second, third };
+}
+
+static bool SameReaperState(const ReaperState& a, const ReaperState& b)
+{
+    return SameBits(a.play_position, b.play_position)
+        && SameBits(a.play_rate, b.play_rate)
+        && a.play_state == b.play_state
+        && a.repeat == b.repeat
+        && SameBits(a.time_selection_start_position, b.time_selection_start_position)
+        && SameBits(a.time_selection_end_position, b.time_selection_end_position)
+        && a.preserve_pitch == b.preserve_pitch;
+}
+
+// Header and one of every record type, times going forward by a different amount each time
+static std::vector<std::byte> EncodeTestTrace(std::vector<std::size_t>& record_ends)
+{
+    const auto start = TraceEncoder::Clock::time_point() + std::chrono::hours(1);
+    TraceEncoder encoder(start);
+
+    std::vector<std::byte> buffer;
+    TraceEncoder::EncodeHeader(buffer);
+    record_ends.push_back(buffer.size());
+
+    encoder.EncodeExtState(buffer, start, "trace_path", "C:/traces/session.tnttrace");
+    record_ends.push_back(buffer.size());
+
+    auto time = start;
+    for (const ReaperState& state : MakeReaperStates())
+    {
+        time += std::chrono::microseconds(33333);
+        encoder.EncodeTick(buffer, time, state, 0.0125);
+        record_ends.push_back(buffer.size());
+    }
+
+    GuitarProState guitar_pro_state;
+    guitar_pro_state.play_position = 42.125;
+    guitar_pro_state.time_selection_start_position = 40.0;
+    guitar_pro_state.time_selection_end_position = 48.0;
+    guitar_pro_state.play_rate = 0.75;
+    guitar_pro_state.play_state = true;
+    guitar_pro_state.count_in_state = true;
+    guitar_pro_state.loop_state = true;
+    guitar_pro_state.timestamp = time - std::chrono::milliseconds(5);
+    encoder.EncodeGuitarProState(buffer, time, guitar_pro_state);
+    record_ends.push_back(buffer.size());
+
+    guitar_pro_state.play_position = 1.0;
+    guitar_pro_state.count_in_state = false;
+    encoder.EncodeGuitarProState(buffer, time, guitar_pro_state);
+    record_ends.push_back(buffer.size());
+
+    time += std::chrono::seconds(5);
+    encoder.EncodeGuitarProReadFailed(buffer, time);
+    record_ends.push_back(buffer.size());
+
+    encoder.EncodeReaperCommand(buffer, time, { ReaperCommandType::TIME_SELECTION, 40.0, 48.0, 0 });
+    record_ends.push_back(buffer.size());
+
+    return buffer;
+}
+
+TNT_TEST_CASE(trace_records_round_trip)
+{
+    std::vector<std::size_t> record_ends;
+    const std::vector<std::byte> buffer = EncodeTestTrace(record_ends);
+
+    // A tick identical to the previous one is only its type, time and an empty field mask
+    TNT_CHECK(record_ends[4] - record_ends[3] <= 6);
+
+    TraceDecoder decoder(buffer);
+    TraceRecord record;
+
+    TNT_CHECK(decoder.Next(record));
+    TNT_CHECK(record.type == TraceRecordType::EXT_STATE);
+    TNT_CHECK(record.time == std::chrono::nanoseconds::zero());
+    TNT_CHECK(record.key == "trace_path");
+    TNT_CHECK(record.value == "C:/traces/session.tnttrace");
+
+    std::chrono::nanoseconds time = std::chrono::nanoseconds::zero();
+    for (const ReaperState& state : MakeReaperStates())
+    {
+        time += std::chrono::microseconds(33333);
+        TNT_CHECK(decoder.Next(record));
+        TNT_CHECK(record.type == TraceRecordType::TICK);
+        TNT_CHECK(record.time == time);
+        TNT_CHECK(SameReaperState(record.reaper_state, state));
+        TNT_CHECK(SameBits(record.output_latency, 0.0125));
+    }
+
+    TNT_CHECK(decoder.Next(record));
+    TNT_CHECK(record.type == TraceRecordType::GUITAR_PRO_STATE);
+    TNT_CHECK(SameBits(record.guitar_pro_state.play_position, 42.125));
+    TNT_CHECK(SameBits(record.guitar_pro_state.play_rate, 0.75));
+    TNT_CHECK(record.guitar_pro_state.count_in_state && record.guitar_pro_state.loop_state && record.guitar_pro_state.play_state);
+    TNT_CHECK(record.guitar_pro_state.timestamp.time_since_epoch() == time - std::chrono::milliseconds(5));
+
+    TNT_CHECK(decoder.Next(record));
+    TNT_CHECK(SameBits(record.guitar_pro_state.play_position, 1.0));
+    TNT_CHECK(SameBits(record.guitar_pro_state.time_selection_end_position, 48.0));
+    TNT_CHECK(!record.guitar_pro_state.count_in_state && record.guitar_pro_state.loop_state);
+
+    TNT_CHECK(decoder.Next(record));
+    TNT_CHECK(record.type == TraceRecordType::GUITAR_PRO_READ_FAILED);
+    TNT_CHECK(record.time == time + std::chrono::seconds(5));
+
+    TNT_CHECK(decoder.Next(record));
+    TNT_CHECK(record.type == TraceRecordType::REAPER_COMMAND);
+    TNT_CHECK(record.command.type == ReaperCommandType::TIME_SELECTION);
+    TNT_CHECK(SameBits(record.command.value, 40.0) && SameBits(record.command.end_value, 48.0));
+
+    TNT_CHECK(!decoder.Next(record));
+    TNT_CHECK(!decoder.IsTruncated());
+}
+
+TNT_TEST_CASE(trace_decoder_detects_truncated_tail)
+{
+    std::vector<std::size_t> record_ends;
+    const std::vector<std::byte> buffer = EncodeTestTrace(record_ends);
+
+    // Cut anywhere inside the last records, everything before the cut still decodes
+    for (std::size_t size = record_ends[record_ends.size() - 4] + 1; size < buffer.size(); size++)
+    {
+        TraceDecoder decoder(std::span<const std::byte>(buffer).first(size));
+        TraceRecord record;
+
+        std::size_t decoded = 0;
+        while (decoder.Next(record))
+        {
+            decoded++;
+        }
+
+        const bool at_record_end = std::find(record_ends.begin(), record_ends.end(), size) != record_ends.end();
+        TNT_CHECK(decoder.IsTruncated() == !at_record_end);
+        TNT_CHECK(decoded + 1 == static_cast<std::size_t>(std::upper_bound(record_ends.begin(), record_ends.end(), size) - record_ends.begin()));
+    }
+
+    // Not a trace at all
+    TNT_CHECK_THROWS(TraceDecoder(std::span<const std::byte>(buffer).first(4)));
+    std::vector<std::byte> wrong_magic = buffer;
+    wrong_magic[0] = std::byte('X');
+    TNT_CHECK_THROWS(TraceDecoder(wrong_magic));
+}
+
+TNT_TEST_CASE(trace_replay_matches_recording)
+{
+    const TemporaryFile file("tnt_test_session.tnttrace");
+    const auto tick = [](const double seconds) {
+        return std::chrono::duration_cast<SimulatedReaper::Clock::duration>(std::chrono::duration<double>(seconds));
+    };
+
+    std::size_t recorded_ticks = 0;
+    {
+        SyntheticGuitarPro guitar_pro;
+        SimulatedReaper reaper;
+        reaper.SetSeekLatency(0.05);
+        reaper.SetExtState(EXT_STATE_SECTION, TRACE_PATH_KEY, file.GetPath().string());
+
+        PluginState plugin_state;
+        Plugin plugin(plugin_state, guitar_pro.GetMemorySourceFactory(), reaper.CreateBackend());
+        plugin.Start();
+
+        double position = 5.0;
+        double play_rate = 1.0;
+        guitar_pro.SetPlayRate(play_rate);
+        guitar_pro.SetPlayPosition(position);
+        guitar_pro.SetPlayState(true);
+
+        for (int i = 0; i < 600; i++)
+        {
+            // Twice the speed, then a 0.5 s UI freeze while playing, then a click elsewhere
+            if (i == 200)
+            {
+                play_rate = 2.0;
+                guitar_pro.SetPlayRate(play_rate);
+            }
+
+            const double interval = i == 300 ? 0.5 : 1.0 / 30.0;
+            position = i == 400 ? 80.0 : position + interval * play_rate;
+            guitar_pro.SetPlayPosition(position);
+
+            reaper.Advance(tick(interval));
+            plugin.MainLoop();
+            recorded_ticks++;
+        }
+
+        plugin.Stop();
+    }
+
+    const TraceReplayResult result = TraceReplayer(file.GetPath()).Run();
+    TNT_CHECK(result.tick_count == recorded_ticks);
+    TNT_CHECK(result.recorded_command_count > 0);
+    TNT_CHECK(result.replayed_command_count == result.recorded_command_count);
+    TNT_CHECK(result.divergences.empty());
+    TNT_CHECK(!result.truncated);
+}
@@ -0,0 +1,92 @@
+#include "test.h"
+#include "test_zip.h"
+
+#include "zip_archive.h"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+using namespace tnt;
+using namespace tnt::test;
+
+// Text that deflate can't shrink much, so cutting off the end of the stream loses data
+static std::string MakeTestData(const std::size_t size)
+{
+    std::string data;
+    data.reserve(size);
+
+    std::uint32_t state = 12345;
+    while (data.size() < size)
+    {
+        state = state * 1664525 + 1013904223;
+        data.push_back(static_cast<char>('a' + (state >> 24) % 26));
+    }
+
+    return data;
+}
+
+static std::string ReadAll(const ZipArchive& archive, const std::string_view name, int& chunk_count)
+{
+    std::string data;
+    chunk_count = 0;
+    archive.ReadEntry(name, [&](const std::string_view chunk) {
+        data.append(chunk);
+        chunk_count++;
+    });
+
+    return data;
+}
+
+TNT_TEST_CASE(zip_archive_reads_stored_entry)
+{
+    const TemporaryFile file("tnt_test_stored.zip");
+    WriteTestZip(file.GetPath(), { { "first.txt", "first entry", true }, { "second.txt", "stored entry", false } });
+
+    const ZipArchive archive(file.GetPath());
+    TNT_CHECK(archive.Contains("second.txt"));
+    TNT_CHECK(!archive.Contains("third.txt"));
+
+    int chunk_count = 0;
+    TNT_CHECK(ReadAll(archive, "second.txt", chunk_count) == "stored entry");
+    TNT_CHECK(ReadAll(archive, "first.txt", chunk_count) == "first entry");
+    TNT_CHECK_THROWS(ReadAll(archive, "third.txt", chunk_count));
+}
+
+TNT_TEST_CASE(zip_archive_inflates_in_chunks)
+{
+    const std::string data = MakeTestData(300 * 1024);
+    const TemporaryFile file("tnt_test_deflated.zip");
+    WriteTestZip(file.GetPath(), { { "data.txt", data } });
+
+    const ZipArchive archive(file.GetPath());
+    int chunk_count = 0;
+    TNT_CHECK(ReadAll(archive, "data.txt", chunk_count) == data);
+    TNT_CHECK(chunk_count > 1);
+}
+
+TNT_TEST_CASE(zip_archive_rejects_truncated_deflate)
+{
+    const TemporaryFile file("tnt_test_truncated.zip");
+    TestZipEntry entry = { "data.txt", MakeTestData(100 * 1024) };
+    entry.truncate = 16;
+    WriteTestZip(file.GetPath(), { entry });
+
+    const ZipArchive archive(file.GetPath());
+    int chunk_count = 0;
+    TNT_CHECK_THROWS(ReadAll(archive, "data.txt", chunk_count));
+}
+
+TNT_TEST_CASE(zip_archive_rejects_other_files)
+{
+    const TemporaryFile file("tnt_test_not_a.zip");
+    WriteTestZip(file.GetPath(), {});
+    TNT_CHECK(!ZipArchive(file.GetPath()).Contains("data.txt"));
+
+    {
+        std::ofstream stream(file.GetPath(), std::ios::binary | std::ios::trunc);
+        stream << MakeTestData(1024);
+    }
+
+    TNT_CHECK_THROWS(ZipArchive(file.GetPath()));
+}